@@ -39,6 +39,10 @@ static void rtpp_stats_updatebyname_d_fin(void *pub) {
     fprintf(stderr, "Method rtpp_stats@%p::updatebyname_d (rtpp_stats_updatebyname_d) is invoked after destruction\x0a", pub);
     RTPP_AUTOTRAP();
 }
+static void rtpp_stats_updatehist_fin(void *pub) {
+    fprintf(stderr, "Method rtpp_stats@%p::updatehist (rtpp_stats_updatehist) is invoked after destruction\x0a", pub);
+    RTPP_AUTOTRAP();
+}
 static const struct rtpp_stats_smethods rtpp_stats_smethods_fin = {
     .getidxbyname = (rtpp_stats_getidxbyname_t)&rtpp_stats_getidxbyname_fin,
     .getlvalbyname = (rtpp_stats_getlvalbyname_t)&rtpp_stats_getlvalbyname_fin,
@@ -48,6 +52,7 @@ static const struct rtpp_stats_smethods rtpp_stats_smethods_fin = {
     .updatebyidx = (rtpp_stats_updatebyidx_t)&rtpp_stats_updatebyidx_fin,
     .updatebyname = (rtpp_stats_updatebyname_t)&rtpp_stats_updatebyname_fin,
     .updatebyname_d = (rtpp_stats_updatebyname_d_t)&rtpp_stats_updatebyname_d_fin,
+    .updatehist = (rtpp_stats_updatehist_t)&rtpp_stats_updatehist_fin,
 };
 void rtpp_stats_fin(struct rtpp_stats *pub) {
     RTPP_DBG_ASSERT(pub->smethods->getidxbyname != (rtpp_stats_getidxbyname_t)NULL);
@@ -58,6 +63,7 @@ void rtpp_stats_fin(struct rtpp_stats *pub) {
     RTPP_DBG_ASSERT(pub->smethods->updatebyidx != (rtpp_stats_updatebyidx_t)NULL);
     RTPP_DBG_ASSERT(pub->smethods->updatebyname != (rtpp_stats_updatebyname_t)NULL);
     RTPP_DBG_ASSERT(pub->smethods->updatebyname_d != (rtpp_stats_updatebyname_d_t)NULL);
+    RTPP_DBG_ASSERT(pub->smethods->updatehist != (rtpp_stats_updatehist_t)NULL);
     RTPP_DBG_ASSERT(pub->smethods != &rtpp_stats_smethods_fin &&
       pub->smethods != NULL);
     pub->smethods = &rtpp_stats_smethods_fin;
@@ -92,6 +98,7 @@ rtpp_stats_fintest()
         .updatebyidx = (rtpp_stats_updatebyidx_t)((void *)0x1),
         .updatebyname = (rtpp_stats_updatebyname_t)((void *)0x1),
         .updatebyname_d = (rtpp_stats_updatebyname_d_t)((void *)0x1),
+        .updatehist = (rtpp_stats_updatehist_t)((void *)0x1),
     };
     tp->pub.smethods = &dummy;
     CALL_SMETHOD(tp->pub.rcnt, attach, (rtpp_refcnt_dtor_t)&rtpp_stats_fin,
@@ -105,7 +112,8 @@ rtpp_stats_fintest()
     CALL_TFIN(&tp->pub, updatebyidx);
     CALL_TFIN(&tp->pub, updatebyname);
     CALL_TFIN(&tp->pub, updatebyname_d);
-    assert((_naborts - naborts_s) == 8);
+    CALL_TFIN(&tp->pub, updatehist);
+    assert((_naborts - naborts_s) == 9);
     free(tp);
 }
 const static void *_rtpp_stats_ftp = (void *)&rtpp_stats_fintest;
@@ -0,0 +1,89 @@
+/* Auto-generated by genfincode_stat.sh - DO NOT EDIT! */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#define RTPP_FINCODE
+#include "rtpp_types.h"
+#include "rtpp_debug.h"
+#include "rtpp_tload.h"
+#include "rtpp_tload_fin.h"
+static void rtpp_tload_aggregate_fin(void *pub) {
+    fprintf(stderr, "Method rtpp_tload@%p::aggregate (rtpp_tload_aggregate) is invoked after destruction\x0a", pub);
+    RTPP_AUTOTRAP();
+}
+static void rtpp_tload_get_load_fin(void *pub) {
+    fprintf(stderr, "Method rtpp_tload@%p::get_load (rtpp_tload_get_load) is invoked after destruction\x0a", pub);
+    RTPP_AUTOTRAP();
+}
+static void rtpp_tload_reg_fin(void *pub) {
+    fprintf(stderr, "Method rtpp_tload@%p::reg (rtpp_tload_reg) is invoked after destruction\x0a", pub);
+    RTPP_AUTOTRAP();
+}
+static void rtpp_tload_report_fin(void *pub) {
+    fprintf(stderr, "Method rtpp_tload@%p::report (rtpp_tload_report) is invoked after destruction\x0a", pub);
+    RTPP_AUTOTRAP();
+}
+static void rtpp_tload_unreg_fin(void *pub) {
+    fprintf(stderr, "Method rtpp_tload@%p::unreg (rtpp_tload_unreg) is invoked after destruction\x0a", pub);
+    RTPP_AUTOTRAP();
+}
+static const struct rtpp_tload_smethods rtpp_tload_smethods_fin = {
+    .aggregate = (rtpp_tload_aggregate_t)&rtpp_tload_aggregate_fin,
+    .get_load = (rtpp_tload_get_load_t)&rtpp_tload_get_load_fin,
+    .reg = (rtpp_tload_reg_t)&rtpp_tload_reg_fin,
+    .report = (rtpp_tload_report_t)&rtpp_tload_report_fin,
+    .unreg = (rtpp_tload_unreg_t)&rtpp_tload_unreg_fin,
+};
+void rtpp_tload_fin(struct rtpp_tload *pub) {
+    RTPP_DBG_ASSERT(pub->smethods->aggregate != (rtpp_tload_aggregate_t)NULL);
+    RTPP_DBG_ASSERT(pub->smethods->get_load != (rtpp_tload_get_load_t)NULL);
+    RTPP_DBG_ASSERT(pub->smethods->reg != (rtpp_tload_reg_t)NULL);
+    RTPP_DBG_ASSERT(pub->smethods->report != (rtpp_tload_report_t)NULL);
+    RTPP_DBG_ASSERT(pub->smethods->unreg != (rtpp_tload_unreg_t)NULL);
+    RTPP_DBG_ASSERT(pub->smethods != &rtpp_tload_smethods_fin &&
+      pub->smethods != NULL);
+    pub->smethods = &rtpp_tload_smethods_fin;
+}
+#if defined(RTPP_FINTEST)
+#include <assert.h>
+#include <stddef.h>
+#include "rtpp_mallocs.h"
+#include "rtpp_refcnt.h"
+#include "rtpp_linker_set.h"
+#define CALL_TFIN(pub, fn) ((void (*)(typeof(pub)))((pub)->smethods->fn))(pub)
+
+void
+rtpp_tload_fintest()
+{
+    int naborts_s;
+
+    struct {
+        struct rtpp_tload pub;
+    } *tp;
+
+    naborts_s = _naborts;
+    tp = rtpp_rzmalloc(sizeof(*tp), offsetof(typeof(*tp), pub.rcnt));
+    assert(tp != NULL);
+    assert(tp->pub.rcnt != NULL);
+    static const struct rtpp_tload_smethods dummy = {
+        .aggregate = (rtpp_tload_aggregate_t)((void *)0x1),
+        .get_load = (rtpp_tload_get_load_t)((void *)0x1),
+        .reg = (rtpp_tload_reg_t)((void *)0x1),
+        .report = (rtpp_tload_report_t)((void *)0x1),
+        .unreg = (rtpp_tload_unreg_t)((void *)0x1),
+    };
+    tp->pub.smethods = &dummy;
+    CALL_SMETHOD(tp->pub.rcnt, attach, (rtpp_refcnt_dtor_t)&rtpp_tload_fin,
+      &tp->pub);
+    RTPP_OBJ_DECREF(&(tp->pub));
+    CALL_TFIN(&tp->pub, aggregate);
+    CALL_TFIN(&tp->pub, get_load);
+    CALL_TFIN(&tp->pub, reg);
+    CALL_TFIN(&tp->pub, report);
+    CALL_TFIN(&tp->pub, unreg);
+    assert((_naborts - naborts_s) == 5);
+    free(tp);
+}
+const static void *_rtpp_tload_ftp = (void *)&rtpp_tload_fintest;
+DATA_SET(rtpp_fintests, _rtpp_tload_ftp);
+#endif /* RTPP_FINTEST */
@@ -0,0 +1,18 @@
+/* Auto-generated by genfincode_stat.sh - DO NOT EDIT! */
+#if !defined(_rtpp_tload_fin_h)
+#define _rtpp_tload_fin_h
+#if !defined(RTPP_AUTOTRAP)
+#define RTPP_AUTOTRAP() abort()
+#else
+extern int _naborts;
+#endif
+#if defined(RTPP_DEBUG)
+struct rtpp_tload;
+void rtpp_tload_fin(struct rtpp_tload *);
+#else
+#define rtpp_tload_fin(arg) /* nop */
+#endif
+#if defined(RTPP_FINTEST)
+void rtpp_tload_fintest(void);
+#endif /* RTPP_FINTEST */
+#endif /* _rtpp_tload_fin_h */
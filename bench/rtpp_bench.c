@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/*
+ * In-process micro-benchmarks of the media path. Each benchmark runs the
+ * requested number of threads, each pushing the requested number of
+ * packets through the piece of code being measured, and reports results
+ * as a single JSON object per line, suitable for tracking regressions.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config_pp.h"
+
+#include "rtpp_types.h"
+#include "rtpp_lhist.h"
+#include "rtpp_time.h"
+
+#include "rtpp_bench.h"
+
+static const struct rtpp_bench *benches[] = {
+    &rtpp_bench_queue,
+    &rtpp_bench_hash,
+    &rtpp_bench_resizer,
+    &rtpp_bench_stream_rx,
+    &rtpp_bench_pproc,
+    &rtpp_bench_record,
+    &rtpp_bench_pipeline,
+    &rtpp_bench_refcnt,
+    NULL
+};
+
+#define RTP_HDR_LEN 12
+#define RTP_PT_PCMU 0
+#define BENCH_SSRC  0x42454e43
+
+/*
+ * Fill in RTP packet with PCMU payload of the given size, with the send
+ * timestamp stored at the beginning of the payload. Returns size of the
+ * packet.
+ */
+int
+rtpp_bench_rtp_fill(unsigned char *buf, int seq, uint32_t ts, int psize,
+  double stamp)
+{
+    uint32_t ssrc;
+
+    buf[0] = 0x80;
+    buf[1] = RTP_PT_PCMU;
+    buf[2] = (seq >> 8) & 0xff;
+    buf[3] = seq & 0xff;
+    ts = htonl(ts);
+    memcpy(buf + 4, &ts, sizeof(ts));
+    ssrc = htonl(BENCH_SSRC);
+    memcpy(buf + 8, &ssrc, sizeof(ssrc));
+    memset(buf + RTP_HDR_LEN, 0xff, psize);
+    if (psize >= (int)sizeof(stamp))
+        memcpy(buf + RTP_HDR_LEN, &stamp, sizeof(stamp));
+    return (RTP_HDR_LEN + psize);
+}
+
+double
+rtpp_bench_rtp_stamp(const unsigned char *buf, int len)
+{
+    double stamp;
+
+    if (len < RTP_HDR_LEN + (int)sizeof(stamp))
+        return (-1);
+    memcpy(&stamp, buf + RTP_HDR_LEN, sizeof(stamp));
+    return (stamp);
+}
+
+/* Sleep until it's time to send i-th packet at the given rate */
+void
+rtpp_bench_pace(double stime, int i, int rate)
+{
+    struct timespec ts;
+    double delay;
+
+    if (rate <= 0)
+        return;
+    delay = stime + ((double)i / rate) - getdtime();
+    if (delay <= 0)
+        return;
+    ts.tv_sec = (time_t)delay;
+    ts.tv_nsec = (long)((delay - ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+}
+
+static void *
+rtpp_bench_thread(void *arg)
+{
+    struct rtpp_bench_thr *tp;
+
+    tp = (struct rtpp_bench_thr *)arg;
+    tp->bp->run(tp);
+    return (NULL);
+}
+
+static void
+rtpp_bench_report(FILE *of, const struct rtpp_bench *bp,
+  const struct rtpp_bench_opts *op, const struct rtpp_bench_res *rp)
+{
+    const struct rtpp_lhist *hp;
+
+    hp = &rp->lat;
+    fprintf(of, "{\"bench\": \"%s\", \"threads\": %d, \"npkts\": %d, "
+      "\"rate\": %d, \"psize\": %d, \"nops\": %ju, \"nlost\": %ju, "
+      "\"elapsed\": %f, \"pps\": %.1f, \"lat_unit\": \"%s\", "
+      "\"lat_p50\": %ju, \"lat_p90\": %ju, \"lat_p99\": %ju, "
+      "\"lat_max\": %ju}\n", bp->name, op->nthreads, op->npkts, op->rate,
+      op->psize, (uintmax_t)rp->nops, (uintmax_t)rp->nlost, rp->etime,
+      (rp->etime > 0) ? (double)rp->nops / rp->etime : 0.0,
+      (bp->lunit == RTPP_BENCH_NS) ? "ns" : "us",
+      (uintmax_t)rtpp_lhist_pctl(hp, 0.5), (uintmax_t)rtpp_lhist_pctl(hp, 0.9),
+      (uintmax_t)rtpp_lhist_pctl(hp, 0.99), (uintmax_t)hp->max);
+    fflush(of);
+}
+
+static int
+rtpp_bench_run(const struct rtpp_bench *bp, const struct rtpp_bench_opts *op,
+  struct rtpp_bench_inst *inst, FILE *of)
+{
+    struct rtpp_bench_thr *thrs;
+    struct rtpp_bench_res res;
+    void *arg;
+    int i;
+
+    arg = NULL;
+    if (bp->setup != NULL) {
+        arg = bp->setup(op, inst);
+        if (arg == NULL) {
+            warnx("%s: setup has failed", bp->name);
+            return (-1);
+        }
+    }
+    thrs = calloc(op->nthreads, sizeof(thrs[0]));
+    if (thrs == NULL)
+        err(1, "calloc");
+    for (i = 0; i < op->nthreads; i++) {
+        thrs[i] = (struct rtpp_bench_thr){.bp = bp, .op = op, .inst = inst,
+          .arg = arg, .idx = i};
+        if (pthread_create(&thrs[i].thread_id, NULL, rtpp_bench_thread,
+          &thrs[i]) != 0)
+            errx(1, "%s: can't create thread", bp->name);
+    }
+    /*
+     * Threads run concurrently, so the aggregate rate is the total number
+     * of operations over the time taken by the slowest one.
+     */
+    memset(&res, '\0', sizeof(res));
+    for (i = 0; i < op->nthreads; i++) {
+        pthread_join(thrs[i].thread_id, NULL);
+        res.nops += thrs[i].res.nops;
+        res.nlost += thrs[i].res.nlost;
+        if (thrs[i].res.etime > res.etime)
+            res.etime = thrs[i].res.etime;
+        rtpp_lhist_merge(&res.lat, &thrs[i].res.lat);
+    }
+    free(thrs);
+    if (bp->teardown != NULL)
+        bp->teardown(arg, &res);
+    rtpp_bench_report(of, bp, op, &res);
+    return (0);
+}
+
+static void
+usage(void)
+{
+
+    fprintf(stderr, "usage: rtpp_bench [-l] [-n npkts] [-t nthreads] "
+      "[-r rate] [-s psize] [-o outfile]\n"
+      "                  [bench ...] [-- rtpproxy_args ...]\n");
+    exit(1);
+}
+
+static const struct rtpp_bench *
+rtpp_bench_byname(const char *name)
+{
+    int i;
+
+    for (i = 0; benches[i] != NULL; i++) {
+        if (strcmp(benches[i]->name, name) == 0)
+            return (benches[i]);
+    }
+    return (NULL);
+}
+
+int
+main(int argc, char **argv)
+{
+    struct rtpp_bench_opts opts = {.npkts = 100000, .nthreads = 1,
+      .psize = 160};
+    const struct rtpp_bench *sel[sizeof(benches) / sizeof(benches[0])];
+    struct rtpp_bench_inst *inst;
+    const char *ofname;
+    FILE *of;
+    int ch, i, nsel, ndash, needinst, rval;
+
+    /*
+     * Everything after "--" is passed to the rtpproxy instance as is, so
+     * hide it from getopt(3).
+     */
+    for (ndash = 1; ndash < argc; ndash++) {
+        if (strcmp(argv[ndash], "--") == 0)
+            break;
+    }
+    if (ndash < argc) {
+        opts.rtpp_argc = argc - ndash - 1;
+        opts.rtpp_argv = (const char * const *)&argv[ndash + 1];
+    }
+
+    ofname = NULL;
+    while ((ch = getopt(ndash, argv, "ln:t:r:s:o:")) != -1) {
+        switch (ch) {
+        case 'l':
+            for (i = 0; benches[i] != NULL; i++)
+                printf("%-10s %s\n", benches[i]->name, benches[i]->descr);
+            exit(0);
+
+        case 'n':
+            opts.npkts = atoi(optarg);
+            if (opts.npkts <= 0)
+                errx(1, "%s: number of packets is invalid", optarg);
+            break;
+
+        case 't':
+            opts.nthreads = atoi(optarg);
+            if (opts.nthreads <= 0)
+                errx(1, "%s: number of threads is invalid", optarg);
+            break;
+
+        case 'r':
+            opts.rate = atoi(optarg);
+            if (opts.rate < 0)
+                errx(1, "%s: packet rate is invalid", optarg);
+            break;
+
+        case 's':
+            opts.psize = atoi(optarg);
+            if (opts.psize < (int)sizeof(double) || opts.psize > 1400)
+                errx(1, "%s: payload size is out of range %d..1400", optarg,
+                  (int)sizeof(double));
+            break;
+
+        case 'o':
+            ofname = optarg;
+            break;
+
+        default:
+            usage();
+        }
+    }
+
+    nsel = 0;
+    needinst = 0;
+    for (i = optind; i < ndash; i++) {
+        if (nsel == (int)(sizeof(sel) / sizeof(sel[0])) - 1)
+            errx(1, "too many benchmarks specified");
+        sel[nsel] = rtpp_bench_byname(argv[i]);
+        if (sel[nsel] == NULL)
+            errx(1, "%s: unknown benchmark, see -l", argv[i]);
+        needinst |= sel[nsel]->needinst;
+        nsel++;
+    }
+    if (nsel == 0) {
+        for (i = 0; benches[i] != NULL; i++) {
+            sel[nsel++] = benches[i];
+            needinst |= benches[i]->needinst;
+        }
+    }
+
+    of = stdout;
+    if (ofname != NULL) {
+        of = fopen(ofname, "w");
+        if (of == NULL)
+            err(1, "can't open %s", ofname);
+    }
+
+    inst = NULL;
+    if (needinst) {
+        inst = rtpp_bench_inst_ctor(&opts);
+        if (inst == NULL)
+            errx(1, "can't start rtpproxy instance");
+    }
+
+    rval = 0;
+    for (i = 0; i < nsel; i++) {
+        if (rtpp_bench_run(sel[i], &opts, inst, of) != 0)
+            rval = 1;
+    }
+
+    if (inst != NULL)
+        rtpp_bench_inst_dtor(inst);
+    if (of != stdout)
+        fclose(of);
+    return (rval);
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+struct rtpp_bench_inst;
+struct rtpp_cfg;
+struct rtpp_session;
+struct rtpp_timestamp;
+struct rtp_packet;
+
+struct rtpp_bench_opts {
+    int npkts;                  /* Packets (operations) per thread */
+    int nthreads;
+    int rate;                   /* Per-thread packet rate, 0 is unlimited */
+    int psize;                  /* RTP payload size */
+    int rtpp_argc;              /* Extra arguments for the rtpproxy instance */
+    const char * const *rtpp_argv;
+};
+
+enum rtpp_bench_lunit {RTPP_BENCH_NS = 0, RTPP_BENCH_US};
+
+struct rtpp_bench_res {
+    uint64_t nops;              /* Operations completed */
+    uint64_t nlost;             /* Packets that never made it out */
+    double etime;               /* Time spent in the code being measured */
+    struct rtpp_lhist lat;
+};
+
+struct rtpp_bench;
+
+struct rtpp_bench_thr {
+    const struct rtpp_bench *bp;
+    const struct rtpp_bench_opts *op;
+    struct rtpp_bench_inst *inst;
+    void *arg;                  /* Whatever setup() has returned */
+    int idx;
+    struct rtpp_bench_res res;
+    pthread_t thread_id;
+};
+
+struct rtpp_bench {
+    const char *name;
+    const char *descr;
+    enum rtpp_bench_lunit lunit;
+    int needinst;               /* Needs in-process rtpproxy instance */
+    void *(*setup)(const struct rtpp_bench_opts *, struct rtpp_bench_inst *);
+    void (*run)(struct rtpp_bench_thr *);
+    /* Optional, can adjust the aggregated results */
+    void (*teardown)(void *, struct rtpp_bench_res *);
+};
+
+extern const struct rtpp_bench rtpp_bench_queue;
+extern const struct rtpp_bench rtpp_bench_hash;
+extern const struct rtpp_bench rtpp_bench_resizer;
+extern const struct rtpp_bench rtpp_bench_stream_rx;
+extern const struct rtpp_bench rtpp_bench_pproc;
+extern const struct rtpp_bench rtpp_bench_record;
+extern const struct rtpp_bench rtpp_bench_pipeline;
+extern const struct rtpp_bench rtpp_bench_refcnt;
+
+/*
+ * Latency is recorded in the unit of the benchmark: nanoseconds for
+ * the ones timing individual calls and microseconds for the ones
+ * timing packets across threads or sockets.
+ */
+static inline void
+rtpp_bench_lreg(struct rtpp_bench_thr *tp, double lat)
+{
+
+    rtpp_lhist_reg(&tp->res.lat, (tp->bp->lunit == RTPP_BENCH_NS) ?
+      lat * 1e3 : lat);
+}
+
+int rtpp_bench_rtp_fill(unsigned char *, int, uint32_t, int, double);
+double rtpp_bench_rtp_stamp(const unsigned char *, int);
+void rtpp_bench_pace(double, int, int);
+
+/*
+ * In-process rtpproxy instance, see rtpp_bench_inst.c. A session is set
+ * up between two local sockets, fds[0] for the caller and fds[1] for the
+ * callee, caddrs[] are their addresses and addrs[] are the relay addresses
+ * each of them should send to.
+ */
+struct rtpp_bench_sess {
+    struct rtpp_session *sp;
+    char call_id[64];
+    int fds[2];
+    struct sockaddr_in caddrs[2];
+    struct sockaddr_in addrs[2];
+};
+
+struct rtpp_bench_inst *rtpp_bench_inst_ctor(const struct rtpp_bench_opts *);
+void rtpp_bench_inst_dtor(struct rtpp_bench_inst *);
+struct rtpp_cfg *rtpp_bench_inst_cfg(struct rtpp_bench_inst *);
+const char *rtpp_bench_inst_tdir(struct rtpp_bench_inst *);
+int rtpp_bench_inst_sess(struct rtpp_bench_inst *, const char *, int,
+  struct rtpp_bench_sess *);
+void rtpp_bench_sess_free(struct rtpp_bench_inst *, struct rtpp_bench_sess *);
+struct rtp_packet *rtpp_bench_pkt(int, int, const struct rtpp_timestamp *,
+  const struct sockaddr_in *);
+int rtpp_bench_sock(struct sockaddr_in *);
+int rtpp_bench_drain(int, struct rtpp_bench_thr *);
+int rtpp_bench_collect(int, struct rtpp_bench_thr *, int, double);
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Session table lookups by Call-ID, with some insert/remove churn mixed
+ * in to keep the table lock honest.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config_pp.h"
+
+#include "rtpp_types.h"
+#include "rtpp_codeptr.h"
+#include "rtpp_refcnt.h"
+#include "rtpp_mallocs.h"
+#include "rtpp_hash_table.h"
+#include "rtpp_lhist.h"
+#include "rtpp_str.h"
+#include "rtpp_time.h"
+
+#include "rtpp_bench.h"
+
+#define HB_NKEYS    65536
+#define HB_CHURN    16      /* Every Nth operation is remove + insert */
+
+struct hb_ent {
+    struct rtpp_refcnt *rcnt;
+    char key[48];
+    struct rtpp_str_const skey;
+};
+
+struct hb_ctx {
+    struct rtpp_hash_table *ht;
+    struct hb_ent *keys;
+};
+
+static struct hb_ent *
+hb_ent_ctor(const char *fmt, int idx)
+{
+    struct hb_ent *ep;
+
+    ep = rtpp_rzmalloc(sizeof(*ep), offsetof(struct hb_ent, rcnt));
+    if (ep == NULL)
+        return (NULL);
+    CALL_SMETHOD(ep->rcnt, use_stdfree, ep);
+    snprintf(ep->key, sizeof(ep->key), fmt, idx);
+    ep->skey.s = ep->key;
+    ep->skey.len = strlen(ep->key);
+    return (ep);
+}
+
+static int
+hb_insert(struct rtpp_hash_table *ht, struct hb_ent *ep)
+{
+    struct rtpp_hash_table_entry *hte;
+
+    hte = CALL_SMETHOD(ht, append_str_refcnt, rtpp_str_fix(&ep->skey),
+      ep->rcnt, NULL);
+    return ((hte == NULL) ? -1 : 0);
+}
+
+static void *
+hb_setup(const struct rtpp_bench_opts *op, struct rtpp_bench_inst *inst)
+{
+    struct hb_ctx *ctx;
+    struct hb_ent *ep;
+    int i;
+
+    ctx = calloc(1, sizeof(*ctx));
+    if (ctx == NULL)
+        goto e0;
+    ctx->keys = calloc(HB_NKEYS, sizeof(ctx->keys[0]));
+    if (ctx->keys == NULL)
+        goto e1;
+    ctx->ht = rtpp_hash_table_ctor(rtpp_ht_key_str_t, RTPP_HT_NODUPS);
+    if (ctx->ht == NULL)
+        goto e2;
+    for (i = 0; i < HB_NKEYS; i++) {
+        /* Lookup keys are separate from the stored ones on purpose */
+        snprintf(ctx->keys[i].key, sizeof(ctx->keys[i].key),
+          "%08x-bench-call-id@127.0.0.1", i);
+        ctx->keys[i].skey.s = ctx->keys[i].key;
+        ctx->keys[i].skey.len = strlen(ctx->keys[i].key);
+        ep = hb_ent_ctor("%08x-bench-call-id@127.0.0.1", i);
+        if (ep == NULL)
+            goto e3;
+        if (hb_insert(ctx->ht, ep) != 0) {
+            RTPP_OBJ_DECREF(ep);
+            goto e3;
+        }
+        RTPP_OBJ_DECREF(ep);
+    }
+    return (ctx);
+e3:
+    RTPP_OBJ_DECREF(ctx->ht);
+e2:
+    free(ctx->keys);
+e1:
+    free(ctx);
+e0:
+    return (NULL);
+}
+
+static void
+hb_run(struct rtpp_bench_thr *tp)
+{
+    struct hb_ctx *ctx;
+    struct hb_ent *ep;
+    struct rtpp_refcnt *rco;
+    uint32_t rnd;
+    double t0, t1;
+    int i;
+
+    ctx = (struct hb_ctx *)tp->arg;
+    ep = hb_ent_ctor("bench-churn-%d@127.0.0.1", tp->idx);
+    if (ep == NULL)
+        return;
+    if (hb_insert(ctx->ht, ep) != 0)
+        goto out;
+    rnd = 2463534242U + tp->idx;
+    for (i = 0; i < tp->op->npkts; i++) {
+        rnd ^= rnd << 13;
+        rnd ^= rnd >> 17;
+        rnd ^= rnd << 5;
+        if ((i % HB_CHURN) == HB_CHURN - 1) {
+            t0 = getdtime();
+            /* Table drops its reference, we still hold ours */
+            rco = CALL_SMETHOD(ctx->ht, remove_by_key, ep->key, NULL);
+            if (rco == NULL || hb_insert(ctx->ht, ep) != 0)
+                tp->res.nlost++;
+            t1 = getdtime();
+        } else {
+            t0 = getdtime();
+            rco = CALL_SMETHOD(ctx->ht, find_str,
+              rtpp_str_fix(&ctx->keys[rnd % HB_NKEYS].skey));
+            if (rco != NULL)
+                RC_DECREF(rco);
+            t1 = getdtime();
+            if (rco == NULL)
+                tp->res.nlost++;
+        }
+        tp->res.nops++;
+        tp->res.etime += t1 - t0;
+        rtpp_bench_lreg(tp, t1 - t0);
+    }
+    CALL_SMETHOD(ctx->ht, remove_by_key, ep->key, NULL);
+out:
+    RTPP_OBJ_DECREF(ep);
+}
+
+static void
+hb_teardown(void *arg, struct rtpp_bench_res *rp)
+{
+    struct hb_ctx *ctx;
+
+    ctx = (struct hb_ctx *)arg;
+    RTPP_OBJ_DECREF(ctx->ht);
+    free(ctx->keys);
+    free(ctx);
+}
+
+const struct rtpp_bench rtpp_bench_hash = {
+    .name = "hash",
+    .descr = "session hash table lookups with insert/remove churn",
+    .lunit = RTPP_BENCH_NS,
+    .setup = hb_setup,
+    .run = hb_run,
+    .teardown = hb_teardown,
+};
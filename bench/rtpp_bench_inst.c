@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Runs rtpproxy in the same process via librtpproxy, so that benchmarks
+ * can get hold of the fully configured objects (sessions, streams,
+ * packet processing chains) and call into them directly.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config_pp.h"
+
+#include "rtpp_types.h"
+#include "rtpp_cfg.h"
+#include "rtpp_codeptr.h"
+#include "rtpp_refcnt.h"
+#include "rtpp_command.h"
+#include "rtpp_command_args.h"
+#include "rtpp_command_sub.h"
+#include "rtpp_command_private.h"
+#include "rtpp_command_stats.h"
+#include "rtpp_lhist.h"
+#include "rtpp_pipe.h"
+#include "rtpp_session.h"
+#include "rtpp_stream.h"
+#include "rtpp_str.h"
+#include "rtpp_time.h"
+#include "rtp.h"
+#include "rtp_packet.h"
+
+#include "librtpproxy.h"
+
+#include "rtpp_bench.h"
+
+#if defined(__linux__)
+static int optreset; /* Not present in linux */
+#endif
+
+#define BENCH_FTAG "bench_ft"
+#define BENCH_TTAG "bench_tt"
+#define BENCH_SO_RCVBUF (4 * 1024 * 1024)
+
+struct rtpp_bench_inst {
+    struct rtpp_cfg *cfsp;
+    int tfd;
+    char tdir[PATH_MAX];
+    pthread_mutex_t cmd_lock;
+    struct rtpp_command_stats cstat;
+};
+
+static int
+rtpp_bench_inst_cmd(struct rtpp_bench_inst *inst, const char *fmt, ...)
+{
+    struct rtpp_timestamp dtime;
+    struct rtpp_command *cmd;
+    char buf[RTPP_CMD_BUFLEN];
+    va_list ap;
+    int len, rval;
+
+    va_start(ap, fmt);
+    len = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (len < 0 || len >= (int)sizeof(buf))
+        return (-1);
+
+    rtpp_timestamp_get(&dtime);
+    pthread_mutex_lock(&inst->cmd_lock);
+    cmd = rtpp_command_ctor(inst->cfsp, inst->tfd, &dtime, &inst->cstat, 0);
+    if (cmd == NULL) {
+        rval = -1;
+        goto e0;
+    }
+    memcpy(cmd->buf, buf, len + 1);
+    if (rtpp_command_split(cmd, len, &rval, NULL) == 0)
+        rval = handle_command(inst->cfsp, cmd);
+    else
+        rval = -1;
+    free_command(cmd);
+e0:
+    pthread_mutex_unlock(&inst->cmd_lock);
+    return (rval);
+}
+
+struct rtpp_bench_inst *
+rtpp_bench_inst_ctor(const struct rtpp_bench_opts *op)
+{
+    struct rtpp_bench_inst *inst;
+    const char **argv;
+    char sockname[PATH_MAX + 16];
+    int argc, i;
+
+    inst = calloc(1, sizeof(*inst));
+    if (inst == NULL)
+        goto e0;
+    strcpy(inst->tdir, "/tmp/rtpp_bench.XXXXXX");
+    if (mkdtemp(inst->tdir) == NULL)
+        goto e1;
+    snprintf(sockname, sizeof(sockname), "unix:%s/rtpp.sock", inst->tdir);
+    argv = calloc(16 + op->rtpp_argc, sizeof(argv[0]));
+    if (argv == NULL)
+        goto e2;
+    argc = 0;
+    argv[argc++] = "rtpproxy";
+    argv[argc++] = "-f";
+    argv[argc++] = "-F";
+    argv[argc++] = "-s";
+    argv[argc++] = sockname;
+    argv[argc++] = "-l";
+    argv[argc++] = "127.0.0.1";
+    argv[argc++] = "-d";
+    argv[argc++] = "crit";
+    argv[argc++] = "-r";
+    argv[argc++] = inst->tdir;
+    argv[argc++] = "-T";
+    argv[argc++] = "600";
+    for (i = 0; i < op->rtpp_argc; i++)
+        argv[argc++] = op->rtpp_argv[i];
+    argv[argc] = NULL;
+
+    /* We have already been through getopt(3), so rewind it */
+    optreset = 1;
+    optind = 1;
+    inst->cfsp = rtpp_main(argc, argv);
+    free(argv);
+    if (inst->cfsp == NULL)
+        goto e2;
+    inst->cfsp->no_resolve = 1;
+    inst->tfd = open("/dev/null", O_WRONLY, 0);
+    if (inst->tfd < 0)
+        goto e3;
+    if (pthread_mutex_init(&inst->cmd_lock, NULL) != 0)
+        goto e4;
+    return (inst);
+e4:
+    close(inst->tfd);
+e3:
+    rtpp_shutdown(inst->cfsp);
+e2:
+    rmdir(inst->tdir);
+e1:
+    free(inst);
+e0:
+    return (NULL);
+}
+
+/* Remove scratch directory, it only ever has plain files in it */
+static void
+rtpp_bench_rmtree(const char *dir)
+{
+    char path[PATH_MAX];
+    struct dirent *dep;
+    DIR *dp;
+
+    dp = opendir(dir);
+    if (dp != NULL) {
+        while ((dep = readdir(dp)) != NULL) {
+            if (strcmp(dep->d_name, ".") == 0 || strcmp(dep->d_name, "..") == 0)
+                continue;
+            snprintf(path, sizeof(path), "%s/%s", dir, dep->d_name);
+            unlink(path);
+        }
+        closedir(dp);
+    }
+    if (rmdir(dir) != 0)
+        fprintf(stderr, "rtpp_bench: can't remove %s: %s\n", dir,
+          strerror(errno));
+}
+
+void
+rtpp_bench_inst_dtor(struct rtpp_bench_inst *inst)
+{
+
+    rtpp_shutdown(inst->cfsp);
+    close(inst->tfd);
+    pthread_mutex_destroy(&inst->cmd_lock);
+    rtpp_bench_rmtree(inst->tdir);
+    free(inst);
+}
+
+struct rtpp_cfg *
+rtpp_bench_inst_cfg(struct rtpp_bench_inst *inst)
+{
+
+    return (inst->cfsp);
+}
+
+const char *
+rtpp_bench_inst_tdir(struct rtpp_bench_inst *inst)
+{
+
+    return (inst->tdir);
+}
+
+/* Open non-blocking UDP socket bound to a random loopback port */
+int
+rtpp_bench_sock(struct sockaddr_in *sinp)
+{
+    socklen_t slen;
+    int fd, flags, so_rcvbuf;
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+        goto e0;
+    memset(sinp, '\0', sizeof(*sinp));
+    sinp->sin_family = AF_INET;
+    sinp->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr *)sinp, sizeof(*sinp)) != 0)
+        goto e1;
+    slen = sizeof(*sinp);
+    if (getsockname(fd, (struct sockaddr *)sinp, &slen) != 0)
+        goto e1;
+    so_rcvbuf = BENCH_SO_RCVBUF;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &so_rcvbuf, sizeof(so_rcvbuf));
+    flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+        goto e1;
+    return (fd);
+e1:
+    close(fd);
+e0:
+    return (-1);
+}
+
+/*
+ * Allocate RTP packet as if it has just been received from the given
+ * address at the given time. The payload is stamped with the current
+ * time.
+ */
+struct rtp_packet *
+rtpp_bench_pkt(int seq, int psize, const struct rtpp_timestamp *rtime,
+  const struct sockaddr_in *from)
+{
+    struct rtp_packet *pkt;
+
+    pkt = rtp_packet_alloc();
+    if (pkt == NULL)
+        return (NULL);
+    pkt->size = rtpp_bench_rtp_fill(pkt->data.buf, seq, seq * psize, psize,
+      getdtime());
+    pkt->rtime = *rtime;
+    if (from != NULL) {
+        memcpy(&pkt->raddr, from, sizeof(*from));
+        pkt->rlen = sizeof(*from);
+    }
+    return (pkt);
+}
+
+/*
+ * Read everything that is queued up on the socket. If the thread is
+ * given, the latency of each packet is recorded based on the timestamp
+ * stored in its payload. Returns number of packets read.
+ */
+int
+rtpp_bench_drain(int fd, struct rtpp_bench_thr *tp)
+{
+    unsigned char buf[2048];
+    double stamp;
+    ssize_t len;
+    int n;
+
+    for (n = 0;; n++) {
+        len = recv(fd, buf, sizeof(buf), 0);
+        if (len < 0)
+            break;
+        if (tp == NULL)
+            continue;
+        stamp = rtpp_bench_rtp_stamp(buf, len);
+        if (stamp > 0)
+            rtpp_bench_lreg(tp, getdtime() - stamp);
+    }
+    return (n);
+}
+
+/*
+ * Keep reading from the socket until the expected number of packets has
+ * arrived or nothing has come in for the given amount of time. Returns
+ * number of packets read.
+ */
+int
+rtpp_bench_collect(int fd, struct rtpp_bench_thr *tp, int nwant,
+  double timeout)
+{
+    struct pollfd pfd;
+    int n;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    for (n = 0; n < nwant;) {
+        pfd.revents = 0;
+        if (poll(&pfd, 1, (int)(timeout * 1000)) <= 0)
+            break;
+        n += rtpp_bench_drain(fd, tp);
+    }
+    return (n);
+}
+
+/*
+ * Create session between two local sockets by issuing U and L commands
+ * the same way the SIP proxy would, then look the session up.
+ */
+int
+rtpp_bench_inst_sess(struct rtpp_bench_inst *inst, const char *name, int idx,
+  struct rtpp_bench_sess *bsp)
+{
+    const struct rtpp_str_const ftag = {.s = BENCH_FTAG,
+      .len = sizeof(BENCH_FTAG) - 1};
+    struct rtpp_str_const cid;
+    int i;
+
+    memset(bsp, '\0', sizeof(*bsp));
+    bsp->fds[0] = bsp->fds[1] = -1;
+    snprintf(bsp->call_id, sizeof(bsp->call_id), "%s_%d_%u", name, idx,
+      (unsigned)getpid());
+    for (i = 0; i < 2; i++) {
+        bsp->fds[i] = rtpp_bench_sock(&bsp->caddrs[i]);
+        if (bsp->fds[i] < 0)
+            goto e0;
+    }
+    if (rtpp_bench_inst_cmd(inst, "U %s 127.0.0.1 %d %s", bsp->call_id,
+      ntohs(bsp->caddrs[0].sin_port), BENCH_FTAG) != 0)
+        goto e0;
+    if (rtpp_bench_inst_cmd(inst, "L %s 127.0.0.1 %d %s %s", bsp->call_id,
+      ntohs(bsp->caddrs[1].sin_port), BENCH_FTAG, BENCH_TTAG) != 0)
+        goto e1;
+    cid = (struct rtpp_str_const){.s = bsp->call_id,
+      .len = strlen(bsp->call_id)};
+    if (find_stream(inst->cfsp, rtpp_str_fix(&cid), rtpp_str_fix(&ftag),
+      NULL, &bsp->sp) == -1)
+        goto e1;
+    /*
+     * Caller has been given the port allocated by the L command and
+     * callee the one allocated by the U command.
+     */
+    for (i = 0; i < 2; i++) {
+        bsp->addrs[i].sin_family = AF_INET;
+        bsp->addrs[i].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bsp->addrs[i].sin_port = htons(bsp->sp->rtp->stream[1 - i]->port);
+    }
+    return (0);
+e1:
+    rtpp_bench_inst_cmd(inst, "D %s %s", bsp->call_id, BENCH_FTAG);
+e0:
+    for (i = 0; i < 2; i++) {
+        if (bsp->fds[i] >= 0)
+            close(bsp->fds[i]);
+    }
+    return (-1);
+}
+
+void
+rtpp_bench_sess_free(struct rtpp_bench_inst *inst, struct rtpp_bench_sess *bsp)
+{
+    int i;
+
+    RTPP_OBJ_DECREF(bsp->sp);
+    rtpp_bench_inst_cmd(inst, "D %s %s", bsp->call_id, BENCH_FTAG);
+    for (i = 0; i < 2; i++)
+        close(bsp->fds[i]);
+}
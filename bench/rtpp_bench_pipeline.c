@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/*
+ * End-to-end media path over loopback: caller sends paced RTP to the
+ * relay port, the rtpproxy I/O threads pick it up and forward it to the
+ * callee. Latency is measured from the sendto(2) at the caller to the
+ * recv(2) at the callee.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config_pp.h"
+
+#include "rtpp_types.h"
+#include "rtpp_lhist.h"
+#include "rtpp_time.h"
+
+#include "rtpp_bench.h"
+
+#define PLB_TAIL 1.0        /* How long to wait for stragglers, sec */
+
+static void *
+plb_setup(const struct rtpp_bench_opts *op, struct rtpp_bench_inst *inst)
+{
+
+    return (inst);
+}
+
+static void
+plb_run(struct rtpp_bench_thr *tp)
+{
+    struct rtpp_bench_sess bs;
+    unsigned char buf[2048];
+    double stime;
+    int i, len, nrcvd, nsent;
+
+    if (rtpp_bench_inst_sess(tp->inst, "pipeline", tp->idx, &bs) != 0)
+        return;
+    nrcvd = nsent = 0;
+    stime = getdtime();
+    for (i = 0; i < tp->op->npkts; i++) {
+        rtpp_bench_pace(stime, i, tp->op->rate);
+        len = rtpp_bench_rtp_fill(buf, i, i * tp->op->psize, tp->op->psize,
+          getdtime());
+        if (sendto(bs.fds[0], buf, len, 0, (struct sockaddr *)&bs.addrs[0],
+          sizeof(bs.addrs[0])) == len)
+            nsent++;
+        nrcvd += rtpp_bench_drain(bs.fds[1], tp);
+    }
+    nrcvd += rtpp_bench_collect(bs.fds[1], tp, nsent - nrcvd, PLB_TAIL);
+    tp->res.etime = getdtime() - stime;
+    /* Don't count the time spent waiting for packets that never came */
+    if (nrcvd < nsent)
+        tp->res.etime -= PLB_TAIL;
+    tp->res.nops = nrcvd;
+    tp->res.nlost = tp->op->npkts - nrcvd;
+    rtpp_bench_sess_free(tp->inst, &bs);
+}
+
+const struct rtpp_bench rtpp_bench_pipeline = {
+    .name = "pipeline",
+    .descr = "caller to callee through the relay over loopback",
+    .lunit = RTPP_BENCH_US,
+    .needinst = 1,
+    .setup = plb_setup,
+    .run = plb_run,
+};
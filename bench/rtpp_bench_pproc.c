@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Per-packet processing chain of an established session: analyzer,
+ * resizer and recorder checks and the relay handing the packet over to
+ * the network I/O thread. Packets are injected directly into the chain,
+ * socket reads are covered by the stream_rx benchmark.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config_pp.h"
+
+#include "rtpp_types.h"
+#include "rtpp_cfg.h"
+#include "rtpp_codeptr.h"
+#include "rtpp_refcnt.h"
+#include "rtpp_lhist.h"
+#include "rtpp_pipe.h"
+#include "rtpp_session.h"
+#include "rtpp_stream.h"
+#include "rtpp_time.h"
+#include "rtp.h"
+#include "rtp_packet.h"
+#include "rtpp_proc.h"
+#include "rtpp_proc_async.h"
+#include "rtpp_netio_async.h"
+#include "advanced/packet_processor.h"
+#include "advanced/pproc_manager.h"
+
+#include "rtpp_bench.h"
+
+#define PB_BATCH 32         /* Packets per netio queue pump */
+
+static void *
+pb_setup(const struct rtpp_bench_opts *op, struct rtpp_bench_inst *inst)
+{
+
+    return (rtpp_bench_inst_cfg(inst));
+}
+
+static void
+pb_run(struct rtpp_bench_thr *tp)
+{
+    const struct rtpp_cfg *cfsp;
+    struct rtpp_proc_rstats rstats;
+    struct rtpp_bench_sess bs;
+    struct rtpp_stream *stp;
+    struct sthread_args *sender;
+    struct pkt_proc_ctx pktx;
+    struct rtpp_timestamp rtime;
+    double t0, t1;
+    int i, nrcvd;
+
+    cfsp = (const struct rtpp_cfg *)tp->arg;
+    if (rtpp_bench_inst_sess(tp->inst, "pproc", tp->idx, &bs) != 0)
+        return;
+    stp = bs.sp->rtp->stream[1];
+    sender = rtpp_anetio_get_sender(cfsp->rtpp_proc_cf->netio, tp->idx);
+    memset(&rstats, '\0', sizeof(rstats));
+    nrcvd = 0;
+    for (i = 0; i < tp->op->npkts; i++) {
+        rtpp_timestamp_get(&rtime);
+        pktx = (struct pkt_proc_ctx){.strmp_in = stp,
+          .strmp_out = CALL_SMETHOD(stp, get_sender, cfsp), .rsp = &rstats};
+        pktx.pktp = rtpp_bench_pkt(i, tp->op->psize, &rtime, &bs.caddrs[0]);
+        if (pktx.pktp == NULL) {
+            if (pktx.strmp_out != NULL)
+                RTPP_OBJ_DECREF(pktx.strmp_out);
+            continue;
+        }
+        pktx.pktp->sender = sender;
+        t0 = getdtime();
+        CALL_SMETHOD(stp->pproc_manager, handle, &pktx);
+        t1 = getdtime();
+        if (pktx.strmp_out != NULL)
+            RTPP_OBJ_DECREF(pktx.strmp_out);
+        tp->res.nops++;
+        tp->res.etime += t1 - t0;
+        rtpp_bench_lreg(tp, t1 - t0);
+        if ((i % PB_BATCH) == PB_BATCH - 1) {
+            rtpp_anetio_pump_q(sender);
+            nrcvd += rtpp_bench_drain(bs.fds[1], NULL);
+        }
+    }
+    rtpp_anetio_pump_q(sender);
+    nrcvd += rtpp_bench_collect(bs.fds[1], NULL, tp->res.nops - nrcvd, 0.5);
+    tp->res.nlost = tp->res.nops - nrcvd;
+    rtpp_bench_sess_free(tp->inst, &bs);
+}
+
+const struct rtpp_bench rtpp_bench_pproc = {
+    .name = "pproc",
+    .descr = "packet processing chain of a session, up to the relay",
+    .lunit = RTPP_BENCH_NS,
+    .needinst = 1,
+    .setup = pb_setup,
+    .run = pb_run,
+};
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Cross-thread handoff through the work item queue, the way the packet
+ * processing threads hand packets over to the network I/O ones. Every
+ * thread is a producer, a single consumer records how long each item
+ * has spent in the queue.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config_pp.h"
+
+#include "rtpp_types.h"
+#include "rtpp_codeptr.h"
+#include "rtpp_refcnt.h"
+#include "rtpp_lhist.h"
+#include "rtpp_queue.h"
+#include "rtpp_time.h"
+#include "rtpp_wi.h"
+#include "rtpp_wi_data.h"
+
+#include "rtpp_bench.h"
+
+#define QB_BATCH 64
+
+struct qb_item {
+    double stamp;           /* Negative value tells consumer to exit */
+};
+
+struct qb_ctx {
+    struct rtpp_queue *q;
+    pthread_t thread_id;
+    double stime;
+    double etime;
+    uint64_t nrecv;
+    struct rtpp_lhist lat;
+};
+
+static void *
+qb_consumer(void *arg)
+{
+    struct qb_ctx *ctx;
+    struct rtpp_wi *items[QB_BATCH];
+    struct qb_item *ip;
+    int i, n, done;
+
+    ctx = (struct qb_ctx *)arg;
+    for (done = 0; !done;) {
+        n = rtpp_queue_get_items(ctx->q, items, QB_BATCH, 0);
+        for (i = 0; i < n; i++) {
+            ip = rtpp_wi_data_get_ptr(items[i], sizeof(*ip), sizeof(*ip));
+            if (ip->stamp < 0) {
+                done = 1;
+            } else {
+                ctx->etime = getdtime();
+                rtpp_lhist_reg(&ctx->lat, ctx->etime - ip->stamp);
+                ctx->nrecv++;
+            }
+            RTPP_OBJ_DECREF(items[i]);
+        }
+    }
+    return (NULL);
+}
+
+static int
+qb_put(struct rtpp_queue *q, double stamp)
+{
+    struct rtpp_wi *wi;
+    struct qb_item *ip;
+
+    wi = rtpp_wi_malloc_udata((void **)&ip, sizeof(*ip));
+    if (wi == NULL)
+        return (-1);
+    ip->stamp = stamp;
+    if (rtpp_queue_put_item(wi, q) != 0) {
+        RTPP_OBJ_DECREF(wi);
+        return (-1);
+    }
+    return (0);
+}
+
+static void *
+qb_setup(const struct rtpp_bench_opts *op, struct rtpp_bench_inst *inst)
+{
+    struct qb_ctx *ctx;
+
+    ctx = calloc(1, sizeof(*ctx));
+    if (ctx == NULL)
+        goto e0;
+    ctx->q = rtpp_queue_init(RTPQ_LARGE_CB_LEN, "rtpp_bench_queue");
+    if (ctx->q == NULL)
+        goto e1;
+    if (pthread_create(&ctx->thread_id, NULL, qb_consumer, ctx) != 0)
+        goto e2;
+    ctx->stime = getdtime();
+    return (ctx);
+e2:
+    rtpp_queue_destroy(ctx->q);
+e1:
+    free(ctx);
+e0:
+    return (NULL);
+}
+
+static void
+qb_run(struct rtpp_bench_thr *tp)
+{
+    struct qb_ctx *ctx;
+    double stime;
+    int i;
+
+    ctx = (struct qb_ctx *)tp->arg;
+    stime = getdtime();
+    for (i = 0; i < tp->op->npkts; i++) {
+        rtpp_bench_pace(stime, i, tp->op->rate);
+        if (qb_put(ctx->q, getdtime()) != 0) {
+            tp->res.nlost++;
+            continue;
+        }
+        tp->res.nops++;
+    }
+    tp->res.etime = getdtime() - stime;
+}
+
+/*
+ * Producers only measure how fast they can enqueue, what matters is how
+ * quickly the consumer gets through the lot, so use its figures instead.
+ */
+static void
+qb_teardown(void *arg, struct rtpp_bench_res *rp)
+{
+    struct qb_ctx *ctx;
+
+    ctx = (struct qb_ctx *)arg;
+    while (qb_put(ctx->q, -1) != 0)
+        continue;
+    pthread_join(ctx->thread_id, NULL);
+    rp->nops = ctx->nrecv;
+    if (ctx->nrecv > 0)
+        rp->etime = ctx->etime - ctx->stime;
+    rp->lat = ctx->lat;
+    rtpp_queue_destroy(ctx->q);
+    free(ctx);
+}
+
+const struct rtpp_bench rtpp_bench_queue = {
+    .name = "queue",
+    .descr = "work item handoff between threads via rtpp_queue",
+    .lunit = RTPP_BENCH_US,
+    .setup = qb_setup,
+    .run = qb_run,
+    .teardown = qb_teardown,
+};
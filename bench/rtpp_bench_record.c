@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Writing of the session recording, in whatever format rtpproxy has been
+ * configured for (pass -P after "--" to get pcap).
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config_pp.h"
+
+#include "rtpp_types.h"
+#include "rtpp_cfg.h"
+#include "rtpp_codeptr.h"
+#include "rtpp_refcnt.h"
+#include "rtpp_lhist.h"
+#include "rtpp_pipe.h"
+#include "rtpp_record.h"
+#include "rtpp_session.h"
+#include "rtpp_stream.h"
+#include "rtpp_time.h"
+#include "rtp.h"
+#include "rtp_packet.h"
+#include "rtpp_proc.h"
+#include "advanced/packet_processor.h"
+#include "advanced/pproc_manager.h"
+
+#include "rtpp_bench.h"
+
+static void *
+rcb_setup(const struct rtpp_bench_opts *op, struct rtpp_bench_inst *inst)
+{
+
+    return (rtpp_bench_inst_cfg(inst));
+}
+
+static void
+rcb_run(struct rtpp_bench_thr *tp)
+{
+    const struct rtpp_cfg *cfsp;
+    struct rtpp_proc_rstats rstats;
+    struct rtpp_bench_sess bs;
+    struct rtpp_record *rrc;
+    struct pkt_proc_ctx pktx;
+    struct rtpp_timestamp rtime;
+    char rname[32];
+    double t0, t1;
+    int i;
+
+    cfsp = (const struct rtpp_cfg *)tp->arg;
+    if (rtpp_bench_inst_sess(tp->inst, "record", tp->idx, &bs) != 0)
+        return;
+    snprintf(rname, sizeof(rname), "record_%d", tp->idx);
+    rrc = rtpp_record_ctor(cfsp, bs.sp, rname, 1, RECORD_RTP);
+    if (rrc == NULL)
+        goto out;
+    memset(&rstats, '\0', sizeof(rstats));
+    pktx = (struct pkt_proc_ctx){.strmp_in = bs.sp->rtp->stream[1],
+      .strmp_out = bs.sp->rtp->stream[0], .rsp = &rstats};
+    for (i = 0; i < tp->op->npkts; i++) {
+        rtpp_timestamp_get(&rtime);
+        pktx.pktp = rtpp_bench_pkt(i, tp->op->psize, &rtime, &bs.caddrs[0]);
+        if (pktx.pktp == NULL) {
+            tp->res.nlost++;
+            continue;
+        }
+        t0 = getdtime();
+        CALL_SMETHOD(rrc, pktwrite, &pktx);
+        t1 = getdtime();
+        RTPP_OBJ_DECREF(pktx.pktp);
+        tp->res.nops++;
+        tp->res.etime += t1 - t0;
+        rtpp_bench_lreg(tp, t1 - t0);
+    }
+    RTPP_OBJ_DECREF(rrc);
+out:
+    rtpp_bench_sess_free(tp->inst, &bs);
+}
+
+const struct rtpp_bench rtpp_bench_record = {
+    .name = "record",
+    .descr = "writing RTP packets into the session recording",
+    .lunit = RTPP_BENCH_NS,
+    .needinst = 1,
+    .setup = rcb_setup,
+    .run = rcb_run,
+};
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Reference taking and dropping on a packet object, the operation the
+ * relay path does for the packet and the socket it is sent through. All
+ * threads share the same packet, so running more than one thread shows
+ * what the references handed between the processing and the sender
+ * threads cost once the counter's cache line bounces between CPUs.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config_pp.h"
+
+#include "rtpp_types.h"
+#include "rtpp_codeptr.h"
+#include "rtpp_refcnt.h"
+#include "rtpp_lhist.h"
+#include "rtpp_time.h"
+#include "rtp.h"
+#include "rtp_packet.h"
+
+#include "rtpp_bench.h"
+
+#define RCB_BATCH 64        /* Increments and decrements timed together */
+
+static void *
+rcb_setup(const struct rtpp_bench_opts *op, struct rtpp_bench_inst *inst)
+{
+
+    return (rtp_packet_alloc());
+}
+
+static void
+rcb_run(struct rtpp_bench_thr *tp)
+{
+    struct rtp_packet *pkt;
+    double t0, t1;
+    int i, j;
+
+    pkt = (struct rtp_packet *)tp->arg;
+    for (i = 0; i < tp->op->npkts; i += RCB_BATCH) {
+        t0 = getdtime();
+        for (j = 0; j < RCB_BATCH; j++) {
+            RTPP_OBJ_INCREF(pkt);
+            RTPP_OBJ_DECREF(pkt);
+        }
+        t1 = getdtime();
+        tp->res.nops += RCB_BATCH;
+        tp->res.etime += t1 - t0;
+        rtpp_bench_lreg(tp, (t1 - t0) / RCB_BATCH);
+    }
+}
+
+static void
+rcb_teardown(void *arg, struct rtpp_bench_res *rp)
+{
+
+    RTPP_OBJ_DECREF((struct rtp_packet *)arg);
+}
+
+const struct rtpp_bench rtpp_bench_refcnt = {
+    .name = "refcnt",
+    .descr = "incref/decref pair on a packet shared by all threads",
+    .lunit = RTPP_BENCH_NS,
+    .setup = rcb_setup,
+    .run = rcb_run,
+    .teardown = rcb_teardown,
+};
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Re-packetization of a steady 20 ms PCMU stream into 40 ms packets. The
+ * clock is simulated, so the resizer sees perfectly paced input no matter
+ * how fast the benchmark runs.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config_pp.h"
+
+#include "rtpp_types.h"
+#include "rtpp_cfg.h"
+#include "rtpp_codeptr.h"
+#include "rtpp_refcnt.h"
+#include "rtpp_lhist.h"
+#include "rtpp_time.h"
+#include "rtp.h"
+#include "rtp_packet.h"
+#include "rtp_resizer.h"
+#include "rtpp_proc.h"
+
+#include "rtpp_bench.h"
+
+#define RB_OPTIME 40        /* Output packetization, ms */
+#define RB_STIME  1000.0    /* Simulated clock starts here */
+
+static void *
+rb_setup(const struct rtpp_bench_opts *op, struct rtpp_bench_inst *inst)
+{
+
+    return (rtpp_bench_inst_cfg(inst));
+}
+
+static int
+rb_flush(struct rtp_resizer *rp, double dtime)
+{
+    struct rtp_packet *pkt;
+    int n;
+
+    for (n = 0; (pkt = rtp_resizer_get(rp, dtime)) != NULL; n++)
+        RTPP_OBJ_DECREF(pkt);
+    return (n);
+}
+
+static void
+rb_run(struct rtpp_bench_thr *tp)
+{
+    const struct rtpp_cfg *cfsp;
+    struct rtpp_proc_rstats rstats;
+    struct rtp_resizer *rp;
+    struct rtp_packet *pkt;
+    struct rtpp_timestamp rtime;
+    double ptime, t0, t1;
+    int i;
+
+    cfsp = (const struct rtpp_cfg *)tp->arg;
+    rp = rtp_resizer_new(RB_OPTIME);
+    if (rp == NULL)
+        return;
+    memset(&rstats, '\0', sizeof(rstats));
+    /* PCMU, one byte per sample */
+    ptime = (double)tp->op->psize / 8000.0;
+    for (i = 0; i < tp->op->npkts; i++) {
+        rtime.mono = rtime.wall = RB_STIME + i * ptime;
+        pkt = rtpp_bench_pkt(i, tp->op->psize, &rtime, NULL);
+        if (pkt == NULL) {
+            tp->res.nlost++;
+            continue;
+        }
+        t0 = getdtime();
+        rtp_resizer_enqueue(rp, &pkt, &rstats);
+        if (pkt != NULL) {
+            /* Not taken over by the resizer */
+            RTPP_OBJ_DECREF(pkt);
+            tp->res.nlost++;
+        }
+        rb_flush(rp, rtime.mono);
+        t1 = getdtime();
+        tp->res.nops++;
+        tp->res.etime += t1 - t0;
+        rtpp_bench_lreg(tp, t1 - t0);
+    }
+    rb_flush(rp, rtime.mono + 1.0);
+    rtp_resizer_free(cfsp->rtpp_stats, rp);
+}
+
+const struct rtpp_bench rtpp_bench_resizer = {
+    .name = "resizer",
+    .descr = "20 ms to 40 ms RTP re-packetization",
+    .lunit = RTPP_BENCH_NS,
+    .needinst = 1,
+    .setup = rb_setup,
+    .run = rb_run,
+};
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Packet ingress: reading packets off a stream's socket and running them
+ * through the source address check and latching. Each thread gets its
+ * own stream that is not known to the rtpproxy I/O threads, so it does
+ * not have to race them for the packets.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config_pp.h"
+
+#include "rtpp_types.h"
+#include "rtpp_cfg.h"
+#include "rtpp_codeptr.h"
+#include "rtpp_refcnt.h"
+#include "rtpp_command.h"
+#include "rtpp_lhist.h"
+#include "rtpp_pipe.h"
+#include "rtpp_socket.h"
+#include "rtpp_stream.h"
+#include "rtpp_time.h"
+#include "rtp.h"
+#include "rtp_packet.h"
+#include "rtpp_proc.h"
+#if ENABLE_MODULE_IF
+#include "rtpp_module_if.h"
+#include "rtpp_modman.h"
+#endif
+
+#include "rtpp_bench.h"
+
+#define SB_BURST 64         /* Packets queued on the socket per round */
+
+static struct rtpp_stream *
+sb_stream_ctor(const struct rtpp_cfg *cfsp, const struct sockaddr_in *laddr,
+  int *lportp)
+{
+    struct rtpp_stream *stp;
+    struct rtpp_socket *fds[2];
+    struct r_stream_ctor_args rsca = {
+        .log = cfsp->glog,
+        .proc_servers = cfsp->proc_servers,
+        .rtpp_stats = cfsp->rtpp_stats,
+        .side = RTPP_SSIDE_CALLER,
+        .pipe_type = PIPE_RTP,
+#if ENABLE_MODULE_IF
+        .nmodules = cfsp->modules_cf->count.total,
+#endif
+        .pproc_manager = cfsp->pproc_manager
+    };
+
+    stp = rtpp_stream_ctor(&rsca);
+    if (stp == NULL)
+        goto e0;
+    if (rtpp_create_listener(cfsp, (const struct sockaddr *)laddr, 0, lportp,
+      fds) == -1)
+        goto e1;
+    stp->laddr = (const struct sockaddr *)laddr;
+    stp->port = *lportp;
+    CALL_SMETHOD(stp, set_skt, fds[0]);
+    RTPP_OBJ_DECREF(fds[0]);
+    RTPP_OBJ_DECREF(fds[1]);
+    return (stp);
+e1:
+    RTPP_OBJ_DECREF(stp);
+e0:
+    return (NULL);
+}
+
+static void *
+sb_setup(const struct rtpp_bench_opts *op, struct rtpp_bench_inst *inst)
+{
+
+    return (rtpp_bench_inst_cfg(inst));
+}
+
+static void
+sb_run(struct rtpp_bench_thr *tp)
+{
+    const struct rtpp_cfg *cfsp;
+    struct rtpp_proc_rstats rstats;
+    struct rtpp_stream *stp;
+    struct rtp_packet *pkt;
+    struct rtpp_timestamp dtime;
+    struct sockaddr_in laddr, caddr, dst;
+    unsigned char buf[2048];
+    double t0, t1;
+    int cfd, i, j, len, lport, nsent;
+
+    cfsp = (const struct rtpp_cfg *)tp->arg;
+    memset(&laddr, '\0', sizeof(laddr));
+    laddr.sin_family = AF_INET;
+    laddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    stp = sb_stream_ctor(cfsp, &laddr, &lport);
+    if (stp == NULL)
+        return;
+    cfd = rtpp_bench_sock(&caddr);
+    if (cfd < 0)
+        goto out;
+    dst = laddr;
+    dst.sin_port = htons(lport);
+    memset(&rstats, '\0', sizeof(rstats));
+    for (i = 0; i < tp->op->npkts; i += nsent) {
+        for (nsent = 0; nsent < SB_BURST && i + nsent < tp->op->npkts; nsent++) {
+            len = rtpp_bench_rtp_fill(buf, i + nsent, (i + nsent) *
+              tp->op->psize, tp->op->psize, getdtime());
+            if (sendto(cfd, buf, len, 0, (struct sockaddr *)&dst,
+              sizeof(dst)) != len)
+                break;
+        }
+        tp->res.nlost += nsent;
+        rtpp_timestamp_get(&dtime);
+        for (j = 0; j < nsent + 1; j++) {
+            t0 = getdtime();
+            pkt = CALL_SMETHOD(stp, rx, cfsp->rtcp_streams_wrt, &dtime,
+              &rstats);
+            t1 = getdtime();
+            if (pkt == NULL)
+                break;
+            if (pkt == RTPP_S_RX_DCONT)
+                continue;
+            RTPP_OBJ_DECREF(pkt);
+            tp->res.nlost--;
+            tp->res.nops++;
+            tp->res.etime += t1 - t0;
+            rtpp_bench_lreg(tp, t1 - t0);
+        }
+        if (nsent == 0) {
+            tp->res.nlost += tp->op->npkts - i;
+            break;
+        }
+    }
+    close(cfd);
+out:
+    RTPP_OBJ_DECREF(stp);
+}
+
+const struct rtpp_bench rtpp_bench_stream_rx = {
+    .name = "stream_rx",
+    .descr = "socket read, source check and latching in rtpp_stream",
+    .lunit = RTPP_BENCH_NS,
+    .needinst = 1,
+    .setup = sb_setup,
+    .run = sb_run,
+};
@@ -79,8 +79,13 @@ decoder_new(struct session *sp, int dflags)
     return (void *)dp;
 }
 
+/*
+ * Make sure the output buffer has some decoded samples in it, refilling it
+ * from the next packet (or generated silence) as necessary. Returns the
+ * number of samples available or one of the DECODER_XXX codes.
+ */
 int32_t
-decoder_get(struct decoder_stream *dp)
+decoder_prime(struct decoder_stream *dp)
 {
     unsigned int cticks, t;
     int j;
@@ -133,18 +138,45 @@ decoder_get(struct decoder_stream *dp)
               sizeof(dp->obuf));
             if (j > 0)
                 dp->lpt = dp->pp->rpkt->pt;
+            dp->lpp = dp->pp;
             dp->pp = MYQ_NEXT(dp->pp);
             if (j <= 0)
-                return decoder_get(dp);
+                return decoder_prime(dp);
             dp->oblen = j / 2;
             dp->obp = dp->obuf;
         }
     }
+    return (dp->oblen);
+}
+
+int32_t
+decoder_get(struct decoder_stream *dp)
+{
+    int32_t r;
+
+    r = decoder_prime(dp);
+    if (r <= 0)
+        return (r);
     dp->oblen--;
     dp->obp += 1;
     return *(dp->obp - 1);
 }
 
+/*
+ * Consume nsamples from the output buffer, the caller has to make sure
+ * that many are available via decoder_prime().
+ */
+const int16_t *
+decoder_take(struct decoder_stream *dp, unsigned int nsamples)
+{
+    const int16_t *rp;
+
+    rp = dp->obp;
+    dp->oblen -= nsamples;
+    dp->obp += nsamples;
+    return (rp);
+}
+
 int
 decode_frame(struct decoder_stream *dp, int16_t *obuf, unsigned char *ibuf,
   unsigned int ibytes, unsigned int obytes_max)
@@ -55,6 +55,7 @@
 struct decoder_stream {
     struct session *sp;
     struct packet *pp;
+    struct packet *lpp;		/* last packet handed to the codec */
     unsigned int nticks;
     unsigned int sticks;
     unsigned char lpt;
@@ -79,9 +80,12 @@ struct decoder_stream {
 #define D_FLAG_NONE      0x0
 #define D_FLAG_NOSYNC    0x1
 #define D_FLAG_ERRFAIL   0x2
+#define D_FLAG_NOBLKMIX  0x4    /* always mix sample by sample */
 
 void *decoder_new(struct session *, int);
+int32_t decoder_prime(struct decoder_stream *);
 int32_t decoder_get(struct decoder_stream *);
+const int16_t *decoder_take(struct decoder_stream *, unsigned int);
 int decode_frame(struct decoder_stream *, int16_t *, unsigned char *,
   unsigned int, unsigned int);
 int generate_silence(struct decoder_stream *, int16_t *, unsigned int);
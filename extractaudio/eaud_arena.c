@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "eaud_arena.h"
+
+#define EAUD_ARENA_ALIGN (sizeof(max_align_t))
+#define EAUD_ARENA_DEFSZ (256 * 1024)
+
+struct eaud_arena_chunk {
+    struct eaud_arena_chunk *next;
+    size_t len;
+    size_t used;
+    max_align_t data[];
+};
+
+void
+eaud_arena_init(struct eaud_arena *ap, size_t csize)
+{
+
+    ap->chunks = NULL;
+    ap->csize = (csize > 0) ? csize : EAUD_ARENA_DEFSZ;
+}
+
+void *
+eaud_arena_alloc(struct eaud_arena *ap, size_t len)
+{
+    struct eaud_arena_chunk *acp;
+    size_t clen;
+    void *rval;
+
+    len = (len + EAUD_ARENA_ALIGN - 1) & ~(EAUD_ARENA_ALIGN - 1);
+    acp = ap->chunks;
+    if (acp == NULL || acp->len - acp->used < len) {
+        clen = (len > ap->csize) ? len : ap->csize;
+        acp = malloc(sizeof(*acp) + clen);
+        if (acp == NULL)
+            return (NULL);
+        acp->len = clen;
+        acp->used = 0;
+        acp->next = ap->chunks;
+        ap->chunks = acp;
+    }
+    rval = (unsigned char *)acp->data + acp->used;
+    acp->used += len;
+    return (rval);
+}
+
+void
+eaud_arena_free(struct eaud_arena *ap)
+{
+    struct eaud_arena_chunk *acp;
+
+    while (ap->chunks != NULL) {
+        acp = ap->chunks;
+        ap->chunks = acp->next;
+        free(acp);
+    }
+}
@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+
+#if HAVE_ERR_H
+# include <err.h>
+#endif
+
+#include "rtpp_types.h"
+#include "rtpp_time.h"
+#include "eaud_batch.h"
+
+/*
+ * Batch mode: convert many recorded sessions in one process using a pool
+ * of worker threads. The list of sessions comes either from a directory
+ * (every foo.a.rtp / foo.o.rtp pair found there is converted into
+ * foo.<ext> next to it), or from a manifest file with one session per
+ * line in the same "rdir outfile [link1] ... [linkN]" form that the
+ * command line accepts. The manifest can be read from the stdin by
+ * passing "-". Malformed or over-long manifest lines are skipped with a
+ * warning and counted as failed sessions.
+ */
+
+struct eaud_batch_ent {
+    struct eaud_job job;
+    char *sbuf;
+    char *aname;
+    char *bname;
+    char *oname;
+    char **links;
+};
+
+struct eaud_batch {
+    struct eaud_batch_ent *ents;
+    int nents;
+    int alen;
+    int next;
+    int nfailed;
+    pthread_mutex_t lock;
+    eaud_convert_t convert;
+    const struct eaud_opts *opts;
+};
+
+static char *
+eaud_batch_mkname(const char *prefix, const char *suffix)
+{
+    char *rval;
+    size_t len;
+
+    len = strlen(prefix) + strlen(suffix) + 1;
+    rval = malloc(len);
+    if (rval == NULL)
+        return (NULL);
+    snprintf(rval, len, "%s%s", prefix, suffix);
+    return (rval);
+}
+
+static void
+eaud_batch_ent_free(struct eaud_batch_ent *ep)
+{
+
+    if (ep->sbuf != NULL)
+        free(ep->sbuf);
+    if (ep->aname != NULL)
+        free(ep->aname);
+    if (ep->bname != NULL)
+        free(ep->bname);
+    if (ep->oname != NULL)
+        free(ep->oname);
+    if (ep->links != NULL)
+        free(ep->links);
+}
+
+static struct eaud_batch_ent *
+eaud_batch_add(struct eaud_batch *bp, const char *rdir, const char *oname)
+{
+    struct eaud_batch_ent *ep;
+
+    if (bp->nents == bp->alen) {
+        int nalen;
+
+        nalen = (bp->alen == 0) ? 64 : bp->alen * 2;
+        ep = realloc(bp->ents, nalen * sizeof(bp->ents[0]));
+        if (ep == NULL)
+            return (NULL);
+        bp->ents = ep;
+        bp->alen = nalen;
+    }
+    ep = &bp->ents[bp->nents];
+    memset(ep, '\0', sizeof(*ep));
+    ep->aname = eaud_batch_mkname(rdir, ".a.rtp");
+    ep->bname = eaud_batch_mkname(rdir, ".o.rtp");
+    ep->oname = strdup(oname);
+    if (ep->aname == NULL || ep->bname == NULL || ep->oname == NULL) {
+        eaud_batch_ent_free(ep);
+        return (NULL);
+    }
+    ep->job.aname = ep->aname;
+    ep->job.bname = ep->bname;
+    ep->job.oname = ep->oname;
+    bp->nents += 1;
+    return (ep);
+}
+
+static int
+eaud_batch_scandir(struct eaud_batch *bp, const char *dname, const char *oext)
+{
+    DIR *dirp;
+    struct dirent *dep;
+    struct stat sb;
+    char *rdir, *oname, *aname;
+    size_t nlen;
+    int rval;
+
+    dirp = opendir(dname);
+    if (dirp == NULL) {
+        warn("%s: can't open directory", dname);
+        return (-1);
+    }
+    rval = 0;
+    while ((dep = readdir(dirp)) != NULL) {
+        nlen = strlen(dep->d_name);
+        if (nlen <= 6 || strcmp(dep->d_name + nlen - 4, ".rtp") != 0)
+            continue;
+        if (strcmp(dep->d_name + nlen - 6, ".a.rtp") != 0 &&
+          strcmp(dep->d_name + nlen - 6, ".o.rtp") != 0)
+            continue;
+        rdir = malloc(strlen(dname) + 1 + nlen + 1);
+        if (rdir == NULL) {
+            rval = -1;
+            break;
+        }
+        sprintf(rdir, "%s/%.*s", dname, (int)(nlen - 6), dep->d_name);
+        /* Only pick up orphaned .o.rtp files, the rest goes with .a.rtp */
+        if (dep->d_name[nlen - 5] == 'o') {
+            aname = eaud_batch_mkname(rdir, ".a.rtp");
+            if (aname == NULL) {
+                free(rdir);
+                rval = -1;
+                break;
+            }
+            if (stat(aname, &sb) == 0) {
+                free(aname);
+                free(rdir);
+                continue;
+            }
+            free(aname);
+        }
+        oname = malloc(strlen(rdir) + 1 + strlen(oext) + 1);
+        if (oname == NULL) {
+            free(rdir);
+            rval = -1;
+            break;
+        }
+        sprintf(oname, "%s.%s", rdir, oext);
+        if (eaud_batch_add(bp, rdir, oname) == NULL)
+            rval = -1;
+        free(oname);
+        free(rdir);
+        if (rval != 0)
+            break;
+    }
+    closedir(dirp);
+    return (rval);
+}
+
+static int
+eaud_batch_readmanifest(struct eaud_batch *bp, const char *mname)
+{
+    FILE *f;
+    char lbuf[MAXPATHLEN * 4];
+    char *cp, *sbuf, *tok, **tv, **ntv;
+    struct eaud_batch_ent *ep;
+    int ntoks, lnum, rval, ch;
+    size_t llen;
+
+    if (strcmp(mname, "-") == 0) {
+        f = stdin;
+    } else {
+        f = fopen(mname, "r");
+        if (f == NULL) {
+            warn("%s: can't open manifest", mname);
+            return (-1);
+        }
+    }
+    rval = 0;
+    for (lnum = 1; fgets(lbuf, sizeof(lbuf), f) != NULL; lnum++) {
+        llen = strlen(lbuf);
+        if (llen > 0 && lbuf[llen - 1] != '\n' && !feof(f)) {
+            /* Don't let fgets() split an over-long line into two jobs */
+            warnx("%s:%d: line is too long, skipped", mname, lnum);
+            bp->nfailed += 1;
+            do {
+                ch = fgetc(f);
+            } while (ch != '\n' && ch != EOF);
+            continue;
+        }
+        if (lbuf[0] == '#')
+            continue;
+        sbuf = strdup(lbuf);
+        if (sbuf == NULL)
+            goto e0;
+        tv = NULL;
+        ntoks = 0;
+        for (cp = sbuf; (tok = strsep(&cp, " \t\r\n")) != NULL;) {
+            if (*tok == '\0')
+                continue;
+            ntv = realloc(tv, (ntoks + 1) * sizeof(tv[0]));
+            if (ntv == NULL)
+                goto e1;
+            tv = ntv;
+            tv[ntoks++] = tok;
+        }
+        if (ntoks == 0) {
+            free(sbuf);
+            continue;
+        }
+        if (ntoks < 2) {
+            warnx("%s:%d: missing outfile, skipped", mname, lnum);
+            bp->nfailed += 1;
+            free(tv);
+            free(sbuf);
+            continue;
+        }
+        ep = eaud_batch_add(bp, tv[0], tv[1]);
+        if (ep == NULL)
+            goto e1;
+        /* Everything after the outfile is the list of links */
+        ep->sbuf = sbuf;
+        ep->links = tv;
+        ep->job.links = tv + 2;
+        ep->job.nlinks = ntoks - 2;
+    }
+    goto out;
+e1:
+    if (tv != NULL)
+        free(tv);
+    free(sbuf);
+e0:
+    rval = -1;
+out:
+    if (f != stdin)
+        fclose(f);
+    return (rval);
+}
+
+static void *
+eaud_batch_worker(void *arg)
+{
+    struct eaud_batch *bp;
+    struct eaud_batch_ent *ep;
+    double stime;
+    int i, rval;
+
+    bp = (struct eaud_batch *)arg;
+    for (;;) {
+        pthread_mutex_lock(&bp->lock);
+        i = bp->next;
+        if (i < bp->nents)
+            bp->next += 1;
+        pthread_mutex_unlock(&bp->lock);
+        if (i >= bp->nents)
+            break;
+        ep = &bp->ents[i];
+        stime = getdtime();
+        rval = bp->convert(bp->opts, &ep->job);
+        fprintf(stderr, "%s: %s in %.3f sec\n", ep->job.oname,
+          (rval == 0) ? "converted" : "FAILED", getdtime() - stime);
+        if (rval != 0) {
+            pthread_mutex_lock(&bp->lock);
+            bp->nfailed += 1;
+            pthread_mutex_unlock(&bp->lock);
+        }
+    }
+    return (NULL);
+}
+
+int
+eaud_batch_run(const char *src, const char *oext, int njobs,
+  eaud_convert_t convert, const struct eaud_opts *opts)
+{
+    struct eaud_batch batch;
+    struct stat sb;
+    pthread_t *thrs;
+    double stime;
+    int i, nthrs, rval;
+
+    memset(&batch, '\0', sizeof(batch));
+    batch.convert = convert;
+    batch.opts = opts;
+    rval = -1;
+
+    if (strcmp(src, "-") != 0 && stat(src, &sb) == 0 && S_ISDIR(sb.st_mode)) {
+        if (eaud_batch_scandir(&batch, src, oext) != 0)
+            goto e0;
+    } else {
+        if (eaud_batch_readmanifest(&batch, src) != 0)
+            goto e0;
+    }
+    if (batch.nents == 0) {
+        rval = (batch.nfailed == 0) ? 0 : 1;
+        goto e0;
+    }
+
+    if (njobs <= 0) {
+        njobs = sysconf(_SC_NPROCESSORS_ONLN);
+        if (njobs <= 0)
+            njobs = 1;
+    }
+    if (njobs > batch.nents)
+        njobs = batch.nents;
+    thrs = malloc(njobs * sizeof(thrs[0]));
+    if (thrs == NULL)
+        goto e0;
+    if (pthread_mutex_init(&batch.lock, NULL) != 0)
+        goto e1;
+
+    stime = getdtime();
+    for (nthrs = 0; nthrs < njobs; nthrs++) {
+        if (pthread_create(&thrs[nthrs], NULL, eaud_batch_worker, &batch) != 0)
+            break;
+    }
+    if (nthrs == 0) {
+        /* Could not start any threads, do the work in this one */
+        eaud_batch_worker(&batch);
+    }
+    for (i = 0; i < nthrs; i++)
+        pthread_join(thrs[i], NULL);
+    fprintf(stderr, "batch: %d sessions, %d failed, %d workers, %.3f sec\n",
+      batch.nents, batch.nfailed, (nthrs == 0) ? 1 : nthrs,
+      getdtime() - stime);
+    rval = (batch.nfailed == 0) ? 0 : 1;
+
+    pthread_mutex_destroy(&batch.lock);
+e1:
+    free(thrs);
+e0:
+    for (i = 0; i < batch.nents; i++)
+        eaud_batch_ent_free(&batch.ents[i]);
+    if (batch.ents != NULL)
+        free(batch.ents);
+    return (rval);
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "config.h"
+
+#include "rtp_info.h"
+#include "decoder.h"
+#include "session.h"
+#include "eaud_mix.h"
+
+/*
+ * All loops in here are kept trivial on purpose, so that the compiler can
+ * turn them into vector code. The arithmetic matches the per-sample mixer
+ * in extractaudio.c bit by bit.
+ */
+static void
+eaud_mix_add(int32_t *restrict acc, const int16_t *restrict src, int n,
+  int seen)
+{
+    int i;
+
+    if (seen == 0) {
+        for (i = 0; i < n; i++)
+            acc[i] = src[i];
+    } else {
+        for (i = 0; i < n; i++)
+            acc[i] = (acc[i] + src[i]) / 2;
+    }
+}
+
+/*
+ * Mix up to maxlen samples starting at isample from every channel in the
+ * active set into abuf/bbuf. The block is cut short at the next sync point
+ * and at the start of any channel that is not active yet, so the result is
+ * the same as if the samples were mixed one by one. Returns the number of
+ * samples mixed, or 0 if one of the decoders has hit EOF or error and the
+ * caller has to go through the per-sample path instead.
+ */
+int
+eaud_mix_block(struct channels *ap, int64_t isample, int64_t sync_sample,
+  int maxlen, int32_t *abuf, int32_t *bbuf, uint64_t *nasamples,
+  uint64_t *nbsamples)
+{
+    struct cnode *cnp;
+    const int16_t *src;
+    int32_t r;
+    int blen, seen_a, seen_b;
+
+    blen = maxlen;
+    if (sync_sample > isample && sync_sample - isample < blen)
+        blen = sync_sample - isample;
+    MYQ_FOREACH(cnp, ap) {
+        if (cnp->cp->skip > isample) {
+            if (cnp->cp->skip - isample < blen)
+                blen = cnp->cp->skip - isample;
+            continue;
+        }
+        r = decoder_prime(cnp->cp->decoder);
+        if (r <= 0)
+            return (0);
+        if (r < blen)
+            blen = r;
+    }
+
+    seen_a = seen_b = 0;
+    MYQ_FOREACH(cnp, ap) {
+        if (cnp->cp->skip > isample)
+            continue;
+        src = decoder_take(cnp->cp->decoder, blen);
+        if (cnp->cp->origin == A_CH) {
+            eaud_mix_add(abuf, src, blen, seen_a);
+            *nasamples += blen;
+            seen_a = 1;
+        } else {
+            eaud_mix_add(bbuf, src, blen, seen_b);
+            *nbsamples += blen;
+            seen_b = 1;
+        }
+    }
+    if (seen_a == 0)
+        memset(abuf, 0, blen * sizeof(abuf[0]));
+    if (seen_b == 0)
+        memset(bbuf, 0, blen * sizeof(bbuf[0]));
+    return (blen);
+}
+
+void
+eaud_mix_out_mono(int16_t *restrict obuf, const int32_t *restrict abuf,
+  const int32_t *restrict bbuf, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        obuf[i] = (abuf[i] + bbuf[i]) / 2;
+}
+
+void
+eaud_mix_out_stereo(int16_t *restrict obuf, const int32_t *restrict abuf,
+  const int32_t *restrict bbuf, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        obuf[i * 2] = abuf[i];
+        obuf[i * 2 + 1] = bbuf[i];
+    }
+}
@@ -0,0 +1,547 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/ip6.h>
+#include <netinet/udp.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sndfile.h>
+
+#include "config.h"
+
+#if HAVE_ERR_H
+# include <err.h>
+#endif
+
+#include "rtpp_types.h"
+#include "rtp_info.h"
+#include "rtpp_record_adhoc.h"
+#include "rtpp_record_private.h"
+#include "rtpp_time.h"
+#include "rtp.h"
+#include "session.h"
+#include "decoder.h"
+#include "rtpp_loader.h"
+#include "eaud_pcap.h"
+#include "eaud_mix.h"
+#include "eaud_substreams.h"
+#include "eaud_batch.h"
+#include "eaud_stream.h"
+
+/*
+ * Streaming mode: follow recordings that are still being written, decode
+ * and output audio as it comes in. Unlike the regular loader, which needs
+ * the whole file mmap()ed, files are read incrementally and every
+ * complete record is copied out into its own packet, which is freed as
+ * soon as the decoder is done with it, so memory use does not depend on
+ * the length of the call.
+ *
+ * Audio is only produced up to EAUD_STREAM_DELAY behind the newest packet
+ * seen, to give reordered or late packets a chance to get in. A stream
+ * that runs out of packets before that is considered paused, its channel
+ * is dropped and started afresh at the current output position once
+ * packets for it start to arrive again. The whole thing ends once none of
+ * the input files has grown for the idle timeout, at which point whatever
+ * is still queued is decoded and the output is closed.
+ */
+
+#define EAUD_STREAM_DELAY 0.5     /* seconds */
+#define EAUD_STREAM_POLL  200000  /* usec */
+#define EAUD_STREAM_RDSZ  (64 * 1024)
+
+enum eaud_src_type {EAUD_SRC_UNKN = 0, EAUD_SRC_ADHOC, EAUD_SRC_PCAP};
+
+struct eaud_stream_src {
+    const char *path;
+    enum origin origin;
+    int fd;
+    enum eaud_src_type type;
+    int network;
+    unsigned char *buf;
+    size_t blen;
+    size_t balen;
+    double ltime;
+    int pending;
+};
+
+struct eaud_stream {
+    struct eaud_stream_src srcs[2];
+    int nsrcs;
+    struct channels channels;
+    struct channels act;
+    double basetime;
+    double ltime;
+    int64_t isample;
+    int dflags;
+    int stereo;
+    SNDFILE *sffile;
+    uint64_t nasamples;
+    uint64_t nbsamples;
+    uint64_t nwsamples;
+};
+
+/*
+ * Read at most one EAUD_STREAM_RDSZ chunk, so that only that much plus
+ * the incomplete record left over from the previous call is ever held
+ * in the buffer, no matter how much of the file is already there.
+ */
+static int
+eaud_stream_read(struct eaud_stream_src *srcp)
+{
+    unsigned char *nbuf;
+    ssize_t rlen;
+
+    if (srcp->balen - srcp->blen < EAUD_STREAM_RDSZ) {
+        nbuf = realloc(srcp->buf, srcp->blen + EAUD_STREAM_RDSZ);
+        if (nbuf == NULL) {
+            warn("realloc() failed");
+            return (-1);
+        }
+        srcp->buf = nbuf;
+        srcp->balen = srcp->blen + EAUD_STREAM_RDSZ;
+    }
+    do {
+        rlen = read(srcp->fd, srcp->buf + srcp->blen, EAUD_STREAM_RDSZ);
+    } while (rlen < 0 && errno == EINTR);
+    if (rlen < 0) {
+        warn("%s: read() failed", srcp->path);
+        return (-1);
+    }
+    srcp->blen += rlen;
+    /* Full chunk, there is likely more where it came from */
+    srcp->pending = (rlen == EAUD_STREAM_RDSZ);
+    return (rlen);
+}
+
+static int
+eaud_stream_enqueue(struct eaud_stream *esp, struct eaud_stream_src *srcp,
+  double dtime, const unsigned char *data, int len)
+{
+    struct packet *pack;
+    struct pkt_hdr_adhoc *ahp;
+    int rval;
+
+    /* Packet, adhoc header and the RTP data all in one chunk */
+    pack = malloc(sizeof(*pack) + sizeof(*ahp) + len);
+    if (pack == NULL) {
+        warn("malloc() failed");
+        return (-1);
+    }
+    ahp = (struct pkt_hdr_adhoc *)&pack[1];
+    memset(ahp, '\0', sizeof(*ahp));
+    ahp->time = dtime;
+    ahp->plen = len;
+    pack->pkt = ahp;
+    pack->rpkt = (rtp_hdr_t *)&ahp[1];
+    memcpy(pack->rpkt, data, len);
+    if (rtp_packet_parse_raw((unsigned char *)pack->rpkt, len,
+      &(pack->parsed)) != RTP_PARSER_OK || pack->parsed.nsamples <= 0) {
+        free(pack);
+        return (0);
+    }
+    rval = rtpp_loader_enqueue(&esp->channels, pack, srcp->origin);
+    if (rval <= 0)
+        free(pack);
+    if (rval > 0 && dtime > esp->ltime)
+        esp->ltime = dtime;
+    if (rval > 0 && dtime > srcp->ltime)
+        srcp->ltime = dtime;
+    return (rval);
+}
+
+static int
+eaud_stream_parse(struct eaud_stream *esp, struct eaud_stream_src *srcp)
+{
+    unsigned char *cp, *ep;
+    size_t rlen;
+    pcap_hdr_t pcap_hdr;
+    struct pkt_hdr_adhoc ahdr;
+    pcaprec_hdr_t rhdr;
+    struct pcap_dissect pd;
+    int rval;
+
+    cp = srcp->buf;
+    ep = srcp->buf + srcp->blen;
+    if (srcp->type == EAUD_SRC_UNKN) {
+        if (srcp->blen < sizeof(uint32_t))
+            return (0);
+        if (*(uint32_t *)cp != PCAP_MAGIC) {
+            srcp->type = EAUD_SRC_ADHOC;
+        } else {
+            if (srcp->blen < sizeof(pcap_hdr))
+                return (0);
+            memcpy(&pcap_hdr, cp, sizeof(pcap_hdr));
+            if (pcap_hdr.network != DLT_EN10MB && pcap_hdr.network != DLT_NULL) {
+                warnx("%s: unsupported data-link type in the PCAP: %d",
+                  srcp->path, pcap_hdr.network);
+                return (-1);
+            }
+            if (pcap_hdr.version_major != PCAP_VER_MAJR ||
+              pcap_hdr.version_minor != PCAP_VER_MINR) {
+                warnx("%s: unsupported version of the PCAP: %d.%d", srcp->path,
+                  pcap_hdr.version_major, pcap_hdr.version_minor);
+                return (-1);
+            }
+            srcp->type = EAUD_SRC_PCAP;
+            srcp->network = pcap_hdr.network;
+            cp += sizeof(pcap_hdr);
+        }
+    }
+    while (cp < ep) {
+        rval = 0;
+        if (srcp->type == EAUD_SRC_ADHOC) {
+            if (ep - cp < sizeof(ahdr))
+                break;
+            memcpy(&ahdr, cp, sizeof(ahdr));
+            rlen = sizeof(ahdr) + ahdr.plen;
+            if (ep - cp < rlen)
+                break;
+            if (ahdr.plen >= sizeof(rtp_hdr_t))
+                rval = eaud_stream_enqueue(esp, srcp, ahdr.time,
+                  cp + sizeof(ahdr), ahdr.plen);
+        } else {
+            if (ep - cp < sizeof(rhdr))
+                break;
+            memcpy(&rhdr, cp, sizeof(rhdr));
+            rlen = sizeof(rhdr) + rhdr.incl_len;
+            if (ep - cp < rlen)
+                break;
+            if (eaud_pcap_dissect(cp, rlen, srcp->network, &pd) == PCP_DSCT_OK &&
+              pd.l5_len >= sizeof(rtp_hdr_t))
+                rval = eaud_stream_enqueue(esp, srcp,
+                  ts2dtime(rhdr.ts_sec, rhdr.ts_usec), pd.l5_data, pd.l5_len);
+        }
+        if (rval < 0)
+            return (-1);
+        cp += rlen;
+    }
+    /* Keep the incomplete tail around until the rest of it arrives */
+    srcp->blen = ep - cp;
+    memmove(srcp->buf, cp, srcp->blen);
+    return (0);
+}
+
+/*
+ * Start decoding channels that have just appeared and feed newly arrived
+ * packets to the ones whose decoder has caught up with the input.
+ */
+static int
+eaud_stream_refresh(struct eaud_stream *esp)
+{
+    struct cnode *cnp;
+    struct channel *cp;
+    struct decoder_stream *dp;
+    double skip;
+
+    MYQ_FOREACH(cnp, &esp->channels) {
+        cp = cnp->cp;
+        dp = cp->decoder;
+        if (dp != NULL) {
+            if (dp->pp == NULL && dp->lpp != NULL)
+                dp->pp = MYQ_NEXT(dp->lpp);
+            continue;
+        }
+        if (esp->basetime < 0)
+            esp->basetime = MYQ_FIRST(&cp->session)->pkt->time;
+        skip = (MYQ_FIRST(&cp->session)->pkt->time - esp->basetime) * 8000;
+        cp->skip = (skip > esp->isample) ? skip : esp->isample;
+        cp->decoder = decoder_new(&cp->session, esp->dflags);
+        if (cp->decoder == NULL) {
+            warn("decoder_new() failed");
+            return (-1);
+        }
+        if (channel_insert(&esp->act, cp) < 0) {
+            warn("channel_insert() failed");
+            return (-1);
+        }
+    }
+    return (0);
+}
+
+/* Free packets that the decoder is done with */
+static void
+eaud_stream_reap(struct eaud_stream *esp)
+{
+    struct cnode *cnp;
+    struct session *sp;
+    struct decoder_stream *dp;
+    struct packet *pp;
+
+    MYQ_FOREACH(cnp, &esp->channels) {
+        dp = cnp->cp->decoder;
+        if (dp == NULL)
+            continue;
+        sp = &(cnp->cp->session);
+        while ((pp = MYQ_FIRST(sp)) != NULL && pp != dp->pp && pp != dp->lpp) {
+            MYQ_REMOVE(sp, pp);
+            free(pp);
+        }
+    }
+}
+
+static void
+eaud_stream_free(struct channels *channels, struct cnode *cnp)
+{
+    struct session *sp;
+    struct packet *pp;
+
+    sp = &(cnp->cp->session);
+    while ((pp = MYQ_FIRST(sp)) != NULL) {
+        MYQ_REMOVE(sp, pp);
+        free(pp);
+    }
+    channel_remove(channels, cnp, 1);
+}
+
+static void
+eaud_stream_drop(struct eaud_stream *esp, struct cnode *cnp)
+{
+    struct cnode *tnp;
+
+    tnp = eaud_ss_find(&esp->channels, cnp->cp);
+    channel_remove(&esp->act, cnp, 0);
+    eaud_stream_free(&esp->channels, tnp);
+}
+
+static int
+eaud_stream_write(struct eaud_stream *esp, int16_t *obuf, int oblen)
+{
+
+    if (sf_write_short(esp->sffile, obuf, oblen) != oblen) {
+        warnx("sf_write_short() failed");
+        return (-1);
+    }
+    esp->nwsamples += oblen;
+    return (0);
+}
+
+/*
+ * Mix everything up to hsample, or until all channels are exhausted if
+ * final is set.
+ */
+static int
+eaud_stream_mix(struct eaud_stream *esp, int64_t hsample, int final)
+{
+    int16_t obuf[EAUD_MIX_MAXBLK];
+    int32_t abuf[EAUD_MIX_MAXBLK], bbuf[EAUD_MIX_MAXBLK];
+    int32_t asample, bsample, csample;
+    struct cnode *cnp, *cnp_next;
+    int nout, maxlen, nblk, seen_a, seen_b;
+
+    nout = (esp->stereo == 0) ? 1 : 2;
+    while (final ? !MYQ_EMPTY(&esp->act) : esp->isample < hsample) {
+        maxlen = EAUD_MIX_MAXBLK / nout;
+        if (!final && hsample - esp->isample < maxlen)
+            maxlen = hsample - esp->isample;
+        if ((esp->dflags & D_FLAG_NOBLKMIX) == 0) {
+            nblk = eaud_mix_block(&esp->act, esp->isample, -1, maxlen, abuf,
+              bbuf, &esp->nasamples, &esp->nbsamples);
+        } else {
+            nblk = 0;
+        }
+        if (nblk > 0) {
+            if (esp->stereo == 0) {
+                eaud_mix_out_mono(obuf, abuf, bbuf, nblk);
+            } else {
+                eaud_mix_out_stereo(obuf, abuf, bbuf, nblk);
+            }
+            if (eaud_stream_write(esp, obuf, nblk * nout) != 0)
+                return (-1);
+            esp->isample += nblk;
+            continue;
+        }
+        /* Some decoder has run dry or failed, go sample by sample */
+        asample = bsample = 0;
+        seen_a = seen_b = 0;
+        for (cnp = MYQ_FIRST(&esp->act); cnp != NULL; cnp = cnp_next) {
+            cnp_next = MYQ_NEXT(cnp);
+            if (cnp->cp->skip > esp->isample)
+                continue;
+            csample = decoder_get(cnp->cp->decoder);
+            if (csample == DECODER_EOF) {
+                eaud_stream_drop(esp, cnp);
+                continue;
+            }
+            if (csample == DECODER_ERROR)
+                continue;
+            if (cnp->cp->origin == A_CH) {
+                asample = (seen_a != 0) ? (asample + csample) / 2 : csample;
+                esp->nasamples++;
+                seen_a = 1;
+            } else {
+                bsample = (seen_b != 0) ? (bsample + csample) / 2 : csample;
+                esp->nbsamples++;
+                seen_b = 1;
+            }
+        }
+        if (final && MYQ_EMPTY(&esp->act))
+            break;
+        if (esp->stereo == 0) {
+            obuf[0] = (asample + bsample) / 2;
+        } else {
+            obuf[0] = asample;
+            obuf[1] = bsample;
+        }
+        if (eaud_stream_write(esp, obuf, nout) != 0)
+            return (-1);
+        esp->isample += 1;
+    }
+    return (0);
+}
+
+/*
+ * Newest arrival time audio can be produced up to. While still catching
+ * up with what is already in the files, stay behind the source that has
+ * been read the least, so that its older packets are not taken for late.
+ */
+static double
+eaud_stream_htime(const struct eaud_stream *esp)
+{
+    const struct eaud_stream_src *srcp;
+    double htime;
+    int i;
+
+    htime = -1;
+    for (i = 0; i < esp->nsrcs; i++) {
+        srcp = &esp->srcs[i];
+        if (srcp->pending && (htime < 0 || srcp->ltime < htime))
+            htime = srcp->ltime;
+    }
+    return ((htime < 0) ? esp->ltime : htime);
+}
+
+int
+eaud_stream_run(const struct eaud_job *job, SF_INFO *sfinfo, int stereo,
+  int dflags, int idle)
+{
+    struct eaud_stream es, *esp;
+    struct eaud_stream_src *srcp;
+    double now, lgrow;
+    int64_t hsample;
+    int i, n, ngrown, final, rval;
+
+    esp = &es;
+    memset(esp, '\0', sizeof(*esp));
+    MYQ_INIT(&esp->channels);
+    MYQ_INIT(&esp->act);
+    esp->basetime = -1;
+    /* Stream positions are only ever derived from the arrival times */
+    esp->dflags = dflags & ~D_FLAG_NOSYNC;
+    esp->stereo = stereo;
+    rval = -1;
+
+    for (i = 0; i < 2; i++) {
+        srcp = &esp->srcs[esp->nsrcs];
+        srcp->path = (i == 0) ? job->aname : job->bname;
+        srcp->origin = (i == 0) ? A_CH : B_CH;
+        if (srcp->path == NULL)
+            continue;
+        srcp->fd = open(srcp->path, O_RDONLY);
+        if (srcp->fd < 0) {
+            if ((dflags & D_FLAG_ERRFAIL) != 0) {
+                warn("%s: can't open", srcp->path);
+                goto e0;
+            }
+            continue;
+        }
+        esp->nsrcs += 1;
+    }
+    if (esp->nsrcs == 0) {
+        warnx("cannot open neither %s nor %s", job->aname, job->bname);
+        goto e0;
+    }
+
+    esp->sffile = sf_open(job->oname, SFM_WRITE, sfinfo);
+    if (esp->sffile == NULL) {
+        warnx("%s: can't open output file", job->oname);
+        goto e0;
+    }
+
+    lgrow = getdtime();
+    do {
+        ngrown = 0;
+        for (i = 0; i < esp->nsrcs; i++) {
+            srcp = &esp->srcs[i];
+            n = eaud_stream_read(srcp);
+            if (n < 0)
+                goto e1;
+            if (n == 0)
+                continue;
+            ngrown += 1;
+            if (eaud_stream_parse(esp, srcp) != 0)
+                goto e1;
+        }
+        now = getdtime();
+        if (ngrown > 0)
+            lgrow = now;
+        final = (now - lgrow) >= idle;
+        if (eaud_stream_refresh(esp) != 0)
+            goto e1;
+        if (esp->basetime >= 0) {
+            hsample = (eaud_stream_htime(esp) - EAUD_STREAM_DELAY -
+              esp->basetime) * 8000;
+            if (eaud_stream_mix(esp, hsample, final) != 0)
+                goto e1;
+            eaud_stream_reap(esp);
+            sf_write_sync(esp->sffile);
+        }
+        if (ngrown == 0 && !final)
+            usleep(EAUD_STREAM_POLL);
+    } while (!final);
+    fprintf(stderr, "samples decoded: O: %" PRIu64 ", A: %" PRIu64
+      ", written: %" PRIu64 "\n", esp->nbsamples, esp->nasamples,
+      esp->nwsamples);
+    rval = 0;
+
+    for (i = job->nlinks - 1; i >= 0; i--) {
+        link(job->oname, job->links[i]);
+    }
+e1:
+    sf_close(esp->sffile);
+e0:
+    while (!MYQ_EMPTY(&esp->act))
+        channel_remove(&esp->act, MYQ_FIRST(&esp->act), 0);
+    while (!MYQ_EMPTY(&esp->channels))
+        eaud_stream_free(&esp->channels, MYQ_FIRST(&esp->channels));
+    for (i = 0; i < esp->nsrcs; i++) {
+        close(esp->srcs[i].fd);
+        if (esp->srcs[i].buf != NULL)
+            free(esp->srcs[i].buf);
+    }
+    return (rval);
+}
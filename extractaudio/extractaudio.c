@@ -77,6 +77,9 @@
 # include "eaud_crypto.h"
 #endif
 #include "eaud_substreams.h"
+#include "eaud_mix.h"
+#include "eaud_batch.h"
+#include "eaud_stream.h"
 
 /*#define EAUD_DUMPRAW "/tmp/eaud.raw"*/
 
@@ -84,12 +87,23 @@
 #define LOPT_ALICE_CRYPTO 256
 #define LOPT_BOB_CRYPTO   257
 #endif
+#define LOPT_NOBLKMIX     258
+
+struct eaud_opts {
+    int dflags;
+    int stereo;
+    int delete;
+    int batch;
+    SF_INFO sfinfo;
+};
 
 const static struct option longopts[] = {
 #if ENABLE_SRTP || ENABLE_SRTP2
     { "alice-crypto", required_argument, NULL, LOPT_ALICE_CRYPTO },
     { "bob-crypto",   required_argument, NULL, LOPT_BOB_CRYPTO },
 #endif
+    /* Disables the block mixer, only there for testing */
+    { "no-block-mix", no_argument,       NULL, LOPT_NOBLKMIX },
     { NULL,           0,                 NULL, 0 }
 };
 
@@ -101,15 +115,17 @@ const static struct option longopts[] = {
 RTPP_MEMDEB_APP_STATIC;
 #endif
 
-const static char *usage_msg[8] = {
-  "%s\n%s\n%s\n%s\n%s\n%s\n%s\n",
+const static char *usage_msg[10] = {
+  "%s\n%s\n%s\n%s\n%s\n%s\n%s\n%s\n%s\n",
   "usage: extractaudio [-idsne] [-F file_fmt] [-D data_fmt] rdir outfile",
   "                    [link1] ... [linkN]",
   "       extractaudio [-idsne] [-F file_fmt] [-D data_fmt] [-A answer_cap]",
   "                    [-B originate_cap] [--alice-crypto CSPEC]",
   "                    [--bob-crypto CSPEC] outfile [link1] ... [linkN]",
   "       extractaudio -S [-A answer_cap] [-B originate_cap]",
-  "       extractaudio -S rdir"
+  "       extractaudio -S rdir",
+  "       extractaudio -b [-j njobs] [-idsne] [-F fmt] [-D fmt] rdir|manifest",
+  "       extractaudio -f idle_sec [-idsne] [-F fmt] [-D fmt] rdir outfile"
 };
 
 static void
@@ -117,7 +133,8 @@ usage(void)
 {
 
     fprintf(stderr, usage_msg[0], usage_msg[1], usage_msg[2], usage_msg[3],
-      usage_msg[4], usage_msg[5], usage_msg[6], usage_msg[7]);
+      usage_msg[4], usage_msg[5], usage_msg[6], usage_msg[7], usage_msg[8],
+      usage_msg[9]);
     exit(1);
 }
 
@@ -158,17 +175,13 @@ channel_insert(struct channels *channels, struct channel *channel)
     return 0;
 }
 
-static void
+void
 channel_remove(struct channels *channels, struct cnode *cnp, int dealloc)
 {
+    /* Packets belong to whoever has loaded them */
     if (dealloc != 0) {
-        struct session *sp = &(cnp->cp->session);
-        while (!MYQ_EMPTY(sp)) {
-            struct packet *pkt = MYQ_FIRST(sp);
-            MYQ_REMOVE(sp, pkt);
-            free(pkt);
-        }
-        free(cnp->cp->decoder);
+        if (cnp->cp->decoder != NULL)
+            free(cnp->cp->decoder);
         free(cnp->cp);
     }
 
@@ -178,7 +191,7 @@ channel_remove(struct channels *channels, struct cnode *cnp, int dealloc)
 
 static int
 load_session(const char *path, struct channels *channels, enum origin origin,
-  struct eaud_crypto *crypto)
+  struct eaud_crypto *crypto, struct rtpp_loader **loaderp, int batch)
 {
     int pcount, jc;
     struct rtpp_session_stat stat;
@@ -195,6 +208,9 @@ load_session(const char *path, struct channels *channels, enum origin origin,
 
     update_rtpp_totals(&stat, &stat);
     jc = get_jitter_stats(stat.jdata, &jstat, NULL);
+    flockfile(stdout);
+    if (batch)
+        printf("%s: ", path);
     printf("pcount=%u, min_seq=%u, max_seq=%u, seq_offset=%u, ssrc=0x%.8X, duplicates=%u\n",
       (unsigned int)stat.last.pcount, (unsigned int)stat.last.min_seq, (unsigned int)stat.last.max_seq,
       (unsigned int)stat.last.seq_offset, (unsigned int)stat.last.ssrc.val, (unsigned int)stat.last.duplicates);
@@ -204,8 +220,10 @@ load_session(const char *path, struct channels *channels, enum origin origin,
         printf("last_jitter=%f,average_jitter=%f,max_jitter=%f\n",
           jstat.jlast, jstat.javg, jstat.jmax);
     }
+    funlockfile(stdout);
 
-    loader->destroy(loader);
+    /* Packets point into the loader's buffer, caller destroys it when done */
+    *loaderp = loader;
     rtpp_stats_destroy(&stat);
 
     return pcount;
@@ -232,199 +250,59 @@ e0:
     return -1;
 }
 
-int
-main(int argc, char **argv)
+static int
+eaud_convert(const struct eaud_opts *opts, const struct eaud_job *job)
 {
-    int ch, seen_a, seen_b;
-    int oblen, delete, stereo, idprio, nch, neof;
+    int seen_a, seen_b;
+    int oblen, nch, neof, nloaded, nout, nblk, dflags, i, rval;
     int32_t bsample, asample, csample;
     uint64_t nasamples, nbsamples, nwsamples;
     struct channels channels, act_subset, *ap;
-    struct cnode *cnp;
-#if defined(__FreeBSD__)
-    struct rtprio rt;
-#endif
-    int16_t obuf[1024];
-    char aname_s[MAXPATHLEN], bname_s[MAXPATHLEN];
+    struct cnode *cnp, *cnp_next;
+    struct rtpp_loader *aloader, *bloader;
+    int16_t obuf[EAUD_MIX_MAXBLK];
+    int32_t abuf[EAUD_MIX_MAXBLK], bbuf[EAUD_MIX_MAXBLK];
     const char *aname, *bname;
     double basetime;
     SF_INFO sfinfo;
     SNDFILE *sffile;
-    int dflags, nloaded;
-    const struct supported_fmt *sf_of;
-    uint32_t use_file_fmt, use_data_fmt;
-    uint32_t dflt_file_fmt, dflt_data_fmt;
-    int option_index;
-    struct eaud_crypto *alice_crypto, *bob_crypto;
     int64_t isample, sync_sample;
 
-#ifdef RTPP_CHECK_LEAKS
-    RTPP_MEMDEB_APP_INIT();
-#endif
-
     MYQ_INIT(&channels);
     MYQ_INIT(&act_subset);
-    memset(&sfinfo, 0, sizeof(sfinfo));
-    sfinfo.samplerate = 8000;
-    sfinfo.channels = 1;
-    use_file_fmt = use_data_fmt = 0;
-    dflt_file_fmt = SF_FORMAT_WAV;
-    dflt_data_fmt = SF_FORMAT_GSM610;
-
-    delete = stereo = idprio = 0;
-    dflags = D_FLAG_NONE;
-    aname = bname = NULL;
-    alice_crypto = bob_crypto = NULL;
+    aloader = bloader = NULL;
+    aname = job->aname;
+    bname = job->bname;
+    dflags = opts->dflags;
     isample = -1;
     sync_sample = 0;
-    int scanonly = 0;
-    int ecode = 0;
-
-    while ((ch = getopt_long(argc, argv, "dsSineF:D:A:B:U:", longopts,
-      &option_index)) != -1)
-        switch (ch) {
-        case 'd':
-            delete = 1;
-            break;
-
-        case 's':
-            stereo = 1;
-            sfinfo.channels = 2;
-            /* GSM+WAV doesn't work with more than 1 channels */
-            dflt_data_fmt = SF_FORMAT_MS_ADPCM;
-            break;
-
-        case 'i':
-            idprio = 1;
-            break;
-
-        case 'n':
-            dflags |= D_FLAG_NOSYNC;
-            break;
-
-        case 'F':
-            sf_of = pick_format(optarg, eaud_file_fmts);
-            if (sf_of == NULL) {
-                warnx("unknown output file format: \"%s\"", optarg);
-                dump_formats_descr("Supported file formats:\n", eaud_file_fmts);
-                ecode = 1;
-                goto done;
-            }
-            use_file_fmt = sf_of->id;
-            break;
-
-        case 'D':
-            sf_of = pick_format(optarg, eaud_data_fmts);
-            if (sf_of == NULL) {
-                warnx("unknown output data format: \"%s\"", optarg);
-                dump_formats_descr("Supported data formats:\n", eaud_data_fmts);
-                ecode = 1;
-                goto done;
-            }
-            use_data_fmt = sf_of->id;
-            break;
-
-        case 'A':
-            aname = optarg;
-            break;
-
-        case 'B':
-            bname = optarg;
-            break;
-
-#if ENABLE_SRTP || ENABLE_SRTP2
-        case LOPT_ALICE_CRYPTO:
-            alice_crypto = eaud_crypto_getopt_parse(optarg);
-            if (alice_crypto == NULL) {
-                ecode = 1;
-                goto done;
-            }
-            break;
-
-        case LOPT_BOB_CRYPTO:
-            bob_crypto = eaud_crypto_getopt_parse(optarg);
-            if (bob_crypto == NULL) {
-                ecode = 1;
-                goto done;
-            }
-            break;
-#endif
-
-        case 'S':
-            scanonly = 1;
-            break;
-
-        case 'e':
-            dflags |= D_FLAG_ERRFAIL;
-            break;
-
-        case '?':
-        default:
-            usage();
-        }
-    argc -= optind;
-    argv += optind;
-
-    if (aname == NULL && bname == NULL) {
-        if ((argc < 2 && !scanonly) || (scanonly && argc != 1))
-            usage();
-    } else if ((argc == 0 && !scanonly) || (scanonly && argc != 0)) {
-        usage();
-    }
-
-    if (use_file_fmt == 0) {
-        use_file_fmt = dflt_file_fmt;
-    }
-    if (use_data_fmt == 0) {
-        use_data_fmt = dflt_data_fmt;
-    }
-
-    if (idprio != 0) {
-#if defined(__FreeBSD__)
-        rt.type = RTP_PRIO_IDLE;
-        rt.prio = RTP_PRIO_MAX;
-        rtprio(RTP_SET, 0, &rt);
-#else
-        setpriority(PRIO_PROCESS, 0, 20);
-#endif
-    }
-
-    if (aname == NULL && bname == NULL) {
-        sprintf(aname_s, "%s.a.rtp", argv[0]);
-        aname = aname_s;
-        sprintf(bname_s, "%s.o.rtp", argv[0]);
-        bname = bname_s;
-        argv += 1;
-        argc -= 1;
-    }
-
-    if (scanonly) {
-        if (aname != NULL) {
-            printf("%s: %d\n", aname, scan_session(aname));
-        }
-        if (bname != NULL) {
-            printf("%s: %d\n", bname, scan_session(bname));
-        }
-        goto done;
-    }
+    rval = 0;
 
     nloaded = 0;
     if (aname != NULL) {
-        if (load_session(aname, &channels, A_CH, alice_crypto) >= 0) {
+        if (load_session(aname, &channels, A_CH, job->alice_crypto,
+          &aloader, opts->batch) >= 0) {
             nloaded += 1;
         } else if (dflags & D_FLAG_ERRFAIL) {
-            errx(1, "cannot load %s", aname);
+            warnx("cannot load %s", aname);
+            rval = 1;
+            goto done;
         }
     }
     if (bname != NULL) {
-        if (load_session(bname, &channels, B_CH, bob_crypto) >= 0) {
+        if (load_session(bname, &channels, B_CH, job->bob_crypto,
+          &bloader, opts->batch) >= 0) {
             nloaded += 1;
         } else if (dflags & D_FLAG_ERRFAIL) {
-            errx(1, "cannot load %s", bname);
+            warnx("cannot load %s", bname);
+            rval = 1;
+            goto done;
         }
     }
     if (nloaded == 0) {
-       errx(1, "cannot load neither %s nor %s", aname, bname);
+        warnx("cannot load neither %s nor %s", aname, bname);
+        rval = 1;
+        goto done;
     }
 
     if (MYQ_EMPTY(&channels))
@@ -447,24 +325,29 @@ main(int argc, char **argv)
     MYQ_FOREACH(cnp, &channels) {
         cnp->cp->skip = (cnp->cp->btime - basetime) * 8000;
         cnp->cp->decoder = decoder_new(&(cnp->cp->session), dflags);
-        if (cnp->cp->decoder == NULL)
-            err(1, "decoder_new() failed");
+        if (cnp->cp->decoder == NULL) {
+            warn("decoder_new() failed");
+            rval = 1;
+            goto done;
+        }
         nch++;
     }
 
     oblen = 0;
 
-    sfinfo.format = use_file_fmt | use_data_fmt;
-
-    sffile = sf_open(argv[0], SFM_WRITE, &sfinfo);
-    if (sffile == NULL)
-        errx(2, "%s: can't open output file", argv[0]);
+    sfinfo = opts->sfinfo;
+    sffile = sf_open(job->oname, SFM_WRITE, &sfinfo);
+    if (sffile == NULL) {
+        warnx("%s: can't open output file", job->oname);
+        rval = 2;
+        goto done;
+    }
 #if defined(EAUD_DUMPRAW)
     FILE *raw_file = fopen(EAUD_DUMPRAW, "w");
 #endif
 
-    struct cnode *cnp_next;
     nasamples = nbsamples = nwsamples = 0;
+    nout = (opts->stereo == 0) ? 1 : 2;
     do {
         neof = 0;
         asample = bsample = 0;
@@ -473,10 +356,42 @@ main(int argc, char **argv)
         if ((dflags & D_FLAG_NOSYNC) == 1) {
             ap = &channels;
         } else if (sync_sample == isample) {
-            if (eaud_ss_syncactive(&channels, &act_subset, isample, &sync_sample) < 0)
-                errx(1, "eaud_ss_syncactive() failed");
+            if (eaud_ss_syncactive(&channels, &act_subset, isample, &sync_sample) < 0) {
+                warnx("eaud_ss_syncactive() failed");
+                sf_close(sffile);
+                rval = 1;
+                goto done;
+            }
             ap = &act_subset;
         }
+        if ((dflags & (D_FLAG_NOSYNC | D_FLAG_NOBLKMIX)) == 0) {
+            /*
+             * Fast path: mix as many samples as all active decoders have
+             * buffered in one go, fall back to the per-sample loop below
+             * whenever any of them hits EOF or error.
+             */
+            nblk = eaud_mix_block(ap, isample, sync_sample,
+              (sizeof(obuf) / sizeof(obuf[0]) - oblen) / nout, abuf, bbuf,
+              &nasamples, &nbsamples);
+            if (nblk > 0) {
+                if (opts->stereo == 0) {
+                    eaud_mix_out_mono(obuf + oblen, abuf, bbuf, nblk);
+                } else {
+                    eaud_mix_out_stereo(obuf + oblen, abuf, bbuf, nblk);
+                }
+                oblen += nblk * nout;
+                isample += nblk - 1;
+                if (oblen == sizeof(obuf) / sizeof(obuf[0])) {
+#if defined(EAUD_DUMPRAW)
+                    fwrite(obuf, sizeof(int16_t), oblen, raw_file);
+#endif
+                    sf_write_short(sffile, obuf, oblen);
+                    nwsamples += oblen / sizeof(obuf[0]);
+                    oblen = 0;
+                }
+                continue;
+            }
+        }
         MYQ_FOREACH(cnp, ap) {
 restart:
             if ((dflags & D_FLAG_NOSYNC) == 0) {
@@ -497,8 +412,9 @@ restart:
 
                 tnp = eaud_ss_find(&channels, cnp->cp);
                 assert(tnp != NULL);
-                channel_remove(&channels, tnp, 1);
+                /* cnp is tnp in the NOSYNC case, so grab next first */
                 cnp_next = MYQ_NEXT(cnp);
+                channel_remove(&channels, tnp, 1);
                 if (ap != &channels) {
                     channel_remove(ap, cnp, 0);
                 }
@@ -532,7 +448,7 @@ restart:
         }
 out:
         if (neof < nch) {
-            if (stereo == 0) {
+            if (opts->stereo == 0) {
                 obuf[oblen] = (asample + bsample) / 2;
                 oblen += 1;
             } else {
@@ -559,13 +475,12 @@ out:
 #endif
     sf_close(sffile);
 
-    while (argc > 1) {
-        link(argv[0], argv[argc - 1]);
-        argc--;
+    for (i = job->nlinks - 1; i >= 0; i--) {
+        link(job->oname, job->links[i]);
     }
 
 theend:
-    if (delete != 0) {
+    if (opts->delete != 0) {
         if (aname != NULL) {
             unlink(aname);
         }
@@ -574,6 +489,239 @@ theend:
         }
     }
 
+done:
+    while (!MYQ_EMPTY(&act_subset))
+        channel_remove(&act_subset, MYQ_FIRST(&act_subset), 0);
+    while (!MYQ_EMPTY(&channels))
+        channel_remove(&channels, MYQ_FIRST(&channels), 1);
+    if (aloader != NULL)
+        aloader->destroy(aloader);
+    if (bloader != NULL)
+        bloader->destroy(bloader);
+    return (rval);
+}
+
+int
+main(int argc, char **argv)
+{
+    int ch, idprio, batch, njobs, follow;
+#if defined(__FreeBSD__)
+    struct rtprio rt;
+#endif
+    char aname_s[MAXPATHLEN], bname_s[MAXPATHLEN];
+    const char *aname, *bname, *file_fmt_name;
+    struct eaud_opts opts;
+    struct eaud_job job;
+    const struct supported_fmt *sf_of;
+    uint32_t use_file_fmt, use_data_fmt;
+    uint32_t dflt_file_fmt, dflt_data_fmt;
+    int option_index;
+    struct eaud_crypto *alice_crypto, *bob_crypto;
+
+#ifdef RTPP_CHECK_LEAKS
+    RTPP_MEMDEB_APP_INIT();
+#endif
+
+    memset(&opts, 0, sizeof(opts));
+    memset(&job, 0, sizeof(job));
+    opts.sfinfo.samplerate = 8000;
+    opts.sfinfo.channels = 1;
+    use_file_fmt = use_data_fmt = 0;
+    dflt_file_fmt = SF_FORMAT_WAV;
+    dflt_data_fmt = SF_FORMAT_GSM610;
+    file_fmt_name = "wav";
+
+    idprio = batch = njobs = follow = 0;
+    opts.dflags = D_FLAG_NONE;
+    aname = bname = NULL;
+    alice_crypto = bob_crypto = NULL;
+    int scanonly = 0;
+    int ecode = 0;
+
+    while ((ch = getopt_long(argc, argv, "dsSineF:D:A:B:U:bj:f:", longopts,
+      &option_index)) != -1)
+        switch (ch) {
+        case 'd':
+            opts.delete = 1;
+            break;
+
+        case 's':
+            opts.stereo = 1;
+            opts.sfinfo.channels = 2;
+            /* GSM+WAV doesn't work with more than 1 channels */
+            dflt_data_fmt = SF_FORMAT_MS_ADPCM;
+            break;
+
+        case 'i':
+            idprio = 1;
+            break;
+
+        case 'n':
+            opts.dflags |= D_FLAG_NOSYNC;
+            break;
+
+        case 'F':
+            sf_of = pick_format(optarg, eaud_file_fmts);
+            if (sf_of == NULL) {
+                warnx("unknown output file format: \"%s\"", optarg);
+                dump_formats_descr("Supported file formats:\n", eaud_file_fmts);
+                ecode = 1;
+                goto done;
+            }
+            use_file_fmt = sf_of->id;
+            file_fmt_name = sf_of->name;
+            break;
+
+        case 'D':
+            sf_of = pick_format(optarg, eaud_data_fmts);
+            if (sf_of == NULL) {
+                warnx("unknown output data format: \"%s\"", optarg);
+                dump_formats_descr("Supported data formats:\n", eaud_data_fmts);
+                ecode = 1;
+                goto done;
+            }
+            use_data_fmt = sf_of->id;
+            break;
+
+        case 'A':
+            aname = optarg;
+            break;
+
+        case 'B':
+            bname = optarg;
+            break;
+
+#if ENABLE_SRTP || ENABLE_SRTP2
+        case LOPT_ALICE_CRYPTO:
+            alice_crypto = eaud_crypto_getopt_parse(optarg);
+            if (alice_crypto == NULL) {
+                ecode = 1;
+                goto done;
+            }
+            break;
+
+        case LOPT_BOB_CRYPTO:
+            bob_crypto = eaud_crypto_getopt_parse(optarg);
+            if (bob_crypto == NULL) {
+                ecode = 1;
+                goto done;
+            }
+            break;
+#endif
+
+        case LOPT_NOBLKMIX:
+            opts.dflags |= D_FLAG_NOBLKMIX;
+            break;
+
+        case 'S':
+            scanonly = 1;
+            break;
+
+        case 'e':
+            opts.dflags |= D_FLAG_ERRFAIL;
+            break;
+
+        case 'b':
+            batch = 1;
+            break;
+
+        case 'j':
+            njobs = atoi(optarg);
+            if (njobs <= 0)
+                usage();
+            break;
+
+        case 'f':
+            follow = atoi(optarg);
+            if (follow <= 0)
+                usage();
+            break;
+
+        case '?':
+        default:
+            usage();
+        }
+    argc -= optind;
+    argv += optind;
+
+    if (batch) {
+        if (argc != 1 || scanonly || follow || aname != NULL ||
+          bname != NULL || alice_crypto != NULL || bob_crypto != NULL)
+            usage();
+    } else if (follow && (scanonly || alice_crypto != NULL ||
+      bob_crypto != NULL)) {
+        usage();
+    } else if (aname == NULL && bname == NULL) {
+        if ((argc < 2 && !scanonly) || (scanonly && argc != 1))
+            usage();
+    } else if ((argc == 0 && !scanonly) || (scanonly && argc != 0)) {
+        usage();
+    }
+
+    if (use_file_fmt == 0) {
+        use_file_fmt = dflt_file_fmt;
+    }
+    if (use_data_fmt == 0) {
+        use_data_fmt = dflt_data_fmt;
+    }
+    opts.sfinfo.format = use_file_fmt | use_data_fmt;
+
+    if (idprio != 0) {
+#if defined(__FreeBSD__)
+        rt.type = RTP_PRIO_IDLE;
+        rt.prio = RTP_PRIO_MAX;
+        rtprio(RTP_SET, 0, &rt);
+#else
+        setpriority(PRIO_PROCESS, 0, 20);
+#endif
+    }
+
+    if (aname == NULL && bname == NULL && !batch) {
+        sprintf(aname_s, "%s.a.rtp", argv[0]);
+        aname = aname_s;
+        sprintf(bname_s, "%s.o.rtp", argv[0]);
+        bname = bname_s;
+        argv += 1;
+        argc -= 1;
+    }
+
+    if (scanonly) {
+        if (aname != NULL) {
+            printf("%s: %d\n", aname, scan_session(aname));
+        }
+        if (bname != NULL) {
+            printf("%s: %d\n", bname, scan_session(bname));
+        }
+        goto done;
+    }
+
+    if (batch) {
+        opts.batch = 1;
+        ecode = (eaud_batch_run(argv[0], file_fmt_name, njobs, eaud_convert,
+          &opts) == 0) ? 0 : 1;
+        goto done;
+    }
+
+    job.aname = aname;
+    job.bname = bname;
+    job.alice_crypto = alice_crypto;
+    job.bob_crypto = bob_crypto;
+    job.oname = argv[0];
+    job.links = argv + 1;
+    job.nlinks = argc - 1;
+    if (follow) {
+        ecode = (eaud_stream_run(&job, &opts.sfinfo, opts.stereo,
+          opts.dflags, follow) == 0) ? 0 : 1;
+        if (ecode == 0 && opts.delete != 0) {
+            if (aname != NULL)
+                unlink(aname);
+            if (bname != NULL)
+                unlink(bname);
+        }
+        goto done;
+    }
+    ecode = eaud_convert(&opts, &job);
+
 done:
     if (alice_crypto != NULL)
         free(alice_crypto);
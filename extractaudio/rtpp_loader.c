@@ -61,6 +61,7 @@
 #include "eaud_adhoc.h"
 #include "rtpp_scan_pcap.h"
 #include "rtpp_scan_adhoc.h"
+#include "eaud_arena.h"
 
 static int load_adhoc(struct rtpp_loader *loader, struct channels *,
   struct rtpp_session_stat *, enum origin, struct eaud_crypto *);
@@ -70,7 +71,14 @@ static int load_pcap(struct rtpp_loader *loader, struct channels *,
 static void
 rtpp_loader_destroy(struct rtpp_loader *loader)
 {
+    unsigned char *base;
 
+    /* The PCAP header is skipped over once it has been validated */
+    base = loader->ibuf;
+    if (loader->load == load_pcap && loader->private.pcap_data.pcap_hdr != NULL)
+        base = (unsigned char *)loader->private.pcap_data.pcap_hdr;
+    eaud_arena_free(&loader->arena);
+    munmap(base, loader->sb.st_size + (loader->ibuf - base));
     close(loader->ifd);
     free(loader);
 }
@@ -86,6 +94,7 @@ rtpp_load(const char *path)
         return NULL;
 
     memset(rval, '\0', sizeof(*rval));
+    eaud_arena_init(&rval->arena, 0);
 
     rval->ifd = open(path, O_RDONLY);
     if (rval->ifd == -1) {
@@ -158,6 +167,169 @@ channel_alloc(enum origin origin)
     return (channel);
 }
 
+/*
+ * SSRC -> channel index used while loading, so that finding the channel
+ * for each packet does not require walking the whole list.
+ */
+struct ssrc_idx_ent {
+    uint32_t ssrc;
+    struct channel *cp;
+};
+
+struct ssrc_idx {
+    struct ssrc_idx_ent *tbl;
+    unsigned int size;
+    unsigned int nents;
+};
+
+#define SSRC_IDX_HASH(ssrc, size) (((ssrc) * 0x9E3779B1u) & ((size) - 1))
+
+static void
+ssrc_idx_add(struct ssrc_idx *ip, uint32_t ssrc, struct channel *cp)
+{
+    unsigned int i;
+
+    for (i = SSRC_IDX_HASH(ssrc, ip->size); ip->tbl[i].cp != NULL;
+      i = (i + 1) & (ip->size - 1))
+        continue;
+    ip->tbl[i].ssrc = ssrc;
+    ip->tbl[i].cp = cp;
+    ip->nents += 1;
+}
+
+/* Make sure there is room for one more entry, keeping load under 50% */
+static int
+ssrc_idx_reserve(struct ssrc_idx *ip)
+{
+    struct ssrc_idx otbl;
+    unsigned int i;
+
+    if ((ip->nents + 1) * 2 <= ip->size)
+        return (0);
+    otbl = *ip;
+    ip->size = (otbl.size > 0) ? otbl.size * 2 : 16;
+    ip->tbl = calloc(ip->size, sizeof(ip->tbl[0]));
+    if (ip->tbl == NULL) {
+        *ip = otbl;
+        return (-1);
+    }
+    ip->nents = 0;
+    for (i = 0; i < otbl.size; i++) {
+        if (otbl.tbl[i].cp != NULL)
+            ssrc_idx_add(ip, otbl.tbl[i].ssrc, otbl.tbl[i].cp);
+    }
+    if (otbl.tbl != NULL)
+        free(otbl.tbl);
+    return (0);
+}
+
+static struct channel *
+ssrc_idx_lookup(const struct ssrc_idx *ip, uint32_t ssrc)
+{
+    unsigned int i;
+
+    if (ip->size == 0)
+        return (NULL);
+    for (i = SSRC_IDX_HASH(ssrc, ip->size); ip->tbl[i].cp != NULL;
+      i = (i + 1) & (ip->size - 1)) {
+        if (ip->tbl[i].ssrc == ssrc)
+            return (ip->tbl[i].cp);
+    }
+    return (NULL);
+}
+
+static void
+ssrc_idx_free(struct ssrc_idx *ip)
+{
+
+    if (ip->tbl != NULL)
+        free(ip->tbl);
+}
+
+/* Index channels that have been loaded from other files already */
+static int
+ssrc_idx_init(struct ssrc_idx *ip, struct channels *channels)
+{
+    struct cnode *cnp;
+
+    memset(ip, '\0', sizeof(*ip));
+    MYQ_FOREACH(cnp, channels) {
+        if (ssrc_idx_reserve(ip) != 0) {
+            ssrc_idx_free(ip);
+            return (-1);
+        }
+        ssrc_idx_add(ip, MYQ_FIRST(&(cnp->cp->session))->rpkt->ssrc, cnp->cp);
+    }
+    return (0);
+}
+
+static int
+loader_enqueue(struct channels *channels, struct ssrc_idx *ip,
+  struct packet *pack, enum origin origin)
+{
+    struct packet *pp;
+    struct channel *channel;
+    struct session *sess;
+
+    if (ip != NULL) {
+        channel = ssrc_idx_lookup(ip, pack->rpkt->ssrc);
+        sess = (channel != NULL) ? &(channel->session) : NULL;
+    } else {
+        sess = session_lookup(channels, pack->rpkt->ssrc, &channel);
+    }
+    if (sess == NULL) {
+        if (ip != NULL && ssrc_idx_reserve(ip) != 0) {
+            warn("ssrc_idx_reserve() failed");
+            return (-1);
+        }
+        channel = channel_alloc(origin);
+        if (channel == NULL) {
+            warn("channel_alloc() failed");
+            return (-1);
+        }
+        sess = &(channel->session);
+        MYQ_INIT(sess);
+        MYQ_INSERT_HEAD(sess, pack);
+        if (channel_insert(channels, channel) < 0) {
+            warn("channel_insert() failed");
+            free(channel);
+            return (-1);
+        }
+        if (ip != NULL)
+            ssrc_idx_add(ip, pack->rpkt->ssrc, channel);
+        return (1);
+    }
+
+    /* Put packet it order */
+    MYQ_FOREACH_REVERSE(pp, sess) {
+        if (pp->parsed.seq == pack->parsed.seq) {
+            /* Duplicate packet */
+            return (0);
+        }
+        if (pp->parsed.ts < pack->parsed.ts ||
+          pp->parsed.seq < pack->parsed.seq) {
+            MYQ_INSERT_AFTER(sess, pp, pack);
+            return (1);
+        }
+    }
+    MYQ_INSERT_HEAD(sess, pack);
+    return (1);
+}
+
+/*
+ * Queue packet into the channel matching its SSRC, keeping packets ordered
+ * and creating the channel if necessary. Returns 1 if the packet has been
+ * queued, 0 if it was a duplicate or -1 on error. The packet is owned by
+ * the caller in the last two cases.
+ */
+int
+rtpp_loader_enqueue(struct channels *channels, struct packet *pack,
+  enum origin origin)
+{
+
+    return (loader_enqueue(channels, NULL, pack, origin));
+}
+
 static int
 load_adhoc(struct rtpp_loader *loader, struct channels *channels,
   struct rtpp_session_stat *stat, enum origin origin,
@@ -165,12 +337,14 @@ load_adhoc(struct rtpp_loader *loader, struct channels *channels,
 {
     int pcount, rcode;
     unsigned char *cp, *ep;
-    struct packet *pack, *pp;
-    struct channel *channel;
-    struct session *sess;
+    struct packet *pack;
     off_t st_size;
     struct adhoc_dissect ad_data;
+    struct ssrc_idx idx;
 
+    if (ssrc_idx_init(&idx, channels) != 0)
+        return -1;
+    pack = NULL;
     pcount = 0;
     st_size = loader->sb.st_size;
     ep = loader->ibuf + st_size;
@@ -180,22 +354,24 @@ load_adhoc(struct rtpp_loader *loader, struct channels *channels,
             break;
 
         case ADH_DSCT_EOF:
-            goto endloop;
+            continue;
 
         default:
-            return -1;
+            goto e0;
         }
-        pack = malloc(sizeof(*pack));
+        /* Slot is reused if the previous packet has been rejected */
         if (pack == NULL) {
-            warn("malloc() failed");
-            return -1;
+            pack = eaud_arena_alloc(&loader->arena, sizeof(*pack));
+            if (pack == NULL) {
+                warn("eaud_arena_alloc() failed");
+                goto e0;
+            }
         }
         rcode = rtp_packet_parse_raw(ad_data.pkt, ad_data.ahp->plen,
           &(pack->parsed));
         if (rcode != RTP_PARSER_OK) {
             /* XXX error handling */
             warnx("rtp_packet_parse_raw() failed: %s", rtp_packet_parse_errstr(rcode));
-            free(pack);
             continue;
         }
         pack->pkt = ad_data.ahp;
@@ -204,58 +380,34 @@ load_adhoc(struct rtpp_loader *loader, struct channels *channels,
           ad_data.ahp->time) == UPDATE_ERR) {
             /* XXX error handling */
             warnx("update_rtpp_stats() failed");
-            free(pack);
-            return (-1);
+            goto e0;
         }
         if (pack->parsed.nsamples <= 0) {
             warnx("pack->parsed.nsamples = %d", pack->parsed.nsamples);
-            free(pack);
             continue;
         }
 
-        sess = session_lookup(channels, pack->rpkt->ssrc, &channel);
-        if (sess == NULL) {
-            channel = channel_alloc(origin);
-            if (channel == NULL) {
-                goto e0;
-            }
-            sess = &(channel->session);
-            MYQ_INIT(sess);
-            MYQ_INSERT_HEAD(sess, pack);
-            if (channel_insert(channels, channel) < 0) {
-                warn("channel_insert() failed");
-                goto e0;
-            }
+        switch (loader_enqueue(channels, &idx, pack, origin)) {
+        case 1:
             pcount++;
-            goto endloop;
-        }
+            pack = NULL;
+            break;
 
-        /* Put packet it order */
-        MYQ_FOREACH_REVERSE(pp, sess) {
-            if (pp->parsed.seq == pack->parsed.seq) {
-                /* Duplicate packet */
-                free(pack);
-                goto endloop;
-            }
-            if (pp->parsed.ts < pack->parsed.ts ||
-              pp->parsed.seq < pack->parsed.seq) {
-                MYQ_INSERT_AFTER(sess, pp, pack);
-                goto reg_pack;
-            }
+        case 0:
+            break;
+
+        default:
+            goto e0;
         }
-        MYQ_INSERT_HEAD(sess, pack);
-reg_pack:
-        pcount++;
-endloop:
-        continue;
     }
     if (cp != ep) {
         warnx("invalid format, %d packets loaded", pcount);
-        return -1;
+        goto e0;
     }
+    ssrc_idx_free(&idx);
     return pcount;
 e0:
-    free(pack);
+    ssrc_idx_free(&idx);
     return (-1);
 }
 
@@ -266,14 +418,16 @@ load_pcap(struct rtpp_loader *loader, struct channels *channels,
 {
     int pcount, rcode;
     unsigned char *cp, *ep;
-    struct packet *pack, *pp;
-    struct channel *channel;
-    struct session *sess;
+    struct packet *pack;
     int rtp_pkt_len, rval;
     off_t st_size;
     int network;
     struct pcap_dissect pd;
+    struct ssrc_idx idx;
 
+    if (ssrc_idx_init(&idx, channels) != 0)
+        return -1;
+    pack = NULL;
     st_size = loader->sb.st_size;
     network = loader->private.pcap_data.pcap_hdr->network;
     ep = loader->ibuf + st_size;
@@ -285,7 +439,7 @@ load_pcap(struct rtpp_loader *loader, struct channels *channels,
             if (rval == PCP_DSCT_UNKN)
                 continue;
             warnx("broken or truncated PCAP file");
-            return -1;
+            goto e0;
         }
         if (pd.l5_len < sizeof(rtp_hdr_t))
             continue;
@@ -305,16 +459,18 @@ load_pcap(struct rtpp_loader *loader, struct channels *channels,
         rtp_pkt_len = pd.l5_len;
 #endif
 
-        pack = malloc(sizeof(*pack) + sizeof(*pack->pkt));
         if (pack == NULL) {
-            warn("malloc() failed");
-            return -1;
+            pack = eaud_arena_alloc(&loader->arena,
+              sizeof(*pack) + sizeof(*pack->pkt));
+            if (pack == NULL) {
+                warn("eaud_arena_alloc() failed");
+                goto e0;
+            }
         }
         rcode = rtp_packet_parse_raw(pd.l5_data, rtp_pkt_len, &(pack->parsed));
         if (rcode != RTP_PARSER_OK) {
             /* XXX error handling */
             warnx("rtp_packet_parse_raw() failed: %s", rtp_packet_parse_errstr(rcode));
-            free(pack);
             continue;
         }
         pack->pkt = (struct pkt_hdr_adhoc *)&pack[1];
@@ -334,58 +490,33 @@ load_pcap(struct rtpp_loader *loader, struct channels *channels,
         if (update_rtpp_stats(NULL, stat, pack->rpkt, &(pack->parsed), pack->pkt->time) == UPDATE_ERR) {
             /* XXX error handling */
             warnx("update_rtpp_stats() failed");
-            free(pack);
-            return (-1);
+            goto e0;
         }
         if (pack->parsed.nsamples <= 0) {
             warnx("pack->parsed.nsamples = %d", pack->parsed.nsamples);
-            free(pack);
             continue;
         }
 
-        sess = session_lookup(channels, pack->rpkt->ssrc, &channel);
-        if (sess == NULL) {
-            channel = channel_alloc(origin);
-            if (channel == NULL) {
-                warn("channel_alloc() failed");
-                goto e0;
-            }
-            sess = &(channel->session);
-            MYQ_INIT(sess);
-            MYQ_INSERT_HEAD(sess, pack);
-            if (channel_insert(channels, channel) < 0) {
-                warn("channel_insert() failed");
-                goto e0;
-            }
+        switch (loader_enqueue(channels, &idx, pack, origin)) {
+        case 1:
             pcount++;
-            goto endloop;
-        }
+            pack = NULL;
+            break;
 
-        /* Put packet it order */
-        MYQ_FOREACH_REVERSE(pp, sess) {
-            if (pp->parsed.seq == pack->parsed.seq) {
-                /* Duplicate packet */
-                free(pack);
-                goto endloop;
-            }
-            if (pp->parsed.ts < pack->parsed.ts ||
-              pp->parsed.seq < pack->parsed.seq) {
-                MYQ_INSERT_AFTER(sess, pp, pack);
-                goto reg_pack;
-            }
+        case 0:
+            break;
+
+        default:
+            goto e0;
         }
-        MYQ_INSERT_HEAD(sess, pack);
-reg_pack:
-        pcount++;
-endloop:
-        continue;
     }
     if (cp != loader->ibuf + st_size) {
         warnx("invalid format, %d packets loaded", pcount);
-        return -1;
+        goto e0;
     }
+    ssrc_idx_free(&idx);
     return pcount;
 e0:
-    free(pack);
+    ssrc_idx_free(&idx);
     return (-1);
 }
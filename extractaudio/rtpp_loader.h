@@ -33,11 +33,14 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include "eaud_arena.h"
+
 struct rtpp_loader;
 struct sessions;
 struct channels;
 struct rtpp_session_stat;
 struct eaud_crypto;
+struct packet;
 
 enum origin;
 
@@ -58,6 +61,8 @@ struct rtpp_loader {
     rtpp_loader_scan_t scan;
     rtpp_loader_load_t load;
     rtpp_loader_dtor_t destroy;
+    /* Packets loaded from the file, freed along with the loader */
+    struct eaud_arena arena;
 
     union {
         struct {
@@ -68,5 +73,6 @@ struct rtpp_loader {
 };
 
 struct rtpp_loader *rtpp_load(const char *);
+int rtpp_loader_enqueue(struct channels *, struct packet *, enum origin);
 
 #endif
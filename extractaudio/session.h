@@ -128,5 +128,6 @@ struct streams {
 
 struct session *session_lookup(struct channels *, uint32_t, struct channel **);
 int channel_insert(struct channels *, struct channel *);
+void channel_remove(struct channels *, struct cnode *, int);
 
 #endif
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+/*
+ * On-disk layout of the binary accounting file produced by the acct_bin
+ * flavour of the module, shared with the rtpp_acct_bin2csv converter.
+ *
+ * The file starts with a header listing the type of every column, followed
+ * by any number of self-contained blocks, each one holding a batch of
+ * records stored column by column: nrows 8-byte values for the first
+ * column, then for the second and so on, followed by the string heap that
+ * the string columns point into. The columns are the same and come in the
+ * same order as in the CSV output, except that the IP address and the port
+ * of each remote end are kept as a single string column. All integers are
+ * in host byte order, the magic numbers can be used to detect a mismatch.
+ */
+
+#define ACCT_BIN_MAGIC   0x42505452 /* "RTPB" */
+#define ACCT_BIN_BMAGIC  0x4b4c4252 /* "RBLK" */
+#define ACCT_BIN_VERSION 1
+
+enum acct_bin_ctype {ACB_STR = 1, ACB_I64, ACB_U64, ACB_F64, ACB_BOOL};
+
+#define ACCT_BIN_COLS(X) \
+    X(RVER, ACB_STR) X(NID, ACB_STR) X(PID, ACB_I64) X(SID, ACB_I64) \
+    X(CID, ACB_STR) X(FTAG, ACB_STR) \
+    X(SETUP_TS, ACB_F64) X(TEARDOWN_TS, ACB_F64) \
+    X(RTP_FIRST_INO, ACB_F64) X(RTP_LAST_INO, ACB_F64) \
+    X(RTP_FIRST_INA, ACB_F64) X(RTP_LAST_INA, ACB_F64) \
+    X(RTP_NPKTS_INA, ACB_U64) X(RTP_NPKTS_INO, ACB_U64) \
+    X(RTP_NRELAYED, ACB_U64) X(RTP_NDROPPED, ACB_U64) \
+    X(RTCP_NPKTS_INA, ACB_U64) X(RTCP_NPKTS_INO, ACB_U64) \
+    X(RTCP_NRELAYED, ACB_U64) X(RTCP_NDROPPED, ACB_U64) \
+    X(NSENT_INO, ACB_U64) X(NRCVD_INO, ACB_U64) X(NDUPS_INO, ACB_U64) \
+    X(NLOST_INO, ACB_U64) X(PERRS_INO, ACB_U64) X(SSRC_INO, ACB_STR) \
+    X(SSRC_CNT_INO, ACB_U64) X(PT_INO, ACB_I64) \
+    X(NSENT_INA, ACB_U64) X(NRCVD_INA, ACB_U64) X(NDUPS_INA, ACB_U64) \
+    X(NLOST_INA, ACB_U64) X(PERRS_INA, ACB_U64) X(SSRC_INA, ACB_STR) \
+    X(SSRC_CNT_INA, ACB_U64) X(PT_INA, ACB_I64) \
+    X(JLAST_INO, ACB_F64) X(JMAX_INO, ACB_F64) X(JAVG_INO, ACB_F64) \
+    X(JLAST_INA, ACB_F64) X(JMAX_INA, ACB_F64) X(JAVG_INA, ACB_F64) \
+    X(RTP_RMT_O, ACB_STR) X(RTP_RMT_A, ACB_STR) \
+    X(RTCP_RMT_O, ACB_STR) X(RTCP_RMT_A, ACB_STR) \
+    X(HLD_STS_O, ACB_BOOL) X(HLD_STS_A, ACB_BOOL) \
+    X(HLD_CNT_O, ACB_I64) X(HLD_CNT_A, ACB_I64)
+
+#define ACB_COL_ID(name, type) ACB_COL_##name,
+#define ACB_COL_TYPE(name, type) type,
+
+enum acct_bin_col {
+    ACCT_BIN_COLS(ACB_COL_ID)
+    ACCT_BIN_NCOLS
+};
+
+union acct_bin_val {
+    int64_t i;
+    uint64_t u;
+    double f;
+    struct {
+        uint32_t off;
+        uint32_t len;
+    } s;
+};
+
+struct acct_bin_fhdr {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t ncols;
+    /* Followed by ncols column types, padded to 8 bytes */
+};
+
+struct acct_bin_bhdr {
+    uint32_t magic;
+    uint32_t nrows;
+    uint32_t slen;
+    uint32_t _pad;
+};
+
+#define ACB_ALIGN(len) (((len) + 7) & ~(size_t)7)
+#define ACB_FHDR_LEN (sizeof(struct acct_bin_fhdr) + ACB_ALIGN(ACCT_BIN_NCOLS))
+#define ACB_BLOCK_LEN(nrows, slen) (sizeof(struct acct_bin_bhdr) + \
+  (size_t)(nrows) * ACCT_BIN_NCOLS * sizeof(union acct_bin_val) + \
+  ACB_ALIGN(slen))
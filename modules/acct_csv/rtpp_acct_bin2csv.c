@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#include <sys/types.h>
+#include <err.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rtpp_acct_csv.h"
+#include "rtpp_acct_bin.h"
+
+/*
+ * Convert the binary accounting file(s) produced by the acct_bin module
+ * into the same CSV format as written by the acct_csv module.
+ */
+
+static const uint8_t ctypes[] = {ACCT_BIN_COLS(ACB_COL_TYPE)};
+
+static void
+usage(void)
+{
+
+    fprintf(stderr, "usage: rtpp_acct_bin2csv [-H] [file ...]\n");
+    exit(1);
+}
+
+static void
+acb_print_val(FILE *ofile, enum acct_bin_ctype type,
+  const union acct_bin_val *vp, const char *heap, size_t slen)
+{
+
+    switch (type) {
+    case ACB_STR:
+        if ((size_t)vp->s.off + vp->s.len > slen)
+            errx(1, "string is out of the heap bounds");
+        fwrite(heap + vp->s.off, 1, vp->s.len, ofile);
+        break;
+
+    case ACB_I64:
+        fprintf(ofile, "%" PRId64, vp->i);
+        break;
+
+    case ACB_U64:
+        fprintf(ofile, "%" PRIu64, vp->u);
+        break;
+
+    case ACB_F64:
+        fprintf(ofile, "%f", vp->f);
+        break;
+
+    case ACB_BOOL:
+        fputs((vp->i == 0) ? "f" : "t", ofile);
+        break;
+    }
+}
+
+static int
+acb_convert(FILE *ifile, const char *iname, FILE *ofile)
+{
+    struct acct_bin_fhdr fhdr;
+    struct acct_bin_bhdr bhdr;
+    uint8_t ftypes[ACB_ALIGN(ACCT_BIN_NCOLS)];
+    union acct_bin_val *cols;
+    const char *heap;
+    size_t blen, r;
+    void *bbuf;
+    uint32_t i, j;
+
+    if (fread(&fhdr, sizeof(fhdr), 1, ifile) != 1) {
+        warnx("%s: can't read file header", iname);
+        return (-1);
+    }
+    if (fhdr.magic != ACCT_BIN_MAGIC || fhdr.version != ACCT_BIN_VERSION) {
+        warnx("%s: unknown format or version", iname);
+        return (-1);
+    }
+    if (fhdr.ncols != ACCT_BIN_NCOLS ||
+      fread(ftypes, sizeof(ftypes), 1, ifile) != 1 ||
+      memcmp(ftypes, ctypes, sizeof(ctypes)) != 0) {
+        warnx("%s: column layout mismatch", iname);
+        return (-1);
+    }
+    bbuf = NULL;
+    while ((r = fread(&bhdr, 1, sizeof(bhdr), ifile)) == sizeof(bhdr)) {
+        if (bhdr.magic != ACCT_BIN_BMAGIC) {
+            warnx("%s: corrupt block header", iname);
+            goto e0;
+        }
+        blen = ACB_BLOCK_LEN(bhdr.nrows, bhdr.slen) - sizeof(bhdr);
+        free(bbuf);
+        bbuf = malloc(blen);
+        if (bbuf == NULL) {
+            warn("malloc(%zu)", blen);
+            goto e0;
+        }
+        if (fread(bbuf, blen, 1, ifile) != 1) {
+            warnx("%s: truncated block", iname);
+            goto e0;
+        }
+        cols = bbuf;
+        heap = (const char *)(cols + (size_t)bhdr.nrows * ACCT_BIN_NCOLS);
+        for (i = 0; i < bhdr.nrows; i++) {
+            for (j = 0; j < ACCT_BIN_NCOLS; j++) {
+                if (j > 0)
+                    fputs(SEP, ofile);
+                acb_print_val(ofile, ctypes[j], &cols[j * bhdr.nrows + i],
+                  heap, bhdr.slen);
+            }
+            fputc('\n', ofile);
+        }
+    }
+    free(bbuf);
+    if (r != 0) {
+        warnx("%s: truncated block header", iname);
+        return (-1);
+    }
+    return (0);
+e0:
+    free(bbuf);
+    return (-1);
+}
+
+int
+main(int argc, char **argv)
+{
+    int ch, nohead, rval;
+    FILE *ifile;
+
+    nohead = 0;
+    while ((ch = getopt(argc, argv, "H")) != -1) {
+        switch (ch) {
+        case 'H':
+            nohead = 1;
+            break;
+
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    argv += optind;
+
+    if (!nohead)
+        fwrite(ACCT_CSV_HEAD, 1, sizeof(ACCT_CSV_HEAD) - 1, stdout);
+    if (argc == 0)
+        return (acb_convert(stdin, "stdin", stdout) == 0 ? 0 : 1);
+    rval = 0;
+    for (; argc > 0; argc--, argv++) {
+        ifile = fopen(argv[0], "r");
+        if (ifile == NULL) {
+            warn("%s", argv[0]);
+            rval = 1;
+            continue;
+        }
+        if (acb_convert(ifile, argv[0], stdout) != 0)
+            rval = 1;
+        fclose(ifile);
+    }
+    return (rval);
+}
@@ -28,6 +28,7 @@
 #include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <inttypes.h>
 #include <fcntl.h>
@@ -62,6 +63,11 @@
 #include "rtpp_str.h"
 #include "rtpp_sbuf.h"
 
+#include "rtpp_acct_csv.h"
+#if defined(RTPP_ACCT_BIN)
+#include "rtpp_acct_bin.h"
+#endif
+
 #define SSRC_STRLEN 11
 
 struct rtpp_mod_acct_face {
@@ -79,17 +85,42 @@ struct rtpp_module_priv {
    char node_id[_POSIX_HOST_NAME_MAX + 1];
    struct rtpp_mod_acct_face o;
    struct rtpp_mod_acct_face a;
+   /* Formatted records (CSV) or string heap (binary) not written out yet */
    struct rtpp_sbuf *sbuf;
+   int nrecs;
+   const void *fhdr;
+   size_t fhdr_len;
+#if defined(RTPP_ACCT_BIN)
+   /* Column-major, ACCT_BIN_BATCH values per column */
+   union acct_bin_val *cols;
+   unsigned char fhdr_buf[ACB_FHDR_LEN];
+#endif
 };
 
-/* Bump this when some changes are made */
-#define RTPP_METRICS_VERSION	"1.2"
-
 #define HNAME_REFRESH_IVAL	1.0
 
+/*
+ * Records are collected and written out in one go once the accounting
+ * queue runs dry or enough of them have piled up, so that under load we
+ * do one lock/write/unlock cycle per batch rather than per call.
+ */
+#define ACCT_CSV_FLUSH_LEN	(64 * 1024)
+#define ACCT_BIN_BATCH		256
+
+#if !defined(RTPP_ACCT_BIN)
+#define ACCT_MOD_NAME	"acct_csv"
+#define ACCT_MOD_ID	1
+#define ACCT_FNAME	"rtpproxy_acct.csv"
+#else
+#define ACCT_MOD_NAME	"acct_bin"
+#define ACCT_MOD_ID	6
+#define ACCT_FNAME	"rtpproxy_acct.bin"
+#endif
+
 static struct rtpp_module_priv *rtpp_acct_csv_ctor(const struct rtpp_cfg *);
 static void rtpp_acct_csv_dtor(struct rtpp_module_priv *);
 static void rtpp_acct_csv_do(struct rtpp_module_priv *, struct rtpp_acct *);
+static void rtpp_acct_csv_flush(struct rtpp_module_priv *);
 static off_t rtpp_acct_csv_lockf(int);
 static void rtpp_acct_csv_unlockf(int, off_t);
 
@@ -100,13 +131,14 @@ RTPP_MEMDEB_APP_STATIC;
 #endif
 
 static const struct rtpp_acct_handlers acct_csv_aapi = {
-    .on_session_end = AAPI_FUNC(rtpp_acct_csv_do, rtpp_acct_OSIZE())
+    .on_session_end = AAPI_FUNC(rtpp_acct_csv_do, rtpp_acct_OSIZE()),
+    .on_idle.func = rtpp_acct_csv_flush
 };
 
 struct rtpp_minfo RTPP_MOD_SELF = {
-    .descr.name = "acct_csv",
+    .descr.name = ACCT_MOD_NAME,
     .descr.ver = MI_VER_INIT(),
-    .descr.module_id = 1,
+    .descr.module_id = ACCT_MOD_ID,
     .proc.ctor = rtpp_acct_csv_ctor,
     .proc.dtor = rtpp_acct_csv_dtor,
 #ifdef RTPP_CHECK_LEAKS
@@ -115,8 +147,8 @@ struct rtpp_minfo RTPP_MOD_SELF = {
     .aapi = &acct_csv_aapi
 };
 #if defined(LIBRTPPROXY)
-const static struct rtpp_minfo *_rtpp_module_acct_csv = &RTPP_MOD_SELF;
-DATA_SET(rtpp_modules, _rtpp_module_acct_csv);
+const static struct rtpp_minfo *_rtpp_module_acct = &RTPP_MOD_SELF;
+DATA_SET(rtpp_modules, _rtpp_module_acct);
 #endif
 
 static const char *
@@ -131,43 +163,6 @@ rtpp_acct_get_nid(struct rtpp_module_priv *pvt, struct rtpp_acct *ap)
     return (pvt->node_id);
 }
 
-#define SFX_INO "_ino"
-#define SFX_INA "_ina"
-
-#define SFX_O   "_o"
-#define SFX_A   "_a"
-
-#define PFX_GEN "rtpp_"
-
-
-#define RVER_NM     "rec_ver"
-#define NID_NM      PFX_GEN "node_id"
-#define PID_NM      PFX_GEN "pid"
-#define SID_NM      "sess_uid"
-#define CID_NM      "call_id"
-#define PT_NAME     "rtpa_pt_last"
-#define PT_NM_O     PT_NAME SFX_INO
-#define PT_NM_A     PT_NAME SFX_INA
-#define PFX_RTP     "rtp_"
-#define PFX_RTCP    "rtcp_"
-#define RM_IP_NM "rmt_ip"
-#define RM_PT_NM "rmt_pt"
-#define R_RM_NM_O PFX_GEN PFX_RTP RM_IP_NM SFX_O
-#define R_RM_NM_A PFX_GEN PFX_RTP RM_IP_NM SFX_A
-#define C_RM_NM_O PFX_GEN PFX_RTCP RM_IP_NM SFX_O
-#define C_RM_NM_A PFX_GEN PFX_RTCP RM_IP_NM SFX_A
-#define R_RM_PT_NM_O PFX_GEN PFX_RTP RM_PT_NM SFX_O
-#define R_RM_PT_NM_A PFX_GEN PFX_RTP RM_PT_NM SFX_A
-#define C_RM_PT_NM_O PFX_GEN PFX_RTCP RM_PT_NM SFX_O
-#define C_RM_PT_NM_A PFX_GEN PFX_RTCP RM_PT_NM SFX_A
-
-#define HLD_CNT_NM   "hld_cnt"
-#define HLD_STS_NM   "hld_sts"
-#define HLD_CNT_NM_O PFX_GEN HLD_CNT_NM SFX_O
-#define HLD_CNT_NM_A PFX_GEN HLD_CNT_NM SFX_A
-#define HLD_STS_NM_O PFX_GEN HLD_STS_NM SFX_O
-#define HLD_STS_NM_A PFX_GEN HLD_STS_NM SFX_A
-
 #define RVER_FMT    "%s"
 #define NID_FMT     "%s"
 #define PID_FMT     "%d"
@@ -176,27 +171,12 @@ rtpp_acct_get_nid(struct rtpp_module_priv *pvt, struct rtpp_acct *ap)
 #define LSSRC_FMT   "%s"
 #define SNCHG_FMT   "%lu"
 #define RM_FMT      "%s"
-#define SEP         ","
 #define HLD_STS_FMT "%s"
 #define HLD_CNT_FMT "%d"
 
 #define STR_INIT(str) ((const struct rtpp_str_fixed){.s = (str), .len = sizeof(str) - 1})
 
-static const struct rtpp_str_fixed head = STR_INIT(RVER_NM SEP NID_NM SEP PID_NM SEP SID_NM
-    SEP CID_NM SEP
-    "from_tag,setup_ts,teardown_ts,first_rtp_ts_ino,last_rtp_ts_ino,"
-    "first_rtp_ts_ina,last_rtp_ts_ina,rtp_npkts_ina,rtp_npkts_ino,"
-    "rtp_nrelayed,rtp_ndropped,rtcp_npkts_ina,rtcp_npkts_ino,"
-    "rtcp_nrelayed,rtcp_ndropped,rtpa_nsent_ino,rtpa_nrcvd_ino,"
-    "rtpa_ndups_ino,rtpa_nlost_ino,rtpa_perrs_ino,"
-    "rtpa_ssrc_last_ino,rtpa_ssrc_cnt_ino" SEP PT_NM_O SEP
-    "rtpa_nsent_ina,rtpa_nrcvd_ina,rtpa_ndups_ina,rtpa_nlost_ina,"
-    "rtpa_perrs_ina,rtpa_ssrc_last_ina,rtpa_ssrc_cnt_ina" SEP PT_NM_A SEP
-    "rtpa_jitter_last_ino,rtpa_jitter_max_ino,rtpa_jitter_avg_ino,"
-    "rtpa_jitter_last_ina,rtpa_jitter_max_ina,rtpa_jitter_avg_ina" SEP
-    R_RM_NM_O SEP R_RM_PT_NM_O SEP R_RM_NM_A SEP R_RM_PT_NM_A SEP
-    C_RM_NM_O SEP C_RM_PT_NM_O SEP C_RM_NM_A SEP C_RM_PT_NM_A SEP
-    HLD_STS_NM_O SEP HLD_STS_NM_A SEP HLD_CNT_NM_O SEP HLD_CNT_NM_A "\n");
+static const struct rtpp_str_fixed head = STR_INIT(ACCT_CSV_HEAD);
 
 static int
 rtpp_acct_csv_open(struct rtpp_module_priv *pvt)
@@ -223,9 +203,9 @@ rtpp_acct_csv_open(struct rtpp_module_priv *pvt)
     }
     if (pvt->stt.st_size == 0) {
         do {
-            r = write(pvt->fd, head.s, head.len);
+            r = write(pvt->fd, pvt->fhdr, pvt->fhdr_len);
         } while (r < 0 && errno == EINTR);
-        if (r > 0 && r < head.len)
+        if (r > 0 && r < pvt->fhdr_len)
             r = -1;
     }
     rtpp_acct_csv_unlockf(pvt->fd, pos);
@@ -248,27 +228,49 @@ rtpp_acct_csv_ctor(const struct rtpp_cfg *cfsp)
     if (pvt == NULL) {
         goto e0;
     }
-    pvt->sbuf = rtpp_sbuf_ctor(head.len * 2);
+    pvt->sbuf = rtpp_sbuf_ctor(ACCT_CSV_FLUSH_LEN + head.len * 2);
     if (pvt->sbuf == NULL) {
         goto e1;
     }
+#if !defined(RTPP_ACCT_BIN)
+    pvt->fhdr = head.s;
+    pvt->fhdr_len = head.len;
+#else
+    pvt->cols = mod_zmalloc(ACCT_BIN_BATCH * ACCT_BIN_NCOLS *
+      sizeof(pvt->cols[0]));
+    if (pvt->cols == NULL) {
+        goto e2;
+    }
+    struct acct_bin_fhdr *fhp = (struct acct_bin_fhdr *)pvt->fhdr_buf;
+    static const uint8_t ctypes[] = {ACCT_BIN_COLS(ACB_COL_TYPE)};
+    fhp->magic = ACCT_BIN_MAGIC;
+    fhp->version = ACCT_BIN_VERSION;
+    fhp->ncols = ACCT_BIN_NCOLS;
+    memcpy(fhp + 1, ctypes, sizeof(ctypes));
+    pvt->fhdr = pvt->fhdr_buf;
+    pvt->fhdr_len = sizeof(pvt->fhdr_buf);
+#endif
     pvt->pid = getpid();
     if (cfsp->cwd_orig == NULL) {
-        snprintf(pvt->fname, sizeof(pvt->fname), "%s", "rtpproxy_acct.csv");
+        snprintf(pvt->fname, sizeof(pvt->fname), "%s", ACCT_FNAME);
     } else {
         snprintf(pvt->fname, sizeof(pvt->fname), "%s/%s", cfsp->cwd_orig,
-          "rtpproxy_acct.csv");
+          ACCT_FNAME);
     }
     if (gethostname(pvt->node_id, sizeof(pvt->node_id)) != 0) {
         strcpy(pvt->node_id, "UNKNOWN");
     }
     pvt->fd = -1;
     if (rtpp_acct_csv_open(pvt) == -1) {
-        goto e2;
+        goto e3;
     }
     return (pvt);
 
+e3:
+#if defined(RTPP_ACCT_BIN)
+    mod_free(pvt->cols);
 e2:
+#endif
     rtpp_sbuf_dtor(pvt->sbuf);
 e1:
     mod_free(pvt);
@@ -280,7 +282,11 @@ static void
 rtpp_acct_csv_dtor(struct rtpp_module_priv *pvt)
 {
 
+    rtpp_acct_csv_flush(pvt);
     close(pvt->fd);
+#if defined(RTPP_ACCT_BIN)
+    mod_free(pvt->cols);
+#endif
     rtpp_sbuf_dtor(pvt->sbuf);
     mod_free(pvt);
     return;
@@ -321,26 +327,94 @@ format_netaddr(struct rtpp_netaddr *nap_rtp, struct rtpp_netaddr *nap_rtcp,
 
 #define FMT_BOOL(x) ((x == 0) ? "f" : "t")
 
+/* Write all of the iov out, dealing with short writes */
+static int
+rtpp_acct_csv_writev(int fd, struct iovec *iov, int iovcnt)
+{
+    ssize_t r;
+
+    while (iovcnt > 0) {
+        r = writev(fd, iov, iovcnt);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            return (-1);
+        }
+        for (; iovcnt > 0 && r >= (ssize_t)iov->iov_len; iov++, iovcnt--)
+            r -= iov->iov_len;
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + r;
+            iov->iov_len -= r;
+        }
+    }
+    return (0);
+}
+
 static void
-rtpp_acct_csv_do(struct rtpp_module_priv *pvt, struct rtpp_acct *acct)
+rtpp_acct_csv_flush(struct rtpp_module_priv *pvt)
 {
-    int pos, rval;
+    int pos, rval, iovcnt;
     struct stat stt;
+#if !defined(RTPP_ACCT_BIN)
+    struct iovec iov[1];
+#else
+    struct iovec iov[ACCT_BIN_NCOLS + 3];
+    struct acct_bin_bhdr bhdr;
+    static const uint64_t zpad;
+    int i;
+#endif
 
+    if (pvt->nrecs == 0)
+        return;
     rval = stat(pvt->fname, &stt);
     if (rval != -1) {
         if (stt.st_dev != pvt->stt.st_dev || stt.st_ino != pvt->stt.st_ino) {
             if (rtpp_acct_csv_open(pvt) < 0)
-                return;
+                goto out;
         }
     } else if (rval == -1 && errno == ENOENT) {
         if (rtpp_acct_csv_open(pvt) < 0)
-            return;
+            goto out;
+    }
+#if !defined(RTPP_ACCT_BIN)
+    iov[0].iov_base = pvt->sbuf->bp;
+    iov[0].iov_len = RS_ULEN(pvt->sbuf);
+    iovcnt = 1;
+#else
+    memset(&bhdr, '\0', sizeof(bhdr));
+    bhdr.magic = ACCT_BIN_BMAGIC;
+    bhdr.nrows = pvt->nrecs;
+    bhdr.slen = RS_ULEN(pvt->sbuf);
+    iov[0].iov_base = &bhdr;
+    iov[0].iov_len = sizeof(bhdr);
+    for (i = 0; i < ACCT_BIN_NCOLS; i++) {
+        iov[i + 1].iov_base = &pvt->cols[i * ACCT_BIN_BATCH];
+        iov[i + 1].iov_len = pvt->nrecs * sizeof(pvt->cols[0]);
     }
+    iov[i + 1].iov_base = pvt->sbuf->bp;
+    iov[i + 1].iov_len = bhdr.slen;
+    iov[i + 2].iov_base = (void *)&zpad;
+    iov[i + 2].iov_len = ACB_ALIGN(bhdr.slen) - bhdr.slen;
+    iovcnt = i + 3;
+#endif
     pos = rtpp_acct_csv_lockf(pvt->fd);
     if (pos < 0) {
-        return;
+        goto out;
+    }
+    if (rtpp_acct_csv_writev(pvt->fd, iov, iovcnt) != 0) {
+        mod_elog(RTPP_LOG_ERR, "can't write %d records to '%s'", pvt->nrecs,
+          pvt->fname);
     }
+    rtpp_acct_csv_unlockf(pvt->fd, pos);
+out:
+    rtpp_sbuf_reset(pvt->sbuf);
+    pvt->nrecs = 0;
+}
+
+#if !defined(RTPP_ACCT_BIN)
+static void
+rtpp_acct_csv_do(struct rtpp_module_priv *pvt, struct rtpp_acct *acct)
+{
 
     format_ssrc(&acct->rasta->last_ssrc, pvt->a.ssrc, sizeof(pvt->a.ssrc));
     format_ssrc(&acct->rasto->last_ssrc, pvt->o.ssrc, sizeof(pvt->o.ssrc));
@@ -373,16 +447,109 @@ rtpp_acct_csv_do(struct rtpp_module_priv *pvt, struct rtpp_acct *acct)
             break;
         if (res == SBW_SHRT) {
             if (rtpp_sbuf_extend(pvt->sbuf, pvt->sbuf->alen * 2) != 0)
-                goto out;
+                return;
             continue;
         }
-        goto out;
+        return;
     } while (1);
-    write(pvt->fd, pvt->sbuf->bp, RS_ULEN(pvt->sbuf));
-    rtpp_sbuf_reset(pvt->sbuf);
-out:
-    rtpp_acct_csv_unlockf(pvt->fd, pos);
+    pvt->nrecs += 1;
+    if (RS_ULEN(pvt->sbuf) >= ACCT_CSV_FLUSH_LEN)
+        rtpp_acct_csv_flush(pvt);
 }
+#else
+#define ACB_VAL(pvt, col) ((pvt)->cols[ACB_COL_##col * ACCT_BIN_BATCH + \
+  (pvt)->nrecs])
+
+static int
+acb_set_str(struct rtpp_module_priv *pvt, enum acct_bin_col col,
+  const char *str)
+{
+    union acct_bin_val *vp;
+    int res, off;
+
+    vp = &pvt->cols[col * ACCT_BIN_BATCH + pvt->nrecs];
+    off = RS_ULEN(pvt->sbuf);
+    while ((res = rtpp_sbuf_write(pvt->sbuf, "%s", str)) == SBW_SHRT) {
+        if (rtpp_sbuf_extend(pvt->sbuf, pvt->sbuf->alen * 2) != 0)
+            return (-1);
+    }
+    if (res != SBW_OK)
+        return (-1);
+    vp->s.off = off;
+    vp->s.len = RS_ULEN(pvt->sbuf) - off;
+    return (0);
+}
+
+static void
+rtpp_acct_csv_do(struct rtpp_module_priv *pvt, struct rtpp_acct *acct)
+{
+    int off;
+
+    format_ssrc(&acct->rasta->last_ssrc, pvt->a.ssrc, sizeof(pvt->a.ssrc));
+    format_ssrc(&acct->rasto->last_ssrc, pvt->o.ssrc, sizeof(pvt->o.ssrc));
+    format_netaddr(acct->rtp.a.rem_addr, acct->rtcp.a.rem_addr, &pvt->a);
+    format_netaddr(acct->rtp.o.rem_addr, acct->rtcp.o.rem_addr, &pvt->o);
+
+    off = RS_ULEN(pvt->sbuf);
+    if (acb_set_str(pvt, ACB_COL_RVER, RTPP_METRICS_VERSION) != 0 ||
+      acb_set_str(pvt, ACB_COL_NID, rtpp_acct_get_nid(pvt, acct)) != 0 ||
+      acb_set_str(pvt, ACB_COL_CID, ES_IF_NULL(acct->call_id)) != 0 ||
+      acb_set_str(pvt, ACB_COL_FTAG, ES_IF_NULL(acct->from_tag)) != 0 ||
+      acb_set_str(pvt, ACB_COL_SSRC_INO, pvt->o.ssrc) != 0 ||
+      acb_set_str(pvt, ACB_COL_SSRC_INA, pvt->a.ssrc) != 0 ||
+      acb_set_str(pvt, ACB_COL_RTP_RMT_O, pvt->o.rtp_adr) != 0 ||
+      acb_set_str(pvt, ACB_COL_RTP_RMT_A, pvt->a.rtp_adr) != 0 ||
+      acb_set_str(pvt, ACB_COL_RTCP_RMT_O, pvt->o.rtcp_adr) != 0 ||
+      acb_set_str(pvt, ACB_COL_RTCP_RMT_A, pvt->a.rtcp_adr) != 0) {
+        /* Roll back whatever has made it into the heap */
+        pvt->sbuf->cp = pvt->sbuf->bp + off;
+        return;
+    }
+    ACB_VAL(pvt, PID).i = pvt->pid;
+    ACB_VAL(pvt, SID).i = (int64_t)acct->seuid;
+    ACB_VAL(pvt, SETUP_TS).f = TS2RT(*acct->init_ts);
+    ACB_VAL(pvt, TEARDOWN_TS).f = TS2RT(*acct->destroy_ts);
+    ACB_VAL(pvt, RTP_FIRST_INO).f = TS2RT(acct->rtp.o.ps->first_pkt_rcv);
+    ACB_VAL(pvt, RTP_LAST_INO).f = TS2RT(acct->rtp.o.ps->last_pkt_rcv);
+    ACB_VAL(pvt, RTP_FIRST_INA).f = TS2RT(acct->rtp.a.ps->first_pkt_rcv);
+    ACB_VAL(pvt, RTP_LAST_INA).f = TS2RT(acct->rtp.a.ps->last_pkt_rcv);
+    ACB_VAL(pvt, RTP_NPKTS_INA).u = acct->rtp.a.ps->npkts_in;
+    ACB_VAL(pvt, RTP_NPKTS_INO).u = acct->rtp.o.ps->npkts_in;
+    ACB_VAL(pvt, RTP_NRELAYED).u = acct->rtp.pcnts->nrelayed;
+    ACB_VAL(pvt, RTP_NDROPPED).u = acct->rtp.pcnts->ndropped;
+    ACB_VAL(pvt, RTCP_NPKTS_INA).u = acct->rtcp.a.ps->npkts_in;
+    ACB_VAL(pvt, RTCP_NPKTS_INO).u = acct->rtcp.o.ps->npkts_in;
+    ACB_VAL(pvt, RTCP_NRELAYED).u = acct->rtcp.pcnts->nrelayed;
+    ACB_VAL(pvt, RTCP_NDROPPED).u = acct->rtcp.pcnts->ndropped;
+    ACB_VAL(pvt, NSENT_INO).u = acct->rasto->psent;
+    ACB_VAL(pvt, NRCVD_INO).u = acct->rasto->precvd;
+    ACB_VAL(pvt, NDUPS_INO).u = acct->rasto->pdups;
+    ACB_VAL(pvt, NLOST_INO).u = acct->rasto->plost;
+    ACB_VAL(pvt, PERRS_INO).u = acct->rasto->pecount;
+    ACB_VAL(pvt, SSRC_CNT_INO).u = acct->rasto->ssrc_changes;
+    ACB_VAL(pvt, PT_INO).i = acct->rasto->last_pt;
+    ACB_VAL(pvt, NSENT_INA).u = acct->rasta->psent;
+    ACB_VAL(pvt, NRCVD_INA).u = acct->rasta->precvd;
+    ACB_VAL(pvt, NDUPS_INA).u = acct->rasta->pdups;
+    ACB_VAL(pvt, NLOST_INA).u = acct->rasta->plost;
+    ACB_VAL(pvt, PERRS_INA).u = acct->rasta->pecount;
+    ACB_VAL(pvt, SSRC_CNT_INA).u = acct->rasta->ssrc_changes;
+    ACB_VAL(pvt, PT_INA).i = acct->rasta->last_pt;
+    ACB_VAL(pvt, JLAST_INO).f = acct->jrasto->jlast;
+    ACB_VAL(pvt, JMAX_INO).f = acct->jrasto->jmax;
+    ACB_VAL(pvt, JAVG_INO).f = acct->jrasto->javg;
+    ACB_VAL(pvt, JLAST_INA).f = acct->jrasta->jlast;
+    ACB_VAL(pvt, JMAX_INA).f = acct->jrasta->jmax;
+    ACB_VAL(pvt, JAVG_INA).f = acct->jrasta->javg;
+    ACB_VAL(pvt, HLD_STS_O).i = (acct->rtp.o.hld_stat.status != 0);
+    ACB_VAL(pvt, HLD_STS_A).i = (acct->rtp.a.hld_stat.status != 0);
+    ACB_VAL(pvt, HLD_CNT_O).i = acct->rtp.o.hld_stat.cnt;
+    ACB_VAL(pvt, HLD_CNT_A).i = acct->rtp.a.hld_stat.cnt;
+    pvt->nrecs += 1;
+    if (pvt->nrecs == ACCT_BIN_BATCH)
+        rtpp_acct_csv_flush(pvt);
+}
+#endif
 
 static off_t
 rtpp_acct_csv_lockf(int fd)
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+/* Bump this when some changes are made */
+#define RTPP_METRICS_VERSION	"1.2"
+
+#define SFX_INO "_ino"
+#define SFX_INA "_ina"
+
+#define SFX_O   "_o"
+#define SFX_A   "_a"
+
+#define PFX_GEN "rtpp_"
+
+
+#define RVER_NM     "rec_ver"
+#define NID_NM      PFX_GEN "node_id"
+#define PID_NM      PFX_GEN "pid"
+#define SID_NM      "sess_uid"
+#define CID_NM      "call_id"
+#define PT_NAME     "rtpa_pt_last"
+#define PT_NM_O     PT_NAME SFX_INO
+#define PT_NM_A     PT_NAME SFX_INA
+#define PFX_RTP     "rtp_"
+#define PFX_RTCP    "rtcp_"
+#define RM_IP_NM "rmt_ip"
+#define RM_PT_NM "rmt_pt"
+#define R_RM_NM_O PFX_GEN PFX_RTP RM_IP_NM SFX_O
+#define R_RM_NM_A PFX_GEN PFX_RTP RM_IP_NM SFX_A
+#define C_RM_NM_O PFX_GEN PFX_RTCP RM_IP_NM SFX_O
+#define C_RM_NM_A PFX_GEN PFX_RTCP RM_IP_NM SFX_A
+#define R_RM_PT_NM_O PFX_GEN PFX_RTP RM_PT_NM SFX_O
+#define R_RM_PT_NM_A PFX_GEN PFX_RTP RM_PT_NM SFX_A
+#define C_RM_PT_NM_O PFX_GEN PFX_RTCP RM_PT_NM SFX_O
+#define C_RM_PT_NM_A PFX_GEN PFX_RTCP RM_PT_NM SFX_A
+
+#define HLD_CNT_NM   "hld_cnt"
+#define HLD_STS_NM   "hld_sts"
+#define HLD_CNT_NM_O PFX_GEN HLD_CNT_NM SFX_O
+#define HLD_CNT_NM_A PFX_GEN HLD_CNT_NM SFX_A
+#define HLD_STS_NM_O PFX_GEN HLD_STS_NM SFX_O
+#define HLD_STS_NM_A PFX_GEN HLD_STS_NM SFX_A
+
+#define SEP         ","
+
+/* CSV header line, shared by the acct_csv module and rtpp_acct_bin2csv */
+#define ACCT_CSV_HEAD RVER_NM SEP NID_NM SEP PID_NM SEP SID_NM \
+    SEP CID_NM SEP \
+    "from_tag,setup_ts,teardown_ts,first_rtp_ts_ino,last_rtp_ts_ino," \
+    "first_rtp_ts_ina,last_rtp_ts_ina,rtp_npkts_ina,rtp_npkts_ino," \
+    "rtp_nrelayed,rtp_ndropped,rtcp_npkts_ina,rtcp_npkts_ino," \
+    "rtcp_nrelayed,rtcp_ndropped,rtpa_nsent_ino,rtpa_nrcvd_ino," \
+    "rtpa_ndups_ino,rtpa_nlost_ino,rtpa_perrs_ino," \
+    "rtpa_ssrc_last_ino,rtpa_ssrc_cnt_ino" SEP PT_NM_O SEP \
+    "rtpa_nsent_ina,rtpa_nrcvd_ina,rtpa_ndups_ina,rtpa_nlost_ina," \
+    "rtpa_perrs_ina,rtpa_ssrc_last_ina,rtpa_ssrc_cnt_ina" SEP PT_NM_A SEP \
+    "rtpa_jitter_last_ino,rtpa_jitter_max_ino,rtpa_jitter_avg_ino," \
+    "rtpa_jitter_last_ina,rtpa_jitter_max_ina,rtpa_jitter_avg_ina" SEP \
+    R_RM_NM_O SEP R_RM_PT_NM_O SEP R_RM_NM_A SEP R_RM_PT_NM_A SEP \
+    C_RM_NM_O SEP C_RM_PT_NM_O SEP C_RM_NM_A SEP C_RM_PT_NM_A SEP \
+    HLD_STS_NM_O SEP HLD_STS_NM_A SEP HLD_CNT_NM_O SEP HLD_CNT_NM_A "\n"
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <err.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rtpp_types.h"
+#include "rtpp_sbuf.h"
+#include "rtcp2json.h"
+
+#define BENCH_MAXBATCH 64
+
+/* SR with a single report block */
+static const unsigned char rtcp_sr[] = {
+    0x81, 0xc8, 0x00, 0x0c, 0x12, 0x34, 0x56, 0x78,
+    0xe9, 0x0e, 0x2a, 0x11, 0x4d, 0x2f, 0x1a, 0x9b,
+    0x00, 0x01, 0xe2, 0x40, 0x00, 0x00, 0x01, 0xf4,
+    0x00, 0x01, 0x38, 0x80, 0x87, 0x65, 0x43, 0x21,
+    0x05, 0x00, 0x00, 0x03, 0x00, 0x00, 0x1f, 0x40,
+    0x00, 0x00, 0x00, 0x2a, 0x2a, 0x11, 0x4d, 0x2f,
+    0x00, 0x00, 0x80, 0x00
+};
+
+struct bench_sink {
+    int fd;
+    atomic_bool done;
+    _Atomic(uint64_t) nrecv;
+};
+
+static void
+usage(void)
+{
+
+    fprintf(stderr, "usage: rtcp2json_bench [-n count] [-b batch] [rtcp.raw]\n");
+    exit(1);
+}
+
+static double
+mono_time(void)
+{
+    struct timespec tp;
+
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return (tp.tv_sec + (double)tp.tv_nsec / 1e9);
+}
+
+static void *
+bench_sink_run(void *arg)
+{
+    struct bench_sink *bsp = arg;
+    struct mmsghdr mmsg[BENCH_MAXBATCH];
+    struct iovec iov[BENCH_MAXBATCH];
+    static char rbuf[BENCH_MAXBATCH][2048];
+    int i, n;
+
+    for (i = 0; i < BENCH_MAXBATCH; i++) {
+        iov[i].iov_base = rbuf[i];
+        iov[i].iov_len = sizeof(rbuf[i]);
+        memset(&mmsg[i], '\0', sizeof(mmsg[i]));
+        mmsg[i].msg_hdr.msg_iov = &iov[i];
+        mmsg[i].msg_hdr.msg_iovlen = 1;
+    }
+    for (;;) {
+        n = recvmmsg(bsp->fd, mmsg, BENCH_MAXBATCH, MSG_WAITFORONE, NULL);
+        if (n > 0) {
+            atomic_fetch_add(&bsp->nrecv, n);
+            continue;
+        }
+        /* The receive timeout expired, see if the sender is done */
+        if (atomic_load(&bsp->done))
+            break;
+    }
+    return (NULL);
+}
+
+int
+main(int argc, char **argv)
+{
+    struct rtpp_sbuf *sbufs[BENCH_MAXBATCH];
+    struct mmsghdr mmsg[BENCH_MAXBATCH];
+    struct iovec iov[BENCH_MAXBATCH];
+    struct sockaddr_in sin;
+    socklen_t slen;
+    struct timeval tv;
+    struct bench_sink sink;
+    pthread_t sthr;
+    char rtcp_data[1024];
+    const void *rdp;
+    ssize_t rtcp_dlen;
+    long i, count, nsent;
+    int ch, fd, sfd, batch, bsize, k, n, rcvbuf;
+    double stime, etime;
+
+    count = 1000000;
+    batch = 1;
+    while ((ch = getopt(argc, argv, "n:b:")) != -1) {
+        switch (ch) {
+        case 'n':
+            count = strtol(optarg, NULL, 10);
+            if (count <= 0)
+                usage();
+            break;
+
+        case 'b':
+            batch = atoi(optarg);
+            if (batch < 1 || batch > BENCH_MAXBATCH)
+                usage();
+            break;
+
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    argv += optind;
+
+    if (argc > 0) {
+        fd = open(argv[0], O_RDONLY);
+        if (fd < 0)
+            err(1, "%s", argv[0]);
+        rtcp_dlen = read(fd, rtcp_data, sizeof(rtcp_data));
+        if (rtcp_dlen <= 0)
+            errx(1, "%s: read() failed", argv[0]);
+        close(fd);
+        rdp = rtcp_data;
+    } else {
+        rdp = rtcp_sr;
+        rtcp_dlen = sizeof(rtcp_sr);
+    }
+
+    memset(&sink, '\0', sizeof(sink));
+    sink.fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sink.fd < 0)
+        err(1, "socket");
+    memset(&sin, '\0', sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(sink.fd, (struct sockaddr *)&sin, sizeof(sin)) != 0)
+        err(1, "bind");
+    slen = sizeof(sin);
+    if (getsockname(sink.fd, (struct sockaddr *)&sin, &slen) != 0)
+        err(1, "getsockname");
+    rcvbuf = 8 * 1024 * 1024;
+    setsockopt(sink.fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    tv.tv_sec = 0;
+    tv.tv_usec = 100000;
+    setsockopt(sink.fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (pthread_create(&sthr, NULL, bench_sink_run, &sink) != 0)
+        errx(1, "pthread_create() failed");
+
+    sfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sfd < 0)
+        err(1, "socket");
+    if (connect(sfd, (struct sockaddr *)&sin, sizeof(sin)) != 0)
+        err(1, "connect");
+
+    memset(mmsg, '\0', sizeof(mmsg));
+    for (k = 0; k < batch; k++) {
+        sbufs[k] = rtpp_sbuf_ctor(2048);
+        if (sbufs[k] == NULL)
+            errx(1, "rtpp_sbuf_ctor() failed");
+        mmsg[k].msg_hdr.msg_iov = &iov[k];
+        mmsg[k].msg_hdr.msg_iovlen = 1;
+    }
+
+    nsent = 0;
+    stime = mono_time();
+    for (i = 0; i < count; i += bsize) {
+        bsize = (count - i) < batch ? (count - i) : batch;
+        for (k = 0; k < bsize; k++) {
+            rtpp_sbuf_reset(sbufs[k]);
+            if (rtcp2json(sbufs[k], rdp, rtcp_dlen) < 0)
+                errx(1, "rtcp2json() failed");
+            iov[k].iov_base = sbufs[k]->bp;
+            iov[k].iov_len = RS_ULEN(sbufs[k]);
+        }
+        if (batch == 1) {
+            if (send(sfd, iov[0].iov_base, iov[0].iov_len, 0) > 0)
+                nsent++;
+            continue;
+        }
+        n = sendmmsg(sfd, mmsg, bsize, 0);
+        if (n > 0)
+            nsent += n;
+    }
+    etime = mono_time() - stime;
+
+    atomic_store(&sink.done, 1);
+    pthread_join(sthr, NULL);
+
+    printf("reports=%ld batch=%d time=%.3fs rate=%.0f/s sent=%ld received=%llu\n",
+      count, batch, etime, (double)count / etime, nsent,
+      (unsigned long long)atomic_load(&sink.nrecv));
+
+    for (k = 0; k < batch; k++)
+        rtpp_sbuf_dtor(sbufs[k]);
+    close(sfd);
+    close(sink.fd);
+    return (0);
+}
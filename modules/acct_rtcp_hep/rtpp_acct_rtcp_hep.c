@@ -59,22 +59,27 @@
 #include "hep_api.h"
 #include "hepconnector.h"
 #include "rtpp_sbuf.h"
+#include "rtpp_arh_conf.h"
+#include "rtpp_arh_batch.h"
 
 #include "_acct_rtcp_hep_config.h"
 
 struct rtpp_module_priv {
    struct rtpp_sbuf *sbp;
    struct hep_ctx *ctx;
+   unsigned int sample_rate;
+   /* NULL unless exporting over UDP */
+   struct rtpp_arh_batch *batch;
 };
 
 static struct rtpp_module_priv *rtpp_acct_rtcp_hep_ctor(const struct rtpp_cfg *);
 static void rtpp_acct_rtcp_hep_dtor(struct rtpp_module_priv *);
 static void rtpp_acct_rtcp_hep_do(struct rtpp_module_priv *, struct rtpp_acct_rtcp *);
+static void rtpp_acct_rtcp_hep_flush(struct rtpp_module_priv *);
+static int rtpp_acct_rtcp_hep_sampled(struct rtpp_module_priv *, const char *);
 static struct rtpp_module_conf *rtpp_acct_rtcp_hep_get_mconf(void);
 static int rtpp_acct_rtcp_hep_config(struct rtpp_module_priv *);
 
-extern struct rtpp_module_conf *rtpp_arh_conf;
-
 #ifdef RTPP_CHECK_LEAKS
 #include "rtpp_memdeb_internal.h"
 
@@ -82,7 +87,9 @@ RTPP_MEMDEB_APP_STATIC;
 #endif
 
 static const struct rtpp_acct_handlers acct_rtcp_hep_aapi = {
-    .on_rtcp_rcvd = AAPI_FUNC(rtpp_acct_rtcp_hep_do, rtpp_acct_rtcp_OSIZE())
+    .on_rtcp_rcvd = AAPI_FUNC(rtpp_acct_rtcp_hep_do, rtpp_acct_rtcp_OSIZE()),
+    .on_idle.func = rtpp_acct_rtcp_hep_flush,
+    .rtcp_wanted.func = rtpp_acct_rtcp_hep_sampled
 };
 
 struct rtpp_minfo RTPP_MOD_SELF = {
@@ -112,7 +119,11 @@ rtpp_acct_rtcp_hep_ctor(const struct rtpp_cfg *cfsp)
     if (pvt == NULL) {
         goto e0;
     }
-    pvt->sbp = rtpp_sbuf_ctor(512);
+    /*
+     * The buffer is reset, not re-allocated, between reports, so size it
+     * up-front for an SR carrying a few report blocks.
+     */
+    pvt->sbp = rtpp_sbuf_ctor(2048);
     if (pvt->sbp == NULL) {
         goto e1;
     }
@@ -131,10 +142,23 @@ e0:
 static int
 rtpp_acct_rtcp_hep_config(struct rtpp_module_priv *pvt)
 {
-    pvt->ctx = rtpp_arh_conf->conf_data;
+    struct rtpp_arh_conf *cfp = rtpp_arh_conf->conf_data;
+    int stype;
+    socklen_t slen;
+
+    pvt->ctx = &cfp->hep;
+    pvt->sample_rate = cfp->sample_rate;
     if (init_hepsocket(pvt->ctx) != 0) {
         return (-1);
     }
+    slen = sizeof(stype);
+    if (getsockopt(pvt->ctx->sock, SOL_SOCKET, SO_TYPE, &stype, &slen) == 0 &&
+      stype == SOCK_DGRAM) {
+        pvt->batch = rtpp_arh_batch_ctor(pvt->ctx->sock, pvt->ctx->capt_id);
+        if (pvt->batch == NULL) {
+            return (-1);
+        }
+    }
     return (0);
 }
 
@@ -144,12 +168,36 @@ rtpp_acct_rtcp_hep_dtor(struct rtpp_module_priv *pvt)
     if (pvt->ctx->capt_host != default_ctx.capt_host && pvt->ctx->capt_host != NULL) {
         mod_free(pvt->ctx->capt_host);
     }
+    if (pvt->batch != NULL) {
+        rtpp_acct_rtcp_hep_flush(pvt);
+        rtpp_arh_batch_dtor(pvt->batch);
+    }
     hep_gen_dtor(pvt->ctx);
     rtpp_sbuf_dtor(pvt->sbp);
     mod_free(pvt);
     return;
 }
 
+/*
+ * Sampling is done per call rather than per report, so that the capture
+ * side still gets a complete RTCP history for every call it sees. Called
+ * from the packet processing threads, before the report is queued to us.
+ */
+static int
+rtpp_acct_rtcp_hep_sampled(struct rtpp_module_priv *pvt, const char *call_id)
+{
+    uint32_t h;
+
+    if (pvt->sample_rate <= 1)
+        return (1);
+    /* FNV-1a */
+    for (h = 2166136261U; *call_id != '\0'; call_id++) {
+        h ^= (unsigned char)*call_id;
+        h *= 16777619U;
+    }
+    return ((h % pvt->sample_rate) == 0);
+}
+
 static void
 rtpp_acct_rtcp_hep_do(struct rtpp_module_priv *pvt, struct rtpp_acct_rtcp *rarp)
 {
@@ -158,6 +206,17 @@ rtpp_acct_rtcp_hep_do(struct rtpp_module_priv *pvt, struct rtpp_acct_rtcp *rarp)
     struct timeval rtimeval;
     int rval;
 
+    /*
+     * Encode first: a malformed report is then dropped before any of the
+     * HEP header state has been touched.
+     */
+    rtpp_sbuf_reset(pvt->sbp);
+    rval = rtcp2json(pvt->sbp, rarp->pkt->data.buf, rarp->pkt->size);
+    if (rval < 0) {
+        mod_log(RTPP_LOG_ERR, "rtcp2json() failed: %d", rval);
+        goto out;
+    }
+
     memset(&ri, '\0', sizeof(ri));
 
     src_addr = sstosa(&(rarp->pkt->raddr));
@@ -186,6 +245,16 @@ rtpp_acct_rtcp_hep_do(struct rtpp_module_priv *pvt, struct rtpp_acct_rtcp *rarp)
     dtime2timeval(rarp->pkt->rtime.wall, &rtimeval);
     ri.time_sec = SEC(&rtimeval);
     ri.time_usec = USEC(&rtimeval);
+    if (pvt->batch != NULL) {
+        rval = rtpp_arh_batch_add(pvt->batch, &ri, rarp->call_id,
+          pvt->sbp->bp, RS_ULEN(pvt->sbp));
+        if (rval < 0) {
+            mod_elog(RTPP_LOG_INFO, "sending HEP batch failed");
+        }
+        if (rval <= 0) {
+            goto out;
+        }
+    }
     if (hep_gen_fill(pvt->ctx, &ri) < 0) {
       mod_log(RTPP_LOG_ERR, "hep_gen_fill() failed");
         goto out;
@@ -197,13 +266,6 @@ rtpp_acct_rtcp_hep_do(struct rtpp_module_priv *pvt, struct rtpp_acct_rtcp *rarp)
         goto out;
     }
 
-    rtpp_sbuf_reset(pvt->sbp);
-    rval = rtcp2json(pvt->sbp, rarp->pkt->data.buf, rarp->pkt->size);
-    if (rval < 0) {
-        mod_log(RTPP_LOG_ERR, "rtcp2json() failed: %d", rval);
-        goto out;
-    }
-
     rval = send_hep(pvt->ctx, &ri, pvt->sbp->bp, RS_ULEN(pvt->sbp));
     if (rval < 0) {
         mod_log(RTPP_LOG_INFO, "send_hep() failed: %d", rval);
@@ -213,12 +275,24 @@ out:
     return;
 }
 
+static void
+rtpp_acct_rtcp_hep_flush(struct rtpp_module_priv *pvt)
+{
+
+    if (pvt->batch == NULL)
+        return;
+    if (rtpp_arh_batch_flush(pvt->batch) != 0) {
+        mod_elog(RTPP_LOG_INFO, "sending HEP batch failed");
+    }
+}
+
 static struct rtpp_module_conf *
 rtpp_acct_rtcp_hep_get_mconf(void)
 {
-    static struct hep_ctx hp;
+    static struct rtpp_arh_conf hp;
 
-    hp = default_ctx;
+    hp.hep = default_ctx;
+    hp.sample_rate = 1;
     rtpp_arh_conf->conf_data = &hp;
 
     return (rtpp_arh_conf);
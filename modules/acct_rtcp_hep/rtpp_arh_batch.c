@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#if defined(LINUX_XXX) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* sendmmsg() */
+#endif
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+
+#include "rtpp_types.h"
+#include "rtpp_log.h"
+#include "rtpp_log_obj.h"
+#include "rtpp_module.h"
+#include "rtpp_debug.h"
+
+#include "hep_api.h"
+#include "rtpp_arh_batch.h"
+
+#define ARH_BATCH_LEN   32
+#define ARH_FRAME_MAX   2048
+
+/* HEPv3 chunk types, all in the generic (0x0000) vendor space */
+#define HEP3_IP_FAMILY  0x0001
+#define HEP3_IP_PROTO   0x0002
+#define HEP3_SRC_IP4    0x0003
+#define HEP3_DST_IP4    0x0004
+#define HEP3_SRC_IP6    0x0005
+#define HEP3_DST_IP6    0x0006
+#define HEP3_SRC_PORT   0x0007
+#define HEP3_DST_PORT   0x0008
+#define HEP3_TS_SEC     0x0009
+#define HEP3_TS_USEC    0x000a
+#define HEP3_PROTO_TYPE 0x000b
+#define HEP3_CAPT_ID    0x000c
+#define HEP3_PAYLOAD    0x000f
+#define HEP3_CORR_ID    0x0011
+
+#define HEP3_HDR_LEN    6
+#define HEP3_CHUNK_HLEN 6
+
+struct rtpp_arh_batch {
+    int sock;
+    uint32_t capt_id;
+    unsigned int nframes;
+    struct iovec iov[ARH_BATCH_LEN];
+#if defined(HAVE_SENDMMSG)
+    struct mmsghdr msgs[ARH_BATCH_LEN];
+#endif
+    unsigned char frames[ARH_BATCH_LEN][ARH_FRAME_MAX];
+};
+
+struct rtpp_arh_batch *
+rtpp_arh_batch_ctor(int sock, uint32_t capt_id)
+{
+    struct rtpp_arh_batch *bp;
+
+    bp = mod_zmalloc(sizeof(struct rtpp_arh_batch));
+    if (bp == NULL)
+        return (NULL);
+    bp->sock = sock;
+    bp->capt_id = capt_id;
+    for (int i = 0; i < ARH_BATCH_LEN; i++) {
+        bp->iov[i].iov_base = bp->frames[i];
+#if defined(HAVE_SENDMMSG)
+        bp->msgs[i].msg_hdr.msg_iov = &bp->iov[i];
+        bp->msgs[i].msg_hdr.msg_iovlen = 1;
+#endif
+    }
+    return (bp);
+}
+
+void
+rtpp_arh_batch_dtor(struct rtpp_arh_batch *bp)
+{
+
+    mod_free(bp);
+}
+
+static unsigned char *
+hep3_chunk(unsigned char *cp, uint16_t type, const void *data, size_t len)
+{
+    uint16_t hv[3];
+
+    hv[0] = htons(0x0000);
+    hv[1] = htons(type);
+    hv[2] = htons(HEP3_CHUNK_HLEN + len);
+    memcpy(cp, hv, sizeof(hv));
+    memcpy(cp + HEP3_CHUNK_HLEN, data, len);
+    return (cp + HEP3_CHUNK_HLEN + len);
+}
+
+static unsigned char *
+hep3_chunk_u8(unsigned char *cp, uint16_t type, uint8_t v)
+{
+
+    return (hep3_chunk(cp, type, &v, sizeof(v)));
+}
+
+static unsigned char *
+hep3_chunk_u16(unsigned char *cp, uint16_t type, uint16_t v)
+{
+
+    v = htons(v);
+    return (hep3_chunk(cp, type, &v, sizeof(v)));
+}
+
+static unsigned char *
+hep3_chunk_u32(unsigned char *cp, uint16_t type, uint32_t v)
+{
+
+    v = htonl(v);
+    return (hep3_chunk(cp, type, &v, sizeof(v)));
+}
+
+/*
+ * Same chunks as hep_gen_fill() + hep_gen_append(HEP_TID_CID) + send_hep()
+ * produce for an uncompressed HEPv3 frame. The batch is flushed as soon as
+ * it fills up.
+ */
+int
+rtpp_arh_batch_add(struct rtpp_arh_batch *bp, const struct rc_info *rip,
+  const char *call_id, const void *pl, size_t pllen)
+{
+    unsigned char *fp, *cp;
+    size_t cidlen, alen, flen;
+    uint16_t hl;
+
+    cidlen = strlen(call_id);
+    alen = (rip->ip_family == AF_INET) ? sizeof(struct in_addr) :
+      sizeof(struct in6_addr);
+    flen = HEP3_HDR_LEN + 12 * HEP3_CHUNK_HLEN + 3 * sizeof(uint8_t) +
+      2 * sizeof(uint16_t) + 3 * sizeof(uint32_t) + 2 * alen + cidlen + pllen;
+    if (flen > ARH_FRAME_MAX)
+        return (1);
+
+    fp = bp->frames[bp->nframes];
+    cp = fp + HEP3_HDR_LEN;
+    cp = hep3_chunk_u8(cp, HEP3_IP_FAMILY, rip->ip_family);
+    cp = hep3_chunk_u8(cp, HEP3_IP_PROTO, rip->ip_proto);
+    if (rip->ip_family == AF_INET) {
+        cp = hep3_chunk(cp, HEP3_SRC_IP4, rip->src.p4, alen);
+        cp = hep3_chunk(cp, HEP3_DST_IP4, rip->dst.p4, alen);
+    } else {
+        cp = hep3_chunk(cp, HEP3_SRC_IP6, rip->src.p6, alen);
+        cp = hep3_chunk(cp, HEP3_DST_IP6, rip->dst.p6, alen);
+    }
+    cp = hep3_chunk_u16(cp, HEP3_SRC_PORT, rip->src_port);
+    cp = hep3_chunk_u16(cp, HEP3_DST_PORT, rip->dst_port);
+    cp = hep3_chunk_u32(cp, HEP3_TS_SEC, rip->time_sec);
+    cp = hep3_chunk_u32(cp, HEP3_TS_USEC, rip->time_usec);
+    cp = hep3_chunk_u8(cp, HEP3_PROTO_TYPE, rip->proto_type);
+    cp = hep3_chunk_u32(cp, HEP3_CAPT_ID, bp->capt_id);
+    cp = hep3_chunk(cp, HEP3_CORR_ID, call_id, cidlen);
+    cp = hep3_chunk(cp, HEP3_PAYLOAD, pl, pllen);
+    RTPP_DBG_ASSERT((size_t)(cp - fp) == flen);
+    memcpy(fp, "HEP3", 4);
+    hl = htons(flen);
+    memcpy(fp + 4, &hl, sizeof(hl));
+    bp->iov[bp->nframes].iov_len = flen;
+    bp->nframes += 1;
+    if (bp->nframes == ARH_BATCH_LEN)
+        return (rtpp_arh_batch_flush(bp));
+    return (0);
+}
+
+int
+rtpp_arh_batch_flush(struct rtpp_arh_batch *bp)
+{
+    unsigned int i;
+    int n;
+
+    for (i = 0; i < bp->nframes; i += n) {
+#if defined(HAVE_SENDMMSG)
+        n = sendmmsg(bp->sock, &bp->msgs[i], bp->nframes - i, 0);
+#else
+        n = (send(bp->sock, bp->iov[i].iov_base, bp->iov[i].iov_len,
+          0) < 0) ? -1 : 1;
+#endif
+        if (n < 0) {
+            if (errno == EINTR) {
+                n = 0;
+                continue;
+            }
+            bp->nframes = 0;
+            return (-1);
+        }
+    }
+    bp->nframes = 0;
+    return (0);
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#ifndef _RTPP_ARH_BATCH_H_
+#define _RTPP_ARH_BATCH_H_
+
+/*
+ * HEPv3 frames are assembled here and handed to the kernel in batches over
+ * the (connected, datagram) socket set up by init_hepsocket(). Frames that
+ * don't fit into a batch slot are left for send_hep().
+ */
+
+struct rtpp_arh_batch;
+struct rc_info;
+
+struct rtpp_arh_batch *rtpp_arh_batch_ctor(int, uint32_t);
+void rtpp_arh_batch_dtor(struct rtpp_arh_batch *);
+/* 0 - queued, 1 - frame is too large, -1 - flushing a full batch failed */
+int rtpp_arh_batch_add(struct rtpp_arh_batch *, const struct rc_info *,
+  const char *, const void *, size_t);
+/* 0 - all queued frames sent, -1 - the rest has been dropped, see errno */
+int rtpp_arh_batch_flush(struct rtpp_arh_batch *);
+
+#endif /* _RTPP_ARH_BATCH_H_ */
@@ -27,6 +27,7 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
 #include <netdb.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -42,22 +43,23 @@
 #include "ucl.h"
 #include "rtpp_ucl.h"
 
+#include "core_hep.h"
+#include "hep_api.h"
 #include "hepconnector.h"
-
-struct hep_ctx;
+#include "rtpp_arh_conf.h"
 
 static const struct addrinfo udp_hints = { .ai_socktype = SOCK_DGRAM };
 static const struct addrinfo tcp_hints = { .ai_socktype = SOCK_STREAM };
 
 static bool
 conf_set_capt_host(struct rtpp_log *log, const ucl_object_t *top,
-  const ucl_object_t *obj, struct hep_ctx *target)
+  const ucl_object_t *obj, struct rtpp_arh_conf *target)
 {
     const char *val = NULL;
 
     val = ucl_object_tostring_forced(obj);
-    target->capt_host = mod_strdup(val);
-    if (target->capt_host == NULL)
+    target->hep.capt_host = mod_strdup(val);
+    if (target->hep.capt_host == NULL)
         return (false);
 
     return (true);
@@ -65,7 +67,7 @@ conf_set_capt_host(struct rtpp_log *log, const ucl_object_t *top,
 
 static bool
 conf_set_capt_port(struct rtpp_log *log, const ucl_object_t *top,
-  const ucl_object_t *obj, struct hep_ctx *target)
+  const ucl_object_t *obj, struct rtpp_arh_conf *target)
 {
 
     const char *val = NULL;
@@ -84,23 +86,23 @@ conf_set_capt_port(struct rtpp_log *log, const ucl_object_t *top,
             ucl_object_key(obj), (int)rport);
         return (false);
     }
-    snprintf(target->capt_port, sizeof(target->capt_port), "%d", (int)rport);
+    snprintf(target->hep.capt_port, sizeof(target->hep.capt_port), "%d", (int)rport);
     return (true);
 }
 
 static bool
 conf_set_capt_ptype(struct rtpp_log *log, const ucl_object_t *top,
-  const ucl_object_t *obj, struct hep_ctx *target)
+  const ucl_object_t *obj, struct rtpp_arh_conf *target)
 {
 
     const char *val = NULL;
 
     val = ucl_object_tostring_forced(obj);
     if (strcasecmp(val, "udp") == 0) {
-        target->hints = &udp_hints;
+        target->hep.hints = &udp_hints;
         return (true);
     } else if (strcasecmp(val, "tcp") == 0) {
-        target->hints = &tcp_hints;
+        target->hep.hints = &tcp_hints;
         return (true);
     }
 
@@ -111,7 +113,7 @@ conf_set_capt_ptype(struct rtpp_log *log, const ucl_object_t *top,
 
 static bool
 conf_set_capt_id(struct rtpp_log *log, const ucl_object_t *top,
-  const ucl_object_t *obj, struct hep_ctx *target)
+  const ucl_object_t *obj, struct rtpp_arh_conf *target)
 {
 
     const char *val = NULL;
@@ -130,7 +132,32 @@ conf_set_capt_id(struct rtpp_log *log, const ucl_object_t *top,
             ucl_object_key(obj), (int)capt_id);
         return (false);
     }
-    target->capt_id = capt_id;
+    target->hep.capt_id = capt_id;
+    return (true);
+}
+
+static bool
+conf_set_sample_rate(struct rtpp_log *log, const ucl_object_t *top,
+  const ucl_object_t *obj, struct rtpp_arh_conf *target)
+{
+
+    const char *val = NULL;
+    int64_t sample_rate;
+
+    if (ucl_object_type(obj) == UCL_INT) {
+        sample_rate = ucl_object_toint(obj);
+    } else {
+        val = ucl_object_tostring_forced(obj);
+        RTPP_LOG(log, RTPP_LOG_ERR, "error in config file; invalid value for sample_rate in section '%s': '%s'",
+            ucl_object_key(obj), val);
+        return (false);
+    }
+    if (sample_rate < 1 || sample_rate > 0xffff) {
+        RTPP_LOG(log, RTPP_LOG_ERR, "error in config file; invalid value for sample_rate in section '%s': %d",
+            ucl_object_key(obj), (int)sample_rate);
+        return (false);
+    }
+    target->sample_rate = sample_rate;
     return (true);
 }
 
@@ -142,6 +169,7 @@ static struct rtpp_module_conf _rtpp_arh_conf = {
         { "capt_port", (conf_helper_t) conf_set_capt_port },
         { "capt_ptype", (conf_helper_t) conf_set_capt_ptype },
         { "capt_id", (conf_helper_t) conf_set_capt_id },
+        { "sample_rate", (conf_helper_t) conf_set_sample_rate },
         { NULL, (conf_helper_t) rtpp_ucl_set_unknown }
     }
 };
@@ -252,10 +252,11 @@ rtpp_dtls_gw_setup_sender(struct rtpp_module_priv *pvt,
         abort();
     }
 
-    if (rtpp_create_listener(pvt->cfsp, dtls_strmp->laddr, &lport, fds) == -1)
+    if (rtpp_create_listener(pvt->cfsp, dtls_strmp->laddr, spa->shard,
+      &lport, fds) == -1)
         return (-1);
     CALL_SMETHOD(pvt->cfsp->sessinfo, append, spa, sidx, fds);
-    CALL_METHOD(pvt->cfsp->rtpp_proc_cf, nudge);
+    CALL_METHOD(pvt->cfsp->rtpp_proc_cf, nudge, spa->shard);
     RTPP_OBJ_DECREF(fds[0]);
     RTPP_OBJ_DECREF(fds[1]);
     dtls_strmp->port = lport;
@@ -38,6 +38,9 @@
 #include <stdio.h>
 #include <string.h>
 
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include <openssl/sha.h>
+
 #include "config_pp.h"
 
 #include "rtpp_types.h"
@@ -87,6 +90,8 @@
 #include "re_stun.h"
 #include "ice/ice.h"
 
+#include "rtpp_ice_lite_stun.h"
+
 struct rtpp_module_priv {
     /* Empty */
 };
@@ -113,6 +118,13 @@ struct ice_lite_agent_cfg {
     struct ila_sock *sock;
     struct mbuf *mb;
     _Atomic(bool) completed;
+    /* Read-only after ctor, used by the STUN fast path without the lock */
+    const char *lufrag;
+    size_t lufrag_len;
+    struct ila_stun_key skey;
+    /* Protected by state_lock, can change on re-offer */
+    char rufrag[ILA_UFRAG_MAX];
+    size_t rufrag_len;
     struct mux_demux_ctx rtcp_dmx_ctx;
     struct mux_demux_ctx rtcp_mx_ctx;
 };
@@ -308,6 +320,9 @@ ice_lite_data_ctor(int lufrag_len, int lpwd_len)
     if (icem_alloc(&ila_c->icem, ICE_MODE_LITE, ICE_ROLE_CONTROLLED, IPPROTO_UDP, 0,
       tiebrk, lufrag.s, lpwd.s, NULL, NULL) != 0)
         goto e1;
+    ila_c->lufrag = ila_c->icem->lufrag;
+    ila_c->lufrag_len = lufrag.len;
+    ila_stun_key_init(&ila_c->skey, lpwd.s, lpwd.len);
     ila_c->sock = mem_zalloc(sizeof(*ila_c->sock), NULL);
     if (ila_c->sock == NULL)
         goto e2;
@@ -347,11 +362,15 @@ ila_set_rauth(struct ice_lite_agent_cfg *ila_c, const rtpp_str_t *ice_rufrag,
   const rtpp_str_t *ice_rpwd)
 {
 
+    if (ice_rufrag->len > sizeof(ila_c->rufrag))
+        return -1;
     pthread_mutex_lock(&ila_c->state_lock);
     if (icem_sdp_decode(ila_c->icem, "ice-ufrag", ice_rufrag->s) != 0)
         goto e0;
     if (icem_sdp_decode(ila_c->icem, "ice-pwd", ice_rpwd->s) != 0)
         goto e0;
+    memcpy(ila_c->rufrag, ice_rufrag->s, ice_rufrag->len);
+    ila_c->rufrag_len = ice_rufrag->len;
     pthread_mutex_unlock(&ila_c->state_lock);
     return 0;
 e0:
@@ -671,6 +690,42 @@ ril_ice_taste(struct pkt_proc_ctx *pktx)
     return (true);
 }
 
+/*
+ * Answer consent freshness checks on a completed session right away,
+ * without a trip through the worker and libre. Only requests coming from
+ * the latched remote address and carrying nothing that would change the
+ * ICE state qualify.
+ */
+static int
+ila_stun_fastpath(struct ice_lite_agent_cfg *ila_c,
+  const struct pkt_proc_ctx *pktx)
+{
+    struct rtp_packet *pkt = pktx->pktp;
+    struct rtpp_netaddr *rem_addr;
+    int res;
+
+    /* Don't wait for the worker, let it handle the request instead */
+    if (pthread_mutex_trylock(&ila_c->state_lock) != 0)
+        return (-1);
+    res = ila_stun_check(&ila_c->skey, ila_c->lufrag, ila_c->lufrag_len,
+      ila_c->rufrag, ila_c->rufrag_len, pkt->data.buf, pkt->size);
+    pthread_mutex_unlock(&ila_c->state_lock);
+    if (res != 0)
+        return (-1);
+    rem_addr = CALL_SMETHOD(pktx->strmp_in, get_rem_addr, 0);
+    if (rem_addr == NULL)
+        return (-1);
+    if (CALL_SMETHOD(rem_addr, cmp, sstosa(&pkt->raddr), pkt->rlen) != 0) {
+        RTPP_OBJ_DECREF(rem_addr);
+        return (-1);
+    }
+    pkt->size = ila_stun_respond(&ila_c->skey, pkt->data.buf,
+      sstosa(&pkt->raddr));
+    CALL_SMETHOD(pktx->strmp_in, send_pkt_to, pkt->sender, pkt, rem_addr);
+    RTPP_OBJ_DECREF(rem_addr);
+    return (0);
+}
+
 static struct pproc_act
 rtpp_ice_lite_enqueue(const struct pkt_proc_ctx *pktx)
 {
@@ -681,6 +736,8 @@ rtpp_ice_lite_enqueue(const struct pkt_proc_ctx *pktx)
     ila_c = (struct ice_lite_agent_cfg *)pktx->auxp;
     if (ila_c == NULL)
         return (PPROC_ACT_DROP);
+    if (ila_iscompleted(ila_c) && ila_stun_fastpath(ila_c, pktx) == 0)
+        return (PPROC_ACT_TAKE);
     wi = rtpp_wi_malloc_udata((void **)&wip, sizeof(struct wipkt));
     if (wi == NULL)
         return (PPROC_ACT_DROP);
@@ -728,6 +785,7 @@ rtpp_ice_lite_ctor(const struct rtpp_cfg *cfsp)
 #ifdef RTPP_CHECK_LEAKS
     _libre_memdeb = *rtpp_module.memdeb_p;
 #endif
+    ila_stun_init();
     return (pvt);
 
 e0:
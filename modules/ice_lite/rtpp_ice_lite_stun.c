@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Fast path for the STUN Binding requests that keep an already completed
+ * ICE session alive (RFC 7675 consent freshness). Only requests that carry
+ * no state changes are handled here, everything else is left to the libre
+ * ICE stack running on the module worker.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * SHA1_Init() and friends are deprecated, but still the only way to copy
+ * a keyed hash state without a heap allocation.
+ */
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include <openssl/sha.h>
+
+#include "rtpp_ice_lite_stun.h"
+
+#define ILA_STUN_HDR_LEN        20
+#define ILA_STUN_COOKIE         0x2112a442
+#define ILA_STUN_FP_XOR         0x5354554e
+
+#define ILA_STUN_BINDING_REQ    0x0001
+#define ILA_STUN_BINDING_RESP   0x0101
+
+#define ILA_STUN_A_USERNAME     0x0006
+#define ILA_STUN_A_MSG_INTEG    0x0008
+#define ILA_STUN_A_XOR_MAPPED   0x0020
+#define ILA_STUN_A_PRIORITY     0x0024
+#define ILA_STUN_A_USE_CAND     0x0025
+#define ILA_STUN_A_FINGERPRINT  0x8028
+#define ILA_STUN_A_CONTROLLED   0x8029
+#define ILA_STUN_A_CONTROLLING  0x802a
+
+#define ILA_STUN_MI_LEN         (4 + SHA_DIGEST_LENGTH)
+#define ILA_STUN_FP_LEN         (4 + 4)
+
+static uint32_t crc32_tbl[256];
+
+static inline unsigned int
+get16(const unsigned char *p)
+{
+
+    return ((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t
+get32(const unsigned char *p)
+{
+
+    return (((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+}
+
+static inline void
+put16(unsigned char *p, unsigned int v)
+{
+
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+static inline void
+put32(unsigned char *p, uint32_t v)
+{
+
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+void
+ila_stun_init(void)
+{
+    uint32_t c;
+    int i, j;
+
+    for (i = 0; i < 256; i++) {
+        c = i;
+        for (j = 0; j < 8; j++)
+            c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+        crc32_tbl[i] = c;
+    }
+}
+
+static uint32_t
+ila_crc32(const unsigned char *p, size_t len)
+{
+    uint32_t c = 0xffffffff;
+
+    while (len-- > 0)
+        c = crc32_tbl[(c ^ *p++) & 0xff] ^ (c >> 8);
+    return (c ^ 0xffffffff);
+}
+
+void
+ila_stun_key_init(struct ila_stun_key *skp, const char *key, size_t klen)
+{
+    unsigned char pad[SHA_CBLOCK];
+    unsigned char kd[SHA_DIGEST_LENGTH];
+    int i;
+
+    if (klen > SHA_CBLOCK) {
+        SHA1((const unsigned char *)key, klen, kd);
+        key = (const char *)kd;
+        klen = sizeof(kd);
+    }
+    memset(pad, 0x36, sizeof(pad));
+    for (i = 0; i < klen; i++)
+        pad[i] ^= key[i];
+    SHA1_Init(&skp->ictx);
+    SHA1_Update(&skp->ictx, pad, sizeof(pad));
+    memset(pad, 0x5c, sizeof(pad));
+    for (i = 0; i < klen; i++)
+        pad[i] ^= key[i];
+    SHA1_Init(&skp->octx);
+    SHA1_Update(&skp->octx, pad, sizeof(pad));
+}
+
+/*
+ * MESSAGE-INTEGRITY covers the message up to the attribute itself, with
+ * the header length field adjusted to end right after it.
+ */
+static void
+ila_stun_hmac(const struct ila_stun_key *skp, const unsigned char *msg,
+  size_t mi_off, unsigned char *md)
+{
+    SHA_CTX ctx;
+    unsigned char hdr[4];
+
+    put16(hdr, get16(msg));
+    put16(hdr + 2, mi_off + ILA_STUN_MI_LEN - ILA_STUN_HDR_LEN);
+    ctx = skp->ictx;
+    SHA1_Update(&ctx, hdr, sizeof(hdr));
+    SHA1_Update(&ctx, msg + sizeof(hdr), mi_off - sizeof(hdr));
+    SHA1_Final(md, &ctx);
+    ctx = skp->octx;
+    SHA1_Update(&ctx, md, SHA_DIGEST_LENGTH);
+    SHA1_Final(md, &ctx);
+}
+
+/*
+ * Returns 0 if the message is a well-formed and authentic Binding request
+ * from rufrag to lufrag that only refreshes consent, -1 otherwise.
+ */
+int
+ila_stun_check(const struct ila_stun_key *skp, const char *lufrag,
+  size_t lufrag_len, const char *rufrag, size_t rufrag_len,
+  const unsigned char *msg, size_t len)
+{
+    unsigned char md[SHA_DIGEST_LENGTH];
+    size_t off, alen, mi_off;
+    unsigned int atype;
+    int have_user;
+
+    if (len < ILA_STUN_HDR_LEN || (len & 3) != 0)
+        return (-1);
+    if (get16(msg) != ILA_STUN_BINDING_REQ ||
+      get16(msg + 2) + ILA_STUN_HDR_LEN != len ||
+      get32(msg + 4) != ILA_STUN_COOKIE)
+        return (-1);
+    have_user = 0;
+    mi_off = 0;
+    for (off = ILA_STUN_HDR_LEN; off < len; off += 4 + ((alen + 3) & ~3)) {
+        if (off + 4 > len)
+            return (-1);
+        atype = get16(msg + off);
+        alen = get16(msg + off + 2);
+        if (off + 4 + alen > len)
+            return (-1);
+        /* Only FINGERPRINT may follow MESSAGE-INTEGRITY */
+        if (mi_off != 0 && atype != ILA_STUN_A_FINGERPRINT)
+            return (-1);
+        switch (atype) {
+        case ILA_STUN_A_USERNAME:
+            /* "lufrag:rufrag", RFC 8445 Section 7.2.2 */
+            if (alen != lufrag_len + 1 + rufrag_len ||
+              msg[off + 4 + lufrag_len] != ':' ||
+              memcmp(msg + off + 4, lufrag, lufrag_len) != 0 ||
+              memcmp(msg + off + 5 + lufrag_len, rufrag, rufrag_len) != 0)
+                return (-1);
+            have_user = 1;
+            break;
+
+        case ILA_STUN_A_MSG_INTEG:
+            if (alen != SHA_DIGEST_LENGTH)
+                return (-1);
+            mi_off = off;
+            break;
+
+        case ILA_STUN_A_FINGERPRINT:
+            if (alen != 4 || off + ILA_STUN_FP_LEN != len)
+                return (-1);
+            if ((ila_crc32(msg, off) ^ ILA_STUN_FP_XOR) != get32(msg + off + 4))
+                return (-1);
+            break;
+
+        case ILA_STUN_A_PRIORITY:
+        case ILA_STUN_A_CONTROLLING:
+            break;
+
+        case ILA_STUN_A_USE_CAND:
+        case ILA_STUN_A_CONTROLLED:
+            /* Nomination or role conflict, needs the full ICE agent */
+            return (-1);
+
+        default:
+            /* Comprehension-required attribute we don't know about */
+            if (atype < 0x8000)
+                return (-1);
+            break;
+        }
+    }
+    if (!have_user || mi_off == 0)
+        return (-1);
+    ila_stun_hmac(skp, msg, mi_off, md);
+    if (memcmp(md, msg + mi_off + 4, sizeof(md)) != 0)
+        return (-1);
+    return (0);
+}
+
+/*
+ * Turns the Binding request in msg into the success response in-place,
+ * re-using the transaction ID from the request. Returns the response
+ * length.
+ */
+size_t
+ila_stun_respond(const struct ila_stun_key *skp, unsigned char *msg,
+  const struct sockaddr *raddr)
+{
+    const struct sockaddr_in *sin;
+    const struct sockaddr_in6 *sin6;
+    const unsigned char *ap;
+    size_t off, alen;
+    int i;
+
+    put16(msg, ILA_STUN_BINDING_RESP);
+    off = ILA_STUN_HDR_LEN;
+    put16(msg + off, ILA_STUN_A_XOR_MAPPED);
+    msg[off + 4] = 0;
+    /* Address is XOR'ed with the cookie (and the transaction ID for IPv6) */
+    if (raddr->sa_family == AF_INET) {
+        sin = (const struct sockaddr_in *)raddr;
+        alen = 4;
+        msg[off + 5] = 0x01;
+        put16(msg + off + 6, ntohs(sin->sin_port) ^ (ILA_STUN_COOKIE >> 16));
+        ap = (const unsigned char *)&sin->sin_addr;
+    } else {
+        sin6 = (const struct sockaddr_in6 *)raddr;
+        alen = 16;
+        msg[off + 5] = 0x02;
+        put16(msg + off + 6, ntohs(sin6->sin6_port) ^ (ILA_STUN_COOKIE >> 16));
+        ap = (const unsigned char *)&sin6->sin6_addr;
+    }
+    for (i = 0; i < alen; i++)
+        msg[off + 8 + i] = ap[i] ^ msg[4 + i];
+    put16(msg + off + 2, 4 + alen);
+    off += 8 + alen;
+
+    ila_stun_hmac(skp, msg, off, msg + off + 4);
+    put16(msg + off, ILA_STUN_A_MSG_INTEG);
+    put16(msg + off + 2, SHA_DIGEST_LENGTH);
+    off += ILA_STUN_MI_LEN;
+
+    put16(msg + 2, off + ILA_STUN_FP_LEN - ILA_STUN_HDR_LEN);
+    put16(msg + off, ILA_STUN_A_FINGERPRINT);
+    put16(msg + off + 2, 4);
+    put32(msg + off + 4, ila_crc32(msg, off) ^ ILA_STUN_FP_XOR);
+    off += ILA_STUN_FP_LEN;
+
+    return (off);
+}
+
+#if defined(ila_stun_selftest)
+#include <arpa/inet.h>
+#include <err.h>
+
+#define errx_ifnot(expr) \
+    if (!(expr)) \
+        errx(1, "`%s` check has failed in %s() at %s:%d", #expr, __func__, \
+          __FILE__, __LINE__);
+
+/* RFC 5769 Section 2.1, Sample Request */
+static const unsigned char rfc5769_req[] = {
+    0x00, 0x01, 0x00, 0x58, 0x21, 0x12, 0xa4, 0x42,
+    0xb7, 0xe7, 0xa7, 0x01, 0xbc, 0x34, 0xd6, 0x86,
+    0xfa, 0x87, 0xdf, 0xae, 0x80, 0x22, 0x00, 0x10,
+    0x53, 0x54, 0x55, 0x4e, 0x20, 0x74, 0x65, 0x73,
+    0x74, 0x20, 0x63, 0x6c, 0x69, 0x65, 0x6e, 0x74,
+    0x00, 0x24, 0x00, 0x04, 0x6e, 0x00, 0x01, 0xff,
+    0x80, 0x29, 0x00, 0x08, 0x93, 0x2f, 0xf9, 0xb1,
+    0x51, 0x26, 0x3b, 0x36, 0x00, 0x06, 0x00, 0x09,
+    0x65, 0x76, 0x74, 0x6a, 0x3a, 0x68, 0x36, 0x76,
+    0x59, 0x20, 0x20, 0x20, 0x00, 0x08, 0x00, 0x14,
+    0x9a, 0xea, 0xa7, 0x0c, 0xbf, 0xd8, 0xcb, 0x56,
+    0x78, 0x1e, 0xf2, 0xb5, 0xb2, 0xd3, 0xf2, 0x49,
+    0xc1, 0xb5, 0x71, 0xa2, 0x80, 0x28, 0x00, 0x04,
+    0xe5, 0x7a, 0x3b, 0xcf
+};
+#define RFC5769_PWD     "VOkJxbRl1RmTxUk/WvJxBt"
+#define RFC5769_CTRL    48
+#define RFC5769_USER    60
+#define RFC5769_MI      76
+#define RFC5769_FP      100
+
+/* RFC 5769 Sections 2.2 and 2.3, XOR-MAPPED-ADDRESS from the responses */
+static const unsigned char rfc5769_xma4[] = {
+    0x00, 0x20, 0x00, 0x08, 0x00, 0x01, 0xa1, 0x47,
+    0xe1, 0x12, 0xa6, 0x43
+};
+static const unsigned char rfc5769_xma6[] = {
+    0x00, 0x20, 0x00, 0x14, 0x00, 0x02, 0xa1, 0x47,
+    0x01, 0x13, 0xa9, 0xfa, 0xa5, 0xd3, 0xf1, 0x79,
+    0xbc, 0x25, 0xf4, 0xb5, 0xbe, 0xd2, 0xb9, 0xd9
+};
+
+static void
+resign(const struct ila_stun_key *skp, unsigned char *msg)
+{
+
+    ila_stun_hmac(skp, msg, RFC5769_MI, msg + RFC5769_MI + 4);
+    put32(msg + RFC5769_FP + 4, ila_crc32(msg, RFC5769_FP) ^ ILA_STUN_FP_XOR);
+}
+
+static int
+check(const struct ila_stun_key *skp, const char *lu, const char *ru,
+  const unsigned char *msg)
+{
+
+    return (ila_stun_check(skp, lu, strlen(lu), ru, strlen(ru), msg,
+      sizeof(rfc5769_req)));
+}
+
+int
+ila_stun_selftest(void)
+{
+    struct ila_stun_key sk;
+    unsigned char md[SHA_DIGEST_LENGTH];
+    unsigned char msg[sizeof(rfc5769_req)];
+    unsigned char rbuf[128];
+    struct sockaddr_in sin = {.sin_family = AF_INET};
+    struct sockaddr_in6 sin6 = {.sin6_family = AF_INET6};
+    size_t rlen;
+
+    ila_stun_init();
+    ila_stun_key_init(&sk, RFC5769_PWD, strlen(RFC5769_PWD));
+
+    /* Both MESSAGE-INTEGRITY and FINGERPRINT of the vector verify */
+    ila_stun_hmac(&sk, rfc5769_req, RFC5769_MI, md);
+    errx_ifnot(memcmp(md, rfc5769_req + RFC5769_MI + 4, sizeof(md)) == 0);
+    errx_ifnot((ila_crc32(rfc5769_req, RFC5769_FP) ^ ILA_STUN_FP_XOR) ==
+      get32(rfc5769_req + RFC5769_FP + 4));
+
+    /* The request as-is carries ICE-CONTROLLED: role conflict, slow path */
+    errx_ifnot(check(&sk, "evtj", "h6vY", rfc5769_req) == -1);
+
+    /* Same request from a controlling agent is a plain consent check */
+    memcpy(msg, rfc5769_req, sizeof(msg));
+    put16(msg + RFC5769_CTRL, ILA_STUN_A_CONTROLLING);
+    resign(&sk, msg);
+    errx_ifnot(check(&sk, "evtj", "h6vY", msg) == 0);
+
+    /* Bad USERNAME: either half of it wrong, or a prefix only */
+    errx_ifnot(check(&sk, "evtJ", "h6vY", msg) == -1);
+    errx_ifnot(check(&sk, "evtj", "h6vy", msg) == -1);
+    errx_ifnot(check(&sk, "evtj", "h6v", msg) == -1);
+    errx_ifnot(check(&sk, "evt", "jh6vY", msg) == -1);
+    errx_ifnot(check(&sk, "evtj", "h6vYx", msg) == -1);
+
+    /* Bad MESSAGE-INTEGRITY: wrong key, or a flipped bit with valid CRC */
+    {
+        struct ila_stun_key bk;
+
+        ila_stun_key_init(&bk, RFC5769_PWD, strlen(RFC5769_PWD) - 1);
+        errx_ifnot(check(&bk, "evtj", "h6vY", msg) == -1);
+    }
+    msg[RFC5769_MI + 4 + 7] ^= 0x10;
+    put32(msg + RFC5769_FP + 4, ila_crc32(msg, RFC5769_FP) ^ ILA_STUN_FP_XOR);
+    errx_ifnot(check(&sk, "evtj", "h6vY", msg) == -1);
+
+    /* Bad FINGERPRINT */
+    resign(&sk, msg);
+    msg[RFC5769_FP + 4] ^= 0x01;
+    errx_ifnot(check(&sk, "evtj", "h6vY", msg) == -1);
+
+    /* Altered USERNAME not covered by a new HMAC */
+    memcpy(msg, rfc5769_req, sizeof(msg));
+    put16(msg + RFC5769_CTRL, ILA_STUN_A_CONTROLLING);
+    resign(&sk, msg);
+    msg[RFC5769_USER + 4 + 5] = 'H';
+    put32(msg + RFC5769_FP + 4, ila_crc32(msg, RFC5769_FP) ^ ILA_STUN_FP_XOR);
+    errx_ifnot(check(&sk, "evtj", "H6vY", msg) == -1);
+
+    /* Responses carry the XOR-MAPPED-ADDRESS from the RFC 5769 vectors */
+    memcpy(rbuf, rfc5769_req, sizeof(rfc5769_req));
+    sin.sin_port = htons(32853);
+    errx_ifnot(inet_pton(AF_INET, "192.0.2.1", &sin.sin_addr) == 1);
+    rlen = ila_stun_respond(&sk, rbuf, (struct sockaddr *)&sin);
+    errx_ifnot(rlen == ILA_STUN_HDR_LEN + sizeof(rfc5769_xma4) +
+      ILA_STUN_MI_LEN + ILA_STUN_FP_LEN);
+    errx_ifnot(get16(rbuf) == ILA_STUN_BINDING_RESP);
+    errx_ifnot(get16(rbuf + 2) + ILA_STUN_HDR_LEN == rlen);
+    errx_ifnot(memcmp(rbuf + 4, rfc5769_req + 4, 16) == 0);
+    errx_ifnot(memcmp(rbuf + ILA_STUN_HDR_LEN, rfc5769_xma4,
+      sizeof(rfc5769_xma4)) == 0);
+    ila_stun_hmac(&sk, rbuf, rlen - ILA_STUN_MI_LEN - ILA_STUN_FP_LEN, md);
+    errx_ifnot(memcmp(md, rbuf + rlen - ILA_STUN_FP_LEN - SHA_DIGEST_LENGTH,
+      sizeof(md)) == 0);
+    errx_ifnot((ila_crc32(rbuf, rlen - ILA_STUN_FP_LEN) ^ ILA_STUN_FP_XOR) ==
+      get32(rbuf + rlen - 4));
+
+    memcpy(rbuf, rfc5769_req, sizeof(rfc5769_req));
+    sin6.sin6_port = htons(32853);
+    errx_ifnot(inet_pton(AF_INET6, "2001:db8:1234:5678:11:2233:4455:6677",
+      &sin6.sin6_addr) == 1);
+    rlen = ila_stun_respond(&sk, rbuf, (struct sockaddr *)&sin6);
+    errx_ifnot(rlen == ILA_STUN_HDR_LEN + sizeof(rfc5769_xma6) +
+      ILA_STUN_MI_LEN + ILA_STUN_FP_LEN);
+    errx_ifnot(memcmp(rbuf + ILA_STUN_HDR_LEN, rfc5769_xma6,
+      sizeof(rfc5769_xma6)) == 0);
+    errx_ifnot((ila_crc32(rbuf, rlen - ILA_STUN_FP_LEN) ^ ILA_STUN_FP_XOR) ==
+      get32(rbuf + rlen - 4));
+
+    return (0);
+}
+#endif /* ila_stun_selftest */
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#ifndef _RTPP_ICE_LITE_STUN_H_
+#define _RTPP_ICE_LITE_STUN_H_
+
+/* RFC 8445: ice-ufrag is 4 to 256 characters */
+#define ILA_UFRAG_MAX   256
+
+/*
+ * HMAC-SHA1 state with the key already absorbed: the inner and outer
+ * hashes are run over the padded key once, and every message is then
+ * authenticated by copying those two contexts.
+ */
+struct ila_stun_key {
+    SHA_CTX ictx;
+    SHA_CTX octx;
+};
+
+void ila_stun_init(void);
+void ila_stun_key_init(struct ila_stun_key *, const char *, size_t);
+int ila_stun_check(const struct ila_stun_key *, const char *, size_t,
+  const char *, size_t, const unsigned char *, size_t);
+size_t ila_stun_respond(const struct ila_stun_key *, unsigned char *,
+  const struct sockaddr *);
+
+#endif /* _RTPP_ICE_LITE_STUN_H_ */
@@ -67,6 +67,13 @@ enum pproc_order {
 DEFINE_RAW_METHOD(pproc_taste, int, struct pkt_proc_ctx *);
 DEFINE_RAW_METHOD(pproc_enqueue, struct pproc_act, const struct pkt_proc_ctx *);
 
+/*
+ * Handler is one of the stock analyze/resize/record/relay steps, which
+ * the relay fast path in rtpp_proc.c knows how to perform inline. A
+ * chain made exclusively out of those can bypass the generic loop.
+ */
+#define PPROC_IF_FLAG_STOCK (1 << 0)
+
 struct packet_processor_if {
     const char *descr;
     struct rtpp_refcnt *rcnt;
@@ -74,4 +81,5 @@ struct packet_processor_if {
     void *key;
     pproc_taste_t taste;
     pproc_enqueue_t enqueue;
+    unsigned int flags;
 };
@@ -27,6 +27,7 @@
 
 #include <pthread.h>
 #include <assert.h>
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -41,6 +42,7 @@
 #include "rtpp_stream.h"
 #include "rtpp_pcount.h"
 #include "rtpp_stats.h"
+#include "rtpp_lhist.h"
 #include "rtpp_proc.h"
 #include "rtpp_codeptr.h"
 
@@ -113,6 +115,31 @@ pproc_handlers_alloc(int nprocs)
     return (hndlrs);
 }
 
+static int
+pproc_handlers_relay_only(const struct pproc_handlers *hndlrs)
+{
+    int has_relay = 0;
+
+    for (int i = 0; i < hndlrs->nprocs; i++) {
+        const struct pproc_handler *hp = &hndlrs->pproc[i];
+        if ((hp->ppif.flags & PPROC_IF_FLAG_STOCK) == 0 || hp->ppif.taste != NULL)
+            return (0);
+        if (hp->order == PPROC_ORD_RELAY)
+            has_relay = 1;
+    }
+    return (has_relay);
+}
+
+static void
+pproc_manager_sethandlers(struct pproc_manager_pvt *pvt, struct pproc_handlers *newh)
+{
+
+    RTPP_OBJ_DECREF(pvt->handlers);
+    pvt->handlers = newh;
+    atomic_store_explicit(&pvt->pub.relay_only, pproc_handlers_relay_only(newh),
+      memory_order_release);
+}
+
 static void
 rtpp_pproc_mgr_dtor(struct pproc_manager_pvt *pvt)
 {
@@ -139,6 +166,7 @@ pproc_manager_ctor(struct rtpp_stats *rtpp_stats, int nprocs)
     pvt->handlers = pproc_handlers_alloc(nprocs);
     if (pvt->handlers == NULL)
         goto e2;
+    atomic_init(&pvt->pub.relay_only, 0);
     RTPP_OBJ_INCREF(rtpp_stats);
     pvt->rtpp_stats = rtpp_stats;
     PUBINST_FININIT(&pvt->pub, pvt, rtpp_pproc_mgr_dtor);
@@ -183,8 +211,7 @@ rtpp_pproc_mgr_register(struct pproc_manager *pub, enum pproc_order pproc_order,
         if (ip->rcnt != NULL)
             RTPP_OBJ_INCREF(ip);
     }
-    RTPP_OBJ_DECREF(pvt->handlers);
-    pvt->handlers = newh;
+    pproc_manager_sethandlers(pvt, newh);
     pthread_mutex_unlock(&pvt->lock);
     return (0);
 }
@@ -305,8 +332,7 @@ rtpp_pproc_mgr_unregister(struct pproc_manager *pub, void *key)
             if (ip->rcnt != NULL)
                 RTPP_OBJ_INCREF(ip);
         }
-        RTPP_OBJ_DECREF(pvt->handlers);
-        pvt->handlers = newh;
+        pproc_manager_sethandlers(pvt, newh);
         pthread_mutex_unlock(&pvt->lock);
         return (0);
     }
@@ -336,6 +362,8 @@ rtpp_pproc_mgr_clone(struct pproc_manager *pub)
         if (ip->rcnt != NULL)
             RTPP_OBJ_INCREF(ip);
     }
+    atomic_store_explicit(&rval->relay_only,
+      pproc_handlers_relay_only(pvt_new->handlers), memory_order_release);
     pthread_mutex_unlock(&pvt->lock);
     return (rval);
 }
@@ -72,4 +72,9 @@ DECLARE_SMETHODS(pproc_manager)
 
 DECLARE_CLASS_PUBTYPE(pproc_manager, {
     struct pproc_manager *reverse;
+    /*
+     * Set when the chain only consists of stock handlers ending with the
+     * relay, re-evaluated every time a handler is added or removed.
+     */
+    _Atomic(int) relay_only;
 });
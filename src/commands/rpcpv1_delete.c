@@ -55,6 +55,7 @@
 #include "rtpp_codeptr.h"
 #include "rtpp_stream.h"
 #include "rtpp_weakref.h"
+#include "rtpp_repl.h"
 
 struct delete_ematch_arg {
     int ndeleted;
@@ -62,6 +63,7 @@ struct delete_ematch_arg {
     const rtpp_str_t *to_tag;
     int weak;
     struct rtpp_weakref *sessions_wrt;
+    struct rtpp_repl *repl;
 };
 
 static void rtpp_command_del_opts_free(struct delete_opts *);
@@ -93,6 +95,8 @@ rtpp_cmd_delete_ematch(void *dp, void *ap)
         spa->rtp->stream[idx]->weak = 0;
     else
         spa->strong = 0;
+    if (dep->repl != NULL)
+        CALL_METHOD(dep->repl, note, spa->seuid);
 
     /*
      * This seems to be stable from reiterations, the only side
@@ -114,6 +118,8 @@ rtpp_cmd_delete_ematch(void *dp, void *ap)
        medianum, spa->rtp->stream[0]->port, spa->rtp->stream[1]->port);
     if (CALL_SMETHOD(dep->sessions_wrt, unreg, spa->seuid) != NULL) {
         dep->ndeleted++;
+        if (dep->repl != NULL)
+            CALL_METHOD(dep->repl, note, spa->seuid);
     }
     if (cmpr != 2) {
         return (RTPP_HT_MATCH_DEL | RTPP_HT_MATCH_BRK);
@@ -133,7 +139,8 @@ handle_delete(const struct rtpp_cfg *cfsp, struct common_cmd_args *ccap)
         .from_tag = ccap->from_tag,
         .to_tag = ccap->to_tag,
         .weak = ccap->opts.delete->weak,
-        .sessions_wrt = cfsp->sessions_wrt
+        .sessions_wrt = cfsp->sessions_wrt,
+        .repl = cfsp->rtpp_repl_cf
     };
 
     CALL_SMETHOD(cfsp->sessions_ht, foreach_key_str, ccap->call_id,
@@ -152,7 +159,8 @@ handle_delete_as_subc(const struct after_success_h_args *ap,
     struct delete_ematch_arg dea = {
         .from_tag = scp->sessp->from_tag,
         .weak = dop->weak,
-        .sessions_wrt = cfsp->sessions_wrt
+        .sessions_wrt = cfsp->sessions_wrt,
+        .repl = cfsp->rtpp_repl_cf
     };
 
     CALL_SMETHOD(cfsp->sessions_ht, foreach_key_str, scp->sessp->call_id,
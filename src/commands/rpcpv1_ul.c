@@ -75,6 +75,7 @@
 #include "commands/rpcpv1_ul_subc.h"
 #include "rtpp_command_reply.h"
 #include "rtpp_command_stats.h"
+#include "rtpp_repl.h"
 
 #define FREE_IF_NULL(p)	{if ((p) != NULL) {free(p); (p) = NULL;}}
 
@@ -484,7 +485,8 @@ rtpp_command_ul_handle(const struct rtpp_cfg *cfsp, struct rtpp_command *cmd, in
             if (ulop->local_addr != NULL) {
                 spa->rtp->stream[sidx]->laddr = ulop->local_addr;
             }
-            if (rtpp_create_listener(cfsp, spa->rtp->stream[sidx]->laddr, &lport, fds) == -1) {
+            if (rtpp_create_listener(cfsp, spa->rtp->stream[sidx]->laddr,
+              spa->shard, &lport, fds) == -1) {
                 if (fd != NULL)
                     RTPP_OBJ_DECREF(fd);
                 RTPP_LOG(spa->log, RTPP_LOG_ERR, "can't create listener");
@@ -499,7 +501,7 @@ rtpp_command_ul_handle(const struct rtpp_cfg *cfsp, struct rtpp_command *cmd, in
             } else {
                 CALL_SMETHOD(cfsp->sessinfo, append, spa, sidx, fds);
             }
-            CALL_METHOD(cfsp->rtpp_proc_cf, nudge);
+            CALL_METHOD(cfsp->rtpp_proc_cf, nudge, spa->shard);
             RTPP_OBJ_DECREF(fds[0]);
             RTPP_OBJ_DECREF(fds[1]);
             spa->rtp->stream[sidx]->port = lport;
@@ -558,7 +560,8 @@ rtpp_command_ul_handle(const struct rtpp_cfg *cfsp, struct rtpp_command *cmd, in
             CALL_SMETHOD(cmd->reply, error, cfsp->overload_prot.ecode);
             goto err_undo_0;
         }
-        if (rtpp_create_listener(cfsp, ulop->lia[0], &lport, fds) == -1) {
+        if (rtpp_create_listener(cfsp, ulop->lia[0],
+          rtpp_session_shard(cfsp, cmd->cca.call_id), &lport, fds) == -1) {
             RTPP_LOG(cmd->glog, RTPP_LOG_ERR, "can't create listener");
             CALL_SMETHOD(cmd->reply, error, ECODE_LSTFAIL_2);
             goto err_undo_0;
@@ -693,6 +696,8 @@ rtpp_command_ul_handle(const struct rtpp_cfg *cfsp, struct rtpp_command *cmd, in
     }
 
     RTPP_DBG_ASSERT(lport != 0);
+    if (cfsp->rtpp_repl_cf != NULL)
+        CALL_METHOD(cfsp->rtpp_repl_cf, note, spa->seuid);
     ulop->reply.port = lport;
     ulop->reply.ia = ulop->lia[0];
     if (cfsp->advaddr[0] != NULL) {
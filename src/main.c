@@ -38,6 +38,7 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
 #include <grp.h>
@@ -103,6 +104,7 @@
 #include "rtpp_modman.h"
 #endif
 #include "rtpp_stats.h"
+#include "rtpp_tload.h"
 #include "rtpp_sessinfo.h"
 #include "rtpp_time.h"
 #include "rtpp_timed.h"
@@ -112,6 +114,11 @@
 #include "rtpp_debug.h"
 #include "rtpp_locking.h"
 #include "rtpp_nofile.h"
+#include "rtpp_wrestart.h"
+#include "rtpp_repl.h"
+#include "rtpp_cpuset.h"
+#include "rtpp_hpool.h"
+#include "rtp_packet.h"
 #include "advanced/pproc_manager.h"
 #ifdef RTPP_CHECK_LEAKS
 #include "libexecinfo/stacktraverse.h"
@@ -218,7 +225,8 @@ ehandler(void)
     }
     if (_sig_cf->ctrl_socks != NULL)
         rtpp_controlfd_cleanup(_sig_cf);
-    unlink(_sig_cf->pid_file);
+    if (_sig_cf->pid_file != NULL)
+        unlink(_sig_cf->pid_file);
     RTPP_LOG(_sig_cf->glog, RTPP_LOG_INFO, "rtpproxy ended");
 }
 
@@ -228,6 +236,12 @@ ehandler(void)
 #define LOPT_OVL_PROT 259
 #define LOPT_CONFIG   260
 #define LOPT_FORC_ASM 261
+#define LOPT_WRESTART 262
+#define LOPT_REPL_PEER 263
+#define LOPT_REPL_LSTN 264
+#define LOPT_SHARDS   265
+#define LOPT_CPUSET   266
+#define LOPT_PKTPOOL  267
 
 const static struct option longopts[] = {
     { "dso", required_argument, NULL, LOPT_DSO },
@@ -236,6 +250,12 @@ const static struct option longopts[] = {
     { "overload_prot", optional_argument, NULL, LOPT_OVL_PROT },
     { "config", required_argument, NULL, LOPT_CONFIG },
     { "force_asymmetric", no_argument, NULL, LOPT_FORC_ASM },
+    { "warm_restart", required_argument, NULL, LOPT_WRESTART },
+    { "repl_peer", required_argument, NULL, LOPT_REPL_PEER },
+    { "repl_listen", required_argument, NULL, LOPT_REPL_LSTN },
+    { "media_shards", required_argument, NULL, LOPT_SHARDS },
+    { "cpuset", required_argument, NULL, LOPT_CPUSET },
+    { "pkt_pool", required_argument, NULL, LOPT_PKTPOOL },
     { NULL,  0,                 NULL, 0 }
 };
 
@@ -260,6 +280,8 @@ init_config_bail(struct rtpp_cfg *cfsp, int rval, const char *msg, int memdeb)
     }
     free(cfsp->ctrl_socks);
     free(cfsp->runcreds);
+    if (cfsp->cpusets != NULL)
+        rtpp_cpusets_dtor(cfsp->cpusets);
 #if ENABLE_MODULE_IF
     RTPP_OBJ_DECREF(cfsp->modules_cf);
 #else
@@ -296,6 +318,7 @@ init_config(struct rtpp_cfg *cfsp, int argc, const char * const *argv)
     cfsp->port_min = PORT_MIN;
     cfsp->port_max = PORT_MAX;
     cfsp->port_ctl = 0;
+    cfsp->nshards = 1;
 
     cfsp->advaddr[0] = NULL;
     cfsp->advaddr[1] = NULL;
@@ -411,6 +434,56 @@ init_config(struct rtpp_cfg *cfsp, int argc, const char * const *argv)
             cfsp->aforce = 1;
             break;
 
+        case LOPT_WRESTART:
+            cfsp->wrestart_sock = optarg;
+            break;
+
+        case LOPT_REPL_PEER:
+            cfsp->repl_peer = optarg;
+            break;
+
+        case LOPT_REPL_LSTN:
+            cfsp->repl_listen = optarg;
+            break;
+
+        case LOPT_SHARDS:
+            switch (atoi_saferange(optarg, &cfsp->nshards, 1, RTPP_MAX_SHARDS)) {
+            case ATOI_OK:
+                break;
+            case ATOI_OUTRANGE:
+                errx(1, "%s: number of media shards is out of range 1..%d",
+                  optarg, RTPP_MAX_SHARDS);
+            default:
+                errx(1, "%s: number of media shards is invalid", optarg);
+            }
+            break;
+
+        case LOPT_CPUSET:
+#if !HAVE_PTHREAD_SETAFFINITY_NP
+            errx(1, "--cpuset is not supported on this platform");
+#endif
+            if (cfsp->cpusets == NULL) {
+                cfsp->cpusets = rtpp_cpusets_ctor();
+                if (cfsp->cpusets == NULL)
+                    err(1, "can't allocate memory for the CPU sets");
+            }
+            if (rtpp_cpusets_parse(cfsp->cpusets, optarg, &errmsg) != 0)
+                errx(1, "%s: %s", optarg, errmsg);
+            break;
+
+        case LOPT_PKTPOOL:
+            switch (atoi_saferange(optarg, &cfsp->pkt_pool_len, 1,
+              RTPP_PKT_POOL_MAX)) {
+            case ATOI_OK:
+                break;
+            case ATOI_OUTRANGE:
+                errx(1, "%s: packet pool size is out of range 1..%d",
+                  optarg, RTPP_PKT_POOL_MAX);
+            default:
+                errx(1, "%s: packet pool size is invalid", optarg);
+            }
+            break;
+
         case 'c':
             if (strcmp(optarg, "fifo") == 0) {
                  cfsp->sched_policy = SCHED_FIFO;
@@ -708,6 +781,9 @@ init_config(struct rtpp_cfg *cfsp, int argc, const char * const *argv)
     if (cfsp->rdir == NULL && cfsp->sdir != NULL)
 	errx(1, "-S switch requires -r switch");
 
+    if (cfsp->repl_peer != NULL && cfsp->repl_listen != NULL)
+        errx(1, "--repl_peer and --repl_listen are mutually exclusive");
+
     if (cfsp->ropts.no_daemon == 0 && stdio_mode != 0)
         errx(1, "stdio command mode requires -f switch");
 
@@ -741,6 +817,10 @@ init_config(struct rtpp_cfg *cfsp, int argc, const char * const *argv)
     if (cfsp->port_min > cfsp->port_max)
 	errx(1, "port_min should be less than port_max");
 
+    if (((cfsp->port_max - cfsp->port_min) / 2) + 1 < 2 * cfsp->nshards)
+	errx(1, "port range is too small to be split between %d media shards",
+	  cfsp->nshards);
+
     if (bh[0] == NULL && bh[1] == NULL && bh6[0] == NULL && bh6[1] == NULL) {
 	bh[0] = "*";
     }
@@ -805,6 +885,44 @@ update_derived_stats(double dtime, void *argp)
     return (CB_MORE);
 }
 
+struct pkt_pool_part_arg {
+    struct rtpp_hpool *pool;
+    int part;
+};
+
+static void
+pkt_pool_part_init(void *argp)
+{
+    const struct pkt_pool_part_arg *ap;
+
+    ap = (const struct pkt_pool_part_arg *)argp;
+    rtpp_hpool_part_init(ap->pool, ap->part);
+}
+
+static struct pkt_pool_stats {
+    struct rtpp_hpool *pool;
+    struct rtpp_stats *rtpp_stats;
+    struct rtpp_hpool_stats last;
+} pkt_pool_stats;
+
+static enum rtpp_timed_cb_rvals
+update_pkt_pool_stats(double dtime, void *argp)
+{
+    struct pkt_pool_stats *ppsp;
+    struct rtpp_hpool_stats hps;
+
+    ppsp = (struct pkt_pool_stats *)argp;
+    rtpp_hpool_getstats(ppsp->pool, &hps);
+    CALL_SMETHOD(ppsp->rtpp_stats, updatebyname, "npkts_pool_alloc",
+      hps.nalloc - ppsp->last.nalloc);
+    CALL_SMETHOD(ppsp->rtpp_stats, updatebyname, "npkts_pool_miss",
+      hps.nmiss - ppsp->last.nmiss);
+    CALL_SMETHOD(ppsp->rtpp_stats, updatebyname_d, "pkt_pool_util",
+      (double)(hps.ninuse - ppsp->last.ninuse) / hps.nslots);
+    ppsp->last = hps;
+    return (CB_MORE);
+}
+
 #if !defined(LIBRTPPROXY)
 static void
 #else
@@ -814,7 +932,12 @@ rtpp_shutdown(struct rtpp_cfg *cfsp)
 {
     struct rtpp_ctrl_sock *ctrl_sock, *ctrl_sock_next;
 
-    CALL_METHOD(cfsp->rtpp_cmd_cf, dtor);
+    /* Might have been stopped already by the warm restart */
+    if (cfsp->rtpp_cmd_cf != NULL)
+        CALL_METHOD(cfsp->rtpp_cmd_cf, dtor);
+    /* Stop talking to the standby, the sessions are not gone for it */
+    if (cfsp->rtpp_repl_cf != NULL)
+        CALL_METHOD(cfsp->rtpp_repl_cf, shutdown);
     CALL_SMETHOD(cfsp->sessions_wrt, purge);
     CALL_SMETHOD(cfsp->sessions_ht, purge);
 
@@ -830,6 +953,8 @@ rtpp_shutdown(struct rtpp_cfg *cfsp)
 #endif
     RTPP_OBJ_DECREF(cfsp->pproc_manager);
     free(cfsp->runcreds);
+    if (cfsp->cpusets != NULL)
+        rtpp_cpusets_dtor(cfsp->cpusets);
     RTPP_OBJ_DECREF(cfsp->rtpp_notify_cf);
     CALL_METHOD(cfsp->bindaddrs_cf, dtor);
     free(cfsp->locks);
@@ -839,10 +964,26 @@ rtpp_shutdown(struct rtpp_cfg *cfsp)
     CALL_METHOD(cfsp->rtpp_proc_ttl_cf, dtor);
     RTPP_OBJ_DECREF(cfsp->proc_servers);
     CALL_METHOD(cfsp->rtpp_proc_cf, dtor);
+    /* Media and TTL threads may report changes up to this point */
+    if (cfsp->rtpp_repl_cf != NULL)
+        CALL_METHOD(cfsp->rtpp_repl_cf, dtor);
     RTPP_OBJ_DECREF(cfsp->sessinfo);
     RTPP_OBJ_DECREF(cfsp->rtpp_stats);
-    for (int i = 0; i <= RTPP_PT_MAX; i++) {
-        RTPP_OBJ_DECREF(cfsp->port_table[i]);
+    RTPP_OBJ_DECREF(cfsp->rtpp_tload);
+    for (int j = 0; j < cfsp->nshards; j++) {
+        for (int i = 0; i <= RTPP_PT_MAX; i++) {
+            RTPP_OBJ_DECREF(cfsp->port_table[j][i]);
+        }
+    }
+    free(cfsp->port_table);
+    if (cfsp->pkt_pool != NULL) {
+        /*
+         * Packets still in flight hold on to the pool, the last one to be
+         * released unmaps it.
+         */
+        rtp_packet_setpool(NULL);
+        rtpp_hpool_dtor(cfsp->pkt_pool);
+        cfsp->pkt_pool = NULL;
     }
     RTPP_OBJ_DECREF(cfsp->sessions_wrt);
     RTPP_OBJ_DECREF(cfsp->sessions_ht);
@@ -868,7 +1009,7 @@ struct rtpp_cfg *
 rtpp_main(int argc, const char * const *argv)
 #endif
 {
-    int i, len, pid_fd;
+    int i, len, pid_fd, wr_fd, wr_lfd;
     static struct rtpp_cfg cfs;
     char buf[256];
     struct sched_param sparam;
@@ -969,12 +1110,38 @@ rtpp_main(int argc, const char * const *argv)
          /* NOTREACHED */
     }
 
-    for (i = 0; i <= RTPP_PT_MAX; i++) {
-        cfs.port_table[i] = rtpp_port_table_ctor(cfs.port_min,
-          cfs.port_max, cfs.seq_ports, cfs.port_ctl);
-        if (cfs.port_table[i] == NULL) {
-            err(1, "can't allocate memory for the ports data");
-            /* NOTREACHED */
+    cfs.rtpp_tload = rtpp_tload_ctor();
+    if (cfs.rtpp_tload == NULL) {
+        err(1, "can't allocate memory for the thread load data");
+         /* NOTREACHED */
+    }
+
+    cfs.port_table = rtpp_zmalloc(sizeof(cfs.port_table[0]) * cfs.nshards);
+    if (cfs.port_table == NULL) {
+        err(1, "can't allocate memory for the ports data");
+        /* NOTREACHED */
+    }
+    /* Each shard allocates ports from its own contiguous slice */
+    int npairs = ((cfs.port_max - cfs.port_min) / 2) + 1;
+    for (int j = 0; j < cfs.nshards; j++) {
+        int pmin = cfs.port_min + 2 * ((npairs * j) / cfs.nshards);
+        int pmax = cfs.port_min + 2 * ((npairs * (j + 1)) / cfs.nshards - 1);
+        for (i = 0; i <= RTPP_PT_MAX; i++) {
+            cfs.port_table[j][i] = rtpp_port_table_ctor(pmin, pmax,
+              cfs.seq_ports, cfs.port_ctl);
+            if (cfs.port_table[j][i] == NULL) {
+                err(1, "can't allocate memory for the ports data");
+                /* NOTREACHED */
+            }
+        }
+    }
+
+    wr_fd = wr_lfd = -1;
+    if (cfs.wrestart_sock != NULL) {
+        wr_fd = rtpp_wrestart_attach(&cfs);
+        if (wr_fd < 0 && errno != ENOENT && errno != ECONNREFUSED) {
+            err(1, "%s: can't take over from the running instance",
+              cfs.wrestart_sock);
         }
     }
 
@@ -1046,6 +1213,35 @@ rtpp_main(int argc, const char * const *argv)
         exit(1);
     }
 
+    if (cfs.pkt_pool_len > 0) {
+        static const char *backing_names[] = {
+            [RTPP_HPOOL_HUGETLB] = "hugetlb pages",
+            [RTPP_HPOOL_THP] = "transparent huge pages",
+            [RTPP_HPOOL_PLAIN] = "regular pages"
+        };
+
+        cfs.pkt_pool = rtpp_hpool_ctor(rtp_packet_slotsize(), cfs.pkt_pool_len,
+          cfs.nshards);
+        if (cfs.pkt_pool == NULL) {
+            RTPP_ELOG(cfs.glog, RTPP_LOG_ERR,
+              "can't allocate packet pool of %d slots", cfs.pkt_pool_len);
+            exit(1);
+        }
+        /* Each partition is faulted in on the CPUs of its shard */
+        for (int j = 0; j < cfs.nshards; j++) {
+            struct pkt_pool_part_arg ppa = {.pool = cfs.pkt_pool, .part = j};
+
+            if (rtpp_cpusets_run_on(cfs.cpusets, RTPP_TCLASS_PROC, j,
+              pkt_pool_part_init, &ppa) != 0)
+                RTPP_ELOG(cfs.glog, RTPP_LOG_ERR, "can't place packet pool "
+                  "partition %d", j);
+        }
+        RTPP_LOG(cfs.glog, RTPP_LOG_INFO,
+          "packet pool of %d slots is backed by %s", cfs.pkt_pool_len,
+          backing_names[rtpp_hpool_backing(cfs.pkt_pool)]);
+        rtp_packet_setpool(cfs.pkt_pool);
+    }
+
     cfs.rtpp_proc_cf = rtpp_proc_async_ctor(&cfs);
     if (cfs.rtpp_proc_cf == NULL) {
         RTPP_LOG(cfs.glog, RTPP_LOG_ERR,
@@ -1060,7 +1256,7 @@ rtpp_main(int argc, const char * const *argv)
         exit(1);
     }
 
-    cfs.rtpp_timed_cf = rtpp_timed_ctor(0.01);
+    cfs.rtpp_timed_cf = rtpp_timed_ctor(0.01, cfs.rtpp_tload, cfs.cpusets);
     if (cfs.rtpp_timed_cf == NULL) {
         RTPP_ELOG(cfs.glog, RTPP_LOG_ERR,
           "can't init scheduling subsystem");
@@ -1077,13 +1273,35 @@ rtpp_main(int argc, const char * const *argv)
     }
     RTPP_OBJ_DECREF(tp);
 
-    cfs.rtpp_notify_cf = rtpp_notify_ctor(cfs.glog);
+    if (cfs.pkt_pool != NULL) {
+        pkt_pool_stats.pool = cfs.pkt_pool;
+        pkt_pool_stats.rtpp_stats = cfs.rtpp_stats;
+        tp = CALL_SMETHOD(cfs.rtpp_timed_cf, schedule_rc, 1.0,
+          cfs.rtpp_stats->rcnt, update_pkt_pool_stats, NULL, &pkt_pool_stats);
+        if (tp == NULL) {
+            RTPP_ELOG(cfs.glog, RTPP_LOG_ERR,
+              "can't schedule packet pool stats update");
+            exit(1);
+        }
+        RTPP_OBJ_DECREF(tp);
+    }
+
+    cfs.rtpp_notify_cf = rtpp_notify_ctor(cfs.glog, cfs.rtpp_tload);
     if (cfs.rtpp_notify_cf == NULL) {
         RTPP_ELOG(cfs.glog, RTPP_LOG_ERR,
           "can't init timeout notification subsystem");
         exit(1);
     }
 
+    if (cfs.repl_peer != NULL || cfs.repl_listen != NULL) {
+        cfs.rtpp_repl_cf = rtpp_repl_ctor(&cfs);
+        if (cfs.rtpp_repl_cf == NULL) {
+            RTPP_LOG(cfs.glog, RTPP_LOG_ERR,
+              "can't init session replication subsystem");
+            exit(1);
+        }
+    }
+
     cfs.rtpp_proc_ttl_cf = rtpp_proc_ttl_ctor(&cfs);
     if (cfs.rtpp_proc_ttl_cf == NULL) {
         RTPP_LOG(cfs.glog, RTPP_LOG_ERR,
@@ -1100,6 +1318,12 @@ rtpp_main(int argc, const char * const *argv)
     }
 #endif
 
+    if (wr_fd >= 0 && rtpp_wrestart_restore(&cfs, wr_fd) < 0) {
+        RTPP_ELOG(cfs.glog, RTPP_LOG_ERR,
+          "can't take over sessions from the running instance");
+        exit(1);
+    }
+
     cfs.rtpp_cmd_cf = rtpp_command_async_ctor(&cfs);
     if (cfs.rtpp_cmd_cf == NULL) {
         RTPP_ELOG(cfs.glog, RTPP_LOG_ERR,
@@ -1107,6 +1331,15 @@ rtpp_main(int argc, const char * const *argv)
         exit(1);
     }
 
+    if (cfs.wrestart_sock != NULL) {
+        wr_lfd = rtpp_wrestart_listen(&cfs);
+        if (wr_lfd < 0) {
+            RTPP_ELOG(cfs.glog, RTPP_LOG_ERR,
+              "%s: can't create warm restart socket", cfs.wrestart_sock);
+            exit(1);
+        }
+    }
+
     if (cfs.ropts.no_sigtrap == 0) {
         signal(SIGHUP, sighup);
         signal(SIGINT, fatsignal);
@@ -1180,6 +1413,11 @@ rtpp_main(int argc, const char * const *argv)
               "deorbiting-burn sequence completed, exiting");
             break;
         }
+        if (wr_lfd >= 0 && rtpp_wrestart_serve(&cfs, wr_lfd) != 0) {
+            close(wr_lfd);
+            wr_lfd = -1;
+            continue;
+        }
         prdic_procrastinate(elp);
     }
     prdic_free(elp);
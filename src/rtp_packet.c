@@ -41,6 +41,7 @@
 #include "rtpp_packetops.h"
 #include "rtpp_mallocs.h"
 #include "rtpp_refcnt.h"
+#include "rtpp_hpool.h"
 
 #include "rtpp_wi.h"
 #include "rtpp_wi_private.h"
@@ -52,6 +53,7 @@ struct rtp_packet_full;
 struct rtp_packet_priv {
     struct rtp_info rinfo;
     struct rtpp_wi_pvt wip;
+    struct rtpp_hpool *pool;
 };
 
 struct rtp_packet_full {
@@ -86,16 +88,63 @@ rtp_packet_dup(struct rtp_packet *dpkt, const struct rtp_packet *spkt, int flags
     }
 }
 
+/*
+ * Optional pre-allocated (possibly huge page backed) pool to carve packets
+ * from, set once at startup before any media threads are running. Media
+ * threads allocate from the pool partition of their shard, everyone else
+ * from the first one.
+ */
+static struct rtpp_hpool *rtp_packet_pool;
+static __thread int rtp_packet_shard;
+
+size_t
+rtp_packet_slotsize(void)
+{
+
+    return (rtpp_rsize(sizeof(struct rtp_packet_full)));
+}
+
+void
+rtp_packet_setpool(struct rtpp_hpool *hp)
+{
+
+    rtp_packet_pool = hp;
+}
+
+void
+rtp_packet_setshard(int shard)
+{
+
+    rtp_packet_shard = shard;
+}
+
+static void
+rtp_packet_pool_free(void *p)
+{
+    struct rtp_packet_full *pkt;
+
+    pkt = (struct rtp_packet_full *)p;
+    rtpp_hpool_put(pkt->pvt.pool, pkt);
+}
+
 struct rtp_packet *
 rtp_packet_alloc()
 {
     struct rtp_packet_full *pkt;
-
-    pkt = rtpp_rzmalloc(sizeof(*pkt), PVT_RCOFFS(pkt));
-    if (pkt == NULL) {
-        return (NULL);
+    void *slot;
+
+    if (rtp_packet_pool != NULL &&
+      (slot = rtpp_hpool_get(rtp_packet_pool, rtp_packet_shard)) != NULL) {
+        pkt = rtpp_rzinit(slot, sizeof(*pkt), PVT_RCOFFS(pkt));
+        pkt->pvt.pool = rtp_packet_pool;
+        CALL_SMETHOD(pkt->pub.rcnt, attach, rtp_packet_pool_free, pkt);
+    } else {
+        pkt = rtpp_rzmalloc(sizeof(*pkt), PVT_RCOFFS(pkt));
+        if (pkt == NULL) {
+            return (NULL);
+        }
+        CALL_SMETHOD(pkt->pub.rcnt, use_stdfree, pkt);
     }
-    CALL_SMETHOD(pkt->pub.rcnt, use_stdfree, pkt);
     pkt->pub.wi = &(pkt->pvt.wip.pub);
 
     return &(pkt->pub);
@@ -34,6 +34,7 @@ struct rtpp_wi;
 struct rtpp_refcnt;
 struct sthread_args;
 struct packet_processor_if;
+struct rtpp_hpool;
 
 #define MAX_RPKT_LEN 8192
 
@@ -75,6 +76,9 @@ struct rtp_packet {
 #define RTP_PKT_COPYOFF(x) (offsetof(typeof(*x), parse_result))
 
 struct rtp_packet *rtp_packet_alloc() RTPP_EXPORT;
+size_t rtp_packet_slotsize(void);
+void rtp_packet_setpool(struct rtpp_hpool *);
+void rtp_packet_setshard(int);
 void rtp_packet_set_seq(struct rtp_packet *, uint16_t seq);
 void rtp_packet_set_ts(struct rtp_packet *, uint32_t ts);
 
@@ -37,6 +37,7 @@
 #include "rtpp_time.h"
 #include "rtp_packet.h"
 #include "rtp_resizer.h"
+#include "rtpp_lhist.h"
 #include "rtpp_proc.h"
 #include "rtpp_stats.h"
 #include "rtpp_mallocs.h"
@@ -44,6 +45,16 @@
 #include "rtpp_codeptr.h"
 #include "rtpp_refcnt.h"
 
+/*
+ * Output packets are plain contiguous rtp_packets. The container is a
+ * queued input packet whenever one can be reused (aggregation, or a split
+ * that ends on a packet boundary), otherwise a fresh packet that gets the
+ * header and a chunk of payload copied in. Everything downstream of the
+ * resizer (recording, SRTP, modules, the async sender) works on
+ * pkt->data.buf, so no header + iovec form is produced: each output packet
+ * would still need an object of its own, and the payload copies it would
+ * save are a few hundred bytes per packet.
+ */
 struct rtp_resizer {
     int         nsamples_total;
 
@@ -61,12 +72,19 @@ struct rtp_resizer {
     int         output_nsamples;
     int         max_buf_nsamples;
 
+    /* Set while the stream is on the worker's egress timer */
+    int         armed;
+
     struct {
         struct rtp_packet *first;
         struct rtp_packet *last;
+        /* Bytes consumed from the payload of the first packet */
+        int     first_trimmed;
     } queue;
 };
 
+static void pack_queue_head(struct rtp_resizer *);
+
 static int
 min_nsamples(int codec_id)
 {
@@ -195,6 +213,7 @@ rtp_resizer_enqueue(struct rtp_resizer *this, struct rtp_packet **pkt,
 
         if (p == NULL) /* head reached */
         {
+            pack_queue_head(this);
             (*pkt)->next = this->queue.first;
             (*pkt)->prev = NULL;
             this->queue.first->prev = *pkt;
@@ -222,10 +241,34 @@ rtp_resizer_enqueue(struct rtp_resizer *this, struct rtp_packet **pkt,
     *pkt = NULL; /* take control over the packet */
 }
 
+/*
+ * Chunks are consumed from the first packet in the queue by advancing its
+ * payload offset, which leaves a gap between the RTP header and the rest
+ * of the payload. Close the gap when the packet is about to be sent as is
+ * or stops being the first one.
+ */
+static void
+pack_queue_head(struct rtp_resizer *this)
+{
+    struct rtp_packet *p;
+    int hdr_size;
+
+    p = this->queue.first;
+    if (p == NULL || this->queue.first_trimmed == 0)
+        return;
+    hdr_size = p->parsed->data_offset - this->queue.first_trimmed;
+    memmove(&p->data.buf[hdr_size], &p->data.buf[p->parsed->data_offset],
+      p->size - p->parsed->data_offset);
+    p->parsed->data_offset = hdr_size;
+    p->size -= this->queue.first_trimmed;
+    this->queue.first_trimmed = 0;
+}
+
 static void
 detach_queue_head(struct rtp_resizer *this)
 {
 
+    this->queue.first_trimmed = 0;
     this->queue.first = this->queue.first->next;
     if (this->queue.first == NULL)
 	this->queue.last = NULL;
@@ -245,8 +288,23 @@ append_packet(struct rtp_packet *dst, struct rtp_packet *src)
     dst->parsed->appendable = src->parsed->appendable;
 }
 
+/* Truncate the first packet in the queue, see pack_queue_head() */
+static void
+trim_queue_head(struct rtp_resizer *this, const struct rtp_packet_chunk *chunk)
+{
+    struct rtp_packet *src;
+
+    src = this->queue.first;
+    src->parsed->nsamples -= chunk->nsamples;
+    rtp_packet_set_ts(src, src->parsed->ts + chunk->nsamples);
+    src->parsed->data_offset += chunk->bytes;
+    src->parsed->data_size -= chunk->bytes;
+    this->queue.first_trimmed += chunk->bytes;
+}
+
 static void 
-append_chunk(struct rtp_packet *dst, struct rtp_packet *src, const struct rtp_packet_chunk *chunk)
+append_chunk(struct rtp_resizer *this, struct rtp_packet *dst, struct rtp_packet *src,
+  const struct rtp_packet_chunk *chunk)
 {
 
     /* Copy chunk */
@@ -256,32 +314,56 @@ append_chunk(struct rtp_packet *dst, struct rtp_packet *src, const struct rtp_pa
     dst->parsed->data_size += chunk->bytes;
     dst->size += chunk->bytes;
 
-    /* Truncate the source packet */
-    src->parsed->nsamples -= chunk->nsamples;
-    rtp_packet_set_ts(src, src->parsed->ts + chunk->nsamples);
-    src->parsed->data_size -= chunk->bytes;
-    src->size -= chunk->bytes;
-    memmove(&src->data.buf[src->parsed->data_offset],
-      &src->data.buf[src->parsed->data_offset + chunk->bytes], src->parsed->data_size);
+    trim_queue_head(this, chunk);
 }
 
 static void 
-move_chunk(struct rtp_packet *dst, struct rtp_packet *src, const struct rtp_packet_chunk *chunk)
+move_chunk(struct rtp_resizer *this, struct rtp_packet *dst, struct rtp_packet *src,
+  const struct rtp_packet_chunk *chunk)
 {
-    /* Copy chunk */
+    /* Copy chunk, the header has been copied from the trimmed packet */
+    dst->parsed->data_offset -= this->queue.first_trimmed;
     memcpy(&dst->data.buf[dst->parsed->data_offset],
       &src->data.buf[src->parsed->data_offset], chunk->bytes);
     dst->parsed->nsamples = chunk->nsamples;
     dst->parsed->data_size = chunk->bytes;
     dst->size = dst->parsed->data_size + dst->parsed->data_offset;
 
-    /* Truncate the source packet */
-    src->parsed->nsamples -= chunk->nsamples;
-    rtp_packet_set_ts(src, src->parsed->ts + chunk->nsamples);
-    src->parsed->data_size -= chunk->bytes;
-    src->size -= chunk->bytes;
-    memmove(&src->data.buf[src->parsed->data_offset],
-      &src->data.buf[src->parsed->data_offset + chunk->bytes], src->parsed->data_size);
+    trim_queue_head(this, chunk);
+}
+
+/*
+ * Return time at which rtp_resizer_get() is going to produce the next
+ * packet even if no more input arrives, or a negative value if the queue
+ * is empty. If the output is ready to be sent right away returned value
+ * is dtime.
+ */
+double
+rtp_resizer_deadline(struct rtp_resizer *this, double dtime)
+{
+    uint32_t ref_ts;
+    int32_t nsamples_left;
+
+    if (this->queue.first == NULL)
+        return (-1.0);
+    if (this->nsamples_total >= this->output_nsamples)
+        return (dtime);
+    ref_ts = (dtime * 8000.0) + this->tsdelta;
+    nsamples_left = (int32_t)(this->queue.first->parsed->ts +
+      this->max_buf_nsamples - ref_ts);
+    if (nsamples_left <= 0)
+        return (dtime);
+    return (dtime + (double)nsamples_left / 8000.0);
+}
+
+int
+rtp_resizer_arm(struct rtp_resizer *this, int armed)
+{
+    int oarmed;
+
+    oarmed = this->armed;
+    this->armed = armed;
+    return (oarmed);
 }
 
 struct rtp_packet *
@@ -327,6 +409,7 @@ rtp_resizer_get(struct rtp_resizer *this, double dtime)
             if (p->parsed->nsamples > output_nsamples) {
 		rtp_packet_first_chunk_find(p, &chunk, output_nsamples);
 		if (chunk.whole_packet_matched) {
+		    pack_queue_head(this);
 		    ret = p;
 		    detach_queue_head(this);
 		} else {
@@ -336,7 +419,7 @@ rtp_resizer_get(struct rtp_resizer *this, double dtime)
 		    rtp_packet_dup(ret, p, RTPP_DUP_HDRONLY);
                     /* Reset MBT if it happens to be set */
                     p->data.header.mbt = 0;
-		    move_chunk(ret, p, &chunk);
+		    move_chunk(this, ret, p, &chunk);
 		    ++split;
 		}
 		if (!this->seq_initialized) {
@@ -374,7 +457,7 @@ rtp_resizer_get(struct rtp_resizer *this, double dtime)
 		    if ((ret->size + chunk.bytes) > sizeof(ret->data.buf))
 			break;
 		    /* Append chunk to output */
-		    append_chunk(ret, p, &chunk);
+		    append_chunk(this, ret, p, &chunk);
 		    ++split;
 		}
 		++count;
@@ -389,13 +472,12 @@ rtp_resizer_get(struct rtp_resizer *this, double dtime)
         if (ret != NULL && (ret->size + p->parsed->data_size) > sizeof(ret->data.buf))
             break;
 
-        /* Detach head packet from the queue */
-	detach_queue_head(this);
-
         /*
          * Add the packet to the output
          */
         if (ret == NULL) {
+            pack_queue_head(this);
+            detach_queue_head(this);
             ret = p; /* use the first packet as the result container */
             if (!this->seq_initialized) {
                 this->seq = p->parsed->seq;
@@ -403,6 +485,7 @@ rtp_resizer_get(struct rtp_resizer *this, double dtime)
             }
         }
         else {
+            detach_queue_head(this);
 	    append_packet(ret, p);
             RTPP_OBJ_DECREF(p);
         }
@@ -422,3 +505,157 @@ rtp_resizer_get(struct rtp_resizer *this, double dtime)
     }
     return ret;
 }
+
+#if defined(rtp_resizer_selftest)
+#include <arpa/inet.h>
+#include <assert.h>
+#include <stdio.h>
+#include "rtpp_memdeb_internal.h"
+#include "libexecinfo/stacktraverse.h"
+#include "libexecinfo/execinfo.h"
+
+#include "config_pp.h"
+
+#if !defined(NO_ERR_H)
+#include <err.h>
+#include "rtpp_util.h"
+#else
+#include "rtpp_util.h"
+#endif
+
+#define errx_ifnot(expr) \
+    if (!(expr)) \
+        errx(1, "`%s` check has failed in %s() at %s:%d", #expr, __func__, \
+          __FILE__, __LINE__);
+
+RTPP_MEMDEB_APP_STATIC;
+
+/* Multiple of every ptime tested, so that no partial packet is left over */
+#define RSZT_NSAMPLES  (8 * 480)
+#define RSZT_TS0       0xfffff000  /* let TS wrap around half way */
+#define RSZT_SEQ0      0xfff0
+
+struct rszt_state {
+    int out_ns;
+    int seq_inited;
+    uint16_t seq;
+    uint32_t ts;
+    int nsamples;
+    int npkts;
+};
+
+static struct rtp_packet *
+rszt_mkpkt(int idx, int in_ns)
+{
+    struct rtp_packet *pkt;
+    rtp_hdr_t *rhp;
+    int i, soff;
+
+    pkt = rtp_packet_alloc();
+    errx_ifnot(pkt != NULL);
+    rhp = &pkt->data.header;
+    memset(rhp, '\0', sizeof(*rhp));
+    rhp->version = 2;
+    rhp->pt = RTP_PCMU;
+    rhp->seq = htons(RSZT_SEQ0 + idx);
+    rhp->ts = htonl(RSZT_TS0 + idx * in_ns);
+    rhp->ssrc = htonl(0x12345678);
+    /* One byte per sample, the value tells where it has to end up */
+    soff = idx * in_ns;
+    for (i = 0; i < in_ns; i++)
+        pkt->data.buf[sizeof(*rhp) + i] = (soff + i) % 251;
+    pkt->size = sizeof(*rhp) + in_ns;
+    pkt->rtime.mono = 1000.0 + (double)soff / 8000.0;
+    return (pkt);
+}
+
+static void
+rszt_check(struct rszt_state *sp, struct rtp_packet *pkt)
+{
+    const rtp_hdr_t *rhp;
+    int i;
+
+    rhp = &pkt->data.header;
+    /* Payload has to follow the header, no gap left behind by the split */
+    errx_ifnot(pkt->parsed->data_offset == sizeof(*rhp));
+    errx_ifnot(pkt->size == sizeof(*rhp) + pkt->parsed->data_size);
+    errx_ifnot(pkt->parsed->nsamples == sp->out_ns);
+    errx_ifnot(pkt->parsed->data_size == sp->out_ns);
+    errx_ifnot(rhp->pt == RTP_PCMU);
+    errx_ifnot(ntohl(rhp->ssrc) == 0x12345678);
+    errx_ifnot(ntohl(rhp->ts) == pkt->parsed->ts);
+    errx_ifnot(pkt->parsed->ts == (uint32_t)(RSZT_TS0 + sp->nsamples));
+    if (sp->seq_inited)
+        errx_ifnot(ntohs(rhp->seq) == (uint16_t)(sp->seq + 1));
+    sp->seq = ntohs(rhp->seq);
+    sp->seq_inited = 1;
+    for (i = 0; i < pkt->parsed->data_size; i++) {
+        errx_ifnot(pkt->data.buf[pkt->parsed->data_offset + i] ==
+          (sp->nsamples + i) % 251);
+    }
+    sp->nsamples += pkt->parsed->nsamples;
+    sp->npkts += 1;
+}
+
+static void
+rszt_run(int in_ptime, int out_ptime)
+{
+    struct rtp_resizer *rp;
+    struct rtp_packet *pkt;
+    struct rtpp_proc_rstats rs;
+    struct rszt_state st;
+    double dtime;
+    int i, in_ns;
+
+    memset(&rs, '\0', sizeof(rs));
+    memset(&st, '\0', sizeof(st));
+    in_ns = in_ptime * 8;
+    st.out_ns = out_ptime * 8;
+    rp = rtp_resizer_new(out_ptime);
+    errx_ifnot(rp != NULL);
+    errx_ifnot(rtp_resizer_get_ptime(rp) == out_ptime);
+    dtime = 0;
+    for (i = 0; i * in_ns < RSZT_NSAMPLES; i++) {
+        pkt = rszt_mkpkt(i, in_ns);
+        dtime = pkt->rtime.mono;
+        rtp_resizer_enqueue(rp, &pkt, &rs);
+        errx_ifnot(pkt == NULL);
+        while ((pkt = rtp_resizer_get(rp, dtime)) != NULL) {
+            rszt_check(&st, pkt);
+            RTPP_OBJ_DECREF(pkt);
+        }
+    }
+    /* Whatever is left is flushed once it has waited long enough */
+    dtime += 1.0;
+    errx_ifnot(rtp_resizer_deadline(rp, dtime) == (st.nsamples ==
+      RSZT_NSAMPLES ? -1.0 : dtime));
+    while ((pkt = rtp_resizer_get(rp, dtime)) != NULL) {
+        rszt_check(&st, pkt);
+        RTPP_OBJ_DECREF(pkt);
+    }
+    errx_ifnot(st.nsamples == RSZT_NSAMPLES);
+    errx_ifnot(st.npkts == RSZT_NSAMPLES / st.out_ns);
+    errx_ifnot(rs.npkts_resizer_discard.cnt == 0);
+    errx_ifnot(rtp_resizer_deadline(rp, dtime) < 0);
+    rtp_resizer_free(NULL, rp);
+}
+
+int
+rtp_resizer_selftest(void)
+{
+    static const int ptimes[] = {10, 20, 30, 60};
+    int i, j, rval;
+
+    RTPP_MEMDEB_APP_INIT();
+
+    for (i = 0; i < sizeof(ptimes) / sizeof(ptimes[0]); i++) {
+        for (j = 0; j < sizeof(ptimes) / sizeof(ptimes[0]); j++) {
+            if (i != j)
+                rszt_run(ptimes[i], ptimes[j]);
+        }
+    }
+
+    rval = rtpp_memdeb_dumpstats(MEMDEB_SYM, 0);
+    return (rval);
+}
+#endif /* rtp_resizer_selftest */
@@ -36,6 +36,8 @@ struct rtp_packet;
 void rtp_resizer_enqueue(struct rtp_resizer *, struct rtp_packet **,
   struct rtpp_proc_rstats *);
 struct rtp_packet *rtp_resizer_get(struct rtp_resizer *, double);
+double rtp_resizer_deadline(struct rtp_resizer *, double);
+int rtp_resizer_arm(struct rtp_resizer *, int);
 
 struct rtp_resizer *rtp_resizer_new(int);
 void rtp_resizer_free(struct rtpp_stats *, struct rtp_resizer *);
@@ -52,6 +52,7 @@ struct rtpp_analyzer_priv {
     uint32_t aecount;
     struct rtpp_log *log;
 };
+const size_t rtpp_analyzer_osize = sizeof(struct rtpp_analyzer_priv);
 
 static enum update_rtpp_stats_rval rtpp_analyzer_update(struct rtpp_analyzer *,
   struct rtp_packet *);
@@ -91,6 +92,35 @@ e0:
     return (NULL);
 }
 
+struct rtpp_analyzer *
+rtpp_analyzer_ctor_pa(void *pap, struct rtpp_refcnt *rcnt, struct rtpp_log *log)
+{
+    struct rtpp_analyzer_priv *pvt;
+
+    pvt = (struct rtpp_analyzer_priv *)pap;
+    if (rtpp_stats_init(&pvt->rstat) != 0) {
+        return (NULL);
+    }
+    pvt->log = log;
+    RTPP_OBJ_INCREF(log);
+    pvt->pub.rcnt = rcnt;
+#if defined(RTPP_DEBUG)
+    pvt->pub.smethods = GET_SMETHODS(&pvt->pub);
+#endif
+    return (&pvt->pub);
+}
+
+void
+rtpp_analyzer_dtor_pa(struct rtpp_analyzer *pub)
+{
+    struct rtpp_analyzer_priv *pvt;
+
+    PUB2PVT(pub, pvt);
+    rtpp_analyzer_fin(pub);
+    rtpp_stats_destroy(&pvt->rstat);
+    RTPP_OBJ_DECREF(pvt->log);
+}
+
 static enum update_rtpp_stats_rval
 rtpp_analyzer_update(struct rtpp_analyzer *rap, struct rtp_packet *pkt)
 {
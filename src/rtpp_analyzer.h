@@ -52,3 +52,9 @@ DECLARE_SMETHODS(rtpp_analyzer)
 };
 
 DECLARE_CLASS_PUBTYPE(rtpp_analyzer, {});
+
+/* Storage and refcount provided by the owning rtpp_stream */
+extern const size_t rtpp_analyzer_osize;
+struct rtpp_analyzer *rtpp_analyzer_ctor_pa(void *, struct rtpp_refcnt *,
+  struct rtpp_log *);
+void rtpp_analyzer_dtor_pa(struct rtpp_analyzer *);
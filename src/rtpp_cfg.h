@@ -53,13 +53,22 @@ struct pproc_manager;
 struct rtpp_locking;
 struct rtpp_nofile;
 struct rtpp_modman;
+struct rtpp_tload;
+struct rtpp_repl;
+struct rtpp_cpusets;
+struct rtpp_hpool;
 
 #define RTPP_PT_INET	0
 #define	RTPP_PT_INET6	1
 #define	RTPP_PT_MAX	RTPP_PT_INET6
 #define	RTPP_PT_LEN	(RTPP_PT_MAX + 1)
-#define	RTPP_PT_SELECT(cp, af) (((af) == AF_INET) ? \
-  (cp)->port_table[RTPP_PT_INET] : (cp)->port_table[RTPP_PT_INET6])
+#define	RTPP_PT_SELECT(cp, shard, af) (((af) == AF_INET) ? \
+  (cp)->port_table[shard][RTPP_PT_INET] : \
+  (cp)->port_table[shard][RTPP_PT_INET6])
+
+#define	RTPP_MAX_SHARDS	64
+
+#define	RTPP_PKT_POOL_MAX	(1 << 20)
 
 struct overload_prot {
     double low_trs;
@@ -114,7 +123,12 @@ struct rtpp_cfg {
     int log_level;
     int log_facility;
 
-    struct rtpp_port_table *port_table[RTPP_PT_LEN];
+    /* Media plane partitions, each with its own slice of the port range */
+    int nshards;
+    struct rtpp_port_table *(*port_table)[RTPP_PT_LEN];
+    struct rtpp_cpusets *cpusets;   /* Per thread class CPU affinity */
+    int pkt_pool_len;
+    struct rtpp_hpool *pkt_pool;    /* Huge page backed packet pool */
 
     struct rtpp_hash_table *sessions_ht;
     struct rtpp_weakref *sessions_wrt;
@@ -128,6 +142,7 @@ struct rtpp_cfg {
     struct rtpp_cmd_async *rtpp_cmd_cf;
     struct rtpp_proc_async *rtpp_proc_cf;
     struct rtpp_proc_ttl *rtpp_proc_ttl_cf;
+    struct rtpp_repl *rtpp_repl_cf;
     struct rtpp_tnotify_set *rtpp_tnset_cf;
     struct rtpp_notify *rtpp_notify_cf;
     struct rtpp_bindaddrs *bindaddrs_cf;
@@ -135,6 +150,7 @@ struct rtpp_cfg {
     int fastshutdown;
 
     struct rtpp_stats *rtpp_stats;
+    struct rtpp_tload *rtpp_tload;
     struct rtpp_list *ctrl_socks;
     struct rtpp_timed *rtpp_timed_cf;
     struct rtpp_sessinfo *sessinfo;
@@ -143,6 +159,9 @@ struct rtpp_cfg {
     struct overload_prot overload_prot;
 
     const char *cfile;
+    const char *wrestart_sock;      /* Warm restart rendezvous socket */
+    const char *repl_peer;          /* Standby to replicate sessions to */
+    const char *repl_listen;        /* Accept replication from the active */
 
     struct pproc_manager *pproc_manager;
 
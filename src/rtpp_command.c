@@ -81,6 +81,7 @@
 #include "rtpp_socket.h"
 #include "rtpp_util.h"
 #include "rtpp_stats.h"
+#include "rtpp_tload.h"
 #include "rtpp_weakref.h"
 #include "rtpp_proc_async.h"
 #include "rtpp_command_ctx.h"
@@ -162,8 +163,8 @@ failure:
 }
 
 int
-rtpp_create_listener(const struct rtpp_cfg *cfsp, const struct sockaddr *ia, int *port,
-  struct rtpp_socket **fds)
+rtpp_create_listener(const struct rtpp_cfg *cfsp, const struct sockaddr *ia,
+  int shard, int *port, struct rtpp_socket **fds)
 {
     struct create_twinlistener_args cta;
     int i;
@@ -178,7 +179,7 @@ rtpp_create_listener(const struct rtpp_cfg *cfsp, const struct sockaddr *ia, int
     for (i = 0; i < 2; i++)
         fds[i] = NULL;
 
-    rpp = RTPP_PT_SELECT(cfsp, ia->sa_family);
+    rpp = RTPP_PT_SELECT(cfsp, shard, ia->sa_family);
     return (CALL_METHOD(rpp, get_port, create_twinlistener,
       &cta));
 }
@@ -714,7 +715,7 @@ handle_info(const struct rtpp_cfg *cfsp, struct rtpp_command *cmd)
     char addrs[4][256];
     int brief;
 #endif
-    int aerr, i, load;
+    int aerr, i, load, tload;
     unsigned long long packets_in, packets_out;
     unsigned long long sessions_created;
     int sessions_active, rtp_streams_active;
@@ -725,6 +726,7 @@ handle_info(const struct rtpp_cfg *cfsp, struct rtpp_command *cmd)
     brief = 0;
 #endif
     load = 0;
+    tload = 0;
     for (i = 0; opts[i] != '\0'; i++) {
         switch (opts[i]) {
         case 'b':
@@ -739,6 +741,11 @@ handle_info(const struct rtpp_cfg *cfsp, struct rtpp_command *cmd)
             load = 1;
             break;
 
+        case 't':
+        case 'T':
+            tload = 1;
+            break;
+
         default:
             RTPP_LOG(cfsp->glog, RTPP_LOG_ERR, "command syntax error");
             CALL_SMETHOD(cmd->reply, error, ECODE_PARSE_7);
@@ -761,6 +768,9 @@ handle_info(const struct rtpp_cfg *cfsp, struct rtpp_command *cmd)
           aerr = CALL_SMETHOD(cmd->reply, appendf, "average load: %f\n",
             CALL_METHOD(cfsp->rtpp_cmd_cf, get_aload));
     }
+    if (tload != 0 && aerr == 0) {
+        aerr = CALL_SMETHOD(cfsp->rtpp_tload, report, cmd->reply);
+    }
 #if 0
 XXX this needs work to fix it after rtp/rtcp split 
     for (i = 0; i < cfsp->nsessions && brief == 0; i++) {
@@ -52,8 +52,8 @@ void free_command(struct rtpp_command *);
 struct rtpp_command *get_command(const struct rtpp_cfg *, struct rtpp_ctrl_sock *, int, int *,
   const struct rtpp_timestamp *, struct rtpp_command_stats *csp,
   struct rtpp_cmd_rcache *);
-int rtpp_create_listener(const struct rtpp_cfg *, const struct sockaddr *, int *,
-  struct rtpp_socket **) RTPP_EXPORT;
+int rtpp_create_listener(const struct rtpp_cfg *, const struct sockaddr *, int,
+  int *, struct rtpp_socket **) RTPP_EXPORT;
 struct rtpp_command *rtpp_command_ctor(const struct rtpp_cfg *, int, const struct rtpp_timestamp *,
   struct rtpp_command_stats *, int);
 int rtpp_command_split(struct rtpp_command *, int, int *, struct rtpp_cmd_rcache *);
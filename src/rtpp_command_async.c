@@ -38,6 +38,7 @@
 #include <pthread.h>
 #include <signal.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -69,9 +70,18 @@
 #include "rtpp_util.h"
 #include "rtpp_threads.h"
 #include "rtpp_proc_async.h"
+#include "rtpp_tload.h"
+#include "rtpp_cpuset.h"
 
 #define RTPC_MAX_CONNECTIONS 100
 
+/*
+ * Overload protection: RTPP->NET queue length that counts as being fully
+ * loaded, and prefixes of the media-plane threads in the load registry.
+ */
+#define RTPP_OVL_PROC_NAME  "rtpp_proc: "
+#define RTPP_OVL_NETIO_NAME "rtpp_anetio_sender"
+
 struct rtpp_cmd_pollset {
     struct pollfd *pfds;
     int pfds_used;
@@ -96,9 +106,10 @@ struct rtpp_cmd_async_cf {
     int tstate_acceptor;
     int acceptor_started;
     int overload;
-#if 0
-    struct recfilter average_load;
-#endif
+    double ovl_ltime;
+    struct rtpp_tload_ovl ovl;
+    struct rtpp_tload_ent *tlp;
+    struct rtpp_tload_ent *acpt_tlp;
     struct rtpp_command_stats cstats;
     struct rtpp_cmd_pollset pset;
     int wakefds[2];
@@ -312,6 +323,7 @@ rtpp_cmd_acceptor_run(void *arg)
     asp = &cmd_cf->aset;
 
     for (;;) {
+        rtpp_tload_sleep(cmd_cf->acpt_tlp, getdtime(), 0);
 #ifndef LINUX_XXX
         /*
          * On most decent OSes but Linux close()ing file descriptor in
@@ -323,6 +335,7 @@ rtpp_cmd_acceptor_run(void *arg)
 #else
 	nready = poll(asp->pfds, asp->pfds_used, 100);
 #endif
+        rtpp_tload_wake(cmd_cf->acpt_tlp, getdtime());
         pthread_mutex_lock(&cmd_cf->cmd_mutex);
         tstate = cmd_cf->tstate_acceptor;
         pthread_mutex_unlock(&cmd_cf->cmd_mutex);
@@ -380,6 +393,52 @@ rtpp_cmd_acceptor_run(void *arg)
     }
 }
 
+/*
+ * Re-evaluate the overload state, at most once per load averaging window.
+ * The proxy is considered overloaded when the command thread, any of the
+ * media workers or senders is busy for more than high_trs of the time,
+ * when the outbound queue is backing up or is rejecting packets at a
+ * sustained rate. It goes back to normal when all of the above is under
+ * low_trs.
+ */
+static void
+rtpp_cmd_chk_ovl(struct rtpp_cmd_async_cf *cmd_cf, double dtime)
+{
+    const struct rtpp_cfg *cfsp;
+    struct rtpp_tload_agg pagg, nagg, agg;
+    double cload;
+    int ovl;
+
+    if (dtime - cmd_cf->ovl_ltime < RTPP_TLOAD_WIN)
+        return;
+    cmd_cf->ovl_ltime = dtime;
+    cfsp = cmd_cf->cf_save;
+
+    cload = rtpp_tload_ent_getload(cmd_cf->tlp, dtime);
+    CALL_SMETHOD(cfsp->rtpp_tload, aggregate, RTPP_OVL_PROC_NAME, dtime, &pagg);
+    CALL_SMETHOD(cfsp->rtpp_tload, aggregate, RTPP_OVL_NETIO_NAME, dtime, &nagg);
+    agg = nagg;
+    agg.load = cload;
+    if (pagg.load > agg.load)
+        agg.load = pagg.load;
+    if (nagg.load > agg.load)
+        agg.load = nagg.load;
+    if (pagg.qlen > agg.qlen)
+        agg.qlen = pagg.qlen;
+    agg.nitems += pagg.nitems;
+    agg.ndrops += pagg.ndrops;
+
+    ovl = rtpp_tload_ovl_update(&cmd_cf->ovl, &agg,
+      cfsp->overload_prot.high_trs, cfsp->overload_prot.low_trs);
+    if (ovl != cmd_cf->overload) {
+        RTPP_LOG(cfsp->glog, ovl ? RTPP_LOG_ERR : RTPP_LOG_INFO, "overload "
+          "protection %s: cmd load %.2f, media load %.2f, netio load %.2f, "
+          "netio qlen %u, drop rate %.4f", ovl ? "engaged" : "disengaged",
+          cload, pagg.load, nagg.load, nagg.qlen, cmd_cf->ovl.drate);
+        rtpp_command_async_reg_overload(&cmd_cf->pub, ovl);
+    }
+}
+
 static void
 rtpp_cmd_queue_run(void *arg)
 {
@@ -389,10 +448,16 @@ rtpp_cmd_queue_run(void *arg)
     struct rtpp_timestamp sptime;
     struct rtpp_command_stats *csp;
     struct rtpp_stats *rtpp_stats_cf;
+    unsigned int nitems;
+    int ptout;
 
     cmd_cf = (struct rtpp_cmd_async_cf *)arg;
     rtpp_stats_cf = cmd_cf->cf_save->rtpp_stats;
     csp = &cmd_cf->cstats;
+    nitems = 0;
+    /* Overload protection needs periodic wakeups to track the load */
+    ptout = (cmd_cf->cf_save->overload_prot.ecode != 0) ?
+      (int)(RTPP_TLOAD_WIN * 1000) : INFTIM;
 
     psp = &cmd_cf->pset;
 
@@ -403,8 +468,13 @@ rtpp_cmd_queue_run(void *arg)
             break;
         }
         pthread_mutex_unlock(&cmd_cf->cmd_mutex);
+        if (ptout != INFTIM)
+            rtpp_cmd_chk_ovl(cmd_cf, getdtime());
         pthread_mutex_lock(&psp->pfds_mutex);
-        nready = poll(psp->pfds, psp->pfds_used, INFTIM);
+        rtpp_tload_sleep(cmd_cf->tlp, getdtime(), nitems);
+        nready = poll(psp->pfds, psp->pfds_used, ptout);
+        rtpp_tload_wake(cmd_cf->tlp, getdtime());
+        nitems = 0;
         if (nready == 0) {
             pthread_mutex_unlock(&psp->pfds_mutex);
             continue;
@@ -467,6 +537,7 @@ closefd:
         if (nready > 0) {
             rtpp_anetio_pump(cmd_cf->cf_save->rtpp_proc_cf->netio);
         }
+        nitems = csp->ncmds_rcvd.cnt;
         flush_cstats(rtpp_stats_cf, csp);
     }
 }
@@ -474,20 +545,11 @@ closefd:
 static double
 rtpp_command_async_get_aload(struct rtpp_cmd_async *pub)
 {
-#if 0
-    double aload;
     struct rtpp_cmd_async_cf *cmd_cf;
 
     PUB2PVT(pub, cmd_cf);
 
-    pthread_mutex_lock(&cmd_cf->cmd_mutex);
-    aload = cmd_cf->average_load.lastval;
-    pthread_mutex_unlock(&cmd_cf->cmd_mutex);
-
-    return (aload);
-#else
-    return (0);
-#endif
+    return (rtpp_tload_ent_getload(cmd_cf->tlp, getdtime()));
 }
 
 static int
@@ -687,28 +749,42 @@ rtpp_command_async_ctor(struct rtpp_cfg *cfsp)
         goto e5;
     }
 
-#if 0
-    recfilter_init(&cmd_cf->average_load, 0.999, 0.0, 1);
-#endif
+    cmd_cf->tlp = CALL_SMETHOD(cfsp->rtpp_tload, reg, "rtpp_cmd_queue", NULL);
+    if (cmd_cf->tlp == NULL) {
+        goto e6;
+    }
 
     cmd_cf->cf_save = cfsp;
     if (need_acptr != 0) {
+        cmd_cf->acpt_tlp = CALL_SMETHOD(cfsp->rtpp_tload, reg,
+          "rtpp_cmd_acceptor", NULL);
+        if (cmd_cf->acpt_tlp == NULL) {
+            goto e7;
+        }
         if (pthread_create(&cmd_cf->acpt_thread_id, NULL,
           (void *(*)(void *))&rtpp_cmd_acceptor_run, cmd_cf) != 0) {
-            goto e6;
+            goto e8;
         }
         cmd_cf->acceptor_started = 1;
 #if HAVE_PTHREAD_SETNAME_NP
         (void)pthread_setname_np(cmd_cf->acpt_thread_id, "rtpp_cmd_acceptor");
 #endif
+        if (rtpp_cpusets_apply(cfsp->cpusets, RTPP_TCLASS_CMD, -1,
+          cmd_cf->acpt_thread_id) != 0)
+            RTPP_ELOG(cfsp->glog, RTPP_LOG_ERR, "can't set CPU affinity for "
+              "rtpp_cmd_acceptor");
     }
     if (pthread_create(&cmd_cf->thread_id, NULL,
       (void *(*)(void *))&rtpp_cmd_queue_run, cmd_cf) != 0) {
-        goto e7;
+        goto e9;
     }
 #if HAVE_PTHREAD_SETNAME_NP
     (void)pthread_setname_np(cmd_cf->thread_id, "rtpp_cmd_queue");
 #endif
+    if (rtpp_cpusets_apply(cfsp->cpusets, RTPP_TCLASS_CMD, -1,
+      cmd_cf->thread_id) != 0)
+        RTPP_ELOG(cfsp->glog, RTPP_LOG_ERR, "can't set CPU affinity for "
+          "rtpp_cmd_queue");
     cmd_cf->pub.dtor = &rtpp_command_async_dtor;
     cmd_cf->pub.wakeup = &rtpp_command_async_wakeup;
     cmd_cf->pub.get_aload = &rtpp_command_async_get_aload;
@@ -716,7 +792,7 @@ rtpp_command_async_ctor(struct rtpp_cfg *cfsp)
     cmd_cf->pub.chk_overload = &rtpp_command_async_chk_overload;
     return (&cmd_cf->pub);
 
-e7:
+e9:
     if (cmd_cf->acceptor_started != 0) {
         pthread_mutex_lock(&cmd_cf->cmd_mutex);
         cmd_cf->tstate_acceptor = TSTATE_CEASE;
@@ -726,6 +802,11 @@ e7:
         }
         pthread_join(cmd_cf->acpt_thread_id, NULL);
     }
+e8:
+    if (cmd_cf->acpt_tlp != NULL)
+        CALL_SMETHOD(cmd_cf->acpt_tlp->owner, unreg, cmd_cf->acpt_tlp);
+e7:
+    CALL_SMETHOD(cmd_cf->tlp->owner, unreg, cmd_cf->tlp);
 e6:
     CALL_METHOD(cmd_cf->rcache, shutdown);
     RTPP_OBJ_DECREF(cmd_cf->rcache);
@@ -771,6 +852,9 @@ rtpp_command_async_dtor(struct rtpp_cmd_async *pub)
     }
     CALL_METHOD(cmd_cf->rcache, shutdown);
     RTPP_OBJ_DECREF(cmd_cf->rcache);
+    if (cmd_cf->acpt_tlp != NULL)
+        CALL_SMETHOD(cmd_cf->acpt_tlp->owner, unreg, cmd_cf->acpt_tlp);
+    CALL_SMETHOD(cmd_cf->tlp->owner, unreg, cmd_cf->tlp);
     pthread_mutex_destroy(&cmd_cf->cmd_mutex);
     free_pollset(&cmd_cf->pset);
     free_accptset(&cmd_cf->aset);
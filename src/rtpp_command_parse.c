@@ -200,7 +200,7 @@ fill_cmd_props(const struct rtpp_cfg *cfsp, struct rtpp_command *cmd,
     case 'I':
         cmd->cca.op = INFO;
         cmd->cca.rname = "get_info";
-        cmd->cca.hint = "I[b]";
+        cmd->cca.hint = "I[blt]";
         cpp->max_argc = 1;
         cpp->min_argc = 1;
         cpp->has_cmods = 1;
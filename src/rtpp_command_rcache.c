@@ -29,10 +29,12 @@
 #include "config_pp.h"
 #endif
 
+#include <pthread.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "rtpp_debug.h"
 #include "rtpp_types.h"
 #include "rtpp_str.h"
 #include "rtpp_command_rcache.h"
@@ -46,6 +48,16 @@
 #include "rtpp_util.h"
 
 #define	RTPP_RCACHE_CPERD	3.0
+/*
+ * Each entry pins its reply object (~1k), so this caps the cache at some
+ * 32MB. Oldest entries are evicted ahead of their expiration once the cap
+ * is reached.
+ */
+#define	RTPP_RCACHE_MAXENTS	(32 * 1024)
+/* Max number of released entries kept around for reuse */
+#define	RTPP_RCACHE_POOLMAX	1024
+
+struct rtpp_cmd_rcache_entry_pvt;
 
 struct rtpp_cmd_rcache_pvt {
     struct rtpp_cmd_rcache pub;
@@ -53,6 +65,16 @@ struct rtpp_cmd_rcache_pvt {
     struct rtpp_hash_table *ht;
     struct rtpp_timed_task *timeout;
     int timeout_rval;
+    pthread_mutex_t lock;
+    /*
+     * All entries have the same min_ttl, so the insertion order is also
+     * the expiration order.
+     */
+    struct rtpp_cmd_rcache_entry_pvt *head;
+    struct rtpp_cmd_rcache_entry_pvt **tailp;
+    int nents;
+    struct rtpp_cmd_rcache_entry_pvt *pool;
+    int npool;
 };
 
 struct rtpp_cmd_rcache_entry_pvt {
@@ -60,6 +82,9 @@ struct rtpp_cmd_rcache_entry_pvt {
     rtpp_str_const_t reply;
     struct rtpp_refcnt *reply_rcnt;
     double etime;
+    struct rtpp_cmd_rcache_pvt *owner;
+    struct rtpp_hash_table_entry *hte;
+    struct rtpp_cmd_rcache_entry_pvt *next;
 };
 
 static enum rtpp_timed_cb_rvals rtpp_cmd_rcache_cleanup(double, void *);
@@ -87,6 +112,10 @@ rtpp_cmd_rcache_ctor(struct rtpp_timed *rtpp_timed_cf, double min_ttl)
     if (pvt->ht == NULL) {
         goto e0;
     }
+    if (pthread_mutex_init(&pvt->lock, NULL) != 0) {
+        goto e1;
+    }
+    pvt->tailp = &pvt->head;
     pvt->timeout = CALL_SMETHOD(rtpp_timed_cf, schedule_rc, RTPP_RCACHE_CPERD,
       pvt->pub.rcnt, rtpp_cmd_rcache_cleanup, NULL, pvt);
     if (pvt->timeout == NULL) {
@@ -102,6 +131,8 @@ rtpp_cmd_rcache_ctor(struct rtpp_timed *rtpp_timed_cf, double min_ttl)
     return (&pvt->pub);
 
 e2:
+    pthread_mutex_destroy(&pvt->lock);
+e1:
     RTPP_OBJ_DECREF(pvt->ht);
 e0:
     RTPP_OBJ_DECREF(&(pvt->pub));
@@ -113,10 +144,87 @@ static void
 rtpp_cmd_rcache_entry_free(void *p)
 {
     struct rtpp_cmd_rcache_entry_pvt *rep;
+    struct rtpp_cmd_rcache_pvt *pvt;
 
     rep = (struct rtpp_cmd_rcache_entry_pvt *)p;
+    pvt = rep->owner;
     RC_DECREF(rep->reply_rcnt);
-    free(rep);
+    pthread_mutex_lock(&pvt->lock);
+    if (pvt->npool < RTPP_RCACHE_POOLMAX) {
+        rep->next = pvt->pool;
+        pvt->pool = rep;
+        pvt->npool++;
+        rep = NULL;
+    }
+    pthread_mutex_unlock(&pvt->lock);
+    if (rep != NULL)
+        free(rep);
+    RTPP_OBJ_DECREF(&(pvt->pub));
+}
+
+static struct rtpp_cmd_rcache_entry_pvt *
+rtpp_cmd_rcache_entry_get(struct rtpp_cmd_rcache_pvt *pvt)
+{
+    struct rtpp_cmd_rcache_entry_pvt *rep;
+    void *rco;
+
+    pthread_mutex_lock(&pvt->lock);
+    rep = pvt->pool;
+    if (rep != NULL) {
+        pvt->pool = rep->next;
+        pvt->npool--;
+    }
+    pthread_mutex_unlock(&pvt->lock);
+    if (rep == NULL) {
+        return (rtpp_rzmalloc(sizeof(struct rtpp_cmd_rcache_entry_pvt),
+          PVT_RCOFFS(rep)));
+    }
+    /* Refcnt lives in the same allocation, right after the entry */
+    rco = rep->pub.rcnt;
+    memset(rep, '\0', sizeof(struct rtpp_cmd_rcache_entry_pvt));
+    memset(rco, '\0', rtpp_refcnt_osize);
+    rep->pub.rcnt = rtpp_refcnt_ctor_pa(rco);
+    return (rep);
+}
+
+/*
+ * Unlinks entries from the head of the FIFO that have expired by the ctime,
+ * or are over the RTPP_RCACHE_MAXENTS cap. Must be called with the lock held,
+ * the entries returned have to be removed from the hash table using
+ * rtpp_cmd_rcache_drop() once the lock is released.
+ */
+static struct rtpp_cmd_rcache_entry_pvt *
+rtpp_cmd_rcache_detach(struct rtpp_cmd_rcache_pvt *pvt, double ctime)
+{
+    struct rtpp_cmd_rcache_entry_pvt *rep, *elist;
+    struct rtpp_cmd_rcache_entry_pvt **epp;
+
+    elist = pvt->head;
+    epp = &elist;
+    while ((rep = *epp) != NULL) {
+        if (rep->etime >= ctime && pvt->nents <= RTPP_RCACHE_MAXENTS)
+            break;
+        pvt->nents--;
+        epp = &rep->next;
+    }
+    pvt->head = rep;
+    *epp = NULL;
+    if (pvt->head == NULL)
+        pvt->tailp = &pvt->head;
+    return (elist);
+}
+
+static void
+rtpp_cmd_rcache_drop(struct rtpp_cmd_rcache_pvt *pvt,
+  struct rtpp_cmd_rcache_entry_pvt *elist)
+{
+    struct rtpp_cmd_rcache_entry_pvt *rep;
+
+    while ((rep = elist) != NULL) {
+        elist = rep->next;
+        /* This drops the cache's reference to the entry */
+        CALL_SMETHOD(pvt->ht, remove_ent, rep->hte);
+    }
 }
 
 static void
@@ -124,10 +232,10 @@ rtpp_cmd_rcache_insert(struct rtpp_cmd_rcache *pub, const rtpp_str_t *cookie,
   const rtpp_str_t *reply, struct rtpp_refcnt *reply_rcnt, double ctime)
 {
     struct rtpp_cmd_rcache_pvt *pvt;
-    struct rtpp_cmd_rcache_entry_pvt *rep;
+    struct rtpp_cmd_rcache_entry_pvt *rep, *elist;
 
     PUB2PVT(pub, pvt);
-    rep = rtpp_rzmalloc(sizeof(struct rtpp_cmd_rcache_entry_pvt), PVT_RCOFFS(rep));
+    rep = rtpp_cmd_rcache_entry_get(pvt);
     if (rep == NULL) {
         return;
     }
@@ -136,8 +244,23 @@ rtpp_cmd_rcache_insert(struct rtpp_cmd_rcache *pub, const rtpp_str_t *cookie,
     RC_INCREF(reply_rcnt);
     rep->reply_rcnt = reply_rcnt;
     rep->etime = ctime + pvt->min_ttl;
+    /* Entry goes back to our pool when released, keep us around till then */
+    RTPP_OBJ_INCREF(&(pvt->pub));
+    rep->owner = pvt;
     CALL_SMETHOD(rep->pub.rcnt, attach, rtpp_cmd_rcache_entry_free, rep);
-    CALL_SMETHOD(pvt->ht, append_str_refcnt, cookie, rep->pub.rcnt, NULL);
+    elist = NULL;
+    pthread_mutex_lock(&pvt->lock);
+    rep->hte = CALL_SMETHOD(pvt->ht, append_str_refcnt, cookie, rep->pub.rcnt,
+      NULL);
+    if (rep->hte != NULL) {
+        *pvt->tailp = rep;
+        pvt->tailp = &rep->next;
+        pvt->nents++;
+        if (pvt->nents > RTPP_RCACHE_MAXENTS)
+            elist = rtpp_cmd_rcache_detach(pvt, -1.0);
+    }
+    pthread_mutex_unlock(&pvt->lock);
+    rtpp_cmd_rcache_drop(pvt, elist);
     /*
      * append_refcnt() either takes ownership in which case it incs refcount
      * or it drops the ball in which it does not, so we release rco and set
@@ -171,47 +294,212 @@ static void
 rtpp_cmd_rcache_shutdown(struct rtpp_cmd_rcache *pub)
 {
     struct rtpp_cmd_rcache_pvt *pvt;
+    struct rtpp_cmd_rcache_entry_pvt *elist;
 
     PUB2PVT(pub, pvt);
     pvt->timeout_rval = CB_LAST;
     CALL_METHOD(pvt->timeout, cancel);
     RTPP_OBJ_DECREF(pvt->timeout);
     pvt->timeout = NULL;
+    /* Break the cache <-> entry reference loop */
+    pthread_mutex_lock(&pvt->lock);
+    elist = pvt->head;
+    pvt->head = NULL;
+    pvt->tailp = &pvt->head;
+    pvt->nents = 0;
+    pthread_mutex_unlock(&pvt->lock);
+    rtpp_cmd_rcache_drop(pvt, elist);
 }
 
 void
 rtpp_cmd_rcache_dtor(struct rtpp_cmd_rcache_pvt *pvt)
 {
+    struct rtpp_cmd_rcache_entry_pvt *rep;
 
     rtpp_cmd_rcache_fin(&pvt->pub);
+    RTPP_DBG_ASSERT(pvt->head == NULL);
+    while ((rep = pvt->pool) != NULL) {
+        pvt->pool = rep->next;
+        free(rep);
+    }
     RTPP_OBJ_DECREF(pvt->ht);
+    pthread_mutex_destroy(&pvt->lock);
     free(pvt);
 }
 
+static enum rtpp_timed_cb_rvals
+rtpp_cmd_rcache_cleanup(double ctime, void *p)
+{
+    struct rtpp_cmd_rcache_pvt *pvt;
+    struct rtpp_cmd_rcache_entry_pvt *elist;
+
+    pvt = (struct rtpp_cmd_rcache_pvt *)p;
+    pthread_mutex_lock(&pvt->lock);
+    elist = rtpp_cmd_rcache_detach(pvt, ctime);
+    pthread_mutex_unlock(&pvt->lock);
+    rtpp_cmd_rcache_drop(pvt, elist);
+    return (pvt->timeout_rval);
+}
+
+#if defined(rtpp_cmd_rcache_selftest)
+#include <assert.h>
+#include <stdio.h>
+#include "rtpp_memdeb_internal.h"
+#include "libexecinfo/stacktraverse.h"
+#include "libexecinfo/execinfo.h"
+
+#if !defined(NO_ERR_H)
+#include <err.h>
+#endif
+
+#define errx_ifnot(expr) \
+    if (!(expr)) \
+        errx(1, "`%s` check has failed in %s() at %s:%d", #expr, __func__, \
+          __FILE__, __LINE__);
+
+RTPP_MEMDEB_APP_STATIC;
+
+/*
+ * The cleanup is driven by hand below, so the timed task the cache
+ * schedules on construction is a dummy that never fires.
+ */
+struct rcst_task {
+    struct rtpp_timed_task pub;
+};
+
+static int rcst_ncancels;
+
+struct rcst_reply {
+    struct rtpp_refcnt *rcnt;
+};
+
 static int
-rtpp_cmd_rcache_ematch(void *dp, void *ap)
+rcst_task_cancel(struct rtpp_timed_task *pub)
 {
-    struct rtpp_cmd_rcache_entry_pvt *rep;
-    double *ctimep;
 
-    /*
-     * This method does not need us to bump ref, since we are in the
-     * context of the rtpp_hash_table, which hold its own ref.
-     */
-    ctimep = (double *)ap;
-    rep = (struct rtpp_cmd_rcache_entry_pvt *)dp;
-    if (rep->etime < *ctimep) {
-        return (RTPP_HT_MATCH_DEL);
-    }
-    return (RTPP_HT_MATCH_CONT);
+    rcst_ncancels++;
+    return (0);
 }
 
-static enum rtpp_timed_cb_rvals
-rtpp_cmd_rcache_cleanup(double ctime, void *p)
+static struct rtpp_timed_task *
+rcst_schedule_rc(struct rtpp_timed *pub, double offset,
+  struct rtpp_refcnt *rcnt, rtpp_timed_cb_t cb_func,
+  rtpp_timed_cancel_cb_t cancel_cb_func, void *cb_func_arg)
 {
+    struct rcst_task *tp;
+
+    errx_ifnot(offset == RTPP_RCACHE_CPERD);
+    errx_ifnot(cb_func == rtpp_cmd_rcache_cleanup);
+    tp = rtpp_rzmalloc(sizeof(*tp), PVT_RCOFFS(tp));
+    errx_ifnot(tp != NULL);
+    CALL_SMETHOD(tp->pub.rcnt, use_stdfree, tp);
+    tp->pub.cancel = &rcst_task_cancel;
+    return (&tp->pub);
+}
+
+static const struct rtpp_timed_smethods rcst_timed_smethods = {
+    .schedule_rc = &rcst_schedule_rc,
+};
+
+static void
+rcst_insert(struct rtpp_cmd_rcache *rcp, const char *pfx, int idx,
+  const rtpp_str_t *reply, struct rtpp_refcnt *reply_rcnt, double ctime)
+{
+    char cbuf[32];
+    struct rtpp_str cookie;
+
+    cookie.ro.s = cbuf;
+    cookie.ro.len = snprintf(cbuf, sizeof(cbuf), "%s%d", pfx, idx);
+    CALL_METHOD(rcp, insert, &cookie.fx, reply, reply_rcnt, ctime);
+}
+
+static int
+rcst_present(struct rtpp_cmd_rcache *rcp, const char *pfx, int idx,
+  const rtpp_str_t *reply)
+{
+    char cbuf[32];
+    struct rtpp_str cookie;
+    struct rtpp_cmd_rcache_entry *rep;
+
+    cookie.ro.s = cbuf;
+    cookie.ro.len = snprintf(cbuf, sizeof(cbuf), "%s%d", pfx, idx);
+    rep = CALL_METHOD(rcp, lookup, &cookie.fx);
+    if (rep == NULL)
+        return (0);
+    errx_ifnot(rep->reply->len == reply->len);
+    errx_ifnot(memcmp(rep->reply->s, reply->s, reply->len) == 0);
+    RTPP_OBJ_DECREF(rep);
+    return (1);
+}
+
+int
+rtpp_cmd_rcache_selftest(void)
+{
+    struct rtpp_timed tstub = {.smethods = &rcst_timed_smethods};
+    struct rtpp_cmd_rcache *rcp;
     struct rtpp_cmd_rcache_pvt *pvt;
+    struct rcst_reply *rrp;
+    struct rtpp_str reply;
+    int i, rval;
 
-    pvt = (struct rtpp_cmd_rcache_pvt *)p;
-    CALL_SMETHOD(pvt->ht, foreach, rtpp_cmd_rcache_ematch, &ctime, NULL);
-    return (pvt->timeout_rval);
+    RTPP_MEMDEB_APP_INIT();
+
+    reply.ro.s = "0 12345 10.0.0.1";
+    reply.ro.len = strlen(reply.ro.s);
+    rrp = rtpp_rzmalloc(sizeof(*rrp), offsetof(typeof(*rrp), rcnt));
+    errx_ifnot(rrp != NULL);
+    CALL_SMETHOD(rrp->rcnt, use_stdfree, rrp);
+
+    rcp = rtpp_cmd_rcache_ctor(&tstub, 10.0);
+    errx_ifnot(rcp != NULL);
+    PUB2PVT(rcp, pvt);
+
+    /* Expiration: entries go once they are min_ttl old, oldest first */
+    for (i = 0; i < 10; i++)
+        rcst_insert(rcp, "t", i, &reply.fx, rrp->rcnt, 0.0);
+    for (i = 10; i < 20; i++)
+        rcst_insert(rcp, "t", i, &reply.fx, rrp->rcnt, 5.0);
+    errx_ifnot(pvt->nents == 20);
+    errx_ifnot(rtpp_cmd_rcache_cleanup(9.5, pvt) == CB_MORE);
+    errx_ifnot(pvt->nents == 20);
+    errx_ifnot(rtpp_cmd_rcache_cleanup(10.5, pvt) == CB_MORE);
+    errx_ifnot(pvt->nents == 10);
+    for (i = 0; i < 20; i++)
+        errx_ifnot(rcst_present(rcp, "t", i, &reply.fx) == (i >= 10));
+
+    /* Cap: filling past it evicts the oldest entries regardless of TTL */
+    for (i = 0; i < RTPP_RCACHE_MAXENTS; i++)
+        rcst_insert(rcp, "c", i, &reply.fx, rrp->rcnt, 6.0);
+    errx_ifnot(pvt->nents == RTPP_RCACHE_MAXENTS);
+    for (i = 10; i < 20; i++)
+        errx_ifnot(!rcst_present(rcp, "t", i, &reply.fx));
+    errx_ifnot(rcst_present(rcp, "c", 0, &reply.fx));
+    rcst_insert(rcp, "x", 0, &reply.fx, rrp->rcnt, 7.0);
+    rcst_insert(rcp, "x", 1, &reply.fx, rrp->rcnt, 7.0);
+    errx_ifnot(pvt->nents == RTPP_RCACHE_MAXENTS);
+    errx_ifnot(!rcst_present(rcp, "c", 0, &reply.fx));
+    errx_ifnot(!rcst_present(rcp, "c", 1, &reply.fx));
+    errx_ifnot(rcst_present(rcp, "c", 2, &reply.fx));
+    errx_ifnot(rcst_present(rcp, "c", RTPP_RCACHE_MAXENTS - 1, &reply.fx));
+    errx_ifnot(rcst_present(rcp, "x", 0, &reply.fx));
+    errx_ifnot(rcst_present(rcp, "x", 1, &reply.fx));
+    /* Evicted entries have been recycled into the pool */
+    errx_ifnot(pvt->npool > 0 && pvt->npool <= RTPP_RCACHE_POOLMAX);
+
+    /* Everything inserted at 6.0 expires at 16.0, x0 and x1 a second later */
+    errx_ifnot(rtpp_cmd_rcache_cleanup(16.5, pvt) == CB_MORE);
+    errx_ifnot(pvt->nents == 2);
+    errx_ifnot(!rcst_present(rcp, "c", 2, &reply.fx));
+    errx_ifnot(rcst_present(rcp, "x", 1, &reply.fx));
+
+    CALL_METHOD(rcp, shutdown);
+    errx_ifnot(rcst_ncancels == 1);
+    errx_ifnot(pvt->nents == 0);
+    errx_ifnot(!rcst_present(rcp, "x", 1, &reply.fx));
+    RTPP_OBJ_DECREF(rcp);
+    RTPP_OBJ_DECREF(rrp);
+
+    rval = rtpp_memdeb_dumpstats(MEMDEB_SYM, 0);
+    return (rval);
 }
+#endif /* rtpp_cmd_rcache_selftest */
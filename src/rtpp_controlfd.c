@@ -231,6 +231,8 @@ rtpp_controlfd_init(const struct rtpp_cfg *cfsp)
 
     for (ctrl_sock = RTPP_LIST_HEAD(cfsp->ctrl_socks);
       ctrl_sock != NULL; ctrl_sock = RTPP_ITER_NEXT(ctrl_sock)) {
+        if (ctrl_sock->inherited != 0)
+            continue;
         switch (ctrl_sock->type) {
         case RTPC_SYSD:
             controlfd_in = controlfd_out = controlfd_init_systemd();
@@ -314,7 +316,7 @@ rtpp_controlfd_cleanup(const struct rtpp_cfg *cfsp)
 
     for (ctrl_sock = RTPP_LIST_HEAD(cfsp->ctrl_socks);
       ctrl_sock != NULL; ctrl_sock = RTPP_ITER_NEXT(ctrl_sock)) {
-        if (RTPP_CTRL_ISUNIX(ctrl_sock) == 0)
+        if (RTPP_CTRL_ISUNIX(ctrl_sock) == 0 || ctrl_sock->handed_off != 0)
             continue;
         unlink(ctrl_sock->cmd_sock);
     }
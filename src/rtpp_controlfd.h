@@ -37,6 +37,8 @@ struct rtpp_ctrl_sock {
     int controlfd_out;
     int port_ctl;                   /* Port number for UDP control, 0 for Unix domain */
     int exit_on_close;
+    int inherited;                  /* Received from the predecessor on warm restart */
+    int handed_off;                 /* Passed to the successor on warm restart */
     struct {				/* Temporary space for emergencies (i.e. ENOMEM) */
         char buf[RTPP_CMD_BUFLEN];	/* I/O scrap buffer */
         struct sockaddr_storage addr;	/* space to store receiver's address */
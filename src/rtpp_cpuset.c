@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#if defined(LINUX_XXX) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* pthread_setaffinity_np(), CPU_SET() */
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+
+#if HAVE_PTHREAD_SETAFFINITY_NP && defined(__FreeBSD__)
+#include <pthread_np.h>
+#include <sys/cpuset.h>
+typedef cpuset_t cpu_set_t;
+#endif
+#if HAVE_PTHREAD_SETAFFINITY_NP
+#include <sched.h>
+#endif
+
+#include "rtpp_types.h"
+#include "rtpp_mallocs.h"
+#include "rtpp_cpuset.h"
+
+/* Has to fit into the cpu_set_t passed to pthread_setaffinity_np() */
+#if HAVE_PTHREAD_SETAFFINITY_NP
+#define RTPP_CPUSET_MAXCPU CPU_SETSIZE
+#else
+#define RTPP_CPUSET_MAXCPU 1024
+#endif
+
+static const char *rtpp_tclass_names[RTPP_TCLASS_LEN] = {
+    [RTPP_TCLASS_PROC] = "proc",
+    [RTPP_TCLASS_SENDER] = "sender",
+    [RTPP_TCLASS_CMD] = "cmd",
+    [RTPP_TCLASS_TIMED] = "timed",
+    [RTPP_TCLASS_WORKER] = "worker"
+};
+
+struct rtpp_cpusets *
+rtpp_cpusets_ctor(void)
+{
+
+    return (rtpp_zmalloc(sizeof(struct rtpp_cpusets)));
+}
+
+void
+rtpp_cpusets_dtor(struct rtpp_cpusets *csp)
+{
+    int i;
+
+    for (i = 0; i < RTPP_TCLASS_LEN; i++)
+        free(csp->cls[i].cpus);
+    free(csp);
+}
+
+static int
+rtpp_cpusets_getnum(const char **cpp, int *vp)
+{
+    char *ep;
+    long v;
+
+    if (**cpp < '0' || **cpp > '9')
+        return (-1);
+    v = strtol(*cpp, &ep, 10);
+    if (v < 0 || v >= RTPP_CPUSET_MAXCPU)
+        return (-1);
+    *vp = v;
+    *cpp = ep;
+    return (0);
+}
+
+/*
+ * Parse "class:cpulist", where cpulist is a comma-separated list of CPU
+ * numbers and ranges, i.e. "proc:2-5,10". Threads of the classes that
+ * have one instance per media shard are pinned to a single CPU of the
+ * list, picked by the shard number, the rest can run on any of them.
+ */
+int
+rtpp_cpusets_parse(struct rtpp_cpusets *csp, const char *spec,
+  const char **errmsg)
+{
+    const char *cp;
+    struct rtpp_cpuset *sp;
+    int i, cmin, cmax, *cpus, ncpus;
+    size_t nlen;
+
+    cp = strchr(spec, ':');
+    if (cp == NULL) {
+        *errmsg = "expected class:cpulist";
+        return (-1);
+    }
+    nlen = cp - spec;
+    for (i = 0; i < RTPP_TCLASS_LEN; i++) {
+        if (strlen(rtpp_tclass_names[i]) == nlen &&
+          memcmp(rtpp_tclass_names[i], spec, nlen) == 0)
+            break;
+    }
+    if (i == RTPP_TCLASS_LEN) {
+        *errmsg = "unknown thread class, expected proc, sender, cmd, timed "
+          "or worker";
+        return (-1);
+    }
+    sp = &csp->cls[i];
+    cpus = NULL;
+    ncpus = 0;
+    cp += 1;
+    do {
+        if (rtpp_cpusets_getnum(&cp, &cmin) != 0)
+            goto einval;
+        cmax = cmin;
+        if (*cp == '-') {
+            cp += 1;
+            if (rtpp_cpusets_getnum(&cp, &cmax) != 0 || cmax < cmin)
+                goto einval;
+        }
+        int *ncp = realloc(cpus, sizeof(cpus[0]) * (ncpus + cmax - cmin + 1));
+        if (ncp == NULL) {
+            *errmsg = "out of memory";
+            goto e0;
+        }
+        cpus = ncp;
+        for (i = cmin; i <= cmax; i++)
+            cpus[ncpus++] = i;
+    } while (*cp++ == ',');
+    if (cp[-1] != '\0')
+        goto einval;
+    free(sp->cpus);
+    sp->cpus = cpus;
+    sp->ncpus = ncpus;
+    return (0);
+einval:
+    *errmsg = "invalid CPU list";
+e0:
+    free(cpus);
+    return (-1);
+}
+
+/*
+ * Pin thread to the CPU set configured for its class, if any. The idx is
+ * the media shard number for per-shard threads, or -1 to allow the whole
+ * set.
+ */
+int
+rtpp_cpusets_apply(const struct rtpp_cpusets *csp, enum rtpp_tclass tclass,
+  int idx, pthread_t thread_id)
+{
+    const struct rtpp_cpuset *sp;
+
+    if (csp == NULL || csp->cls[tclass].ncpus == 0)
+        return (0);
+    sp = &csp->cls[tclass];
+#if HAVE_PTHREAD_SETAFFINITY_NP
+    cpu_set_t mask;
+    int i, eval;
+
+    CPU_ZERO(&mask);
+    if (idx < 0) {
+        for (i = 0; i < sp->ncpus; i++)
+            CPU_SET(sp->cpus[i], &mask);
+    } else {
+        CPU_SET(sp->cpus[idx % sp->ncpus], &mask);
+    }
+    eval = pthread_setaffinity_np(thread_id, sizeof(mask), &mask);
+    if (eval != 0) {
+        errno = eval;
+        return (-1);
+    }
+    return (0);
+#else
+    (void)sp;
+    errno = ENOTSUP;
+    return (-1);
+#endif
+}
+
+struct rtpp_cpusets_runarg {
+    const struct rtpp_cpusets *csp;
+    enum rtpp_tclass tclass;
+    int idx;
+    void (*fn)(void *);
+    void *arg;
+};
+
+static void *
+rtpp_cpusets_runner(void *p)
+{
+    const struct rtpp_cpusets_runarg *rap;
+
+    rap = (const struct rtpp_cpusets_runarg *)p;
+    (void)rtpp_cpusets_apply(rap->csp, rap->tclass, rap->idx, pthread_self());
+    rap->fn(rap->arg);
+    return (NULL);
+}
+
+/*
+ * Run fn(arg) on the CPU(s) the given thread would be pinned to, so that
+ * the memory it allocates and touches first ends up on the same NUMA node
+ * under the default first-touch policy. With no CPU set configured for the
+ * class fn is simply called in the current thread. Returns -1 if a pinned
+ * thread can't be created, fn has still been called in that case.
+ */
+int
+rtpp_cpusets_run_on(const struct rtpp_cpusets *csp, enum rtpp_tclass tclass,
+  int idx, void (*fn)(void *), void *arg)
+{
+    struct rtpp_cpusets_runarg ra = {.csp = csp, .tclass = tclass,
+      .idx = idx, .fn = fn, .arg = arg};
+    pthread_t thread_id;
+
+    if (csp == NULL || csp->cls[tclass].ncpus == 0) {
+        fn(arg);
+        return (0);
+    }
+    if (pthread_create(&thread_id, NULL, &rtpp_cpusets_runner, &ra) != 0) {
+        fn(arg);
+        return (-1);
+    }
+    pthread_join(thread_id, NULL);
+    return (0);
+}
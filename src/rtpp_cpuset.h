@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+/* Thread classes that can be pinned with --cpuset */
+enum rtpp_tclass {
+    RTPP_TCLASS_PROC = 0,   /* RTP/RTCP processing, one pair per media shard */
+    RTPP_TCLASS_SENDER,     /* Async senders, one per media shard */
+    RTPP_TCLASS_CMD,        /* Command acceptor and processing */
+    RTPP_TCLASS_TIMED,      /* Timed tasks */
+    RTPP_TCLASS_WORKER,     /* Module worker threads */
+    RTPP_TCLASS_LEN
+};
+
+struct rtpp_cpuset {
+    int ncpus;
+    int *cpus;
+};
+
+struct rtpp_cpusets {
+    struct rtpp_cpuset cls[RTPP_TCLASS_LEN];
+};
+
+struct rtpp_cpusets *rtpp_cpusets_ctor(void);
+void rtpp_cpusets_dtor(struct rtpp_cpusets *);
+int rtpp_cpusets_parse(struct rtpp_cpusets *, const char *, const char **);
+int rtpp_cpusets_apply(const struct rtpp_cpusets *, enum rtpp_tclass, int,
+  pthread_t);
+int rtpp_cpusets_run_on(const struct rtpp_cpusets *, enum rtpp_tclass, int,
+  void (*)(void *), void *);
@@ -103,6 +103,8 @@ static struct rtpp_hash_table_entry * hash_table_append_str_refcnt(struct rtpp_h
 static void hash_table_remove(struct rtpp_hash_table *self, const void *key, struct rtpp_hash_table_entry * sp);
 static void hash_table_remove_str(struct rtpp_hash_table *self,
   const rtpp_str_t *key, struct rtpp_hash_table_entry * sp);
+static void hash_table_remove_ent(struct rtpp_hash_table *self,
+  struct rtpp_hash_table_entry * sp);
 static struct rtpp_refcnt * hash_table_remove_by_key(struct rtpp_hash_table *self,
   const void *key, struct rtpp_ht_opstats *);
 static struct rtpp_refcnt * hash_table_transfer(struct rtpp_hash_table *self,
@@ -125,6 +127,7 @@ DEFINE_SMETHODS(rtpp_hash_table,
     .append_str_refcnt = &hash_table_append_str_refcnt,
     .remove = &hash_table_remove,
     .remove_str = &hash_table_remove_str,
+    .remove_ent = &hash_table_remove_ent,
     .remove_by_key = &hash_table_remove_by_key,
     .transfer = &hash_table_transfer,
     .find = &hash_table_find,
@@ -505,6 +508,26 @@ hash_table_remove_str(struct rtpp_hash_table *self, const rtpp_str_t *key,
     hash_table_remove_raw(pvt, key->s, key->len, sp);
 }
 
+/*
+ * Same as remove(), but uses the hash saved in the entry at the insertion
+ * time, so that the caller does not need to keep the key around.
+ */
+static void
+hash_table_remove_ent(struct rtpp_hash_table *self,
+  struct rtpp_hash_table_entry *sp)
+{
+    struct rtpp_hash_table_priv *pvt;
+
+    PUB2PVT(self, pvt);
+    pthread_mutex_lock(&pvt->hash_table_lock);
+    hash_table_remove_locked(pvt, sp, sp->hash, NULL);
+    pthread_mutex_unlock(&pvt->hash_table_lock);
+    if (sp->hte_type == rtpp_hte_refcnt_t) {
+        RC_DECREF((struct rtpp_refcnt *)sp->sptr);
+    }
+    free(sp);
+}
+
 static struct rtpp_hash_table_entry *
 hash_table_remove_by_key_raw(struct rtpp_hash_table_priv *pvt, const void *key,
   struct rtpp_ht_opstats *hosp)
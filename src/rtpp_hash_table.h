@@ -53,6 +53,8 @@ DECLARE_METHOD(rtpp_hash_table, hash_table_append_str_refcnt, struct rtpp_hash_t
 DECLARE_METHOD(rtpp_hash_table, hash_table_remove, void, const void *key, struct rtpp_hash_table_entry *sp);
 DECLARE_METHOD(rtpp_hash_table, hash_table_remove_str, void,
   const rtpp_str_t *key, struct rtpp_hash_table_entry *sp);
+DECLARE_METHOD(rtpp_hash_table, hash_table_remove_ent, void,
+  struct rtpp_hash_table_entry *sp);
 DECLARE_METHOD(rtpp_hash_table, hash_table_remove_by_key, struct rtpp_refcnt *,
   const void *key, struct rtpp_ht_opstats *);
 DECLARE_METHOD(rtpp_hash_table, hash_table_transfer, struct rtpp_refcnt *,
@@ -80,6 +82,7 @@ DECLARE_SMETHODS(rtpp_hash_table)
     METHOD_ENTRY(hash_table_append_str_refcnt, append_str_refcnt);
     METHOD_ENTRY(hash_table_remove, remove);
     METHOD_ENTRY(hash_table_remove_str, remove_str);
+    METHOD_ENTRY(hash_table_remove_ent, remove_ent);
     METHOD_ENTRY(hash_table_remove_by_key, remove_by_key);
     METHOD_ENTRY(hash_table_transfer, transfer);
     METHOD_ENTRY(hash_table_find, find);
@@ -0,0 +1,413 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rtpp_types.h"
+#include "rtpp_debug.h"
+#include "rtpp_mallocs.h"
+#include "rtpp_hpool.h"
+
+#if !defined(MAP_ANONYMOUS)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#if defined(rtpp_hpool_selftest)
+#include <errno.h>
+
+static int selftest_nohugetlb;
+
+/* Lets the test pretend that no huge pages are reserved */
+static void *
+selftest_mmap(void *addr, size_t len, int prot, int flags, int fd, off_t off)
+{
+
+#if defined(MAP_HUGETLB)
+    if (selftest_nohugetlb && (flags & MAP_HUGETLB) != 0) {
+        errno = ENOMEM;
+        return (MAP_FAILED);
+    }
+#endif
+    return (mmap(addr, len, prot, flags, fd, off));
+}
+#undef mmap
+#define mmap(...) selftest_mmap(__VA_ARGS__)
+#endif
+
+#define RTPP_HPAGE_SIZE (2 * 1024 * 1024)
+#define RTPP_HPOOL_SALIGN 64
+
+struct rtpp_hpool_slot {
+    struct rtpp_hpool_slot *next;
+};
+
+struct rtpp_hpool_part {
+    pthread_mutex_t lock;
+    struct rtpp_hpool_slot *free;
+    int ninuse;
+    uint64_t nalloc;
+    uint64_t nmiss;
+};
+
+struct rtpp_hpool {
+    /*
+     * One reference for the owner plus one for every partition with slots
+     * handed out, so that the atomic is only touched when a partition
+     * goes from empty to non-empty and back.
+     */
+    _Atomic(int) nrefs;
+    int nparts;
+    int nslots;
+    int pslots;
+    size_t slot_size;
+    /* Partitions start at huge page boundaries, so they never share a page */
+    size_t part_size;
+    void *map;
+    size_t maplen;
+    enum rtpp_hpool_backing backing;
+    struct rtpp_hpool_part parts[];
+};
+
+static void *
+rtpp_hpool_map(size_t len, enum rtpp_hpool_backing *bp)
+{
+    void *mp;
+    size_t hoff;
+
+#if defined(MAP_HUGETLB)
+    mp = mmap(NULL, len, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (mp != MAP_FAILED) {
+        *bp = RTPP_HPOOL_HUGETLB;
+        return (mp);
+    }
+#endif
+    /* Over-map and trim to get the start aligned to the huge page size */
+    mp = mmap(NULL, len + RTPP_HPAGE_SIZE, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mp == MAP_FAILED)
+        return (NULL);
+    hoff = (RTPP_HPAGE_SIZE - ((uintptr_t)mp & (RTPP_HPAGE_SIZE - 1))) &
+      (RTPP_HPAGE_SIZE - 1);
+    if (hoff > 0)
+        munmap(mp, hoff);
+    munmap((char *)mp + hoff + len, RTPP_HPAGE_SIZE - hoff);
+    mp = (char *)mp + hoff;
+    *bp = RTPP_HPOOL_PLAIN;
+#if defined(MADV_HUGEPAGE)
+    if (madvise(mp, len, MADV_HUGEPAGE) == 0)
+        *bp = RTPP_HPOOL_THP;
+#endif
+    return (mp);
+}
+
+struct rtpp_hpool *
+rtpp_hpool_ctor(size_t slot_size, int nslots, int nparts)
+{
+    struct rtpp_hpool *hp;
+    int i, pslots;
+
+    if (nslots <= 0 || nparts <= 0)
+        goto e0;
+    hp = rtpp_zmalloc(sizeof(*hp) + sizeof(hp->parts[0]) * nparts);
+    if (hp == NULL)
+        goto e0;
+    for (i = 0; i < nparts; i++) {
+        if (pthread_mutex_init(&hp->parts[i].lock, NULL) != 0)
+            goto e1;
+    }
+    pslots = (nslots + nparts - 1) / nparts;
+    slot_size = (slot_size + RTPP_HPOOL_SALIGN - 1) & ~(RTPP_HPOOL_SALIGN - 1);
+    hp->part_size = slot_size * pslots;
+    hp->part_size = (hp->part_size + RTPP_HPAGE_SIZE - 1) &
+      ~(RTPP_HPAGE_SIZE - 1);
+    hp->maplen = hp->part_size * nparts;
+    hp->map = rtpp_hpool_map(hp->maplen, &hp->backing);
+    if (hp->map == NULL)
+        goto e1;
+    hp->slot_size = slot_size;
+    hp->pslots = pslots;
+    hp->nparts = nparts;
+    hp->nslots = pslots * nparts;
+    atomic_init(&hp->nrefs, 1);
+    return (hp);
+e1:
+    while (i-- > 0)
+        pthread_mutex_destroy(&hp->parts[i].lock);
+    free(hp);
+e0:
+    return (NULL);
+}
+
+/*
+ * Each partition gets a contiguous range of slots. Fault its pages in and
+ * thread the freelist through them in the reverse order, so that the
+ * allocations start at the beginning of the range and the working set stays
+ * compact under light load. The pages are placed on the NUMA node of the
+ * calling thread.
+ */
+void
+rtpp_hpool_part_init(struct rtpp_hpool *hp, int part)
+{
+    struct rtpp_hpool_part *pp;
+    struct rtpp_hpool_slot *sp;
+    char *cp;
+    int k;
+
+    RTPP_DBG_ASSERT(part >= 0 && part < hp->nparts);
+    pp = &hp->parts[part];
+    RTPP_DBG_ASSERT(pp->free == NULL && pp->nalloc == 0);
+    cp = (char *)hp->map + hp->part_size * part;
+    memset(cp, '\0', hp->slot_size * hp->pslots);
+    cp += hp->slot_size * hp->pslots;
+    for (k = 0; k < hp->pslots; k++) {
+        cp -= hp->slot_size;
+        sp = (struct rtpp_hpool_slot *)cp;
+        sp->next = pp->free;
+        pp->free = sp;
+    }
+}
+
+static void
+rtpp_hpool_unref(struct rtpp_hpool *hp)
+{
+    int i;
+
+    if (atomic_fetch_sub_explicit(&hp->nrefs, 1, memory_order_acq_rel) != 1)
+        return;
+    munmap(hp->map, hp->maplen);
+    for (i = 0; i < hp->nparts; i++)
+        pthread_mutex_destroy(&hp->parts[i].lock);
+    free(hp);
+}
+
+void
+rtpp_hpool_dtor(struct rtpp_hpool *hp)
+{
+
+    rtpp_hpool_unref(hp);
+}
+
+void *
+rtpp_hpool_get(struct rtpp_hpool *hp, int part)
+{
+    struct rtpp_hpool_part *pp;
+    struct rtpp_hpool_slot *sp;
+
+    RTPP_DBG_ASSERT(part >= 0 && part < hp->nparts);
+    pp = &hp->parts[part];
+    pthread_mutex_lock(&pp->lock);
+    sp = pp->free;
+    if (sp == NULL) {
+        pp->nmiss++;
+        pthread_mutex_unlock(&pp->lock);
+        return (NULL);
+    }
+    pp->free = sp->next;
+    if (pp->ninuse++ == 0)
+        atomic_fetch_add_explicit(&hp->nrefs, 1, memory_order_relaxed);
+    pp->nalloc++;
+    pthread_mutex_unlock(&pp->lock);
+    return (sp);
+}
+
+void
+rtpp_hpool_put(struct rtpp_hpool *hp, void *p)
+{
+    struct rtpp_hpool_part *pp;
+    struct rtpp_hpool_slot *sp;
+    int last;
+
+    pp = &hp->parts[((char *)p - (char *)hp->map) / hp->part_size];
+    sp = (struct rtpp_hpool_slot *)p;
+    pthread_mutex_lock(&pp->lock);
+    sp->next = pp->free;
+    pp->free = sp;
+    last = (--pp->ninuse == 0);
+    pthread_mutex_unlock(&pp->lock);
+    if (last)
+        rtpp_hpool_unref(hp);
+}
+
+enum rtpp_hpool_backing
+rtpp_hpool_backing(const struct rtpp_hpool *hp)
+{
+
+    return (hp->backing);
+}
+
+void
+rtpp_hpool_getstats(struct rtpp_hpool *hp, struct rtpp_hpool_stats *hsp)
+{
+    struct rtpp_hpool_part *pp;
+    int i;
+
+    hsp->nalloc = hsp->nmiss = 0;
+    hsp->ninuse = 0;
+    for (i = 0; i < hp->nparts; i++) {
+        pp = &hp->parts[i];
+        pthread_mutex_lock(&pp->lock);
+        hsp->nalloc += pp->nalloc;
+        hsp->nmiss += pp->nmiss;
+        hsp->ninuse += pp->ninuse;
+        pthread_mutex_unlock(&pp->lock);
+    }
+    hsp->nslots = hp->nslots;
+}
+
+#if defined(rtpp_hpool_selftest)
+#include <stdio.h>
+#include <string.h>
+#include "rtpp_memdeb_internal.h"
+#include "libexecinfo/stacktraverse.h"
+#include "libexecinfo/execinfo.h"
+
+#if !defined(NO_ERR_H)
+#include <err.h>
+#endif
+
+#define errx_ifnot(expr) \
+    if (!(expr)) \
+        errx(1, "`%s` check has failed in %s() at %s:%d", #expr, __func__, \
+          __FILE__, __LINE__);
+
+RTPP_MEMDEB_APP_STATIC;
+
+#define HPST_SSIZE  100
+#define HPST_NSLOTS 10
+#define HPST_NPARTS 2
+
+static int
+hpst_ismapped(void *p)
+{
+    uintptr_t pg;
+
+    pg = (uintptr_t)p & ~(uintptr_t)(getpagesize() - 1);
+    return (msync((void *)pg, getpagesize(), MS_ASYNC) == 0);
+}
+
+static void
+hpst_run(void)
+{
+    struct rtpp_hpool *hp;
+    struct rtpp_hpool_stats hps;
+    void *slots[HPST_NPARTS][HPST_NSLOTS / HPST_NPARTS];
+    void *sp, *last;
+    int i, j, k;
+
+    errx_ifnot(rtpp_hpool_ctor(HPST_SSIZE, 0, 1) == NULL);
+    errx_ifnot(rtpp_hpool_ctor(HPST_SSIZE, 1, 0) == NULL);
+
+    hp = rtpp_hpool_ctor(HPST_SSIZE, HPST_NSLOTS, HPST_NPARTS);
+    errx_ifnot(hp != NULL);
+    for (i = 0; i < HPST_NPARTS; i++)
+        rtpp_hpool_part_init(hp, i);
+    if (selftest_nohugetlb)
+        errx_ifnot(rtpp_hpool_backing(hp) != RTPP_HPOOL_HUGETLB);
+    rtpp_hpool_getstats(hp, &hps);
+    errx_ifnot(hps.nslots == HPST_NSLOTS && hps.ninuse == 0);
+
+    /* Drain every partition, slots are aligned, distinct and writable */
+    for (i = 0; i < HPST_NPARTS; i++) {
+        for (j = 0; j < HPST_NSLOTS / HPST_NPARTS; j++) {
+            sp = rtpp_hpool_get(hp, i);
+            errx_ifnot(sp != NULL);
+            errx_ifnot(((uintptr_t)sp & (RTPP_HPOOL_SALIGN - 1)) == 0);
+            memset(sp, i * 16 + j, HPST_SSIZE);
+            slots[i][j] = sp;
+        }
+        /* An empty partition doesn't borrow from its neighbours */
+        errx_ifnot(rtpp_hpool_get(hp, i) == NULL);
+        /* Starts at a huge page boundary, so partitions don't share pages */
+        errx_ifnot(((uintptr_t)slots[i][0] & (RTPP_HPAGE_SIZE - 1)) == 0);
+    }
+    for (i = 0; i < HPST_NPARTS; i++) {
+        for (j = 0; j < HPST_NSLOTS / HPST_NPARTS; j++) {
+            for (k = 0; k < HPST_SSIZE; k++)
+                errx_ifnot(((unsigned char *)slots[i][j])[k] == i * 16 + j);
+        }
+    }
+    rtpp_hpool_getstats(hp, &hps);
+    errx_ifnot(hps.nalloc == HPST_NSLOTS);
+    errx_ifnot(hps.nmiss == HPST_NPARTS);
+    errx_ifnot(hps.ninuse == HPST_NSLOTS);
+
+    /* A slot goes back to the partition it came from */
+    rtpp_hpool_put(hp, slots[1][2]);
+    errx_ifnot(rtpp_hpool_get(hp, 0) == NULL);
+    errx_ifnot(rtpp_hpool_get(hp, 1) == slots[1][2]);
+
+    /* Release everything but one slot, then drop the owner reference */
+    last = slots[0][0];
+    for (i = 0; i < HPST_NPARTS; i++) {
+        for (j = 0; j < HPST_NSLOTS / HPST_NPARTS; j++) {
+            if (slots[i][j] != last)
+                rtpp_hpool_put(hp, slots[i][j]);
+        }
+    }
+    rtpp_hpool_getstats(hp, &hps);
+    errx_ifnot(hps.ninuse == 1);
+    rtpp_hpool_dtor(hp);
+    /* Still mapped while the last slot is out, gone once it's back */
+    errx_ifnot(hpst_ismapped(last));
+    memset(last, 0xff, HPST_SSIZE);
+    rtpp_hpool_put(hp, last);
+    errx_ifnot(!hpst_ismapped(last));
+
+    /* Nothing handed out: released right away */
+    hp = rtpp_hpool_ctor(HPST_SSIZE, HPST_NSLOTS, 1);
+    errx_ifnot(hp != NULL);
+    rtpp_hpool_part_init(hp, 0);
+    sp = rtpp_hpool_get(hp, 0);
+    errx_ifnot(sp != NULL);
+    rtpp_hpool_put(hp, sp);
+    rtpp_hpool_dtor(hp);
+    errx_ifnot(!hpst_ismapped(sp));
+}
+
+int
+rtpp_hpool_selftest(void)
+{
+    int rval;
+
+    RTPP_MEMDEB_APP_INIT();
+
+    /* Whatever the system provides, then with MAP_HUGETLB failing */
+    hpst_run();
+    selftest_nohugetlb = 1;
+    hpst_run();
+
+    rval = rtpp_memdeb_dumpstats(MEMDEB_SYM, 0);
+    return (rval);
+}
+#endif /* rtpp_hpool_selftest */
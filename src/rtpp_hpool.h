@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+/* How the pool memory ended up being backed */
+enum rtpp_hpool_backing {
+    RTPP_HPOOL_HUGETLB = 0, /* MAP_HUGETLB, pre-reserved from hugetlbfs */
+    RTPP_HPOOL_THP,         /* Regular mapping with madvise(MADV_HUGEPAGE) */
+    RTPP_HPOOL_PLAIN        /* Regular pages */
+};
+
+struct rtpp_hpool_stats {
+    uint64_t nalloc;        /* Allocations served from the pool */
+    uint64_t nmiss;         /* Allocations failed due to the pool being empty */
+    int ninuse;             /* Slots currently handed out */
+    int nslots;
+};
+
+struct rtpp_hpool;
+
+/*
+ * The pool is split into a number of partitions, one per media shard, each
+ * with its own lock and freelist. A slot is always returned to the
+ * partition it came from, whichever thread releases it.
+ *
+ * rtpp_hpool_dtor() drops the owner's reference: the memory is released
+ * right away if no slots are handed out, or by the rtpp_hpool_put() that
+ * returns the last one otherwise.
+ */
+struct rtpp_hpool *rtpp_hpool_ctor(size_t, int, int);
+/* Has to be called once for each partition before it is used, see main.c */
+void rtpp_hpool_part_init(struct rtpp_hpool *, int);
+void rtpp_hpool_dtor(struct rtpp_hpool *);
+void *rtpp_hpool_get(struct rtpp_hpool *, int);
+void rtpp_hpool_put(struct rtpp_hpool *, void *);
+enum rtpp_hpool_backing rtpp_hpool_backing(const struct rtpp_hpool *);
+void rtpp_hpool_getstats(struct rtpp_hpool *, struct rtpp_hpool_stats *);
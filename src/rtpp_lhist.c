@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "rtpp_lhist.h"
+
+void
+rtpp_lhist_merge(struct rtpp_lhist *dst, const struct rtpp_lhist *src)
+{
+    int i;
+
+    for (i = 0; i < RTPP_LHIST_NBKTS; i++)
+        dst->bkts[i] += src->bkts[i];
+    dst->cnt += src->cnt;
+    if (src->max > dst->max)
+        dst->max = src->max;
+}
+
+void
+rtpp_lhist_reset(struct rtpp_lhist *hp)
+{
+
+    memset(hp, '\0', sizeof(*hp));
+}
+
+/*
+ * Returns an approximate value (mid-point of the bucket) in microseconds
+ * below which the specified fraction of recorded samples falls.
+ */
+uint64_t
+rtpp_lhist_pctl(const struct rtpp_lhist *hp, double pct)
+{
+    uint64_t thres, acc, lo, width;
+    int i, mag, sub;
+
+    if (hp->cnt == 0)
+        return (0);
+    thres = (uint64_t)(pct * (double)hp->cnt);
+    if (thres == 0)
+        thres = 1;
+    acc = 0;
+    for (i = 0; i < RTPP_LHIST_NBKTS; i++) {
+        acc += hp->bkts[i];
+        if (acc >= thres)
+            break;
+    }
+    if (i < RTPP_LHIST_SUBB)
+        return (i);
+    mag = i / RTPP_LHIST_SUBB + RTPP_LHIST_SUBB_BITS - 1;
+    sub = i % RTPP_LHIST_SUBB;
+    width = 1ULL << (mag - RTPP_LHIST_SUBB_BITS);
+    lo = (uint64_t)(RTPP_LHIST_SUBB + sub) * width;
+    lo += width / 2;
+    return ((lo > hp->max) ? hp->max : lo);
+}
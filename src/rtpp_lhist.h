@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#ifndef _RTPP_LHIST_H_
+#define _RTPP_LHIST_H_
+
+/*
+ * Compact log-linear latency histogram. Values are recorded in
+ * microseconds, each power of two is split into RTPP_LHIST_SUBB linear
+ * sub-buckets, which gives about 12% worst-case precision over the range
+ * from 1us to ~30s. Recording is single-writer and lock-free, the owner
+ * thread periodically merges its local copy into the shared one kept by
+ * the rtpp_stats.
+ */
+
+#define RTPP_LHIST_SUBB_BITS 3
+#define RTPP_LHIST_SUBB      (1 << RTPP_LHIST_SUBB_BITS)
+#define RTPP_LHIST_MAXMAG    24
+#define RTPP_LHIST_NBKTS     ((RTPP_LHIST_MAXMAG - RTPP_LHIST_SUBB_BITS + 2) * \
+  RTPP_LHIST_SUBB)
+
+struct rtpp_lhist {
+    uint64_t cnt;
+    uint64_t max;
+    uint64_t bkts[RTPP_LHIST_NBKTS];
+};
+
+static inline int
+rtpp_lhist_bidx(uint64_t v)
+{
+    int mag;
+
+    if (v < RTPP_LHIST_SUBB)
+        return ((int)v);
+    mag = 63 - __builtin_clzll(v);
+    if (mag > RTPP_LHIST_MAXMAG)
+        return (RTPP_LHIST_NBKTS - 1);
+    return ((mag - RTPP_LHIST_SUBB_BITS + 1) * RTPP_LHIST_SUBB +
+      (int)((v >> (mag - RTPP_LHIST_SUBB_BITS)) & (RTPP_LHIST_SUBB - 1)));
+}
+
+static inline void
+rtpp_lhist_reg(struct rtpp_lhist *hp, double lat)
+{
+    uint64_t v;
+
+    v = (lat > 0.0) ? (uint64_t)(lat * 1e6) : 0;
+    hp->bkts[rtpp_lhist_bidx(v)]++;
+    hp->cnt++;
+    if (v > hp->max)
+        hp->max = v;
+}
+
+void rtpp_lhist_merge(struct rtpp_lhist *, const struct rtpp_lhist *);
+void rtpp_lhist_reset(struct rtpp_lhist *);
+uint64_t rtpp_lhist_pctl(const struct rtpp_lhist *, double);
+
+#endif /* _RTPP_LHIST_H_ */
@@ -54,6 +54,13 @@ struct rtpp_log {
 
 struct rtpp_log *rtpp_log_ctor(const char *, const char *, int);
 
+/*
+ * In the background mode every RTPP_LOG()/RTPP_ELOG() callsite may send up
+ * to 50 messages per second to syslog, the excess is dropped and reported
+ * as "N similar message(s) suppressed" later on. The limit can be changed
+ * by setting the RTPP_LOG_RLIMIT environment variable, 0 disables it.
+ * Foreground logging to stderr is never rate limited.
+ */
 #define RTPP_LOG(log, args...) CALL_METHOD((log), genwrite, __FUNCTION__, \
   __LINE__, ## args)
 #define RTPP_ELOG(log, args...) CALL_METHOD((log), errwrite, __FUNCTION__, \
@@ -30,6 +30,7 @@
 #include <math.h>
 #include <syslog.h>
 #include <stdatomic.h>
+#include <stdint.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -51,6 +52,31 @@
 
 #ifdef RTPP_LOG_ADVANCED
 static _Atomic(int) syslog_async_opened = (0);
+
+/*
+ * Per-callsite rate limit for the syslog path: each (function, line) pair
+ * is allowed to emit up to rl_burst messages per second, the rest is
+ * counted and reported either by the next message from the same site or
+ * by the syslog thread, which sweeps the table once it is idle and before
+ * exiting. The callsite table is fixed-size and lock-free, a site that
+ * loses the race for the hash slot is simply not limited.
+ */
+#define RTPP_LOG_RL_SLOTS 1024 /* must be power of 2 */
+#define RTPP_LOG_RL_BURST 50
+
+struct rtpp_log_rlent {
+    _Atomic(uintptr_t) key;
+    _Atomic(uint64_t) state; /* second << 32 | count */
+    /* Set once by the thread that claims the slot, for the sweep */
+    int lnum;
+    int level;
+    _Atomic(const char *) function;
+};
+
+static struct rtpp_log_rlent rl_tbl[RTPP_LOG_RL_SLOTS];
+static unsigned int rl_burst = RTPP_LOG_RL_BURST;
+
+static void rtpp_log_rl_sweep(int);
 #endif
 static double iitime = 0.0;
 
@@ -86,7 +112,12 @@ _rtpp_log_open(const struct rtpp_cfg *cf, const char *app, const char *call_id)
 	facility = LOG_DAEMON;
 
     if (cf->ropts.no_daemon == 0 && atomic_load(&syslog_async_opened) == 0) {
-	if (syslog_async_init(app, facility) == 0) {
+        const char *rlimit;
+
+        rlimit = getenv("RTPP_LOG_RLIMIT");
+        if (rlimit != NULL)
+            rl_burst = strtoul(rlimit, NULL, 10);
+	if (syslog_async_init(app, facility, rtpp_log_rl_sweep) == 0) {
 	    atomic_store(&syslog_async_opened, 1);
         } else {
             return (NULL);
@@ -243,15 +274,132 @@ _rtpp_log_unlock(void)
       memory_order_release);
 }
 
+#ifdef RTPP_LOG_ADVANCED
+static int
+rtpp_log_ratelimit(int level, const char *function, int lnum,
+  unsigned int *nsupp)
+{
+    struct rtpp_log_rlent *rlp;
+    uintptr_t key, okey;
+    uint64_t ostate, nstate;
+    uint32_t now, ocnt;
+
+    *nsupp = 0;
+    if (rl_burst == 0)
+        return (1);
+    key = (uintptr_t)function ^ ((uintptr_t)lnum << 1);
+    rlp = &rl_tbl[(key ^ (key >> 12) ^ ((uintptr_t)lnum * 2654435761u)) &
+      (RTPP_LOG_RL_SLOTS - 1)];
+    okey = atomic_load_explicit(&rlp->key, memory_order_relaxed);
+    if (okey != key) {
+        if (okey != 0)
+            return (1);
+        if (!atomic_compare_exchange_strong(&rlp->key, &okey, key)) {
+            if (okey != key)
+                return (1);
+        } else {
+            rlp->lnum = lnum;
+            rlp->level = level;
+            atomic_store_explicit(&rlp->function, function,
+              memory_order_release);
+        }
+    }
+    now = (uint32_t)getdtime();
+    ostate = atomic_load_explicit(&rlp->state, memory_order_relaxed);
+    do {
+        ocnt = (uint32_t)ostate;
+        if ((uint32_t)(ostate >> 32) != now) {
+            nstate = ((uint64_t)now << 32) | 1;
+        } else {
+            nstate = ostate + 1;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&rlp->state, &ostate,
+      nstate, memory_order_relaxed, memory_order_relaxed));
+    if ((uint32_t)(ostate >> 32) != now && ocnt > rl_burst)
+        *nsupp = ocnt - rl_burst;
+    return ((uint32_t)nstate <= rl_burst);
+}
+
+/*
+ * Only the arguments are recorded on the calling thread, the message is
+ * rendered by the syslog thread, see rtpp_syslog_async.c.
+ */
+static struct syslog_async_msg *
+rtpp_log_syslog_begin(int level, const char *pfmt, const char *call_id,
+  const char *function, int lnum)
+{
+    struct syslog_async_msg *msg;
+
+    msg = syslog_async_begin(level);
+    syslog_async_add(msg, pfmt, strlvl(level), call_id, function, lnum);
+    return (msg);
+}
+
+static void
+rtpp_log_syslog_nsupp(int level, const char *pfmt, const char *call_id,
+  const char *function, int lnum, unsigned int nsupp)
+{
+    struct syslog_async_msg *msg;
+
+    msg = rtpp_log_syslog_begin(level, pfmt, call_id, function, lnum);
+    syslog_async_add(msg, "%u similar message(s) suppressed", nsupp);
+    syslog_async_commit(msg);
+}
+
+/*
+ * Reports the messages suppressed during the past seconds by the sites
+ * that have gone quiet since, or all of them when the syslog thread is
+ * about to exit. Only ever called from the syslog thread.
+ */
+static void
+rtpp_log_rl_sweep(int final)
+{
+    static uint32_t last_sweep;
+    struct rtpp_log_rlent *rlp;
+    const char *function;
+    uint64_t ostate, nstate;
+    uint32_t now, ocnt;
+    int i;
+
+    if (rl_burst == 0)
+        return;
+    now = (uint32_t)getdtime();
+    if (!final && now == last_sweep)
+        return;
+    last_sweep = now;
+    for (i = 0; i < RTPP_LOG_RL_SLOTS; i++) {
+        rlp = &rl_tbl[i];
+        function = atomic_load_explicit(&rlp->function, memory_order_acquire);
+        if (function == NULL)
+            continue;
+        ostate = atomic_load_explicit(&rlp->state, memory_order_relaxed);
+        do {
+            ocnt = (uint32_t)ostate;
+            if (ocnt <= rl_burst || (!final && (uint32_t)(ostate >> 32) == now))
+                break;
+            /* Leave the burst used up, so the count is only reported once */
+            nstate = (ostate & ~(uint64_t)UINT32_MAX) | rl_burst;
+        } while (!atomic_compare_exchange_weak_explicit(&rlp->state, &ostate,
+          nstate, memory_order_relaxed, memory_order_relaxed));
+        if (ocnt <= rl_burst || (!final && (uint32_t)(ostate >> 32) == now))
+            continue;
+        rtpp_log_syslog_nsupp(rlp->level, "%s:%s:%s:%d: ", CALL_ID_NONE,
+          function, rlp->lnum, ocnt - rl_burst);
+    }
+}
+#endif
+
 void
 _rtpp_log_write_va(struct rtpp_log_inst *rli, int level, const char *function,
   int lnum, const char *format, va_list ap)
 {
-    char rtpp_log_buff[2048];
     char rtpp_time_buff[32];
     const char *call_id;
 #ifdef RTPP_LOG_ADVANCED
+    struct syslog_async_msg *msg;
     va_list apc;
+    unsigned int nsupp;
+    int pass;
 #endif
 
     if (check_level(rli, level) == 0)
@@ -265,11 +413,20 @@ _rtpp_log_write_va(struct rtpp_log_inst *rli, int level, const char *function,
 
 #ifdef RTPP_LOG_ADVANCED
     if (atomic_load(&syslog_async_opened) != 0) {
-        snprintf(rtpp_log_buff, sizeof(rtpp_log_buff), rli->format_sl[0],
-          strlvl(level), call_id, function, lnum);
-        va_copy(apc, ap);
-	vsyslog_async(level, rtpp_log_buff, rli->format_sl[1], format, apc);
-        va_end(apc);
+        pass = rtpp_log_ratelimit(level, function, lnum, &nsupp);
+        if (nsupp != 0)
+            rtpp_log_syslog_nsupp(level, rli->format_sl[0], call_id, function,
+              lnum, nsupp);
+        if (pass) {
+            msg = rtpp_log_syslog_begin(level, rli->format_sl[0], call_id,
+              function, lnum);
+            va_copy(apc, ap);
+            syslog_async_vadd(msg, format, apc);
+            va_end(apc);
+            if (rli->format_sl[1] != NULL)
+                syslog_async_add(msg, "%s", rli->format_sl[1]);
+            syslog_async_commit(msg);
+        }
 #if !defined(RTPP_DEBUG)
         return;
 #endif
@@ -290,17 +447,20 @@ void
 _rtpp_log_ewrite_va(struct rtpp_log_inst *rli, int level, const char *function,
   int lnum, const char *format, va_list ap)
 {
-    char rtpp_log_buff[2048];
     char rtpp_time_buff[32];
     const char *call_id;
+    int serrno;
 #ifdef RTPP_LOG_ADVANCED
+    struct syslog_async_msg *msg;
     va_list apc;
-    char *post;
+    unsigned int nsupp;
+    int pass;
 #endif
     
     if (check_level(rli, level) == 0)
 	return;
 
+    serrno = errno;
     if (rli->call_id != NULL) {
         call_id = rli->call_id;
     } else {
@@ -309,21 +469,19 @@ _rtpp_log_ewrite_va(struct rtpp_log_inst *rli, int level, const char *function,
 
 #ifdef RTPP_LOG_ADVANCED
     if (atomic_load(&syslog_async_opened) != 0) {
-        int nch, m;
-
-        m = sizeof(rtpp_log_buff);
-        nch = snprintf(rtpp_log_buff, m, rli->eformat_sl[0],
-          strlvl(level), call_id, function, lnum);
-        nch += 1;
-        post = " TRUNCATED! ";
-        if (nch < m) {
-            post = rtpp_log_buff + nch;
-            snprintf(post, m - nch, rli->eformat_sl[1],
-              strerror(errno), errno);
+        pass = rtpp_log_ratelimit(level, function, lnum, &nsupp);
+        if (nsupp != 0)
+            rtpp_log_syslog_nsupp(level, rli->eformat_sl[0], call_id, function,
+              lnum, nsupp);
+        if (pass) {
+            msg = rtpp_log_syslog_begin(level, rli->eformat_sl[0], call_id,
+              function, lnum);
+            va_copy(apc, ap);
+            syslog_async_vadd(msg, format, apc);
+            va_end(apc);
+            syslog_async_add(msg, rli->eformat_sl[1], strerror(serrno), serrno);
+            syslog_async_commit(msg);
         }
-        va_copy(apc, ap);
-	vsyslog_async(level, rtpp_log_buff, post, format, apc);
-        va_end(apc);
 #if !defined(RTPP_DEBUG)
 	return;
 #endif
@@ -334,7 +492,7 @@ _rtpp_log_ewrite_va(struct rtpp_log_inst *rli, int level, const char *function,
     fprintf(stderr, rli->eformat_se[0], rtpp_time_buff, strlvl(level), call_id,
       function, lnum);
     vfprintf(stderr, format, ap);
-    fprintf(stderr, rli->eformat_se[1], strerror(errno), errno);
+    fprintf(stderr, rli->eformat_se[1], strerror(serrno), serrno);
     fflush(stderr);
     _rtpp_log_unlock();
 }
@@ -129,3 +129,30 @@ rtpp_rmalloc_memdeb(size_t msize, size_t rcntp_offs, void *memdeb_p,
 
     return (rval);
 }
+
+size_t
+rtpp_rsize(size_t msize)
+{
+    size_t pad_size;
+
+    size_t norm_off = offsetof(struct alig_help, b);
+    pad_size = (norm_off - msize) & (norm_off - 1);
+    return (msize + pad_size + rtpp_refcnt_osize);
+}
+
+void *
+rtpp_rzinit(void *rval, size_t msize, size_t rcntp_offs)
+{
+    struct rtpp_refcnt *rcnt;
+    size_t asize;
+    void *rco;
+
+    RTPP_DBG_ASSERT(msize >= rcntp_offs + sizeof(struct rtpp_refcnt *));
+    asize = rtpp_rsize(msize);
+    memset(rval, '\0', asize);
+    rco = (char *)rval + asize - rtpp_refcnt_osize;
+    rcnt = rtpp_refcnt_ctor_pa(rco);
+    *PpP(rval, rcntp_offs, struct rtpp_refcnt **) = rcnt;
+
+    return (rval);
+}
@@ -51,4 +51,18 @@ void *rtpp_rmalloc_memdeb(size_t, size_t, void *, HERETYPE);
 void *rtpp_rmalloc(size_t, size_t);
 #endif
 
+/*
+ * Same as rtpp_rzmalloc(), but initializes caller-supplied storage of at
+ * least rtpp_rsize() bytes instead of allocating it. The caller is
+ * responsible for attaching a dtor that gives the storage back.
+ */
+size_t rtpp_rsize(size_t);
+void *rtpp_rzinit(void *, size_t, size_t);
+
+/*
+ * Rounds size up to the alignment guaranteed by the allocators above, for
+ * laying out several objects in a single allocation.
+ */
+#define RTPP_MALIGN(s) (((s) + sizeof(intmax_t) - 1) & ~(sizeof(intmax_t) - 1))
+
 #endif
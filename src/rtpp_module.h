@@ -27,7 +27,7 @@
 
 #pragma once
 
-#define MODULE_API_REVISION 11
+#define MODULE_API_REVISION 12
 
 struct rtpp_cfg;
 struct rtpp_module_priv;
@@ -35,6 +35,8 @@ DEFINE_METHOD(rtpp_module_priv, rtpp_module_on_session_end, void,
   struct rtpp_acct *);
 DEFINE_METHOD(rtpp_module_priv, rtpp_module_on_rtcp_rcvd, void,
   struct rtpp_acct_rtcp *);
+DEFINE_METHOD(rtpp_module_priv, rtpp_module_on_acct_idle, void);
+DEFINE_METHOD(rtpp_module_priv, rtpp_module_rtcp_wanted, int, const char *);
 
 #define AAPI_FUNC(fname, asize) {.func = (fname), .argsize = (asize)}
 
@@ -48,9 +50,28 @@ struct api_on_rtcp_rcvd {
    rtpp_module_on_rtcp_rcvd_t func;
 };
 
+struct api_on_acct_idle {
+   rtpp_module_on_acct_idle_t func;
+};
+
+struct api_rtcp_wanted {
+   rtpp_module_rtcp_wanted_t func;
+};
+
 struct rtpp_acct_handlers {
     struct api_on_sess_end on_session_end;
     struct api_on_rtcp_rcvd on_rtcp_rcvd;
+    /*
+     * Called once the accounting queue has been drained, modules that
+     * batch their output should flush it here.
+     */
+    struct api_on_acct_idle on_idle;
+    /*
+     * Called with the call-id from the packet processing threads, before
+     * the RTCP report is copied and queued for on_rtcp_rcvd(). Returning
+     * 0 skips the report. Must not block or modify module state.
+     */
+    struct api_rtcp_wanted rtcp_wanted;
 };
 
 #endif /* _RTPP_MODULE_ACCT_H */
@@ -78,8 +78,11 @@
 #include "rtpp_command_sub.h"
 #include "rtpp_command.h"
 #include "rtpp_command_args.h"
+#include "rtpp_syslog_async.h"
 #include "rtpp_command_private.h"
 #include "rtpp_refproxy.h"
+#include "rtpp_tload.h"
+#include "rtpp_cpuset.h"
 #ifdef RTPP_CHECK_LEAKS
 #include "rtpp_memdeb_internal.h"
 #endif
@@ -98,6 +101,7 @@ struct rtpp_module_if_priv {
     /* Privary version of the module's memdeb_p, store it here */
     /* just in case module screws it up                        */
     void *memdeb_p;
+    struct rtpp_tload_ent *tlp;
     int started;
     char mpath[0];
 };
@@ -196,6 +200,11 @@ acct_rtcp_enqueue(const struct pkt_proc_ctx *pktx)
     sessp = CALL_SMETHOD(pvt->sessions_wrt, get_by_idx, pktx->strmp_in->seuid);
     if (sessp == NULL)
        return (PPROC_ACT_DROP);
+    if (pvt->mip->aapi->rtcp_wanted.func != NULL &&
+      pvt->mip->aapi->rtcp_wanted.func(pvt->mpvt, sessp->call_id->s) == 0) {
+        RTPP_OBJ_DECREF(sessp);
+        return (PPROC_ACT_NOP);
+    }
     rarp = rtpp_acct_rtcp_ctor(sessp->call_id->s, pktx->pktp);
     RTPP_OBJ_DECREF(sessp);
     if (rarp == NULL) {
@@ -329,8 +338,10 @@ e3:
     rtpp_memdeb_dtor(pvt->memdeb_p);
 #endif
 e2:
-    if (pvt->dmp != NULL)
+    if (pvt->dmp != NULL) {
+        syslog_async_drain();
         dlclose(pvt->dmp);
+    }
     pvt->mip = NULL;
 e1:
     return (-1);
@@ -364,6 +375,9 @@ rtpp_mif_kaput(struct rtpp_module_if *self)
         /* First, wait for worker thread to terminate */
         pthread_join(pvt->mip->wthr.thread_id, NULL);
     }
+    if (pvt->tlp != NULL) {
+        CALL_SMETHOD(pvt->tlp->owner, unreg, pvt->tlp);
+    }
     if (pvt->mip != NULL) {
         rtpp_queue_destroy(pvt->mip->wthr.mod_q);
         /* Then run module destructor (if any) */
@@ -382,9 +396,11 @@ rtpp_mif_kaput(struct rtpp_module_if *self)
         rtpp_memdeb_dtor(pvt->memdeb_p);
 #endif
     }
-    /* Unload and free everything */
-    if (pvt->dmp != NULL)
+    /* Unload and free everything, the formats go away with the module */
+    if (pvt->dmp != NULL) {
+        syslog_async_drain();
         dlclose(pvt->dmp);
+    }
     free(pvt);
 }
 
@@ -396,11 +412,15 @@ rtpp_mif_run_acct(void *argp)
     int signum;
     const char *aname;
     const struct rtpp_acct_handlers *aap;
+    unsigned int nitems = 0;
 
     pvt = (struct rtpp_module_if_priv *)argp;
     aap = pvt->mip->aapi;
     for (;;) {
+        rtpp_tload_sleep(pvt->tlp, getdtime(), nitems);
         wi = rtpp_queue_get_item(pvt->mip->wthr.mod_q, 0);
+        rtpp_tload_wake(pvt->tlp, getdtime());
+        nitems = 1;
         if (rtpp_wi_get_type(wi) == RTPP_WI_TYPE_SGNL) {
             signum = rtpp_wi_sgnl_get_signum(wi);
             RTPP_OBJ_DECREF(wi);
@@ -427,6 +447,9 @@ rtpp_mif_run_acct(void *argp)
             RTPP_OBJ_DECREF(rapr);
         }
         RTPP_OBJ_DECREF(wi);
+        if (aap->on_idle.func != NULL &&
+          rtpp_queue_get_length(pvt->mip->wthr.mod_q) == 0)
+            aap->on_idle.func(pvt->mpvt);
     }
 }
 
@@ -522,8 +545,17 @@ rtpp_mif_start(struct rtpp_module_if *self, const struct rtpp_cfg *cfsp)
             if (CALL_SMETHOD(cfsp->pproc_manager, reg, PPROC_ORD_WITNESS, &acct_rtcp_poi) < 0)
                 return (-1);
         }
+        char tname[128];
+
+        snprintf(tname, sizeof(tname), "rtpp_module: %s", pvt->mip->descr.name);
+        pvt->tlp = CALL_SMETHOD(cfsp->rtpp_tload, reg, tname,
+          pvt->mip->wthr.mod_q);
         if (pthread_create(&pvt->mip->wthr.thread_id, NULL,
           PTH_CB(&rtpp_mif_run_acct), pvt) != 0) {
+            if (pvt->tlp != NULL) {
+                CALL_SMETHOD(pvt->tlp->owner, unreg, pvt->tlp);
+                pvt->tlp = NULL;
+            }
             return (-1);
         }
     } else {
@@ -536,6 +568,10 @@ rtpp_mif_start(struct rtpp_module_if *self, const struct rtpp_cfg *cfsp)
 #if HAVE_PTHREAD_SETNAME_NP
     (void)pthread_setname_np(pvt->mip->wthr.thread_id, pvt->mip->descr.name);
 #endif
+    if (rtpp_cpusets_apply(cfsp->cpusets, RTPP_TCLASS_WORKER, -1,
+      pvt->mip->wthr.thread_id) != 0)
+        RTPP_ELOG(cfsp->glog, RTPP_LOG_ERR, "%s: can't set CPU affinity for "
+          "the worker thread", pvt->mip->descr.name);
     pvt->started = 1;
     return (0);
 }
@@ -28,11 +28,13 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "config.h"
 #include "rtpp_types.h"
 #include "rtpp_codeptr.h"
 #include "rtpp_refcnt.h"
@@ -42,12 +44,20 @@
 #include "rtpp_network.h"
 #include "rtpp_debug.h"
 
+/*
+ * The address only changes on (re-)latch, while it is checked for every
+ * packet received. Writers serialize on the lock and bump the seq around
+ * the update, so the readers go lock-free and just retry if they happen
+ * to race with the update (seqlock).
+ */
 struct rtpp_netaddr_priv {
     struct rtpp_netaddr pub;
     struct sockaddr_storage sas;
     socklen_t rlen;
+    _Atomic(unsigned int) seq;
     pthread_mutex_t lock;
 };
+const size_t rtpp_netaddr_osize = sizeof(struct rtpp_netaddr_priv);
 
 static void rtpp_netaddr_set(struct rtpp_netaddr *, const struct sockaddr *, size_t);
 static void rtpp_netaddr_dtor(struct rtpp_netaddr_priv *);
@@ -94,17 +104,81 @@ e0:
     return (NULL);
 }
 
+struct rtpp_netaddr *
+rtpp_netaddr_ctor_pa(void *pap, struct rtpp_refcnt *rcnt)
+{
+    struct rtpp_netaddr_priv *pvt;
+
+    pvt = (struct rtpp_netaddr_priv *)pap;
+    if (pthread_mutex_init(&pvt->lock, NULL) != 0) {
+        return (NULL);
+    }
+    pvt->pub.rcnt = rcnt;
+#if defined(RTPP_DEBUG)
+    pvt->pub.smethods = GET_SMETHODS(&pvt->pub);
+#endif
+    return ((&pvt->pub));
+}
+
+void
+rtpp_netaddr_dtor_pa(struct rtpp_netaddr *pub)
+{
+    struct rtpp_netaddr_priv *pvt;
+
+    PUB2PVT(pub, pvt);
+    rtpp_netaddr_fin(pub);
+    pthread_mutex_destroy(&pvt->lock);
+}
+
+static inline unsigned int
+rtpp_netaddr_rbegin(struct rtpp_netaddr_priv *pvt)
+{
+    unsigned int seq;
+
+    while ((seq = atomic_load_explicit(&pvt->seq, memory_order_acquire)) & 1)
+        continue;
+    return (seq);
+}
+
+static inline int
+rtpp_netaddr_rretry(struct rtpp_netaddr_priv *pvt, unsigned int seq)
+{
+
+    atomic_thread_fence(memory_order_acquire);
+    return (atomic_load_explicit(&pvt->seq, memory_order_relaxed) != seq);
+}
+
+/* Consistent copy of the address, returns its length */
+static socklen_t
+rtpp_netaddr_snap(struct rtpp_netaddr_priv *pvt, struct sockaddr_storage *sasp)
+{
+    unsigned int seq;
+    socklen_t rlen;
+
+    do {
+        seq = rtpp_netaddr_rbegin(pvt);
+        rlen = pvt->rlen;
+        memcpy(sasp, &pvt->sas, sizeof(pvt->sas));
+    } while (rtpp_netaddr_rretry(pvt, seq));
+    return (rlen);
+}
+
 static void
 rtpp_netaddr_set(struct rtpp_netaddr *self, const struct sockaddr *addr, size_t alen)
 {
     struct rtpp_netaddr_priv *pvt;
+    unsigned int seq;
 
     PUB2PVT(self, pvt);
     RTPP_DBG_ASSERT(alen <= sizeof(pvt->sas));
 
     pthread_mutex_lock(&pvt->lock);
+    seq = atomic_load_explicit(&pvt->seq, memory_order_relaxed);
+    atomic_store_explicit(&pvt->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
     memcpy(&pvt->sas, addr, alen);
     pvt->rlen = alen;
+    atomic_store_explicit(&pvt->seq, seq + 2, memory_order_release);
     pthread_mutex_unlock(&pvt->lock);
 }
 
@@ -121,13 +195,15 @@ static int
 rtpp_netaddr_isempty(struct rtpp_netaddr *self)
 {
     struct rtpp_netaddr_priv *pvt;
+    unsigned int seq;
     int rval;
 
     RTPP_DBG_ASSERT(self != NULL);
     PUB2PVT(self, pvt);
-    pthread_mutex_lock(&pvt->lock);
-    rval = (pvt->rlen == 0);
-    pthread_mutex_unlock(&pvt->lock);
+    do {
+        seq = rtpp_netaddr_rbegin(pvt);
+        rval = (pvt->rlen == 0);
+    } while (rtpp_netaddr_rretry(pvt, seq));
     return (rval);
 }
 
@@ -135,18 +211,19 @@ static int
 rtpp_netaddr_cmp(struct rtpp_netaddr *self, const struct sockaddr *sap, size_t salen)
 {
     struct rtpp_netaddr_priv *pvt;
+    unsigned int seq;
     int rval;
 
     PUB2PVT(self, pvt);
     RTPP_DBG_ASSERT(salen <= sizeof(pvt->sas));
-    pthread_mutex_lock(&pvt->lock);
-    if (salen != pvt->rlen) {
-        rval = -1;
-        goto unlock_and_return;
-    }
-    rval = memcmp(&pvt->sas, sap, salen);
-unlock_and_return:
-    pthread_mutex_unlock(&pvt->lock);
+    do {
+        seq = rtpp_netaddr_rbegin(pvt);
+        if (salen != pvt->rlen) {
+            rval = -1;
+            continue;
+        }
+        rval = memcmp(&pvt->sas, sap, salen);
+    } while (rtpp_netaddr_rretry(pvt, seq));
     return (rval);
 }
 
@@ -154,28 +231,26 @@ static int
 rtpp_netaddr_isaddrseq(struct rtpp_netaddr *self, const struct sockaddr *sap)
 {
     struct rtpp_netaddr_priv *pvt;
-    int rval;
+    struct sockaddr_storage sas;
+    MAYBE_UNUSED socklen_t rlen;
 
     PUB2PVT(self, pvt);
-    pthread_mutex_lock(&pvt->lock);
-    RTPP_DBG_ASSERT(pvt->rlen > 0);
-    rval = isaddrseq(sstosa(&pvt->sas), sap);
-    pthread_mutex_unlock(&pvt->lock);
-    return (rval);
+    rlen = rtpp_netaddr_snap(pvt, &sas);
+    RTPP_DBG_ASSERT(rlen > 0);
+    return (isaddrseq(sstosa(&sas), sap));
 }
 
 static int
 rtpp_netaddr_cmphost(struct rtpp_netaddr *self, const struct sockaddr *sap)
 {
     struct rtpp_netaddr_priv *pvt;
-    int rval;
+    struct sockaddr_storage sas;
+    MAYBE_UNUSED socklen_t rlen;
 
     PUB2PVT(self, pvt);
-    pthread_mutex_lock(&pvt->lock);
-    RTPP_DBG_ASSERT(pvt->rlen > 0);
-    rval = ishostseq(sstosa(&pvt->sas), sap);
-    pthread_mutex_unlock(&pvt->lock);
-    return (rval);
+    rlen = rtpp_netaddr_snap(pvt, &sas);
+    RTPP_DBG_ASSERT(rlen > 0);
+    return (ishostseq(sstosa(&sas), sap));
 }
 
 static void
@@ -192,13 +267,14 @@ static size_t
 rtpp_netaddr_get(struct rtpp_netaddr *self, struct sockaddr *sap, size_t salen)
 {
     struct rtpp_netaddr_priv *pvt;
+    struct sockaddr_storage sas;
+    socklen_t rlen;
 
     PUB2PVT(self, pvt);
-    pthread_mutex_lock(&pvt->lock);
-    RTPP_DBG_ASSERT((salen >= pvt->rlen) && (pvt->rlen > 0));
-    memcpy(sap, &pvt->sas, pvt->rlen);
-    pthread_mutex_unlock(&pvt->lock);
-    return (pvt->rlen);
+    rlen = rtpp_netaddr_snap(pvt, &sas);
+    RTPP_DBG_ASSERT((salen >= rlen) && (rlen > 0));
+    memcpy(sap, &sas, rlen);
+    return (rlen);
 }
 
 static size_t
@@ -29,6 +29,7 @@
 #pragma once
 
 struct sockaddr;
+struct rtpp_refcnt;
 DECLARE_CLASS(rtpp_netaddr, void) RTPP_EXPORT;
 
 DECLARE_METHOD(rtpp_netaddr, rtpp_netaddr_set, void, const struct sockaddr *,
@@ -58,3 +59,12 @@ DECLARE_SMETHODS(rtpp_netaddr) {
 };
 
 DECLARE_CLASS_PUBTYPE(rtpp_netaddr, {});
+
+/*
+ * Pre-allocated variant for an address embedded into its owner: both the
+ * storage (rtpp_netaddr_osize bytes, zeroed) and the reference counter
+ * belong to the owner, and the owner's destructor calls _dtor_pa().
+ */
+extern const size_t rtpp_netaddr_osize;
+struct rtpp_netaddr *rtpp_netaddr_ctor_pa(void *, struct rtpp_refcnt *);
+void rtpp_netaddr_dtor_pa(struct rtpp_netaddr *);
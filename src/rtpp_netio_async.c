@@ -37,6 +37,7 @@
 #include <signal.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -61,6 +62,11 @@
 #include "rtpp_netio_async.h"
 #include "rtpp_mallocs.h"
 #include "rtpp_debug.h"
+#include "rtpp_stats.h"
+#include "rtpp_lhist.h"
+#include "rtpp_proc.h"
+#include "rtpp_tload.h"
+#include "rtpp_cpuset.h"
 #ifdef RTPP_DEBUG_timers
 #include "rtpp_time.h"
 #include "rtpp_math.h"
@@ -69,6 +75,12 @@
 struct sthread_args {
     struct rtpp_queue *out_q;
     struct rtpp_log *glog;
+    struct rtpp_stats *rtpp_stats;
+    struct rtpp_tload_ent *tlp;
+    struct rtpp_proc_lstat lat_qwait;
+    struct rtpp_proc_lstat lat_send;
+    struct rtpp_proc_lstat lat_total;
+    double last_lflush;
     int dmode;
 #if RTPP_DEBUG_timers
     struct recfilter average_load;
@@ -76,22 +88,37 @@ struct sthread_args {
     struct rtpp_wi *sigterm;
 };
 
-#define SEND_THREADS 1
+struct rtpp_anetio_thr {
+    pthread_t thread_id;
+    struct sthread_args args;
+};
 
+/* One sender per media shard */
 struct rtpp_anetio_cf {
-    pthread_t thread_id[SEND_THREADS];
-    struct sthread_args args[SEND_THREADS];
+    int nthreads;
+    struct rtpp_anetio_thr thr[0];
 };
 
 #define RTPP_ANETIO_MAX_RETRY 3
 #define RTPP_ANETIO_BATCH_LEN (RTPQ_LARGE_CB_LEN / 8)
 
+static void
+rtpp_anetio_flush_lstats(struct sthread_args *args, double dtime)
+{
+
+    FLUSH_LSTAT(args->rtpp_stats, args->lat_qwait);
+    FLUSH_LSTAT(args->rtpp_stats, args->lat_send);
+    FLUSH_LSTAT(args->rtpp_stats, args->lat_total);
+    args->last_lflush = dtime;
+}
+
 static void
 rtpp_anetio_sthread(struct sthread_args *args)
 {
     int n, nsend, i, send_errno, nretry;
     struct rtpp_wi *wi, *wis[RTPQ_LARGE_CB_LEN / 8];
     struct rtpp_wi_pvt *wipp;
+    double tdeq, tstart, tsent;
 #if RTPP_DEBUG_timers
     double tp[3], runtime, sleeptime;
     long run_n;
@@ -100,10 +127,15 @@ rtpp_anetio_sthread(struct sthread_args *args)
     run_n = 0;
     tp[0] = getdtime();
 #endif
+    tsent = getdtime();
+    nsend = 0;
     for (;;) {
+        rtpp_tload_sleep(args->tlp, tsent, nsend);
         nsend = rtpp_queue_get_items(args->out_q, wis, RTPP_ANETIO_BATCH_LEN, 0);
+        tdeq = tsent = getdtime();
+        rtpp_tload_wake(args->tlp, tdeq);
 #if RTPP_DEBUG_timers
-        tp[1] = getdtime();
+        tp[1] = tdeq;
 #endif
 
         for (i = 0; i < nsend; i++) {
@@ -113,6 +145,9 @@ rtpp_anetio_sthread(struct sthread_args *args)
                 RTPP_OBJ_DECREF(wi);
                 goto out;
             }
+            if (wipp->etime != 0.0)
+                rtpp_lhist_reg(&args->lat_qwait.hist, tdeq - wipp->etime);
+            tstart = tsent;
             nretry = 0;
             do {
                 n = sendto(wipp->sock, wipp->msg, wipp->msg_len, wipp->flags,
@@ -156,8 +191,16 @@ rtpp_anetio_sthread(struct sthread_args *args)
                     }
                 }
             } while (wipp->nsend > 0);
+            if (wipp->nsend > 0)
+                rtpp_tload_drop(args->tlp, 1);
+            tsent = getdtime();
+            rtpp_lhist_reg(&args->lat_send.hist, tsent - tstart);
+            if (wipp->rtime != 0.0)
+                rtpp_lhist_reg(&args->lat_total.hist, tsent - wipp->rtime);
             RTPP_OBJ_DECREF(wi);
         }
+        if (tsent - args->last_lflush >= RTPP_PROC_LFLUSH_IVAL)
+            rtpp_anetio_flush_lstats(args, tsent);
 #if RTPP_DEBUG_timers
         sleeptime += tp[1] - tp[0];
         tp[0] = getdtime();
@@ -174,9 +217,20 @@ rtpp_anetio_sthread(struct sthread_args *args)
 #endif
     }
 out:
+    rtpp_anetio_flush_lstats(args, getdtime());
     return;
 }
 
+static inline void
+rtpp_anetio_set_etime(struct rtpp_wi *wi, double rtime)
+{
+    struct rtpp_wi_pvt *wipp;
+
+    PUB2PVT(wi, wipp);
+    wipp->etime = getdtime();
+    wipp->rtime = rtime;
+}
+
 static void
 rtpp_anetio_sendto_debug(struct rtpp_anetio_cf *netio_cf, struct rtpp_wi *wi)
 {
@@ -184,12 +238,12 @@ rtpp_anetio_sendto_debug(struct rtpp_anetio_cf *netio_cf, struct rtpp_wi *wi)
     struct rtpp_wi_pvt *wipp;
     PUB2PVT(wi, wipp);
     wipp->debug = 1;
-    wipp->log = netio_cf->args[0].glog;
+    wipp->log = netio_cf->thr[0].args.glog;
     RTPP_OBJ_INCREF(wipp->log);
 #if RTPP_DEBUG_netio >= 2
-    RTPP_LOG(netio_cf->args[0].glog, RTPP_LOG_DBUG, "malloc(%d, %p, %d, %d, %p, %d) = %p",
+    RTPP_LOG(netio_cf->thr[0].args.glog, RTPP_LOG_DBUG, "malloc(%d, %p, %d, %d, %p, %d) = %p",
       sock, msg, msg_len, flags, sendto, tolen, wi);
-    RTPP_LOG(netio_cf->args[0].glog, RTPP_LOG_DBUG, "sendto(%d, %p, %d, %d, %p, %d)",
+    RTPP_LOG(netio_cf->thr[0].args.glog, RTPP_LOG_DBUG, "sendto(%d, %p, %d, %d, %p, %d)",
       wipp->sock, wipp->msg, wipp->msg_len, wipp->flags, wipp->sendto, wipp->tolen);
 #endif
 #endif
@@ -206,7 +260,8 @@ rtpp_anetio_sendto(struct rtpp_anetio_cf *netio_cf, int sock, const void *msg, \
         return (-1);
     }
     rtpp_anetio_sendto_debug(netio_cf, wi);
-    rtpp_queue_put_item(wi, netio_cf->args[0].out_q);
+    rtpp_anetio_set_etime(wi, 0.0);
+    rtpp_queue_put_item(wi, netio_cf->thr[0].args.out_q);
     return (0);
 }
 
@@ -222,7 +277,8 @@ rtpp_anetio_sendto_na(struct rtpp_anetio_cf *netio_cf, int sock, const void *msg
         return (-1);
     }
     rtpp_anetio_sendto_debug(netio_cf, wi);
-    rtpp_queue_put_item(wi, netio_cf->args[0].out_q);
+    rtpp_anetio_set_etime(wi, 0.0);
+    rtpp_queue_put_item(wi, netio_cf->thr[0].args.out_q);
     return (0);
 }
 
@@ -230,7 +286,8 @@ void
 rtpp_anetio_pump(struct rtpp_anetio_cf *netio_cf)
 {
 
-    rtpp_queue_pump(netio_cf->args[0].out_q);
+    for (int i = 0; i < netio_cf->nthreads; i++)
+        rtpp_queue_pump(netio_cf->thr[i].args.out_q);
 }
 
 void
@@ -259,6 +316,7 @@ rtpp_anetio_send_pkt_na(struct sthread_args *sender, int sock, \
      * rtpp_wi_malloc_pkt_na() consumes pkt and returns wi, so no need to
      * call rtp_packet_free() here.
      */
+    rtpp_anetio_set_etime(wi, pkt->rtime.mono);
 #if RTPP_DEBUG_netio >= 2
     struct rtpp_wi_pvt *wipp;
     PUB2PVT(wi, wipp);
@@ -275,25 +333,48 @@ rtpp_anetio_send_pkt_na(struct sthread_args *sender, int sock, \
     return (0);
 }
 
-struct sthread_args *
-rtpp_anetio_pick_sender(struct rtpp_anetio_cf *netio_cf)
+/*
+ * Queue the same packet to several destinations. Payload is shared by all
+ * work items, the packet is not consumed. Returns the number of items
+ * queued, which may be less than ndst if we are out of memory.
+ */
+int
+rtpp_anetio_fanout_pkt(struct sthread_args *sender, struct rtp_packet *pkt,
+  const struct rtpp_anetio_dst *dsts, int ndst, struct rtpp_refcnt *sock_rcnt)
 {
-    int min_len, i, l;
-    struct sthread_args *sender;
+    struct rtpp_wi *wi;
+    int i;
 
-    sender = &netio_cf->args[0];
-    min_len = rtpp_queue_get_length(sender->out_q);
-    if (min_len == 0) {
-        return (sender);
-    }
-    for (i = 1; i < SEND_THREADS; i++) {
-        l = rtpp_queue_get_length(netio_cf->args[i].out_q);
-        if (l < min_len) {
-            sender = &netio_cf->args[i];
-            min_len = l;
-        }
+    for (i = 0; i < ndst; i++) {
+        wi = rtpp_wi_malloc_fwd(dsts[i].sock, pkt, dsts[i].sendto,
+          dsts[i].tolen, sock_rcnt);
+        if (wi == NULL)
+            break;
+        rtpp_anetio_set_etime(wi, pkt->rtime.mono);
+        rtpp_queue_put_item(wi, sender->out_q);
     }
-    return (sender);
+    return (i);
+}
+
+struct sthread_args *
+rtpp_anetio_get_sender(struct rtpp_anetio_cf *netio_cf, int idx)
+{
+
+    return (&netio_cf->thr[idx % netio_cf->nthreads].args);
+}
+
+struct rtpp_anetio_qinit_arg {
+    struct rtpp_queue **out_qp;
+    int idx;
+};
+
+static void
+rtpp_anetio_qinit(void *argp)
+{
+    const struct rtpp_anetio_qinit_arg *ap;
+
+    ap = (const struct rtpp_anetio_qinit_arg *)argp;
+    *ap->out_qp = rtpp_queue_init(RTPQ_LARGE_CB_LEN, "RTPP->NET%.2d", ap->idx);
 }
 
 struct rtpp_anetio_cf *
@@ -301,69 +382,98 @@ rtpp_netio_async_init(const struct rtpp_cfg *cfsp, int qlen)
 {
     struct rtpp_anetio_cf *netio_cf;
     int i, ri;
+    char tname[32];
 
-    netio_cf = rtpp_zmalloc(sizeof(*netio_cf));
+    netio_cf = rtpp_zmalloc(sizeof(*netio_cf) +
+      sizeof(netio_cf->thr[0]) * cfsp->nshards);
     if (netio_cf == NULL)
         return (NULL);
-
-    for (i = 0; i < SEND_THREADS; i++) {
-        netio_cf->args[i].out_q = rtpp_queue_init(RTPQ_LARGE_CB_LEN, "RTPP->NET%.2d", i);
-        if (netio_cf->args[i].out_q == NULL) {
-            for (ri = i - 1; ri >= 0; ri--) {
-                rtpp_queue_destroy(netio_cf->args[ri].out_q);
-                RTPP_OBJ_DECREF(netio_cf->args[ri].glog);
-            }
+    netio_cf->nthreads = cfsp->nshards;
+
+    for (i = 0; i < netio_cf->nthreads; i++) {
+        const struct rtpp_anetio_qinit_arg qa = {
+            .out_qp = &netio_cf->thr[i].args.out_q,
+            .idx = i
+        };
+        /* Allocated on the node of the CPU the sender is going to run on */
+        if (rtpp_cpusets_run_on(cfsp->cpusets, RTPP_TCLASS_SENDER, i,
+          rtpp_anetio_qinit, (void *)&qa) != 0)
+            RTPP_ELOG(cfsp->glog, RTPP_LOG_ERR, "can't place the queue of "
+              "rtpp_anetio_sender%.2d", i);
+        if (netio_cf->thr[i].args.out_q == NULL) {
             goto e0;
         }
-        rtpp_queue_setqlen(netio_cf->args[i].out_q, qlen);
+        snprintf(tname, sizeof(tname), "rtpp_anetio_sender%.2d", i);
+        netio_cf->thr[i].args.tlp = CALL_SMETHOD(cfsp->rtpp_tload, reg, tname,
+          netio_cf->thr[i].args.out_q);
+        if (netio_cf->thr[i].args.tlp == NULL) {
+            rtpp_queue_destroy(netio_cf->thr[i].args.out_q);
+            goto e0;
+        }
+        rtpp_queue_setqlen(netio_cf->thr[i].args.out_q, qlen);
         RTPP_OBJ_INCREF(cfsp->glog);
-        netio_cf->args[i].glog = cfsp->glog;
-        netio_cf->args[i].dmode = cfsp->dmode;
+        netio_cf->thr[i].args.glog = cfsp->glog;
+        netio_cf->thr[i].args.dmode = cfsp->dmode;
+        RTPP_OBJ_INCREF(cfsp->rtpp_stats);
+        netio_cf->thr[i].args.rtpp_stats = cfsp->rtpp_stats;
+        netio_cf->thr[i].args.lat_qwait.hist_idx = CALL_SMETHOD(cfsp->rtpp_stats,
+          getidxbyname, "lat_netio_qwait");
+        netio_cf->thr[i].args.lat_send.hist_idx = CALL_SMETHOD(cfsp->rtpp_stats,
+          getidxbyname, "lat_netio_send");
+        netio_cf->thr[i].args.lat_total.hist_idx = CALL_SMETHOD(cfsp->rtpp_stats,
+          getidxbyname, "lat_total");
 #if RTPP_DEBUG_timers
-        recfilter_init(&netio_cf->args[i].average_load, 0.9, 0.0, 0);
+        recfilter_init(&netio_cf->thr[i].args.average_load, 0.9, 0.0, 0);
 #endif
     }
 
-    for (i = 0; i < SEND_THREADS; i++) {
-        netio_cf->args[i].sigterm = rtpp_wi_malloc_sgnl(SIGTERM, NULL, 0);
-        if (netio_cf->args[i].sigterm == NULL) {
+    for (i = 0; i < netio_cf->nthreads; i++) {
+        netio_cf->thr[i].args.sigterm = rtpp_wi_malloc_sgnl(SIGTERM, NULL, 0);
+        if (netio_cf->thr[i].args.sigterm == NULL) {
             for (ri = i - 1; ri >= 0; ri--) {
-                RTPP_OBJ_DECREF(netio_cf->args[ri].sigterm);
+                RTPP_OBJ_DECREF(netio_cf->thr[ri].args.sigterm);
             }
             goto e1;
         }
     }
 
-    for (i = 0; i < SEND_THREADS; i++) {
-        if (pthread_create(&(netio_cf->thread_id[i]), NULL, (void *(*)(void *))&rtpp_anetio_sthread, &netio_cf->args[i]) != 0) {
+    for (i = 0; i < netio_cf->nthreads; i++) {
+        if (pthread_create(&(netio_cf->thr[i].thread_id), NULL, (void *(*)(void *))&rtpp_anetio_sthread, &netio_cf->thr[i].args) != 0) {
              for (ri = i - 1; ri >= 0; ri--) {
-                 rtpp_queue_put_item(netio_cf->args[ri].sigterm, netio_cf->args[ri].out_q);
-                 pthread_join(netio_cf->thread_id[ri], NULL);
+                 rtpp_queue_put_item(netio_cf->thr[ri].args.sigterm, netio_cf->thr[ri].args.out_q);
+                 pthread_join(netio_cf->thr[ri].thread_id, NULL);
              }
-             for (ri = i; ri < SEND_THREADS; ri++) {
-                 RTPP_OBJ_DECREF(netio_cf->args[ri].sigterm);
+             for (ri = i; ri < netio_cf->nthreads; ri++) {
+                 RTPP_OBJ_DECREF(netio_cf->thr[ri].args.sigterm);
              }
              goto e1;
         }
 #if HAVE_PTHREAD_SETNAME_NP
-        (void)pthread_setname_np(netio_cf->thread_id[i], "rtpp_anetio_sender");
+        (void)pthread_setname_np(netio_cf->thr[i].thread_id, "rtpp_anetio_sender");
 #endif
+        if (rtpp_cpusets_apply(cfsp->cpusets, RTPP_TCLASS_SENDER, i,
+          netio_cf->thr[i].thread_id) != 0)
+            RTPP_ELOG(cfsp->glog, RTPP_LOG_ERR, "can't set CPU affinity for "
+              "rtpp_anetio_sender%.2d", i);
     }
 
     return (netio_cf);
 
 #if 0
 e2:
-    for (i = 0; i < SEND_THREADS; i++) {
-        RTPP_OBJ_DECREF(netio_cf->args[i].sigterm);
+    for (i = 0; i < netio_cf->nthreads; i++) {
+        RTPP_OBJ_DECREF(netio_cf->thr[i].args.sigterm);
     }
 #endif
 e1:
-    for (i = 0; i < SEND_THREADS; i++) {
-        rtpp_queue_destroy(netio_cf->args[i].out_q);
-        RTPP_OBJ_DECREF(netio_cf->args[i].glog);
-    }
+    i = netio_cf->nthreads;
 e0:
+    for (ri = i - 1; ri >= 0; ri--) {
+        rtpp_queue_destroy(netio_cf->thr[ri].args.out_q);
+        CALL_SMETHOD(netio_cf->thr[ri].args.tlp->owner, unreg, netio_cf->thr[ri].args.tlp);
+        RTPP_OBJ_DECREF(netio_cf->thr[ri].args.glog);
+        RTPP_OBJ_DECREF(netio_cf->thr[ri].args.rtpp_stats);
+    }
     free(netio_cf);
     return (NULL);
 }
@@ -373,13 +483,15 @@ rtpp_netio_async_destroy(struct rtpp_anetio_cf *netio_cf)
 {
     int i;
 
-    for (i = 0; i < SEND_THREADS; i++) {
-        rtpp_queue_put_item(netio_cf->args[i].sigterm, netio_cf->args[i].out_q);
+    for (i = 0; i < netio_cf->nthreads; i++) {
+        rtpp_queue_put_item(netio_cf->thr[i].args.sigterm, netio_cf->thr[i].args.out_q);
     }
-    for (i = 0; i < SEND_THREADS; i++) {
-        pthread_join(netio_cf->thread_id[i], NULL);
-        rtpp_queue_destroy(netio_cf->args[i].out_q);
-        RTPP_OBJ_DECREF(netio_cf->args[i].glog);
+    for (i = 0; i < netio_cf->nthreads; i++) {
+        pthread_join(netio_cf->thr[i].thread_id, NULL);
+        rtpp_queue_destroy(netio_cf->thr[i].args.out_q);
+        CALL_SMETHOD(netio_cf->thr[i].args.tlp->owner, unreg, netio_cf->thr[i].args.tlp);
+        RTPP_OBJ_DECREF(netio_cf->thr[i].args.glog);
+        RTPP_OBJ_DECREF(netio_cf->thr[i].args.rtpp_stats);
     }
     free(netio_cf);
 }
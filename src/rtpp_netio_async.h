@@ -35,6 +35,14 @@ struct sthread_args;
 struct rtpp_log;
 struct rtpp_netaddr;
 struct rtpp_cfg;
+struct rtpp_refcnt;
+
+/* Destination for the rtpp_anetio_fanout_pkt() */
+struct rtpp_anetio_dst {
+    int sock;
+    const struct sockaddr *sendto;
+    socklen_t tolen;
+};
 
 int rtpp_anetio_sendto(struct rtpp_anetio_cf *, int, const void *, \
   size_t, int, const struct sockaddr *, socklen_t);
@@ -49,9 +57,11 @@ int rtpp_anetio_send_pkt(struct sthread_args *, int, \
 int rtpp_anetio_send_pkt_na(struct sthread_args *, int, \
   struct rtpp_netaddr *, struct rtp_packet *,
   struct rtpp_refcnt *, struct rtpp_log *);
+int rtpp_anetio_fanout_pkt(struct sthread_args *, struct rtp_packet *,
+  const struct rtpp_anetio_dst *, int, struct rtpp_refcnt *);
 void rtpp_anetio_pump(struct rtpp_anetio_cf *);
 void rtpp_anetio_pump_q(struct sthread_args *);
-struct sthread_args *rtpp_anetio_pick_sender(struct rtpp_anetio_cf *);
+struct sthread_args *rtpp_anetio_get_sender(struct rtpp_anetio_cf *, int);
 
 struct rtpp_anetio_cf *rtpp_netio_async_init(const struct rtpp_cfg *, int);
 void rtpp_netio_async_destroy(struct rtpp_anetio_cf *);
@@ -41,6 +41,7 @@
 #include <pthread.h>
 #include <signal.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -59,6 +60,8 @@
 #include "rtpp_wi.h"
 #include "rtpp_wi_data.h"
 #include "rtpp_wi_sgnl.h"
+#include "rtpp_time.h"
+#include "rtpp_tload.h"
 
 struct rtpp_notify_wi
 {
@@ -75,6 +78,7 @@ struct rtpp_notify_priv {
     struct rtpp_wi *sigterm;
     pthread_t thread_id;
     struct rtpp_log *glog;
+    struct rtpp_tload_ent *tlp;
 };
 
 static int rtpp_notify_schedule(struct rtpp_notify *,
@@ -91,7 +95,9 @@ rtpp_notify_queue_run(void *arg)
 
     pvt = (struct rtpp_notify_priv *)arg;
     for (;;) {
+        rtpp_tload_sleep(pvt->tlp, getdtime(), 1);
         wi = rtpp_queue_get_item(pvt->nqueue, 0);
+        rtpp_tload_wake(pvt->tlp, getdtime());
         if (rtpp_wi_get_type(wi) == RTPP_WI_TYPE_SGNL) {
             RTPP_OBJ_DECREF(wi);
             break;
@@ -108,7 +114,7 @@ rtpp_notify_queue_run(void *arg)
 }
 
 struct rtpp_notify *
-rtpp_notify_ctor(struct rtpp_log *glog)
+rtpp_notify_ctor(struct rtpp_log *glog, struct rtpp_tload *tload)
 {
     struct rtpp_notify_priv *pvt;
 
@@ -127,9 +133,14 @@ rtpp_notify_ctor(struct rtpp_log *glog)
         goto e2;
     }
 
-    if (pthread_create(&pvt->thread_id, NULL, (void *(*)(void *))&rtpp_notify_queue_run, pvt) != 0) {
+    pvt->tlp = CALL_SMETHOD(tload, reg, "rtpp_notify_queue", pvt->nqueue);
+    if (pvt->tlp == NULL) {
         goto e3;
     }
+
+    if (pthread_create(&pvt->thread_id, NULL, (void *(*)(void *))&rtpp_notify_queue_run, pvt) != 0) {
+        goto e4;
+    }
 #if HAVE_PTHREAD_SETNAME_NP
     (void)pthread_setname_np(pvt->thread_id, "rtpp_notify_queue");
 #endif
@@ -142,6 +153,8 @@ rtpp_notify_ctor(struct rtpp_log *glog)
       pvt);
     return (&pvt->pub);
 
+e4:
+    CALL_SMETHOD(pvt->tlp->owner, unreg, pvt->tlp);
 e3:
     RTPP_OBJ_DECREF(pvt->sigterm);
 e2:
@@ -159,6 +172,7 @@ rtpp_notify_dtor(struct rtpp_notify_priv *pvt)
 
     rtpp_queue_put_item(pvt->sigterm, pvt->nqueue);
     pthread_join(pvt->thread_id, NULL);
+    CALL_SMETHOD(pvt->tlp->owner, unreg, pvt->tlp);
     rtpp_queue_destroy(pvt->nqueue);
     RTPP_OBJ_DECREF(pvt->glog);
     free(pvt);
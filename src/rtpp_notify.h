@@ -30,6 +30,7 @@
 
 struct rtpp_notify;
 struct rtpp_tnotify_target;
+struct rtpp_tload;
 
 DEFINE_METHOD(rtpp_notify, rtpp_notify_schedule, int,
   struct rtpp_tnotify_target *, const rtpp_str_t *, const char *);
@@ -39,4 +40,4 @@ struct rtpp_notify {
     rtpp_notify_schedule_t schedule;
 };
 
-struct rtpp_notify *rtpp_notify_ctor(struct rtpp_log *);
+struct rtpp_notify *rtpp_notify_ctor(struct rtpp_log *, struct rtpp_tload *);
@@ -263,7 +263,7 @@ main(int argc, char **argv)
     }
 #endif
     ecode = 0;
-    rtp = rtpp_timed_ctor(0.1);
+    rtp = rtpp_timed_ctor(0.1, NULL, NULL);
     targs.rsp = rtpp_stats_ctor();
     targs.fqp = rtpp_queue_init(RTPQ_LARGE_CB_LEN, "perftest main->worker");
     targs.bqp = rtpp_queue_init(RTPQ_LARGE_CB_LEN, "perftest worker->main");
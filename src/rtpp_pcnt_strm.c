@@ -52,6 +52,7 @@ struct rtpp_pcnt_strm_priv {
     struct rtpp_pcnts_strm cnt;
     pthread_mutex_t lock;
 };
+const size_t rtpp_pcnt_strm_osize = sizeof(struct rtpp_pcnt_strm_priv);
 
 static void rtpp_pcnt_strm_dtor(struct rtpp_pcnt_strm_priv *);
 static void rtpp_pcnt_strm_get_stats(struct rtpp_pcnt_strm *,
@@ -86,6 +87,32 @@ e0:
     return (NULL);
 }
 
+struct rtpp_pcnt_strm *
+rtpp_pcnt_strm_ctor_pa(void *pap, struct rtpp_refcnt *rcnt)
+{
+    struct rtpp_pcnt_strm_priv *pvt;
+
+    pvt = (struct rtpp_pcnt_strm_priv *)pap;
+    if (pthread_mutex_init(&pvt->lock, NULL) != 0) {
+        return (NULL);
+    }
+    pvt->pub.rcnt = rcnt;
+#if defined(RTPP_DEBUG)
+    pvt->pub.smethods = GET_SMETHODS(&pvt->pub);
+#endif
+    return ((&pvt->pub));
+}
+
+void
+rtpp_pcnt_strm_dtor_pa(struct rtpp_pcnt_strm *pub)
+{
+    struct rtpp_pcnt_strm_priv *pvt;
+
+    PUB2PVT(pub, pvt);
+    rtpp_pcnt_strm_fin(pub);
+    pthread_mutex_destroy(&pvt->lock);
+}
+
 static void
 rtpp_pcnt_strm_dtor(struct rtpp_pcnt_strm_priv *pvt)
 {
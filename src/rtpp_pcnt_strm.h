@@ -45,3 +45,10 @@ DECLARE_SMETHODS(rtpp_pcnt_strm)
 };
 
 DECLARE_CLASS_PUBTYPE(rtpp_pcnt_strm, {});
+
+struct rtpp_refcnt;
+
+/* Storage and refcount provided by the owning rtpp_stream */
+extern const size_t rtpp_pcnt_strm_osize;
+struct rtpp_pcnt_strm *rtpp_pcnt_strm_ctor_pa(void *, struct rtpp_refcnt *);
+void rtpp_pcnt_strm_dtor_pa(struct rtpp_pcnt_strm *);
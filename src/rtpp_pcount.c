@@ -61,12 +61,15 @@ struct rtpp_pcount_priv {
         _Atomic(unsigned long) cnt;
     } top_drop_locs[TOP_DROPS_SIZE];
 };
+const size_t rtpp_pcount_osize = sizeof(struct rtpp_pcount_priv);
 
 static void rtpp_pcount_dtor(struct rtpp_pcount_priv *);
 static void rtpp_pcount_reg_reld(struct rtpp_pcount *);
 static void rtpp_pcount_reg_drop(struct rtpp_pcount *, HERETYPE);
 static void rtpp_pcount_reg_ignr(struct rtpp_pcount *);
 static void rtpp_pcount_get_stats(struct rtpp_pcount *, struct rtpps_pcount *);
+static void rtpp_pcount_add_stats(struct rtpp_pcount *,
+  const struct rtpps_pcount *);
 static void rtpp_pcount_log_drops(struct rtpp_pcount *, struct rtpp_log *);
 
 DEFINE_SMETHODS(rtpp_pcount,
@@ -74,18 +77,14 @@ DEFINE_SMETHODS(rtpp_pcount,
     .reg_drop = &rtpp_pcount_reg_drop,
     .reg_ignr = &rtpp_pcount_reg_ignr,
     .get_stats = &rtpp_pcount_get_stats,
+    .add_stats = &rtpp_pcount_add_stats,
     .log_drops = &rtpp_pcount_log_drops
 );
 
-struct rtpp_pcount *
-rtpp_pcount_ctor(void)
+static void
+rtpp_pcount_init(struct rtpp_pcount_priv *pvt)
 {
-    struct rtpp_pcount_priv *pvt;
 
-    pvt = rtpp_rzmalloc(sizeof(struct rtpp_pcount_priv), PVT_RCOFFS(pvt));
-    if (pvt == NULL) {
-        goto e0;
-    }
     atomic_init(&(pvt->cnt.nrelayed), 0);
     atomic_init(&(pvt->cnt.ndropped), 0);
     atomic_init(&(pvt->cnt.nignored), 0);
@@ -93,6 +92,18 @@ rtpp_pcount_ctor(void)
         atomic_init(&(pvt->top_drop_locs[i].ptr), NULL);
         atomic_init(&(pvt->top_drop_locs[i].cnt), 0);
     }
+}
+
+struct rtpp_pcount *
+rtpp_pcount_ctor(void)
+{
+    struct rtpp_pcount_priv *pvt;
+
+    pvt = rtpp_rzmalloc(sizeof(struct rtpp_pcount_priv), PVT_RCOFFS(pvt));
+    if (pvt == NULL) {
+        goto e0;
+    }
+    rtpp_pcount_init(pvt);
     PUBINST_FININIT(&pvt->pub, pvt, rtpp_pcount_dtor);
     return ((&pvt->pub));
 
@@ -100,6 +111,27 @@ e0:
     return (NULL);
 }
 
+struct rtpp_pcount *
+rtpp_pcount_ctor_pa(void *pap, struct rtpp_refcnt *rcnt)
+{
+    struct rtpp_pcount_priv *pvt;
+
+    pvt = (struct rtpp_pcount_priv *)pap;
+    rtpp_pcount_init(pvt);
+    pvt->pub.rcnt = rcnt;
+#if defined(RTPP_DEBUG)
+    pvt->pub.smethods = GET_SMETHODS(&pvt->pub);
+#endif
+    return ((&pvt->pub));
+}
+
+void
+rtpp_pcount_dtor_pa(struct rtpp_pcount *pub)
+{
+
+    rtpp_pcount_fin(pub);
+}
+
 static void
 rtpp_pcount_dtor(struct rtpp_pcount_priv *pvt)
 {
@@ -181,3 +213,14 @@ rtpp_pcount_get_stats(struct rtpp_pcount *self, struct rtpps_pcount *ocnt)
     ocnt->ndropped = atomic_load_explicit((&pvt->cnt.ndropped), memory_order_relaxed);
     ocnt->nignored = atomic_load_explicit((&pvt->cnt.nignored), memory_order_relaxed);
 }
+
+static void
+rtpp_pcount_add_stats(struct rtpp_pcount *self, const struct rtpps_pcount *icnt)
+{
+    struct rtpp_pcount_priv *pvt;
+
+    PUB2PVT(self, pvt);
+    atomic_fetch_add_explicit(&pvt->cnt.nrelayed, icnt->nrelayed, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pvt->cnt.ndropped, icnt->ndropped, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pvt->cnt.nignored, icnt->nignored, memory_order_relaxed);
+}
@@ -40,6 +40,8 @@ DECLARE_METHOD(rtpp_pcount, rtpp_pcount_log_drops, void, struct rtpp_log *);
 DECLARE_METHOD(rtpp_pcount, rtpp_pcount_reg_ignr, void);
 DECLARE_METHOD(rtpp_pcount, rtpp_pcount_get_stats, void,
   struct rtpps_pcount *);
+DECLARE_METHOD(rtpp_pcount, rtpp_pcount_add_stats, void,
+  const struct rtpps_pcount *);
 
 struct rtpps_pcount {
     unsigned long nrelayed;
@@ -53,6 +55,14 @@ DECLARE_SMETHODS(rtpp_pcount) {
     METHOD_ENTRY(rtpp_pcount_log_drops, log_drops);
     METHOD_ENTRY(rtpp_pcount_reg_ignr, reg_ignr);
     METHOD_ENTRY(rtpp_pcount_get_stats, get_stats);
+    METHOD_ENTRY(rtpp_pcount_add_stats, add_stats);
 };
 
 DECLARE_CLASS_PUBTYPE(rtpp_pcount, {});
+
+struct rtpp_refcnt;
+
+/* Storage and refcount provided by the owner, see rtpp_session.c */
+extern const size_t rtpp_pcount_osize;
+struct rtpp_pcount *rtpp_pcount_ctor_pa(void *, struct rtpp_refcnt *);
+void rtpp_pcount_dtor_pa(struct rtpp_pcount *);
@@ -51,6 +51,7 @@
 #include "rtpp_pcnt_strm.h"
 #include "rtpp_pcnts_strm.h"
 #include "rtpp_stats.h"
+#include "rtpp_debug.h"
 #include "advanced/pproc_manager.h"
 
 struct rtpp_pipe_priv
@@ -60,7 +61,6 @@ struct rtpp_pipe_priv
     int pipe_type;
 };
 
-static void rtpp_pipe_dtor(struct rtpp_pipe_priv *);
 static int rtpp_pipe_get_ttl(struct rtpp_pipe *);
 static void rtpp_pipe_decr_ttl(struct rtpp_pipe *);
 static void rtpp_pipe_get_stats(struct rtpp_pipe *, struct rtpp_acct_pipe *);
@@ -79,16 +79,49 @@ DEFINE_SMETHODS(rtpp_pipe,
     .upd_cntrs = &rtpp_pipe_upd_cntrs,
 );
 
+struct rtpp_pipe_layout {
+    size_t pcount;
+    size_t stream[2];
+    size_t len;
+};
+
+static void
+rtpp_pipe_layout(const struct r_pipe_ctor_args *ap,
+  struct rtpp_pipe_layout *lp)
+{
+    const struct r_stream_ctor_args rsca = {
+        .pipe_type = ap->pipe_type,
+        .nmodules = ap->nmodules
+    };
+    size_t ssize;
+
+    ssize = rtpp_stream_osize(&rsca);
+    lp->pcount = RTPP_MALIGN(sizeof(struct rtpp_pipe_priv));
+    lp->stream[0] = lp->pcount + RTPP_MALIGN(rtpp_pcount_osize);
+    lp->stream[1] = lp->stream[0] + RTPP_MALIGN(ssize);
+    lp->len = lp->stream[1] + ssize;
+}
+
+size_t
+rtpp_pipe_osize(const struct r_pipe_ctor_args *ap)
+{
+    struct rtpp_pipe_layout lay;
+
+    rtpp_pipe_layout(ap, &lay);
+    return (lay.len);
+}
+
 struct rtpp_pipe *
-rtpp_pipe_ctor(const struct r_pipe_ctor_args *ap)
+rtpp_pipe_ctor_pa(void *pap, struct rtpp_refcnt *rcnt,
+  const struct r_pipe_ctor_args *ap)
 {
     struct rtpp_pipe_priv *pvt;
+    struct rtpp_pipe_layout lay;
     int i;
 
-    pvt = rtpp_rzmalloc(sizeof(struct rtpp_pipe_priv), PVT_RCOFFS(pvt));
-    if (pvt == NULL) {
-        goto e0;
-    }
+    RTPP_DBG_ASSERT(ap->owner != NULL);
+    rtpp_pipe_layout(ap, &lay);
+    pvt = (struct rtpp_pipe_priv *)pap;
 
     pvt->streams_wrt = ap->streams_wrt;
 
@@ -100,11 +133,16 @@ rtpp_pipe_ctor(const struct r_pipe_ctor_args *ap)
         .pipe_type = ap->pipe_type,
         .seuid = ap->seuid,
         .nmodules = ap->nmodules,
-        .pproc_manager = ap->pproc_manager
+        .pproc_manager = ap->pproc_manager,
+        .repl = ap->repl,
+        .shard = ap->shard,
+        .sender = ap->sender,
+        .owner = ap->owner
     };
     for (i = 0; i < 2; i++) {
         rsca.side = i;
-        pvt->pub.stream[i] = rtpp_stream_ctor(&rsca);
+        pvt->pub.stream[i] = rtpp_stream_ctor_pa((char *)pvt + lay.stream[i],
+          &rsca);
         if (pvt->pub.stream[i] == NULL) {
             goto e1;
         }
@@ -115,10 +153,12 @@ rtpp_pipe_ctor(const struct r_pipe_ctor_args *ap)
     }
     pvt->pub.stream[0]->stuid_sendr = pvt->pub.stream[1]->stuid;
     pvt->pub.stream[1]->stuid_sendr = pvt->pub.stream[0]->stuid;
-    pvt->pub.pcount = rtpp_pcount_ctor();
-    if (pvt->pub.pcount == NULL) {
-        goto e2;
-    }
+    /*
+     * The pcount is shared by the streams and finalized by the owner once
+     * the last of them is gone.
+     */
+    pvt->pub.pcount = rtpp_pcount_ctor_pa((char *)pvt + lay.pcount,
+      ap->owner);
     for (i = 0; i < 2; i++) {
         RTPP_OBJ_INCREF(pvt->pub.pcount);
         pvt->pub.stream[i]->pcount = pvt->pub.pcount;
@@ -131,10 +171,12 @@ rtpp_pipe_ctor(const struct r_pipe_ctor_args *ap)
     pvt->pub.rtpp_stats = ap->rtpp_stats;
     pvt->pub.log = ap->log;
     RTPP_OBJ_INCREF(ap->log);
-    PUBINST_FININIT(&pvt->pub, pvt, rtpp_pipe_dtor);
+    pvt->pub.rcnt = rcnt;
+#if defined(RTPP_DEBUG)
+    pvt->pub.smethods = GET_SMETHODS(&pvt->pub);
+#endif
     return (&pvt->pub);
 
-e2:
 e1:
     for (i = 0; i < 2; i++) {
         if (pvt->pub.stream[i] != NULL) {
@@ -142,26 +184,23 @@ e1:
             RTPP_OBJ_DECREF(pvt->pub.stream[i]);
         }
     }
-    RTPP_OBJ_DECREF(&(pvt->pub));
-    free(pvt);
-e0:
     return (NULL);
 }
 
-static void
-rtpp_pipe_dtor(struct rtpp_pipe_priv *pvt)
+void
+rtpp_pipe_dtor_pa(struct rtpp_pipe *pub)
 {
+    struct rtpp_pipe_priv *pvt;
     int i;
 
+    PUB2PVT(pub, pvt);
     rtpp_pipe_fin(&(pvt->pub));
     for (i = 0; i < 2; i++) {
         CALL_SMETHOD(pvt->streams_wrt, unreg, pvt->pub.stream[i]->stuid);
         RTPP_OBJ_DECREF(pvt->pub.stream[i]->pproc_manager->reverse);
         RTPP_OBJ_DECREF(pvt->pub.stream[i]);
     }
-    RTPP_OBJ_DECREF(pvt->pub.pcount);
     RTPP_OBJ_DECREF(pvt->pub.log);
-    free(pvt);
 }
 
 static int
@@ -30,6 +30,8 @@
 struct rtpp_stats;
 struct rtpp_acct_pipe;
 struct rtpp_proc_servers;
+struct rtpp_repl;
+struct rtpp_refcnt;
 
 #define PIPE_RTP        1
 #define PIPE_RTCP       2
@@ -45,9 +47,25 @@ struct r_pipe_ctor_args {
     int pipe_type;
     unsigned int nmodules;
     struct pproc_manager *pproc_manager;
+    struct rtpp_repl *repl;
+    /* Media shard of the session and its sender thread */
+    int shard;
+    struct sthread_args *sender;
+    /* Holds the pipe's storage, see rtpp_session.c */
+    struct rtpp_refcnt *owner;
 };
 
-DECLARE_CLASS(rtpp_pipe, const struct r_pipe_ctor_args *);
+struct rtpp_pipe;
+typedef struct rtpp_pipe rtpp_pipe_rot;
+
+/*
+ * The pipe shares the refcount of its owner, the streams and pcount are
+ * laid out after it and keep ap->owner alive for as long as they exist.
+ */
+size_t rtpp_pipe_osize(const struct r_pipe_ctor_args *);
+struct rtpp_pipe *rtpp_pipe_ctor_pa(void *, struct rtpp_refcnt *,
+  const struct r_pipe_ctor_args *);
+void rtpp_pipe_dtor_pa(struct rtpp_pipe *);
 
 DECLARE_METHOD(rtpp_pipe, rtpp_pipe_get_ttl, int);
 DECLARE_METHOD(rtpp_pipe, rtpp_pipe_decr_ttl, void);
@@ -31,7 +31,9 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <poll.h>
+#include <stdatomic.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -41,8 +43,12 @@
 #include "rtpp_time.h"
 #include "rtp_packet.h"
 #include "rtp_resizer.h"
+#include "rtpp_ssrc.h"
+#include "rtp_analyze.h"
+#include "rtpp_analyzer.h"
 #include "rtpp_cfg.h"
 #include "rtpp_defines.h"
+#include "rtpp_lhist.h"
 #include "rtpp_proc.h"
 #include "rtpp_record.h"
 #include "rtpp_codeptr.h"
@@ -50,6 +56,8 @@
 #include "rtpp_sessinfo.h"
 #include "rtpp_stream.h"
 #include "rtpp_pcount.h"
+#include "rtpp_pcnt_strm.h"
+#include "rtpp_ttl.h"
 #include "rtpp_socket.h"
 #include "rtpp_session.h"
 #include "rtpp_pipe.h"
@@ -63,12 +71,54 @@ struct rtpp_proc_ready_lst {
     struct rtpp_stream *stp;
 };
 
+/*
+ * Specialised version of the pproc_manager loop for streams whose chain
+ * only has the stock handlers (analyze, resize, record and relay), with
+ * resizer and recorder both inactive. Performs the same steps as
+ * analyze_rtp_packet()/analyze_rtcp_packet() and relay_packet() without
+ * going through the handler table.
+ */
+static inline int
+relay_fastpath_ok(const struct rtpp_stream *stp)
+{
+
+    if (!atomic_load_explicit(&stp->pproc_manager->relay_only, memory_order_acquire))
+        return (0);
+    return (stp->resizer == NULL && stp->rrc == NULL);
+}
+
+static inline void
+relay_fastpath(struct pkt_proc_ctx *pktxp)
+{
+    struct rtpp_stream *stp_in = pktxp->strmp_in;
+    struct rtpp_stream *stp_out = pktxp->strmp_out;
+    struct rtp_packet *packet = pktxp->pktp;
+
+    CALL_SMETHOD(stp_in->pcnt_strm, reg_pktin, packet);
+    if (stp_in->analyzer != NULL &&
+      CALL_SMETHOD(stp_in->analyzer, update, packet) == UPDATE_SSRC_CHG &&
+      CALL_SMETHOD(stp_in, latch_getmode) != RTPLM_FORCE_ON) {
+        CALL_SMETHOD(stp_in, latch, packet);
+    }
+    CALL_SMETHOD(stp_in->ttl, reset);
+    if (stp_out == NULL || !CALL_SMETHOD(stp_out, issendable)) {
+        RTPP_OBJ_DECREF(packet);
+        CALL_SMETHOD(stp_in->pcount, reg_drop, HEREVAL);
+        pktxp->rsp->npkts_discard.cnt++;
+        return;
+    }
+    CALL_SMETHOD(stp_out, send_pkt, packet->sender, packet);
+    CALL_SMETHOD(stp_in->pcount, reg_reld);
+    pktxp->rsp->npkts_relayed.cnt++;
+}
+
 static void
 rxmit_packets(const struct rtpp_cfg *cfsp, struct rtpp_stream *stp,
   const struct rtpp_timestamp *dtime, int drain_repeat, struct sthread_args *sender,
   struct rtpp_proc_rstats *rsp)
 {
     int ndrain;
+    double tpkt;
     struct rtp_packet *packet = NULL;
     struct pkt_proc_ctx pktx = {
         .strmp_in = stp,
@@ -93,9 +143,17 @@ rxmit_packets(const struct rtpp_cfg *cfsp, struct rtpp_stream *stp,
             ndrain += 1;
             continue;
         }
+        /* Time from the poll wakeup to the packet being read off the socket */
+        tpkt = getdtime();
+        rtpp_lhist_reg(&rsp->lat_rx.hist, tpkt - dtime->mono);
         packet->sender = sender;
         pktx.pktp = packet;
-        CALL_SMETHOD(stp->pproc_manager, handle, &pktx);
+        if (relay_fastpath_ok(stp)) {
+            relay_fastpath(&pktx);
+        } else {
+            CALL_SMETHOD(stp->pproc_manager, handle, &pktx);
+        }
+        rtpp_lhist_reg(&rsp->lat_pproc.hist, getdtime() - tpkt);
     } while (ndrain > 0);
     if (pktx.strmp_out != NULL) {
         RTPP_OBJ_DECREF(pktx.strmp_out);
@@ -103,10 +161,153 @@ rxmit_packets(const struct rtpp_cfg *cfsp, struct rtpp_stream *stp,
     return;
 }
 
+static void
+rsztmr_siftup(struct rtpp_proc_rsztmr *tmrp, int i)
+{
+    struct rtpp_proc_rsztmr_ent e;
+    int pi;
+
+    e = tmrp->heap[i];
+    while (i > 0) {
+        pi = (i - 1) / 2;
+        if (tmrp->heap[pi].deadline <= e.deadline)
+            break;
+        tmrp->heap[i] = tmrp->heap[pi];
+        i = pi;
+    }
+    tmrp->heap[i] = e;
+}
+
+static void
+rsztmr_siftdown(struct rtpp_proc_rsztmr *tmrp, int i)
+{
+    struct rtpp_proc_rsztmr_ent e;
+    int ci;
+
+    e = tmrp->heap[i];
+    for (;;) {
+        ci = i * 2 + 1;
+        if (ci >= tmrp->len)
+            break;
+        if (ci + 1 < tmrp->len && tmrp->heap[ci + 1].deadline < tmrp->heap[ci].deadline)
+            ci++;
+        if (e.deadline <= tmrp->heap[ci].deadline)
+            break;
+        tmrp->heap[i] = tmrp->heap[ci];
+        i = ci;
+    }
+    tmrp->heap[i] = e;
+}
+
+/* Put stream on the egress timer, unless it is already there */
+static void
+rsztmr_arm(struct rtpp_proc_rsztmr *tmrp, struct rtpp_stream *stp,
+  double deadline)
+{
+    struct rtpp_proc_rsztmr_ent *tep;
+
+    if (rtp_resizer_arm(stp->resizer, 1) != 0)
+        return;
+    if (tmrp->len == tmrp->alloc) {
+        int nalloc = (tmrp->alloc == 0) ? 16 : tmrp->alloc * 2;
+
+        tep = realloc(tmrp->heap, sizeof(tmrp->heap[0]) * nalloc);
+        if (tep == NULL) {
+            /* Falls back to the input-driven egress */
+            rtp_resizer_arm(stp->resizer, 0);
+            return;
+        }
+        tmrp->heap = tep;
+        tmrp->alloc = nalloc;
+    }
+    RTPP_OBJ_INCREF(stp);
+    tmrp->heap[tmrp->len].deadline = deadline;
+    tmrp->heap[tmrp->len].stp = stp;
+    tmrp->len++;
+    rsztmr_siftup(tmrp, tmrp->len - 1);
+}
+
+static void
+resizer_egress(const struct rtpp_cfg *cfsp, struct rtpp_stream *stp,
+  const struct rtpp_timestamp *dtime, struct sthread_args *sender,
+  struct rtpp_proc_rstats *rsp)
+{
+    struct pkt_proc_ctx pktx = {
+        .strmp_in = stp,
+        .strmp_out = CALL_SMETHOD(stp, get_sender, cfsp),
+        .rsp = rsp
+    };
+
+    while ((pktx.pktp = rtp_resizer_get(stp->resizer, dtime->mono)) != NULL) {
+        pktx.pktp->sender = sender;
+        if (CALL_SMETHOD(stp->pproc_manager, handleat, &pktx,
+          PPROC_ORD_RESIZE + 1).a & PPROC_ACT_TAKE_v)
+            rsp->npkts_resizer_out.cnt++;
+    }
+
+    if (pktx.strmp_out != NULL)
+        RTPP_OBJ_DECREF(pktx.strmp_out);
+}
+
+/*
+ * Run resizers that are due, re-arming the ones that still have some data
+ * queued. Returns the time of the next deadline or a negative value if
+ * there is none.
+ */
+double
+process_rtp_resizers(const struct rtpp_cfg *cfsp, struct rtpp_proc_rsztmr *tmrp,
+  const struct rtpp_timestamp *dtime, struct sthread_args *sender,
+  struct rtpp_proc_rstats *rsp)
+{
+    struct rtpp_proc_rsztmr_ent *tep;
+    struct rtpp_stream *stp;
+    double deadline;
+
+    while (tmrp->len > 0 && tmrp->heap[0].deadline <= dtime->mono) {
+        tep = &tmrp->heap[0];
+        stp = tep->stp;
+        deadline = -1.0;
+        /* Resizer can be removed or replaced by the command thread */
+        if (stp->resizer != NULL) {
+            resizer_egress(cfsp, stp, dtime, sender, rsp);
+            deadline = rtp_resizer_deadline(stp->resizer, dtime->mono);
+        }
+        if (deadline > dtime->mono) {
+            tep->deadline = deadline;
+            rsztmr_siftdown(tmrp, 0);
+            continue;
+        }
+        if (stp->resizer != NULL)
+            rtp_resizer_arm(stp->resizer, 0);
+        RTPP_OBJ_DECREF(stp);
+        tmrp->len--;
+        if (tmrp->len > 0) {
+            tmrp->heap[0] = tmrp->heap[tmrp->len];
+            rsztmr_siftdown(tmrp, 0);
+        }
+    }
+    return ((tmrp->len > 0) ? tmrp->heap[0].deadline : -1.0);
+}
+
+void
+rtpp_proc_rsztmr_free(struct rtpp_proc_rsztmr *tmrp)
+{
+    int i;
+
+    for (i = 0; i < tmrp->len; i++) {
+        if (tmrp->heap[i].stp->resizer != NULL)
+            rtp_resizer_arm(tmrp->heap[i].stp->resizer, 0);
+        RTPP_OBJ_DECREF(tmrp->heap[i].stp);
+    }
+    free(tmrp->heap);
+    memset(tmrp, '\0', sizeof(*tmrp));
+}
+
 void
 process_rtp_only(const struct rtpp_cfg *cfsp, struct rtpp_polltbl *ptbl,
   const struct rtpp_timestamp *dtime, int drain_repeat, struct sthread_args *sender,
-  struct rtpp_proc_rstats *rsp, struct epoll_event events[], int nready)
+  struct rtpp_proc_rstats *rsp, struct epoll_event events[], int nready,
+  struct rtpp_proc_rsztmr *tmrp)
 {
     int readyfd, ndrained;
     struct rtpp_session *sp;
@@ -140,21 +341,16 @@ process_rtp_only(const struct rtpp_cfg *cfsp, struct rtpp_polltbl *ptbl,
         if (sp->complete != 0) {
             rxmit_packets(cfsp, stp, dtime, drain_repeat, sender, rsp);
             if (stp->resizer != NULL) {
-                struct pkt_proc_ctx pktx = {
-                    .strmp_in = stp,
-                    .strmp_out = CALL_SMETHOD(stp, get_sender, cfsp),
-                    .rsp = rsp
-                };
-
-                while ((pktx.pktp = rtp_resizer_get(stp->resizer, dtime->mono)) != NULL) {
-                    pktx.pktp->sender = sender;
-                    if (CALL_SMETHOD(stp->pproc_manager, handleat, &pktx,
-                      PPROC_ORD_RESIZE + 1).a & PPROC_ACT_TAKE_v)
-                        rsp->npkts_resizer_out.cnt++;
-                }
-
-                if (pktx.strmp_out != NULL)
-                    RTPP_OBJ_DECREF(pktx.strmp_out);
+                double deadline;
+
+                resizer_egress(cfsp, stp, dtime, sender, rsp);
+                /*
+                 * Whatever is left is sent out by the timer, so that
+                 * output does not have to wait for the next input.
+                 */
+                deadline = rtp_resizer_deadline(stp->resizer, dtime->mono);
+                if (tmrp != NULL && deadline >= 0.0)
+                    rsztmr_arm(tmrp, stp, deadline);
             }
             RTPP_OBJ_DECREF(sp);
         } else {
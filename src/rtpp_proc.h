@@ -33,6 +33,7 @@ struct rtpp_polltbl;
 struct rtpp_timestamp;
 struct rtpp_cfg;
 struct epoll_event;
+struct rtpp_stream;
 
 struct rtpp_proc_stat {
     uint64_t cnt;
@@ -46,6 +47,21 @@ struct rtpp_proc_stat {
     } \
 }
 
+/* How often (seconds) per-thread latency histograms are merged into stats */
+#define RTPP_PROC_LFLUSH_IVAL   1.0
+
+struct rtpp_proc_lstat {
+    struct rtpp_lhist hist;
+    int hist_idx;
+};
+
+#define FLUSH_LSTAT(sobj, st)    { \
+    if ((st).hist.cnt > 0) { \
+        CALL_SMETHOD(sobj, updatehist, (st).hist_idx, &(st).hist); \
+        rtpp_lhist_reset(&(st).hist); \
+    } \
+}
+
 struct rtpp_proc_rstats {
     struct rtpp_proc_stat npkts_rcvd;
     struct rtpp_proc_stat npkts_relayed;
@@ -53,6 +69,24 @@ struct rtpp_proc_rstats {
     struct rtpp_proc_stat npkts_resizer_out;
     struct rtpp_proc_stat npkts_resizer_discard;
     struct rtpp_proc_stat npkts_discard;
+    struct rtpp_proc_lstat lat_rx;
+    struct rtpp_proc_lstat lat_pproc;
+};
+
+/*
+ * Per-worker egress timer for the streams with the resizer active. It is
+ * a binary min-heap of streams ordered by the time their resizer is due
+ * to produce the next packet, each entry holds a reference to the stream.
+ */
+struct rtpp_proc_rsztmr_ent {
+    double deadline;
+    struct rtpp_stream *stp;
+};
+
+struct rtpp_proc_rsztmr {
+    struct rtpp_proc_rsztmr_ent *heap;
+    int len;
+    int alloc;
 };
 
 void process_rtp_servers(const struct rtpp_cfg *, double,
@@ -60,6 +94,10 @@ void process_rtp_servers(const struct rtpp_cfg *, double,
 void process_rtp_only(const struct rtpp_cfg *,
   struct rtpp_polltbl *, const struct rtpp_timestamp *, int,
   struct sthread_args *sender, struct rtpp_proc_rstats *,
-  struct epoll_event *, int);
+  struct epoll_event *, int, struct rtpp_proc_rsztmr *);
+double process_rtp_resizers(const struct rtpp_cfg *,
+  struct rtpp_proc_rsztmr *, const struct rtpp_timestamp *,
+  struct sthread_args *, struct rtpp_proc_rstats *);
+void rtpp_proc_rsztmr_free(struct rtpp_proc_rsztmr *);
 
 #endif
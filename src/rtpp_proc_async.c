@@ -53,6 +53,7 @@
 #include "rtpp_command_async.h"
 #include "rtpp_debug.h"
 #include "rtpp_netio_async.h"
+#include "rtpp_lhist.h"
 #include "rtpp_proc.h"
 #include "rtpp_proc_async.h"
 #include "rtpp_proc_wakeup.h"
@@ -72,6 +73,8 @@
 #include "rtp_packet.h"
 #include "rtpp_ttl.h"
 #include "rtpp_threads.h"
+#include "rtpp_tload.h"
+#include "rtpp_cpuset.h"
 #include "advanced/pproc_manager.h"
 #include "advanced/packet_processor.h"
 
@@ -81,24 +84,28 @@ struct rtpp_proc_thread_cf {
     pthread_t thread_id;
     _Atomic(int) tstate;
     int pipe_type;
+    int shard;
     struct rtpp_polltbl ptbl;
     const struct rtpp_proc_async_cf *proc_cf;
     struct rtpp_proc_rstats rstats;
     struct epoll_event *events;
     int events_alloc;
+    struct rtpp_tload_ent *tlp;
+    struct rtpp_proc_rsztmr rsztmr;
 };
 
 struct rtpp_proc_async_cf {
     struct rtpp_proc_async pub;
     const struct rtpp_cfg *cf_save;
-    struct rtpp_proc_thread_cf rtp_thread;
-    struct rtpp_proc_thread_cf rtcp_thread;
     struct rtpp_proc_wakeup *wakeup_cf;
     int npkts_relayed_idx;
+    /* RTP and RTCP thread for each media shard, interleaved */
+    int nthreads;
+    struct rtpp_proc_thread_cf threads[0];
 };
 
 static void rtpp_proc_async_dtor(struct rtpp_proc_async *);
-static int rtpp_proc_async_nudge(struct rtpp_proc_async *);
+static int rtpp_proc_async_nudge(struct rtpp_proc_async *, int);
 
 static void
 flush_rstats(struct rtpp_stats *sobj, struct rtpp_proc_rstats *rsp)
@@ -113,7 +120,15 @@ flush_rstats(struct rtpp_stats *sobj, struct rtpp_proc_rstats *rsp)
 }
 
 static void
-init_rstats(struct rtpp_stats *sobj, struct rtpp_proc_rstats *rsp)
+flush_lstats(struct rtpp_stats *sobj, struct rtpp_proc_rstats *rsp)
+{
+
+    FLUSH_LSTAT(sobj, rsp->lat_rx);
+    FLUSH_LSTAT(sobj, rsp->lat_pproc);
+}
+
+static void
+init_rstats(struct rtpp_stats *sobj, struct rtpp_proc_rstats *rsp, int pipe_type)
 {
 
     rsp->npkts_rcvd.cnt_idx = CALL_SMETHOD(sobj, getidxbyname, "npkts_rcvd");
@@ -122,6 +137,10 @@ init_rstats(struct rtpp_stats *sobj, struct rtpp_proc_rstats *rsp)
     rsp->npkts_resizer_out.cnt_idx = CALL_SMETHOD(sobj, getidxbyname, "npkts_resizer_out");
     rsp->npkts_resizer_discard.cnt_idx = CALL_SMETHOD(sobj, getidxbyname, "npkts_resizer_discard");
     rsp->npkts_discard.cnt_idx = CALL_SMETHOD(sobj, getidxbyname, "npkts_discard");
+    rsp->lat_rx.hist_idx = CALL_SMETHOD(sobj, getidxbyname,
+      (pipe_type == PIPE_RTP) ? "lat_rtp_rx" : "lat_rtcp_rx");
+    rsp->lat_pproc.hist_idx = CALL_SMETHOD(sobj, getidxbyname,
+      (pipe_type == PIPE_RTP) ? "lat_rtp_pproc" : "lat_rtcp_pproc");
 }
 
 static void
@@ -138,6 +157,10 @@ rtpp_proc_async_run(void *arg)
     struct rtpp_stats *stats_cf;
     int tstate;
     struct rtpp_timestamp rtime;
+    double last_lflush, tleft;
+    unsigned int nitems;
+    int tout;
+    struct rtpp_proc_rsztmr *rsztmrp;
 
     tcp = (struct rtpp_proc_thread_cf *)arg;
     proc_cf = tcp->proc_cf;
@@ -146,6 +169,11 @@ rtpp_proc_async_run(void *arg)
     rstats = &tcp->rstats;
 
     memset(&rtime, '\0', sizeof(rtime));
+    last_lflush = 0.0;
+    nitems = 0;
+    /* Only RTP streams can have resizer */
+    rsztmrp = (tcp->pipe_type == PIPE_RTP) ? &tcp->rsztmr : NULL;
+    rtp_packet_setshard(tcp->shard);
 
     RTPP_DBGCODE(netio) {
         last_ctick = 0;
@@ -166,7 +194,16 @@ rtpp_proc_async_run(void *arg)
               "polling for %d %s file descriptors", \
               last_ctick, tcp->ptbl.curlen, PP_NAME(tcp->pipe_type));
         }
-        nready = rtpp_epoll_wait(tcp->ptbl.epfd, tcp->events, tcp->events_alloc, -1);
+        tout = -1;
+        rtpp_tload_sleep(tcp->tlp, getdtime(), nitems);
+        nitems = 0;
+        if (tcp->rsztmr.len > 0) {
+            tleft = tcp->rsztmr.heap[0].deadline - getdtime();
+            tout = (tleft > 0.0) ? (int)(tleft * 1000.0) + 1 : 0;
+        }
+        nready = rtpp_epoll_wait(tcp->ptbl.epfd, tcp->events, tcp->events_alloc, tout);
+        rtpp_timestamp_get(&rtime);
+        rtpp_tload_wake(tcp->tlp, rtime.mono);
         RTPP_DBGCODE(netio) {
             RTPP_DBGCODE(netio > 1 || nready > 0) {
                 RTPP_LOG(cfsp->glog, RTPP_LOG_DBUG, "run %lld " \
@@ -177,18 +214,27 @@ rtpp_proc_async_run(void *arg)
         if (nready < 0 && errno == EINTR) {
             continue;
         }
-        if (nready == 0)
+        if (nready == 0 && tcp->rsztmr.len == 0)
             goto next;
 
-        rtpp_timestamp_get(&rtime);
         RTPP_DBG_ASSERT(rtime.wall > 0 && rtime.mono > 0);
 
-        sender = rtpp_anetio_pick_sender(proc_cf->pub.netio);
-        process_rtp_only(cfsp, &tcp->ptbl, &rtime, ndrain, sender, rstats,
-          tcp->events, nready);
+        sender = rtpp_anetio_get_sender(proc_cf->pub.netio, tcp->shard);
+        if (nready > 0) {
+            process_rtp_only(cfsp, &tcp->ptbl, &rtime, ndrain, sender, rstats,
+              tcp->events, nready, rsztmrp);
+        }
+        if (tcp->rsztmr.len > 0) {
+            process_rtp_resizers(cfsp, &tcp->rsztmr, &rtime, sender, rstats);
+        }
 
         rtpp_anetio_pump_q(sender);
+        nitems = rstats->npkts_rcvd.cnt;
         flush_rstats(stats_cf, rstats);
+        if (rtime.mono - last_lflush >= RTPP_PROC_LFLUSH_IVAL) {
+            flush_lstats(stats_cf, rstats);
+            last_lflush = rtime.mono;
+        }
 
         if (nready == tcp->events_alloc) {
             struct epoll_event *tep;
@@ -205,6 +251,8 @@ next:
             last_ctick++;
         }
     }
+    rtpp_proc_rsztmr_free(&tcp->rsztmr);
+    flush_lstats(stats_cf, rstats);
     rtpp_polltbl_free(&tcp->ptbl);
 }
 
@@ -223,9 +271,10 @@ rtpp_proc_async_setprocname(pthread_t thread_id, const char *pname)
 
 static int
 rtpp_proc_async_thread_init(const struct rtpp_cfg *cfsp, const struct rtpp_proc_async_cf *proc_cf,
-  struct rtpp_proc_thread_cf *tcp, int pipe_type)
+  struct rtpp_proc_thread_cf *tcp, int pipe_type, int shard)
 {
     struct epoll_event epevent;
+    char pname[16], tname[32];
 
     tcp->ptbl.epfd = rtpp_epoll_create();
     if (tcp->ptbl.epfd < 0)
@@ -239,20 +288,37 @@ rtpp_proc_async_thread_init(const struct rtpp_cfg *cfsp, const struct rtpp_proc_
 
     tcp->proc_cf = proc_cf;
     tcp->pipe_type = pipe_type;
+    tcp->shard = tcp->ptbl.shard = shard;
 
-    init_rstats(cfsp->rtpp_stats, &tcp->rstats);
+    init_rstats(cfsp->rtpp_stats, &tcp->rstats, pipe_type);
 
     tcp->events_alloc = 16;
     tcp->events = rtpp_zmalloc(sizeof(tcp->events[0]) * tcp->events_alloc);
     if (tcp->events == NULL)
         goto e2;
 
-    if (pthread_create(&tcp->thread_id, NULL, (void *(*)(void *))&rtpp_proc_async_run, tcp) != 0) {
+    if (cfsp->nshards > 1) {
+        snprintf(pname, sizeof(pname), "%s%.2d", PP_NAME(pipe_type), shard);
+    } else {
+        snprintf(pname, sizeof(pname), "%s", PP_NAME(pipe_type));
+    }
+    snprintf(tname, sizeof(tname), "rtpp_proc: %s", pname);
+    tcp->tlp = CALL_SMETHOD(cfsp->rtpp_tload, reg, tname, NULL);
+    if (tcp->tlp == NULL)
         goto e3;
+
+    if (pthread_create(&tcp->thread_id, NULL, (void *(*)(void *))&rtpp_proc_async_run, tcp) != 0) {
+        goto e4;
     }
-    rtpp_proc_async_setprocname(tcp->thread_id, PP_NAME(pipe_type));
+    rtpp_proc_async_setprocname(tcp->thread_id, pname);
+    if (rtpp_cpusets_apply(cfsp->cpusets, RTPP_TCLASS_PROC, shard,
+      tcp->thread_id) != 0)
+        RTPP_ELOG(cfsp->glog, RTPP_LOG_ERR, "can't set CPU affinity for %s",
+          tname);
     return (0);
 
+e4:
+    CALL_SMETHOD(tcp->tlp->owner, unreg, tcp->tlp);
 e3:
     free(tcp->events);
 e2:
@@ -273,6 +339,7 @@ rtpp_proc_async_thread_destroy(struct rtpp_proc_thread_cf *tcp)
     close(tcp->ptbl.wakefd[1]);
     atomic_store(&tcp->tstate, TSTATE_CEASE);
     pthread_join(tcp->thread_id, NULL);
+    CALL_SMETHOD(tcp->tlp->owner, unreg, tcp->tlp);
     free(tcp->events);
 }
 
@@ -327,8 +394,10 @@ struct rtpp_proc_async *
 rtpp_proc_async_ctor(const struct rtpp_cfg *cfsp)
 {
     struct rtpp_proc_async_cf *proc_cf;
+    int i, wakefds[2 * RTPP_MAX_SHARDS];
 
-    proc_cf = rtpp_zmalloc(sizeof(*proc_cf));
+    proc_cf = rtpp_zmalloc(sizeof(*proc_cf) +
+      sizeof(proc_cf->threads[0]) * 2 * cfsp->nshards);
     if (proc_cf == NULL)
         return (NULL);
 
@@ -347,7 +416,8 @@ rtpp_proc_async_ctor(const struct rtpp_cfg *cfsp)
         .descr = "relay_packet",
         .arg = (void *)proc_cf,
         .key = (void *)&relay_packet,
-        .enqueue = &relay_packet
+        .enqueue = &relay_packet,
+        .flags = PPROC_IF_FLAG_STOCK
     };
     if (CALL_SMETHOD(cfsp->pproc_manager, reg, PPROC_ORD_RELAY, &relay_packet_poi) < 0)
         goto e1;
@@ -356,23 +426,24 @@ rtpp_proc_async_ctor(const struct rtpp_cfg *cfsp)
         .descr = "record_packet",
         .arg = (void *)proc_cf,
         .key = (void *)&record_packet,
-        .enqueue = &record_packet
+        .enqueue = &record_packet,
+        .flags = PPROC_IF_FLAG_STOCK
     };
     if (CALL_SMETHOD(cfsp->pproc_manager, reg, PPROC_ORD_WITNESS, &record_packet_poi) < 0)
         goto e2;
 
-    if (rtpp_proc_async_thread_init(cfsp, proc_cf, &proc_cf->rtp_thread, PIPE_RTP) != 0) {
-        goto e3;
-    }
-
-    if (rtpp_proc_async_thread_init(cfsp, proc_cf, &proc_cf->rtcp_thread, PIPE_RTCP) != 0) {
-        goto e4;
+    for (i = 0; i < 2 * cfsp->nshards; i++) {
+        if (rtpp_proc_async_thread_init(cfsp, proc_cf, &proc_cf->threads[i],
+          (i % 2) == 0 ? PIPE_RTP : PIPE_RTCP, i / 2) != 0) {
+            goto e3;
+        }
+        proc_cf->nthreads++;
+        wakefds[i] = proc_cf->threads[i].ptbl.wakefd[1];
     }
 
-    proc_cf->wakeup_cf = rtpp_proc_wakeup_ctor(proc_cf->rtp_thread.ptbl.wakefd[1],
-      proc_cf->rtcp_thread.ptbl.wakefd[1]);
+    proc_cf->wakeup_cf = rtpp_proc_wakeup_ctor(wakefds, proc_cf->nthreads);
     if (proc_cf->wakeup_cf == NULL)
-        goto e5;
+        goto e3;
 
     RTPP_OBJ_INCREF(cfsp->rtpp_stats);
     RTPP_OBJ_INCREF(cfsp->pproc_manager);
@@ -380,11 +451,9 @@ rtpp_proc_async_ctor(const struct rtpp_cfg *cfsp)
     proc_cf->pub.dtor = &rtpp_proc_async_dtor;
     proc_cf->pub.nudge = &rtpp_proc_async_nudge;
     return (&proc_cf->pub);
-e5:
-    rtpp_proc_async_thread_destroy(&proc_cf->rtcp_thread);
-e4:
-    rtpp_proc_async_thread_destroy(&proc_cf->rtp_thread);
 e3:
+    while (proc_cf->nthreads > 0)
+        rtpp_proc_async_thread_destroy(&proc_cf->threads[--proc_cf->nthreads]);
     CALL_SMETHOD(cfsp->pproc_manager, unreg, record_packet_poi.key);
 e2:
     CALL_SMETHOD(cfsp->pproc_manager, unreg, relay_packet_poi.key);
@@ -404,8 +473,8 @@ rtpp_proc_async_dtor(struct rtpp_proc_async *pub)
     RTPP_OBJ_DECREF(proc_cf->wakeup_cf);
     CALL_SMETHOD(proc_cf->cf_save->pproc_manager, unreg, record_packet);
     CALL_SMETHOD(proc_cf->cf_save->pproc_manager, unreg, relay_packet);
-    rtpp_proc_async_thread_destroy(&proc_cf->rtcp_thread);
-    rtpp_proc_async_thread_destroy(&proc_cf->rtp_thread);
+    while (proc_cf->nthreads > 0)
+        rtpp_proc_async_thread_destroy(&proc_cf->threads[--proc_cf->nthreads]);
     rtpp_netio_async_destroy(proc_cf->pub.netio);
     RTPP_OBJ_DECREF(proc_cf->cf_save->rtpp_stats);
     RTPP_OBJ_DECREF(proc_cf->cf_save->pproc_manager);
@@ -413,12 +482,12 @@ rtpp_proc_async_dtor(struct rtpp_proc_async *pub)
 }
 
 static int
-rtpp_proc_async_nudge(struct rtpp_proc_async *pub)
+rtpp_proc_async_nudge(struct rtpp_proc_async *pub, int shard)
 {
     struct rtpp_proc_async_cf *proc_cf;
     int nres;
 
     PUB2PVT(pub, proc_cf);
-    nres = CALL_SMETHOD(proc_cf->wakeup_cf, nudge);
+    nres = CALL_SMETHOD(proc_cf->wakeup_cf, nudge, shard);
     return (nres);
 }
@@ -33,7 +33,7 @@ struct rtpp_anetio_cf;
 struct rtpp_cfg;
 
 DEFINE_METHOD(rtpp_proc_async, rtpp_proc_async_dtor, void);
-DEFINE_METHOD(rtpp_proc_async, rtpp_proc_async_nudge, int);
+DEFINE_METHOD(rtpp_proc_async, rtpp_proc_async_nudge, int, int);
 
 struct rtpp_proc_async {
     struct rtpp_anetio_cf *netio;
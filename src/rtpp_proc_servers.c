@@ -37,6 +37,7 @@
 #include <pthread.h>
 #include <signal.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -51,6 +52,7 @@
 #include "rtp.h"
 #include "rtpp_time.h"
 #include "rtp_packet.h"
+#include "rtpp_lhist.h"
 #include "rtpp_proc.h"
 #include "rtpp_proc_servers.h"
 #include "rtpp_proc_servers_fin.h"
@@ -65,6 +67,7 @@
 #include "rtpp_wi.h"
 #include "rtpp_wi_sgnl.h"
 #include "rtpp_wi_data.h"
+#include "rtpp_tload.h"
 #include "advanced/packet_processor.h"
 #include "advanced/pproc_manager.h"
 
@@ -77,6 +80,7 @@ struct rtpp_proc_servers_priv {
     struct rtpp_queue *cmd_q;
     struct rtpp_wi *sigterm;
     struct rtpp_weakref *act_servers;
+    struct rtpp_tload_ent *tlp;
     struct rtpp_weakref *inact_servers;
 };
 
@@ -93,7 +97,9 @@ DEFINE_SMETHODS(rtpp_proc_servers,
 
 struct foreach_args {
     double dtime;
-    struct sthread_args *sender;
+    struct rtpp_anetio_cf *netio;
+    /* Shards whose sender got packets and has to be pumped */
+    uint64_t *pump_mask;
     struct rtpp_proc_stat *npkts_played;
     const struct rtpp_cfg *cfsp;
     struct rtpp_weakref *inact_servers;
@@ -108,6 +114,7 @@ process_rtp_servers_foreach(void *dp, void *ap)
     int len;
     struct rtpp_stream *strmp_out;
     struct rtpp_stream *strmp_in;
+    struct sthread_args *sender;
 
     fap = (struct foreach_args *)ap;
     /*
@@ -121,6 +128,7 @@ process_rtp_servers_foreach(void *dp, void *ap)
     strmp_in = CALL_SMETHOD(strmp_out, get_sender, fap->cfsp);
     if (strmp_in == NULL)
         goto e1;
+    sender = rtpp_anetio_get_sender(fap->netio, strmp_out->shard);
     for (;;) {
         pkt = CALL_SMETHOD(rsrv, get, fap->dtime, &len);
         if (pkt == NULL) {
@@ -134,7 +142,8 @@ process_rtp_servers_foreach(void *dp, void *ap)
             }
             break;
         }
-        pkt->sender = fap->sender;
+        pkt->sender = sender;
+        *fap->pump_mask |= 1ULL << strmp_out->shard;
         struct pkt_proc_ctx pktx = {
             .strmp_in = strmp_in,
             .strmp_out = strmp_out,
@@ -153,12 +162,15 @@ e0:
 }
 
 
-static void
+static unsigned int
 run_servers(struct rtpp_proc_servers_priv *tp, double dtime)
 {
+    unsigned int nplayed;
+    uint64_t pump_mask = 0;
     const struct foreach_args fargs = {
         .dtime = dtime,
-        .sender = rtpp_anetio_pick_sender(tp->netio),
+        .netio = tp->netio,
+        .pump_mask = &pump_mask,
         .npkts_played = &tp->npkts_played,
         .cfsp = tp->cfsp,
         .inact_servers = tp->inact_servers,
@@ -167,8 +179,13 @@ run_servers(struct rtpp_proc_servers_priv *tp, double dtime)
     CALL_SMETHOD(tp->act_servers, foreach, process_rtp_servers_foreach,
       (void *)&fargs);
 
-    rtpp_anetio_pump_q(fargs.sender);
+    for (int i = 0; pump_mask != 0; i++, pump_mask >>= 1) {
+        if (pump_mask & 1)
+            rtpp_anetio_pump_q(rtpp_anetio_get_sender(tp->netio, i));
+    }
+    nplayed = tp->npkts_played.cnt;
     FLUSH_STAT(tp->cfsp->rtpp_stats, tp->npkts_played);
+    return (nplayed);
 }
 
 static void
@@ -179,11 +196,15 @@ rtpp_proc_servers_run(void *argp)
     int signum, rval;
     double next_dtime = 0;
     struct timespec deadline;
+    unsigned int nitems = 0;
 
     stap = (struct rtpp_proc_servers_priv *)argp;
     for (;;) {
+        rtpp_tload_sleep(stap->tlp, getdtime(), nitems);
+        nitems = 0;
         if (CALL_SMETHOD(stap->act_servers, get_length) == 0) {
             wi = rtpp_queue_get_item(stap->cmd_q, 1);
+            rtpp_tload_wake(stap->tlp, getdtime());
             next_dtime = 0;
             if (wi == NULL)
                 continue;
@@ -192,14 +213,16 @@ rtpp_proc_servers_run(void *argp)
                 dtime2mtimespec(next_dtime, &deadline);
                 rval = 0;
                 wi = rtpp_queue_get_item_by(stap->cmd_q, &deadline, &rval);
+                rtpp_tload_wake(stap->tlp, getdtime());
             } else {
                 wi = NULL;
                 rval = ETIMEDOUT;
                 next_dtime = getdtime();
+                rtpp_tload_wake(stap->tlp, next_dtime);
             }
             if (wi == NULL) {
                 if (rval == ETIMEDOUT) {
-                    run_servers(stap, next_dtime);
+                    nitems = run_servers(stap, next_dtime);
                     next_dtime += 0.01;
                 }
                 continue;
@@ -231,6 +254,7 @@ rtpp_proc_servers_dtor(struct rtpp_proc_servers_priv *stap)
     rtpp_proc_servers_fin(&(stap->pub));
     rtpp_queue_put_item(stap->sigterm, stap->cmd_q);
     pthread_join(stap->thread_id, NULL);
+    CALL_SMETHOD(stap->tlp->owner, unreg, stap->tlp);
     RTPP_OBJ_DECREF(stap->inact_servers);
     RTPP_OBJ_DECREF(stap->act_servers);
     rtpp_queue_destroy(stap->cmd_q);
@@ -267,9 +291,14 @@ rtpp_proc_servers_ctor(const struct rtpp_cfg *cfsp, struct rtpp_anetio_cf *netio
     stap->cfsp = cfsp;
     stap->npkts_played.cnt_idx = CALL_SMETHOD(cfsp->rtpp_stats, getidxbyname, "npkts_played");
 
+    stap->tlp = CALL_SMETHOD(cfsp->rtpp_tload, reg, "rtpp_proc_servers", stap->cmd_q);
+    if (stap->tlp == NULL) {
+        goto e5;
+    }
+
     if (pthread_create(&stap->thread_id, NULL,
       (void *(*)(void *))&rtpp_proc_servers_run, stap) != 0) {
-        goto e5;
+        goto e6;
     }
 #if HAVE_PTHREAD_SETNAME_NP
     (void)pthread_setname_np(stap->thread_id, "rtpp_proc_servers");
@@ -277,6 +306,8 @@ rtpp_proc_servers_ctor(const struct rtpp_cfg *cfsp, struct rtpp_anetio_cf *netio
 
     PUBINST_FININIT(&stap->pub, stap, rtpp_proc_servers_dtor);
     return (&stap->pub);
+e6:
+    CALL_SMETHOD(stap->tlp->owner, unreg, stap->tlp);
 e5:
     RTPP_OBJ_DECREF(stap->inact_servers);
 e4:
@@ -58,11 +58,15 @@
 #include "rtpp_timeout_data.h"
 #include "rtpp_locking.h"
 #include "rtpp_threads.h"
+#include "rtpp_time.h"
+#include "rtpp_tload.h"
+#include "rtpp_repl.h"
 
 struct foreach_args {
     struct rtpp_notify *rtpp_notify_cf;
     struct rtpp_stats *rtpp_stats;
     struct rtpp_weakref *sessions_wrt;
+    struct rtpp_repl *repl;
 };
 
 struct rtpp_proc_ttl_pvt {
@@ -73,6 +77,7 @@ struct rtpp_proc_ttl_pvt {
     void *elp;
     struct rtpp_hash_table *sessions_ht;
     struct foreach_args fa;
+    struct rtpp_tload_ent *tlp;
 };
 
 static void rtpp_proc_ttl(struct rtpp_hash_table *, const struct foreach_args *);
@@ -92,6 +97,9 @@ rtpp_proc_ttl_foreach(void *dp, void *ap)
      */
     sp = (const struct rtpp_session *)dp;
 
+    /* Belongs to the warm restart successor, which times it out on its own */
+    if (sp->handed_off != 0)
+        return (RTPP_HT_MATCH_CONT);
     if (CALL_SMETHOD(sp->rtp, get_ttl) == 0) {
         RTPP_LOG(sp->log, RTPP_LOG_INFO, "session timeout");
         if (sp->timeout_data != NULL) {
@@ -101,6 +109,8 @@ rtpp_proc_ttl_foreach(void *dp, void *ap)
         }
         CALL_SMETHOD(fap->rtpp_stats, updatebyname, "nsess_timeout", 1);
         CALL_SMETHOD(fap->sessions_wrt, unreg, sp->seuid);
+        if (fap->repl != NULL)
+            CALL_METHOD(fap->repl, note, sp->seuid);
         return (RTPP_HT_MATCH_DEL);
     } else {
         CALL_SMETHOD(sp->rtp, decr_ttl);
@@ -128,7 +138,9 @@ rtpp_proc_ttl_run(void *arg)
         if (tstate == TSTATE_CEASE) {
             break;
         }
+        rtpp_tload_sleep(proc_cf->tlp, getdtime(), 0);
         prdic_procrastinate(proc_cf->elp);
+        rtpp_tload_wake(proc_cf->tlp, getdtime());
         rtpp_proc_ttl(proc_cf->sessions_ht, &proc_cf->fa);
     }
 }
@@ -144,6 +156,7 @@ rtpp_proc_ttl_dtor(struct rtpp_proc_ttl *pub)
     assert(tstate == TSTATE_RUN);
     atomic_store(&proc_cf->tstate, TSTATE_CEASE);
     pthread_join(proc_cf->thread_id, NULL);
+    CALL_SMETHOD(proc_cf->tlp->owner, unreg, proc_cf->tlp);
     RTPP_OBJ_DECREF(proc_cf->sessions_ht);
     RTPP_OBJ_DECREF(proc_cf->fa.sessions_wrt);
     RTPP_OBJ_DECREF(proc_cf->fa.rtpp_notify_cf);
@@ -172,17 +185,25 @@ rtpp_proc_ttl_ctor(const struct rtpp_cfg *cfsp)
     RTPP_OBJ_INCREF(cfsp->rtpp_stats);
     proc_cf->fa.sessions_wrt = cfsp->sessions_wrt;
     RTPP_OBJ_INCREF(cfsp->sessions_wrt);
+    proc_cf->fa.repl = cfsp->rtpp_repl_cf;
     proc_cf->sessions_ht = cfsp->sessions_ht;
     RTPP_OBJ_INCREF(cfsp->sessions_ht);
 
-    if (pthread_create(&proc_cf->thread_id, NULL, (void *(*)(void *))&rtpp_proc_ttl_run, proc_cf) != 0) {
+    proc_cf->tlp = CALL_SMETHOD(cfsp->rtpp_tload, reg, "rtpp_proc_ttl", NULL);
+    if (proc_cf->tlp == NULL) {
         goto e1;
     }
+
+    if (pthread_create(&proc_cf->thread_id, NULL, (void *(*)(void *))&rtpp_proc_ttl_run, proc_cf) != 0) {
+        goto e2;
+    }
 #if HAVE_PTHREAD_SETNAME_NP
     (void)pthread_setname_np(proc_cf->thread_id, "rtpp_proc_ttl");
 #endif
     proc_cf->pub.dtor = &rtpp_proc_ttl_dtor;
     return (&proc_cf->pub);
+e2:
+    CALL_SMETHOD(proc_cf->tlp->owner, unreg, proc_cf->tlp);
 e1:
     RTPP_OBJ_DECREF(cfsp->rtpp_stats);
     RTPP_OBJ_DECREF(cfsp->sessions_ht);
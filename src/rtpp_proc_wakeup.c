@@ -32,6 +32,7 @@
 #include <pthread.h>
 #include <stdatomic.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
 
@@ -42,6 +43,7 @@
 #include "rtpp_codeptr.h"
 #include "rtpp_refcnt.h"
 #include "rtpp_mallocs.h"
+#include "rtpp_cfg.h"
 #include "rtpp_time.h"
 #include "rtpp_threads.h"
 #include "rtpp_proc_async.h"
@@ -58,19 +60,15 @@ struct rtpp_proc_wakeup_priv {
     int delivered_i_wake;
     pthread_mutex_t mutex;
     pthread_cond_t cond;
-    struct {
-        union {
-            struct {
-                int rtp;
-                int rtcp;
-            };
-            int n[0];
-        };
-    } wakefds;
+    /* Shards that have been nudged since the last delivery */
+    uint64_t pending;
+    /* RTP and RTCP threads of every media shard, interleaved */
+    int nwakefds;
+    int wakefds[0];
 };
 
 static void rtpp_proc_wakeup_dtor(struct rtpp_proc_wakeup_priv *);
-static int rtpp_proc_wakeup_nudge(struct rtpp_proc_wakeup *);
+static int rtpp_proc_wakeup_nudge(struct rtpp_proc_wakeup *, int);
 
 DEFINE_SMETHODS(rtpp_proc_wakeup,
     .nudge = &rtpp_proc_wakeup_nudge,
@@ -81,6 +79,7 @@ rtpp_proc_wakeup_run(void *arg)
 {
     struct rtpp_proc_wakeup_priv *wtcp;
     int requested_i_wake = 0;
+    uint64_t pending;
     double last_wakeup = 0, wakeup_at = 0;
     const double wakeup_ival = 1.0 / MAX_WAKEUPS_PS;
 
@@ -117,27 +116,31 @@ rtpp_proc_wakeup_run(void *arg)
         }
 deliver:
         wtcp->delivered_i_wake = requested_i_wake;
+        pending = wtcp->pending;
+        wtcp->pending = 0;
         pthread_mutex_unlock(&wtcp->mutex);
 
-        ret = write(wtcp->wakefds.rtp, &requested_i_wake,
-          sizeof(requested_i_wake));
-        RTPP_DBG_ASSERT(ret < 0 || ret == sizeof(requested_i_wake));
-        ret = write(wtcp->wakefds.rtcp, &requested_i_wake,
-          sizeof(requested_i_wake));
-        RTPP_DBG_ASSERT(ret < 0 || ret == sizeof(requested_i_wake));
+        for (int i = 0; i < wtcp->nwakefds; i++) {
+            if ((pending & (1ULL << (i / 2))) == 0)
+                continue;
+            ret = write(wtcp->wakefds[i], &requested_i_wake,
+              sizeof(requested_i_wake));
+            RTPP_DBG_ASSERT(ret < 0 || ret == sizeof(requested_i_wake));
+        }
         last_wakeup = getdtime();
         wakeup_at = 0;
     }
 }
 
 struct rtpp_proc_wakeup *
-rtpp_proc_wakeup_ctor(int rtp_wakefd, int rtcp_wakefd)
+rtpp_proc_wakeup_ctor(const int *wakefds, int nwakefds)
 {
     pthread_condattr_t cond_attr;
     struct rtpp_proc_wakeup_priv *pvt;
 
-    RTPP_DBG_ASSERT(rtp_wakefd > 0 && rtcp_wakefd > 0);
-    pvt = rtpp_rzmalloc(sizeof(struct rtpp_proc_wakeup_priv), PVT_RCOFFS(pvt));
+    RTPP_DBG_ASSERT(nwakefds > 0 && nwakefds <= 2 * RTPP_MAX_SHARDS);
+    pvt = rtpp_rzmalloc(sizeof(struct rtpp_proc_wakeup_priv) +
+      sizeof(pvt->wakefds[0]) * nwakefds, PVT_RCOFFS(pvt));
     if (pvt == NULL)
         goto e0;
     if (pthread_mutex_init(&pvt->mutex, NULL) != 0)
@@ -149,8 +152,11 @@ rtpp_proc_wakeup_ctor(int rtp_wakefd, int rtcp_wakefd)
     if (pthread_cond_init(&pvt->cond, &cond_attr) != 0)
         goto e3;
     atomic_init(&pvt->tstate, TSTATE_CEASE);
-    pvt->wakefds.rtp = rtp_wakefd;
-    pvt->wakefds.rtcp = rtcp_wakefd;
+    for (int i = 0; i < nwakefds; i++) {
+        RTPP_DBG_ASSERT(wakefds[i] > 0);
+        pvt->wakefds[i] = wakefds[i];
+    }
+    pvt->nwakefds = nwakefds;
     if (pthread_create(&pvt->thread_id, NULL, (void *(*)(void *))&rtpp_proc_wakeup_run, pvt) != 0)
         goto e4;
     pthread_condattr_destroy(&cond_attr);
@@ -183,7 +189,7 @@ rtpp_proc_wakeup_dtor(struct rtpp_proc_wakeup_priv *pvt)
     rtpp_proc_wakeup_fin(&(pvt->pub));
     atomic_store(&pvt->tstate, TSTATE_CEASE);
     /* notify worker thread */
-    rtpp_proc_wakeup_nudge(&(pvt->pub));
+    rtpp_proc_wakeup_nudge(&(pvt->pub), -1);
     pthread_join(pvt->thread_id, NULL);
     pthread_cond_destroy(&pvt->cond);
     pthread_mutex_destroy(&pvt->mutex);
@@ -191,13 +197,14 @@ rtpp_proc_wakeup_dtor(struct rtpp_proc_wakeup_priv *pvt)
 }
 
 static int
-rtpp_proc_wakeup_nudge(struct rtpp_proc_wakeup *self)
+rtpp_proc_wakeup_nudge(struct rtpp_proc_wakeup *self, int shard)
 {
     struct rtpp_proc_wakeup_priv *pvt;
     int requested_i_wake, delivered_i_wake;
 
     PUB2PVT(self, pvt);
     pthread_mutex_lock(&pvt->mutex);
+    pvt->pending |= (shard < 0) ? ~0ULL : (1ULL << shard);
     pvt->requested_i_wake += 1;
     requested_i_wake = pvt->requested_i_wake;
     delivered_i_wake = pvt->delivered_i_wake;
@@ -27,9 +27,10 @@
 
 #pragma once
 
-DECLARE_CLASS(rtpp_proc_wakeup, int, int);
+DECLARE_CLASS(rtpp_proc_wakeup, const int *, int);
 
-DECLARE_METHOD(rtpp_proc_wakeup, rtpp_proc_wakeup_nudge, int);
+/* Wakes up the RTP and RTCP threads of the shard, all of them if < 0 */
+DECLARE_METHOD(rtpp_proc_wakeup, rtpp_proc_wakeup_nudge, int, int);
 
 DECLARE_SMETHODS(rtpp_proc_wakeup)
 {
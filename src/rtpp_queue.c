@@ -33,6 +33,7 @@
 #include <assert.h>
 #include <pthread.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -248,6 +249,8 @@ struct rtpp_queue
     unsigned int length;
     unsigned int qlen;
     unsigned int mlen;
+    unsigned int hwm;
+    uint64_t ndrops;
     circ_buf_t circb;
     char name[128];
 };
@@ -364,6 +367,7 @@ rtpp_queue_put_item(struct rtpp_wi *wi, struct rtpp_queue *queue)
      * is preserved while pulling them out.
      */
     if (queue->mlen != -1 && rtpp_queue_getclen(queue) >= queue->mlen) {
+        queue->ndrops++;
         rval = -1;
         goto out;
     }
@@ -375,7 +379,11 @@ rtpp_queue_put_item(struct rtpp_wi *wi, struct rtpp_queue *queue)
 #endif
     }
 
-    if ((queue->qlen == 1) || (queue->qlen > 1 && rtpp_queue_getclen(queue) % queue->qlen == 0) || wi->wi_type == RTPP_WI_TYPE_SGNL) {
+    unsigned int clen = rtpp_queue_getclen(queue);
+    if (clen > queue->hwm)
+        queue->hwm = clen;
+
+    if ((queue->qlen == 1) || (queue->qlen > 1 && clen % queue->qlen == 0) || wi->wi_type == RTPP_WI_TYPE_SGNL) {
         /* notify worker thread */
         pthread_cond_signal(&queue->cond);
     }
@@ -517,6 +525,24 @@ rtpp_queue_get_length(struct rtpp_queue *queue)
     return (length);
 }
 
+void
+rtpp_queue_get_stats(struct rtpp_queue *queue, struct rtpp_queue_stats *qsp)
+{
+
+    pthread_mutex_lock(&queue->mutex);
+    qsp->length = rtpp_queue_getclen(queue);
+    qsp->hwm = queue->hwm;
+    qsp->ndrops = queue->ndrops;
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+const char *
+rtpp_queue_get_name(const struct rtpp_queue *queue)
+{
+
+    return (queue->name);
+}
+
 #if 0
 int
 rtpp_queue_count_matching(struct rtpp_queue *queue, rtpp_queue_match_fn_t match_fn, void *fn_args)
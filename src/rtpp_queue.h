@@ -75,6 +75,12 @@ struct timespec;
 #define RTPQ_MEDIUM_CB_LEN 256
 #define RTPQ_LARGE_CB_LEN 1024
 
+struct rtpp_queue_stats {
+    unsigned int length;   /* current number of items queued */
+    unsigned int hwm;      /* highest number of items ever queued */
+    uint64_t ndrops;       /* items rejected due to the max length limit */
+};
+
 struct rtpp_queue *rtpp_queue_init(unsigned int, const char *format, ...);
 void rtpp_queue_destroy(struct rtpp_queue *queue);
 
@@ -87,6 +93,8 @@ struct rtpp_wi *rtpp_queue_get_item_by(struct rtpp_queue *queue, struct timespec
   int *);
 int rtpp_queue_get_items(struct rtpp_queue *, struct rtpp_wi **, int, int);
 int rtpp_queue_get_length(struct rtpp_queue *);
+void rtpp_queue_get_stats(struct rtpp_queue *, struct rtpp_queue_stats *);
+const char *rtpp_queue_get_name(const struct rtpp_queue *);
 unsigned int rtpp_queue_setqlen(struct rtpp_queue *, unsigned int);
 
 DEFINE_METHOD(rtpp_wi, rtpp_queue_match_fn, int, void *);
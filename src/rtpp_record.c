@@ -43,6 +43,7 @@
 #include <limits.h>
 #include <netdb.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -76,10 +77,13 @@
 #include "rtpp_util.h"
 #include "rtpp_pipe.h"
 #include "rtpp_netaddr.h"
+#include "rtpp_netio_async.h"
 #include "advanced/pproc_manager.h"
 
 enum record_mode {MODE_LOCAL_PKT, MODE_REMOTE_RTP, MODE_LOCAL_PCAP}; /* MODE_LOCAL_RTP/MODE_REMOTE_PKT? */
 
+#define RTPP_RECORD_MAX_RDST 8
+
 struct rtpp_record_channel {
     struct rtpp_record pub;
     pthread_mutex_t lock;
@@ -94,6 +98,10 @@ struct rtpp_record_channel {
     const char *proto;
     struct rtpp_log *log;
     struct rtpp_timestamp epoch;
+    /* MODE_REMOTE_RTP targets */
+    int nrdst;
+    struct rtpp_anetio_dst rdsts[RTPP_RECORD_MAX_RDST];
+    struct sockaddr_storage raddrs[RTPP_RECORD_MAX_RDST];
 };
 
 static void rtpp_record_write(struct rtpp_record *, const struct pkt_proc_ctx *);
@@ -114,9 +122,9 @@ static int
 ropen_remote_ctor_pa(struct rtpp_record_channel *rrc, struct rtpp_log *log,
   const char *rname, int is_rtcp)
 {
-    char *cp, *tmp;
+    char *cp, *tmp, *dst, *next;
     int n, port;
-    struct sockaddr_storage raddr;
+    struct sockaddr_storage *raddr;
 
     tmp = strdup(rname + 4);
     if (tmp == NULL) {
@@ -125,43 +133,55 @@ ropen_remote_ctor_pa(struct rtpp_record_channel *rrc, struct rtpp_log *log,
     }
     rrc->mode = MODE_REMOTE_RTP;
     rrc->needspool = 0;
-    cp = strrchr(tmp, ':');
-    if (cp == NULL) {
-        RTPP_LOG(log, RTPP_LOG_ERR, "remote recording target specification should include port number");
-        goto e1;
-    }
-    *cp = '\0';
-    cp++;
-
-    if (is_rtcp) {
-        /* Handle RTCP (increase target port by 1) */
-        port = atoi(cp);
-        if (port <= 0 || port > 65534) {
-            RTPP_LOG(log, RTPP_LOG_ERR, "invalid port in the remote recording target specification");
+    /* Comma-separated list of the host:port targets */
+    for (next = tmp; (dst = strsep(&next, ",")) != NULL;) {
+        if (rrc->nrdst == RTPP_RECORD_MAX_RDST) {
+            RTPP_LOG(log, RTPP_LOG_ERR, "too many targets in the remote "
+              "recording specification, %d max", RTPP_RECORD_MAX_RDST);
             goto e1;
         }
-        sprintf(cp, "%d", port + 1);
-    }
+        cp = strrchr(dst, ':');
+        if (cp == NULL) {
+            RTPP_LOG(log, RTPP_LOG_ERR, "remote recording target specification should include port number");
+            goto e1;
+        }
+        *cp = '\0';
+        cp++;
+
+        if (is_rtcp) {
+            /* Handle RTCP (increase target port by 1) */
+            port = atoi(cp);
+            if (port <= 0 || port > 65534) {
+                RTPP_LOG(log, RTPP_LOG_ERR, "invalid port in the remote recording target specification");
+                goto e1;
+            }
+            sprintf(cp, "%d", port + 1);
+        }
 
-    n = resolve(sstosa(&raddr), AF_INET, tmp, cp, 0);
-    if (n != 0) {
-        RTPP_LOG(log, RTPP_LOG_ERR, "ropen: getaddrinfo: %s", gai_strerror(n));
-        goto e1;
-    }
+        raddr = &rrc->raddrs[rrc->nrdst];
+        n = resolve(sstosa(raddr), AF_INET, dst, cp, 0);
+        if (n != 0) {
+            RTPP_LOG(log, RTPP_LOG_ERR, "ropen: getaddrinfo: %s", gai_strerror(n));
+            goto e1;
+        }
+        rrc->rdsts[rrc->nrdst] = (struct rtpp_anetio_dst){.sendto = sstosa(raddr),
+          .tolen = SA_LEN(sstosa(raddr))};
+        rrc->nrdst++;
+    }
+    /*
+     * Not connected, since the same socket is used to send to all
+     * targets.
+     */
     rrc->fd = socket(AF_INET, SOCK_DGRAM, 0);
     if (rrc->fd == -1) {
         RTPP_ELOG(log, RTPP_LOG_ERR, "ropen: can't create socket");
         goto e1;
     }
-    if (connect(rrc->fd, sstosa(&raddr), SA_LEN(sstosa(&raddr))) == -1) {
-        RTPP_ELOG(log, RTPP_LOG_ERR, "ropen: can't connect socket");
-        goto e2;
-    }
+    for (n = 0; n < rrc->nrdst; n++)
+        rrc->rdsts[n].sock = rrc->fd;
     free(tmp);
     return (0);
 
-e2:
-    close(rrc->fd);
 e1:
     free(tmp);
 e0:
@@ -561,6 +581,40 @@ get_hdr_size(const struct sockaddr *raddr)
     return (hdr_size);
 }
 
+static void
+rtpp_record_write_remote(struct rtpp_record_channel *rrc, const struct pkt_proc_ctx *pktxp)
+{
+    struct rtp_packet *packet = pktxp->pktp;
+    struct rtp_packet *cpkt;
+    int i;
+
+    if (packet->sender == NULL) {
+        for (i = 0; i < rrc->nrdst; i++) {
+            sendto(rrc->fd, packet->data.buf, packet->size, 0,
+              rrc->rdsts[i].sendto, rrc->rdsts[i].tolen);
+        }
+        return;
+    }
+    /*
+     * Payload is shared with the relay path, which is only safe if nothing
+     * down the chain is going to modify it in place. Otherwise make one
+     * private copy and let all targets share that instead.
+     */
+    if (atomic_load_explicit(&pktxp->strmp_in->pproc_manager->relay_only,
+      memory_order_acquire)) {
+        cpkt = packet;
+        RTPP_OBJ_INCREF(cpkt);
+    } else {
+        cpkt = rtp_packet_alloc();
+        if (cpkt == NULL)
+            return;
+        rtp_packet_dup(cpkt, packet, 0);
+    }
+    rtpp_anetio_fanout_pkt(packet->sender, cpkt, rrc->rdsts, rrc->nrdst,
+      rrc->pub.rcnt);
+    RTPP_OBJ_DECREF(cpkt);
+}
+
 static void
 rtpp_record_write_locked(struct rtpp_record_channel *rrc, const struct pkt_proc_ctx *pktxp)
 {
@@ -592,10 +646,6 @@ rtpp_record_write_locked(struct rtpp_record_channel *rrc, const struct pkt_proc_
     }
 
     switch (rrc->mode) {
-    case MODE_REMOTE_RTP:
-	send(rrc->fd, packet->data.buf, packet->size, 0);
-	return;
-
     case MODE_LOCAL_PKT:
 	hdr_size = sizeof(struct pkt_hdr_adhoc);
 	prepare_pkt_hdr = &prepare_pkt_hdr_adhoc;
@@ -664,6 +714,11 @@ rtpp_record_write(struct rtpp_record *self, const struct pkt_proc_ctx *pktxp)
     struct rtpp_record_channel *rrc;
 
     PUB2PVT(self, rrc);
+    if (rrc->mode == MODE_REMOTE_RTP) {
+        /* Targets are immutable, no need to lock */
+        rtpp_record_write_remote(rrc, pktxp);
+        return;
+    }
     pthread_mutex_lock(&rrc->lock);
     rtpp_record_write_locked(rrc, pktxp);
     pthread_mutex_unlock(&rrc->lock);
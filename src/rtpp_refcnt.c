@@ -69,7 +69,6 @@ static void rtpp_refcnt_decref(struct rtpp_refcnt *, HERETYPE);
 struct rtpp_refcnt_priv
 {
     struct rtpp_refcnt pub;
-    _Atomic(int) cnt;
     rtpp_refcnt_dtor_t dtor_f;
     void *data;
     rtpp_refcnt_dtor_t pre_dtor_f;
@@ -129,7 +128,7 @@ rtpp_refcnt_ctor(void *data, rtpp_refcnt_dtor_t dtor_f)
 #if defined(RTPP_DEBUG)
     pvt->pub.smethods = rtpp_refcnt_smethods;
 #endif
-    atomic_init(&pvt->cnt, 1);
+    atomic_init(&pvt->pub.cnt, 1);
     return (&pvt->pub);
 }
 
@@ -142,7 +141,7 @@ rtpp_refcnt_ctor_pa(void *pap)
 #if defined(RTPP_DEBUG)
     pvt->pub.smethods = rtpp_refcnt_smethods;
 #endif
-    atomic_init(&pvt->cnt, 1);
+    atomic_init(&pvt->pub.cnt, 1);
     pvt->flags |= RC_FLAG_PA;
     return (&pvt->pub);
 }
@@ -169,10 +168,10 @@ rtpp_refcnt_incref(struct rtpp_refcnt *pub, HERETYPE mlp)
 
     PUB2PVT(pub, pvt);
     RTPP_DBGCODE() {
-        oldcnt = atomic_load_explicit(&pvt->cnt, memory_order_relaxed);
+        oldcnt = atomic_load_explicit(&pvt->pub.cnt, memory_order_relaxed);
         RTPP_DBG_ASSERT(oldcnt > 0 && oldcnt < RC_ABS_MAX);
     }
-    oldcnt = atomic_fetch_add_explicit(&pvt->cnt, 1, memory_order_relaxed);
+    oldcnt = atomic_fetch_add_explicit(&pvt->pub.cnt, 1, memory_order_relaxed);
 #if RTPP_DEBUG_refcnt
     if (pvt->flags & RC_FLAG_TRACE) {
 #ifdef RTPP_DEBUG
@@ -195,11 +194,12 @@ static void
 rtpp_refcnt_decref(struct rtpp_refcnt *pub, HERETYPE mlp)
 {
     struct rtpp_refcnt_priv *pvt;
-    int oldcnt, flags;
+    int oldcnt;
+    MAYBE_UNUSED int flags;
 
     PUB2PVT(pub, pvt);
     RTPP_DBGCODE() {
-        oldcnt = atomic_load_explicit(&pvt->cnt, memory_order_relaxed);
+        oldcnt = atomic_load_explicit(&pvt->pub.cnt, memory_order_relaxed);
         RTPP_DBG_ASSERT(oldcnt > 0 && oldcnt < RC_ABS_MAX);
     }
 #if RTPP_DEBUG_refcnt
@@ -210,7 +210,7 @@ rtpp_refcnt_decref(struct rtpp_refcnt *pub, HERETYPE mlp)
      */
     flags = pvt->flags;
 #endif
-    oldcnt = atomic_fetch_sub_explicit(&pvt->cnt, 1, memory_order_release);
+    oldcnt = atomic_fetch_sub_explicit(&pvt->pub.cnt, 1, memory_order_release);
 #if RTPP_DEBUG_refcnt
     if (flags & RC_FLAG_TRACE) {
 #ifdef RTPP_DEBUG
@@ -228,41 +228,49 @@ rtpp_refcnt_decref(struct rtpp_refcnt *pub, HERETYPE mlp)
 #endif
     RTPP_DBG_ASSERT(oldcnt > 0);
     if (oldcnt == 1) {
-        atomic_thread_fence(memory_order_acquire);
-        flags = pvt->flags;
-        if ((flags & RC_FLAG_PA) == 0) {
-            if (flags & RC_FLAG_HASPRDTOR) {
-                pvt->pre_dtor_f(pvt->pd_data);
-            }
-            if (flags & RC_FLAG_HASDTOR) {
-                pvt->dtor_f(pvt->data);
-            } else {
+        rtpp_refcnt_release(pub);
+    }
+}
+
+void
+rtpp_refcnt_release(struct rtpp_refcnt *pub)
+{
+    struct rtpp_refcnt_priv *pvt;
+    int flags;
+
+    PUB2PVT(pub, pvt);
+    atomic_thread_fence(memory_order_acquire);
+    flags = pvt->flags;
+    if ((flags & RC_FLAG_PA) == 0) {
+        if (flags & RC_FLAG_HASPRDTOR) {
+            pvt->pre_dtor_f(pvt->pd_data);
+        }
+        if (flags & RC_FLAG_HASDTOR) {
+            pvt->dtor_f(pvt->data);
+        } else {
 #if !defined(RTPP_CHECK_LEAKS)
-                free(pvt->data);
+            free(pvt->data);
 #else
-                rtpp_refcnt_free(pvt->data);
+            rtpp_refcnt_free(pvt->data);
 #endif
-            }
-            rtpp_refcnt_fin(pub);
-            free(pvt);
-        } else {
-            rtpp_refcnt_fin(pub);
-            if (flags & RC_FLAG_HASPRDTOR) {
-                pvt->pre_dtor_f(pvt->pd_data);
-            }
-            if (flags & RC_FLAG_HASDTOR) {
-                pvt->dtor_f(pvt->data);
-            }
-            if (flags & RC_FLAG_PA_STDFREE) {
+        }
+        rtpp_refcnt_fin(pub);
+        free(pvt);
+    } else {
+        rtpp_refcnt_fin(pub);
+        if (flags & RC_FLAG_HASPRDTOR) {
+            pvt->pre_dtor_f(pvt->pd_data);
+        }
+        if (flags & RC_FLAG_HASDTOR) {
+            pvt->dtor_f(pvt->data);
+        }
+        if (flags & RC_FLAG_PA_STDFREE) {
 #if !defined(RTPP_CHECK_LEAKS)
-                free(pvt->data);
+            free(pvt->data);
 #else
-                rtpp_refcnt_free(pvt->data);
+            rtpp_refcnt_free(pvt->data);
 #endif
-            }
         }
-
-        return;
     }
 }
 
@@ -272,7 +280,7 @@ rtpp_refcnt_getdata(struct rtpp_refcnt *pub)
     struct rtpp_refcnt_priv *pvt;
 
     PUB2PVT(pub, pvt);
-    RTPP_DBG_ASSERT(atomic_load(&pvt->cnt) > 0);
+    RTPP_DBG_ASSERT(atomic_load(&pvt->pub.cnt) > 0);
     return (pvt->data);
 }
 
@@ -299,7 +307,7 @@ rtpp_refcnt_traceen(struct rtpp_refcnt *pub, HERETYPE mlp)
 
     PUB2PVT(pub, pvt);
     pvt->flags |= RC_FLAG_TRACE;
-    int oldcnt = atomic_load_explicit(&pvt->cnt, memory_order_relaxed);
+    int oldcnt = atomic_load_explicit(&pvt->pub.cnt, memory_order_relaxed);
     fprintf(stderr, CODEPTR_FMT(": rtpp_refcnt(%p, %u).traceen()\n", mlp, pub, oldcnt));
 }
 
@@ -309,7 +317,7 @@ rtpp_refcnt_peek(struct rtpp_refcnt *pub)
     struct rtpp_refcnt_priv *pvt;
 
     PUB2PVT(pub, pvt);
-    return atomic_load_explicit(&pvt->cnt, memory_order_relaxed);
+    return atomic_load_explicit(&pvt->pub.cnt, memory_order_relaxed);
 }
 #endif
 
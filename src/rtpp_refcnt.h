@@ -27,6 +27,8 @@
 
 #pragma once
 
+#include <stdatomic.h>
+
 struct rtpp_codeptr;
 
 typedef void (*rtpp_refcnt_dtor_t)(void *);
@@ -62,14 +64,53 @@ struct rtpp_refcnt
 #if defined(RTPP_DEBUG)
     const struct rtpp_refcnt_smethods * smethods;
 #endif
+    _Atomic(int) cnt;
 };
 
 extern const size_t rtpp_refcnt_osize;
 rtpp_refcnt_rot *rtpp_refcnt_ctor_pa(void *);
+void rtpp_refcnt_release(struct rtpp_refcnt *) RTPP_EXPORT;
+
+/*
+ * Unless the reference tracing is compiled in, the incref/decref are
+ * just an atomic add/sub on the counter and are inlined at the call site.
+ * Only the final decref goes out of line to run the destructors.
+ *
+ * There is no owner-thread (biased) mode: on the relay path a packet is
+ * allocated by the processing thread and released by the sender thread,
+ * and the socket reference it holds is to an object the command thread
+ * owns, so none of those references would be taken by the owner. See
+ * the "refcnt" benchmark in bench/.
+ */
+#if defined(RTPP_DEBUG) || (defined(RTPP_DEBUG_refcnt) && RTPP_DEBUG_refcnt)
+#define RC_INLINE_FASTPATH 0
+#else
+#define RC_INLINE_FASTPATH 1
+#endif
+
+static inline void
+rtpp_refcnt_incref_fast(struct rtpp_refcnt *pub)
+{
+
+    atomic_fetch_add_explicit(&pub->cnt, 1, memory_order_relaxed);
+}
+
+static inline void
+rtpp_refcnt_decref_fast(struct rtpp_refcnt *pub)
+{
+
+    if (atomic_fetch_sub_explicit(&pub->cnt, 1, memory_order_release) == 1)
+        rtpp_refcnt_release(pub);
+}
 
 #define _GET_ARG_3(_1, _2, _3, ...) _3
 #define _RC_CHOOSE(NAME, ...) _GET_ARG_3(__VA_ARGS__, NAME##_2, NAME##_1,)
+#if RC_INLINE_FASTPATH
+#define _RC_REF_1(rp, method) rtpp_refcnt_##method##_fast(rp)
+#define _RC_REF_2(rp, method, harg) rtpp_refcnt_##method##_fast(rp)
+#else
 #define _RC_REF_1(rp, method) CALL_SMETHOD(rp, method, HEREVAL)
 #define _RC_REF_2(rp, method, harg) CALL_SMETHOD(rp, method, harg)
+#endif
 #define RC_INCREF(rp, ...) _RC_CHOOSE(_RC_REF, __VA_ARGS__)(rp, incref, ##__VA_ARGS__)
 #define RC_DECREF(rp, ...) _RC_CHOOSE(_RC_REF, __VA_ARGS__)(rp, decref, ##__VA_ARGS__)
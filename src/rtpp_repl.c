@@ -0,0 +1,1333 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#if defined(LINUX_XXX) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* pthread_setname_np() */
+#endif
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <elperiodic.h>
+
+#include "config.h"
+
+#include "rtpp_types.h"
+#include "rtpp_defines.h"
+#include "rtpp_log.h"
+#include "rtpp_log_obj.h"
+#include "rtpp_cfg.h"
+#include "rtpp_command.h"
+#include "rtpp_command_args.h"
+#include "rtpp_command_async.h"
+#include "rtpp_command_sub.h"
+#include "rtpp_command_private.h"
+#include "rtpp_bindaddrs.h"
+#include "rtpp_codeptr.h"
+#include "rtpp_refcnt.h"
+#include "rtpp_mallocs.h"
+#include "rtpp_hash_table.h"
+#include "rtpp_weakref.h"
+#include "rtpp_network.h"
+#include "rtpp_time.h"
+#include "rtpp_pipe.h"
+#include "rtpp_proc_async.h"
+#include "rtpp_sessinfo.h"
+#include "rtpp_session.h"
+#include "rtpp_socket.h"
+#include "rtpp_stream.h"
+#include "rtpp_threads.h"
+#include "rtpp_ttl.h"
+#include "rtpp_xxHash.h"
+#include "rtpp_wrestart.h"
+#include "rtpp_repl.h"
+
+#define RTPP_REPL_MAGIC   0x5250524c    /* "RPRL" */
+#define RTPP_REPL_VERSION 1             /* Wire format, see below */
+#define RTPP_REPL_FREQ    5.0           /* Batches per second on the active */
+#define RTPP_REPL_CTOUT   1000          /* Connect/send timeout, ms */
+#define RTPP_REPL_QLEN    4096          /* Changes noted between batches */
+
+/*
+ * Wire format. The two hosts need not share the ABI, so that the records
+ * are made of fixed width fields, integers in network byte order:
+ *
+ * header: magic:32 version:16 type:16 dlen:32, then dlen bytes of:
+ * HELLO:  instance:64
+ * SESS:   seuid:64 call_id_len:16 from_tag_len:16 strong:8 complete:8
+ *         side[0] side[1] call_id from_tag
+ *   side:   lidx:8 (0xff - none) laf:8 port:16 stream(RTP) stream(RTCP)
+ *   stream: raf:8 rport:16 raddr:128 flags:8 latch_mode:8 ptime:32
+ *           ssrc:32 seq:16
+ * DEL:    seuid:64
+ * SYNC:   empty
+ *
+ * Address families are sent as RTPP_REPL_AF_*, an IPv4 raddr takes the
+ * first 4 bytes of the field.
+ */
+#define RTPP_REPL_HDR_LEN  12
+#define RTPP_REPL_STRM_LEN 31
+#define RTPP_REPL_SIDE_LEN (4 + 2 * RTPP_REPL_STRM_LEN)
+#define RTPP_REPL_SESS_LEN (14 + 2 * RTPP_REPL_SIDE_LEN)
+#define RTPP_REPL_MAXREC   (RTPP_REPL_SESS_LEN + 2 * RTPP_CMD_BUFLEN)
+
+#define RTPP_REPL_AF_NONE  0
+#define RTPP_REPL_AF_INET  4
+#define RTPP_REPL_AF_INET6 6
+
+#define RTPP_REPL_SF_ASYM    0x01
+#define RTPP_REPL_SF_WEAK    0x02
+#define RTPP_REPL_SF_UNTRUST 0x04
+#define RTPP_REPL_SF_LATCHED 0x08
+#define RTPP_REPL_SF_SSRC    0x10
+
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+enum rtpp_repl_rtype {
+    RTPP_REPL_SESS = 1,  /* Session created or changed */
+    RTPP_REPL_DEL,       /* Session is gone */
+    RTPP_REPL_SYNC,      /* End of the pass, keeps replicated sessions alive */
+    RTPP_REPL_HELLO      /* First record on a connection, instance id */
+};
+
+struct rtpp_repl_hdr {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t type;
+    uint32_t dlen;
+};
+
+struct rtpp_repl_side {
+    int lidx;           /* Index into cfs->bindaddr[], -1 for other address */
+    int laf;
+    int port;           /* 0 if not allocated yet */
+    struct rtpp_stream_snap rtp;
+    struct rtpp_stream_snap rtcp;
+};
+
+/* Decoded SESS record, call_id and from_tag are kept aside */
+struct rtpp_repl_sess {
+    uint64_t seuid;
+    uint32_t call_id_len;
+    uint32_t from_tag_len;
+    int strong;
+    int complete;
+    struct rtpp_repl_side side[2];
+};
+
+/*
+ * Keyed by the seuid of the session on the active: there the value is
+ * the digest of the record last sent, on the standby the seuid of the
+ * local session.
+ */
+struct rtpp_repl_ent {
+    uint64_t key;
+    uint64_t val;
+    uint64_t gen;
+    struct rtpp_refcnt *rcnt;
+};
+
+struct rtpp_repl_buf {
+    char *data;
+    size_t len;
+    size_t alen;
+};
+
+/*
+ * Seuids of the sessions noted since the last batch, duplicates included.
+ * Double-buffered: the replication thread takes the filled one and puts
+ * the other one in its place. When it overflows, the next batch is a full
+ * pass over the session table instead.
+ */
+struct rtpp_repl_q {
+    pthread_mutex_t lock;
+    uint64_t *seuids;
+    size_t len;
+    int ovfl;
+    uint64_t bufs[2][RTPP_REPL_QLEN];
+};
+
+struct rtpp_repl_priv {
+    struct rtpp_repl pub;
+    const struct rtpp_cfg *cfsp;
+    pthread_t thread_id;
+    _Atomic(int) tstate;
+    int standby;
+    struct sockaddr_storage addr;
+    int lfd;
+    int s;
+    void *elp;
+    uint64_t gen;
+    int oerr;
+    /*
+     * Random id of the active process. The seuids it sends are only
+     * unique within one instance, so that the standby drops everything
+     * it has replicated from the previous one once the id changes.
+     */
+    uint64_t instance;
+    int have_instance;
+    /* Standby, per connection: HELLO has been seen, first pass is over */
+    int hello;
+    int insync;
+    struct rtpp_hash_table *ents;
+    struct rtpp_repl_buf buf;
+    struct rtpp_repl_q q;
+};
+
+static void rtpp_repl_note(struct rtpp_repl *, uint64_t);
+static void rtpp_repl_shutdown(struct rtpp_repl *);
+static void rtpp_repl_dtor(struct rtpp_repl *);
+
+static int
+rtpp_repl_parse_addr(const char *spec, struct sockaddr_storage *sap, int passive)
+{
+    char *host, *cp;
+    int af, rval;
+
+    host = strdup(spec);
+    if (host == NULL)
+        return (-1);
+    cp = strrchr(host, ':');
+    if (cp == NULL || cp[1] == '\0') {
+        free(host);
+        return (-1);
+    }
+    *cp = '\0';
+    af = (strchr(host, ':') != NULL) ? AF_INET6 : AF_INET;
+    if (passive)
+        rval = setbindhost(sstosa(sap), af, host, cp + 1);
+    else
+        rval = resolve(sstosa(sap), af, host, cp + 1, 0);
+    free(host);
+    return (rval);
+}
+
+static int
+rtpp_repl_buf_reserve(struct rtpp_repl_buf *bp, size_t len)
+{
+    char *nd;
+    size_t nlen;
+
+    if (bp->len + len <= bp->alen)
+        return (0);
+    nlen = (bp->alen == 0) ? 64 * 1024 : bp->alen;
+    while (nlen < bp->len + len)
+        nlen *= 2;
+    nd = realloc(bp->data, nlen);
+    if (nd == NULL)
+        return (-1);
+    bp->data = nd;
+    bp->alen = nlen;
+    return (0);
+}
+
+static int
+rtpp_repl_buf_append(struct rtpp_repl_buf *bp, const void *data, size_t len)
+{
+
+    if (rtpp_repl_buf_reserve(bp, len) != 0)
+        return (-1);
+    memcpy(bp->data + bp->len, data, len);
+    bp->len += len;
+    return (0);
+}
+
+static uint8_t *
+rtpp_repl_put(uint8_t *cp, uint64_t v, int len)
+{
+    int i;
+
+    for (i = len - 1; i >= 0; i--) {
+        cp[i] = v & 0xff;
+        v >>= 8;
+    }
+    return (cp + len);
+}
+
+static uint64_t
+rtpp_repl_get(const uint8_t **cpp, int len)
+{
+    uint64_t v;
+    int i;
+
+    v = 0;
+    for (i = 0; i < len; i++)
+        v = (v << 8) | (*cpp)[i];
+    *cpp += len;
+    return (v);
+}
+
+static uint8_t *
+rtpp_repl_enc_strm(uint8_t *cp, const struct rtpp_stream_snap *ssp)
+{
+    const struct sockaddr *sa;
+    int flags;
+
+    sa = sstosa(&ssp->rem_addr);
+    memset(cp + 3, '\0', 16);
+    if (ssp->rem_alen == 0) {
+        cp = rtpp_repl_put(cp, RTPP_REPL_AF_NONE, 1);
+        cp = rtpp_repl_put(cp, 0, 2);
+    } else if (sa->sa_family == AF_INET) {
+        cp = rtpp_repl_put(cp, RTPP_REPL_AF_INET, 1);
+        cp = rtpp_repl_put(cp, ntohs(satosin(sa)->sin_port), 2);
+        memcpy(cp, &satosin(sa)->sin_addr, 4);
+    } else {
+        cp = rtpp_repl_put(cp, RTPP_REPL_AF_INET6, 1);
+        cp = rtpp_repl_put(cp, ntohs(satosin6(sa)->sin6_port), 2);
+        memcpy(cp, &satosin6(sa)->sin6_addr, 16);
+    }
+    cp += 16;
+    flags = (ssp->asymmetric ? RTPP_REPL_SF_ASYM : 0) |
+      (ssp->weak ? RTPP_REPL_SF_WEAK : 0) |
+      (ssp->untrusted_addr ? RTPP_REPL_SF_UNTRUST : 0) |
+      (ssp->latched ? RTPP_REPL_SF_LATCHED : 0) |
+      (ssp->ssrc_inited ? RTPP_REPL_SF_SSRC : 0);
+    cp = rtpp_repl_put(cp, flags, 1);
+    cp = rtpp_repl_put(cp, ssp->latch_mode, 1);
+    cp = rtpp_repl_put(cp, (uint32_t)ssp->ptime, 4);
+    cp = rtpp_repl_put(cp, ssp->ssrc, 4);
+    cp = rtpp_repl_put(cp, (uint16_t)ssp->seq, 2);
+    return (cp);
+}
+
+static int
+rtpp_repl_dec_strm(const uint8_t **cpp, struct rtpp_stream_snap *ssp)
+{
+    struct sockaddr_in *sin;
+    struct sockaddr_in6 *sin6;
+    int raf, rport, flags;
+
+    memset(ssp, '\0', sizeof(*ssp));
+    raf = rtpp_repl_get(cpp, 1);
+    rport = rtpp_repl_get(cpp, 2);
+    switch (raf) {
+    case RTPP_REPL_AF_NONE:
+        break;
+
+    case RTPP_REPL_AF_INET:
+        sin = satosin(sstosa(&ssp->rem_addr));
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons(rport);
+        memcpy(&sin->sin_addr, *cpp, 4);
+        ssp->rem_alen = sizeof(*sin);
+        break;
+
+    case RTPP_REPL_AF_INET6:
+        sin6 = satosin6(sstosa(&ssp->rem_addr));
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons(rport);
+        memcpy(&sin6->sin6_addr, *cpp, 16);
+        ssp->rem_alen = sizeof(*sin6);
+        break;
+
+    default:
+        return (-1);
+    }
+    *cpp += 16;
+    flags = rtpp_repl_get(cpp, 1);
+    ssp->asymmetric = (flags & RTPP_REPL_SF_ASYM) != 0;
+    ssp->weak = (flags & RTPP_REPL_SF_WEAK) != 0;
+    ssp->untrusted_addr = (flags & RTPP_REPL_SF_UNTRUST) != 0;
+    ssp->latched = (flags & RTPP_REPL_SF_LATCHED) != 0;
+    ssp->ssrc_inited = (flags & RTPP_REPL_SF_SSRC) != 0;
+    ssp->latch_mode = rtpp_repl_get(cpp, 1);
+    if (ssp->latch_mode > RTPLM_FORCE_ON)
+        return (-1);
+    ssp->ptime = (int32_t)rtpp_repl_get(cpp, 4);
+    ssp->ssrc = rtpp_repl_get(cpp, 4);
+    ssp->seq = rtpp_repl_get(cpp, 2);
+    return (0);
+}
+
+/* Fixed part of the SESS record, RTPP_REPL_SESS_LEN bytes */
+static void
+rtpp_repl_enc_sess(uint8_t *cp, const struct rtpp_repl_sess *rsp)
+{
+    const struct rtpp_repl_side *sdp;
+    int i;
+
+    cp = rtpp_repl_put(cp, rsp->seuid, 8);
+    cp = rtpp_repl_put(cp, rsp->call_id_len, 2);
+    cp = rtpp_repl_put(cp, rsp->from_tag_len, 2);
+    cp = rtpp_repl_put(cp, rsp->strong != 0, 1);
+    cp = rtpp_repl_put(cp, rsp->complete != 0, 1);
+    for (i = 0; i < 2; i++) {
+        sdp = &rsp->side[i];
+        cp = rtpp_repl_put(cp, (sdp->lidx < 0) ? 0xff : sdp->lidx, 1);
+        cp = rtpp_repl_put(cp, (sdp->laf == AF_INET6) ? RTPP_REPL_AF_INET6 :
+          RTPP_REPL_AF_INET, 1);
+        cp = rtpp_repl_put(cp, sdp->port, 2);
+        cp = rtpp_repl_enc_strm(cp, &sdp->rtp);
+        cp = rtpp_repl_enc_strm(cp, &sdp->rtcp);
+    }
+}
+
+static int
+rtpp_repl_dec_sess(const uint8_t *cp, struct rtpp_repl_sess *rsp)
+{
+    struct rtpp_repl_side *sdp;
+    int i, lidx;
+
+    memset(rsp, '\0', sizeof(*rsp));
+    rsp->seuid = rtpp_repl_get(&cp, 8);
+    rsp->call_id_len = rtpp_repl_get(&cp, 2);
+    rsp->from_tag_len = rtpp_repl_get(&cp, 2);
+    rsp->strong = rtpp_repl_get(&cp, 1);
+    rsp->complete = rtpp_repl_get(&cp, 1);
+    for (i = 0; i < 2; i++) {
+        sdp = &rsp->side[i];
+        lidx = rtpp_repl_get(&cp, 1);
+        sdp->lidx = (lidx == 0xff) ? -1 : lidx;
+        switch (rtpp_repl_get(&cp, 1)) {
+        case RTPP_REPL_AF_INET:
+            sdp->laf = AF_INET;
+            break;
+
+        case RTPP_REPL_AF_INET6:
+            sdp->laf = AF_INET6;
+            break;
+
+        default:
+            return (-1);
+        }
+        sdp->port = rtpp_repl_get(&cp, 2);
+        if (rtpp_repl_dec_strm(&cp, &sdp->rtp) != 0 ||
+          rtpp_repl_dec_strm(&cp, &sdp->rtcp) != 0)
+            return (-1);
+    }
+    return (0);
+}
+
+static void
+rtpp_repl_emit(struct rtpp_repl_priv *pvt, enum rtpp_repl_rtype type,
+  const struct iovec *iov, int iovcnt)
+{
+    uint8_t hdr[RTPP_REPL_HDR_LEN], *cp;
+    size_t dlen;
+    int i;
+
+    dlen = 0;
+    for (i = 0; i < iovcnt; i++)
+        dlen += iov[i].iov_len;
+    cp = rtpp_repl_put(hdr, RTPP_REPL_MAGIC, 4);
+    cp = rtpp_repl_put(cp, RTPP_REPL_VERSION, 2);
+    cp = rtpp_repl_put(cp, type, 2);
+    rtpp_repl_put(cp, dlen, 4);
+    if (rtpp_repl_buf_append(&pvt->buf, hdr, sizeof(hdr)) != 0)
+        goto e0;
+    for (i = 0; i < iovcnt; i++) {
+        if (rtpp_repl_buf_append(&pvt->buf, iov[i].iov_base,
+          iov[i].iov_len) != 0)
+            goto e0;
+    }
+    return;
+e0:
+    pvt->oerr = 1;
+}
+
+static void
+rtpp_repl_emit_u64(struct rtpp_repl_priv *pvt, enum rtpp_repl_rtype type,
+  uint64_t v)
+{
+    uint8_t b[8];
+    struct iovec iov[1];
+
+    rtpp_repl_put(b, v, 8);
+    iov[0].iov_base = b;
+    iov[0].iov_len = sizeof(b);
+    rtpp_repl_emit(pvt, type, iov, 1);
+}
+
+static struct rtpp_repl_ent *
+rtpp_repl_ent_ctor(uint64_t key)
+{
+    struct rtpp_repl_ent *rep;
+
+    rep = rtpp_rzmalloc(sizeof(*rep), offsetof(struct rtpp_repl_ent, rcnt));
+    if (rep == NULL)
+        return (NULL);
+    rep->key = key;
+    return (rep);
+}
+
+static void
+rtpp_repl_pack_side(const struct rtpp_cfg *cfsp, struct rtpp_stream *rtps,
+  struct rtpp_stream *rtcps, struct rtpp_repl_side *rsp)
+{
+    int i;
+
+    rsp->lidx = -1;
+    for (i = 0; i < 2; i++) {
+        if (rtps->laddr == cfsp->bindaddr[i])
+            rsp->lidx = i;
+    }
+    rsp->laf = rtps->laddr->sa_family;
+    rsp->port = rtps->port;
+    CALL_SMETHOD(rtps, save_state, &rsp->rtp);
+    CALL_SMETHOD(rtcps, save_state, &rsp->rtcp);
+}
+
+static int
+rtpp_repl_scan_sess(void *dp, void *ap)
+{
+    struct rtpp_session *sp;
+    struct rtpp_repl_priv *pvt;
+    struct rtpp_repl_sess rs, rsd;
+    struct rtpp_repl_ent *rep;
+    struct rtpp_refcnt *rco;
+    struct iovec iov[3];
+    uint8_t rec[RTPP_REPL_SESS_LEN];
+    uint64_t digest;
+    int i, changed;
+
+    sp = (struct rtpp_session *)dp;
+    pvt = (struct rtpp_repl_priv *)ap;
+
+    memset(&rs, '\0', sizeof(rs));
+    rs.seuid = sp->seuid;
+    rs.call_id_len = sp->call_id->len;
+    rs.from_tag_len = sp->from_tag->len;
+    rs.strong = sp->strong;
+    rs.complete = sp->complete;
+    for (i = 0; i < 2; i++) {
+        rtpp_repl_pack_side(pvt->cfsp, sp->rtp->stream[i],
+          sp->rtcp->stream[i], &rs.side[i]);
+    }
+    /*
+     * The latched sequence number is re-synced about once a second on any
+     * active stream, leave it out so that it only goes along with the real
+     * changes.
+     * The standby re-syncs it from the first packet anyway.
+     */
+    rsd = rs;
+    for (i = 0; i < 2; i++) {
+        rsd.side[i].rtp.seq = 0;
+        rsd.side[i].rtcp.seq = 0;
+    }
+    rtpp_repl_enc_sess(rec, &rsd);
+    digest = XXH64(rec, sizeof(rec), 0);
+    digest = XXH64(sp->call_id->s, sp->call_id->len, digest);
+    digest = XXH64(sp->from_tag->s, sp->from_tag->len, digest);
+
+    rco = CALL_SMETHOD(pvt->ents, find, &sp->seuid);
+    if (rco != NULL) {
+        rep = CALL_SMETHOD(rco, getdata);
+        changed = (rep->val != digest);
+        rep->val = digest;
+        rep->gen = pvt->gen;
+        RTPP_OBJ_DECREF(rep);
+    } else {
+        rep = rtpp_repl_ent_ctor(sp->seuid);
+        if (rep == NULL) {
+            pvt->oerr = 1;
+            return (RTPP_WR_MATCH_BRK);
+        }
+        rep->val = digest;
+        rep->gen = pvt->gen;
+        if (CALL_SMETHOD(pvt->ents, append_refcnt, &rep->key, rep->rcnt,
+          NULL) == NULL)
+            pvt->oerr = 1;
+        RTPP_OBJ_DECREF(rep);
+        changed = 1;
+    }
+    if (changed) {
+        rtpp_repl_enc_sess(rec, &rs);
+        iov[0].iov_base = rec;
+        iov[0].iov_len = sizeof(rec);
+        iov[1].iov_base = (void *)sp->call_id->s;
+        iov[1].iov_len = sp->call_id->len;
+        iov[2].iov_base = (void *)sp->from_tag->s;
+        iov[2].iov_len = sp->from_tag->len;
+        rtpp_repl_emit(pvt, RTPP_REPL_SESS, iov, 3);
+    }
+    return (RTPP_WR_MATCH_CONT);
+}
+
+static int
+rtpp_repl_scan_gone(void *dp, void *ap)
+{
+    struct rtpp_repl_ent *rep;
+    struct rtpp_repl_priv *pvt;
+
+    rep = (struct rtpp_repl_ent *)dp;
+    pvt = (struct rtpp_repl_priv *)ap;
+    if (rep->gen == pvt->gen)
+        return (RTPP_HT_MATCH_CONT);
+    rtpp_repl_emit_u64(pvt, RTPP_REPL_DEL, rep->key);
+    return (RTPP_HT_MATCH_DEL);
+}
+
+/* Send out a session that has been noted, or its removal */
+static void
+rtpp_repl_send_one(struct rtpp_repl_priv *pvt, uint64_t seuid)
+{
+    struct rtpp_session *sp;
+    struct rtpp_refcnt *rco;
+
+    sp = CALL_SMETHOD(pvt->cfsp->sessions_wrt, get_by_idx, seuid);
+    if (sp != NULL) {
+        rtpp_repl_scan_sess(sp, pvt);
+        RTPP_OBJ_DECREF(sp);
+        return;
+    }
+    rco = CALL_SMETHOD(pvt->ents, remove_by_key, &seuid, NULL);
+    if (rco == NULL)
+        return;
+    RC_DECREF(rco);
+    rtpp_repl_emit_u64(pvt, RTPP_REPL_DEL, seuid);
+}
+
+/* Take the changes noted so far, returns 1 if some have been lost */
+static int
+rtpp_repl_q_take(struct rtpp_repl_q *qp, const uint64_t **seuidsp,
+  size_t *lenp)
+{
+    int ovfl;
+
+    pthread_mutex_lock(&qp->lock);
+    *seuidsp = qp->seuids;
+    *lenp = qp->len;
+    ovfl = qp->ovfl;
+    qp->seuids = (qp->seuids == qp->bufs[0]) ? qp->bufs[1] : qp->bufs[0];
+    qp->len = 0;
+    qp->ovfl = 0;
+    pthread_mutex_unlock(&qp->lock);
+    return (ovfl);
+}
+
+static void
+rtpp_repl_note(struct rtpp_repl *pub, uint64_t seuid)
+{
+    struct rtpp_repl_priv *pvt;
+
+    PUB2PVT(pub, pvt);
+    if (pvt->standby || atomic_load(&pvt->tstate) != TSTATE_RUN)
+        return;
+    pthread_mutex_lock(&pvt->q.lock);
+    if (pvt->q.len < RTPP_REPL_QLEN)
+        pvt->q.seuids[pvt->q.len++] = seuid;
+    else
+        pvt->q.ovfl = 1;
+    pthread_mutex_unlock(&pvt->q.lock);
+}
+
+static int
+rtpp_repl_connect(struct rtpp_repl_priv *pvt)
+{
+    struct pollfd pfd;
+    socklen_t olen;
+    int s, flags, serr;
+
+    s = socket(pvt->addr.ss_family, SOCK_STREAM, 0);
+    if (s < 0)
+        return (-1);
+    flags = fcntl(s, F_GETFL);
+    if (flags < 0 || fcntl(s, F_SETFL, flags | O_NONBLOCK) < 0)
+        goto e0;
+    if (connect(s, sstosa(&pvt->addr), SA_LEN(sstosa(&pvt->addr))) != 0) {
+        if (errno != EINPROGRESS)
+            goto e0;
+        pfd.fd = s;
+        pfd.events = POLLOUT;
+        if (poll(&pfd, 1, RTPP_REPL_CTOUT) != 1)
+            goto e0;
+        olen = sizeof(serr);
+        if (getsockopt(s, SOL_SOCKET, SO_ERROR, &serr, &olen) != 0 || serr != 0)
+            goto e0;
+    }
+    if (fcntl(s, F_SETFL, flags) < 0)
+        goto e0;
+    pvt->s = s;
+    return (0);
+e0:
+    close(s);
+    return (-1);
+}
+
+static int
+rtpp_repl_flush(struct rtpp_repl_priv *pvt)
+{
+    struct pollfd pfd;
+    size_t off;
+    ssize_t r;
+
+    pfd.fd = pvt->s;
+    pfd.events = POLLOUT;
+    for (off = 0; off < pvt->buf.len; off += r) {
+        if (poll(&pfd, 1, RTPP_REPL_CTOUT) != 1)
+            return (-1);
+        r = send(pvt->s, pvt->buf.data + off, pvt->buf.len - off,
+          MSG_NOSIGNAL);
+        if (r < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                r = 0;
+            else
+                return (-1);
+        }
+    }
+    pvt->buf.len = 0;
+    return (0);
+}
+
+static void
+rtpp_repl_active_run(struct rtpp_repl_priv *pvt)
+{
+    const struct rtpp_cfg *cfsp;
+    const uint64_t *seuids;
+    size_t i, nseuids;
+    int full, nbatch;
+
+    cfsp = pvt->cfsp;
+    nbatch = 0;
+    for (;;) {
+        if (atomic_load(&pvt->tstate) == TSTATE_CEASE)
+            break;
+        prdic_procrastinate(pvt->elp);
+        full = rtpp_repl_q_take(&pvt->q, &seuids, &nseuids);
+        pvt->buf.len = 0;
+        if (pvt->s < 0) {
+            /* Whatever has been noted meanwhile goes with the full sync */
+            if (rtpp_repl_connect(pvt) != 0)
+                continue;
+            RTPP_LOG(cfsp->glog, RTPP_LOG_INFO, "replication: connected to "
+              "the standby, starting full sync");
+            rtpp_repl_emit_u64(pvt, RTPP_REPL_HELLO, pvt->instance);
+            full = 1;
+        }
+        if (full) {
+            pvt->gen++;
+            CALL_SMETHOD(cfsp->sessions_wrt, foreach, rtpp_repl_scan_sess, pvt);
+            CALL_SMETHOD(pvt->ents, foreach, rtpp_repl_scan_gone, pvt, NULL);
+        } else {
+            for (i = 0; i < nseuids; i++)
+                rtpp_repl_send_one(pvt, seuids[i]);
+        }
+        /* Ends the full sync, otherwise a keep-alive about once a second */
+        if (full || ++nbatch >= RTPP_REPL_FREQ) {
+            rtpp_repl_emit(pvt, RTPP_REPL_SYNC, NULL, 0);
+            nbatch = 0;
+        }
+        if (pvt->oerr == 0 && rtpp_repl_flush(pvt) == 0)
+            continue;
+        RTPP_LOG(cfsp->glog, RTPP_LOG_ERR, "replication: %s, reconnecting",
+          pvt->oerr ? "out of memory" : "lost connection to the standby");
+        /* Start over with the full sync */
+        close(pvt->s);
+        pvt->s = -1;
+        pvt->oerr = 0;
+        CALL_SMETHOD(pvt->ents, purge);
+    }
+}
+
+static const struct sockaddr *
+rtpp_repl_laddr(const struct rtpp_cfg *cfsp, const struct rtpp_repl_side *rsp)
+{
+
+    if (rsp->lidx >= 0 && rsp->lidx < 2 && cfsp->bindaddr[rsp->lidx] != NULL)
+        return (cfsp->bindaddr[rsp->lidx]);
+    return (CALL_METHOD(cfsp->bindaddrs_cf, foraf, rsp->laf));
+}
+
+/* Bind a pair of sockets to the same ports the active has */
+static int
+rtpp_repl_bind(const struct rtpp_cfg *cfsp, const struct sockaddr *ia,
+  int port, struct rtpp_socket **fds)
+{
+    struct sockaddr_storage iac;
+    int i, on;
+
+    on = 1;
+    fds[0] = fds[1] = NULL;
+    for (i = 0; i < 2; i++) {
+        fds[i] = rtpp_socket_ctor(cfsp->rtpp_proc_cf->netio, ia->sa_family,
+          SOCK_DGRAM);
+        if (fds[i] == NULL)
+            goto e0;
+        /* The service address is normally not up on the standby yet */
+#if defined(IP_FREEBIND)
+        if (ia->sa_family == AF_INET)
+            setsockopt(CALL_SMETHOD(fds[i], getfd), IPPROTO_IP, IP_FREEBIND,
+              &on, sizeof(on));
+#endif
+#if defined(IPV6_FREEBIND)
+        if (ia->sa_family == AF_INET6)
+            setsockopt(CALL_SMETHOD(fds[i], getfd), IPPROTO_IPV6,
+              IPV6_FREEBIND, &on, sizeof(on));
+#endif
+        memcpy(&iac, ia, SA_LEN(ia));
+        setport(sstosa(&iac), port + i);
+        if (CALL_SMETHOD(fds[i], bind2, sstosa(&iac), SA_LEN(ia)) != 0)
+            goto e0;
+        if (ia->sa_family == AF_INET && cfsp->tos >= 0)
+            CALL_SMETHOD(fds[i], settos, cfsp->tos);
+        CALL_SMETHOD(fds[i], setrbuf, 256 * 1024);
+        if (CALL_SMETHOD(fds[i], setnonblock) < 0)
+            goto e0;
+        CALL_SMETHOD(fds[i], settimestamp);
+    }
+    return (0);
+e0:
+    for (i = 0; i < 2; i++) {
+        if (fds[i] != NULL) {
+            RTPP_OBJ_DECREF(fds[i]);
+            fds[i] = NULL;
+        }
+    }
+    return (-1);
+}
+
+static struct rtpp_session *
+rtpp_repl_sess_create(struct rtpp_repl_priv *pvt,
+  const struct rtpp_repl_sess *rsp, const rtpp_str_t *call_id,
+  const rtpp_str_t *from_tag)
+{
+    const struct rtpp_cfg *cfsp;
+    const struct sockaddr *lia[2];
+    struct rtpp_socket *fds[2];
+    struct common_cmd_args cca;
+    struct rtpp_timestamp dtime;
+    struct rtpp_session *spa;
+    struct rtpp_hash_table_entry *hte;
+    struct rtpp_repl_ent *rep;
+    int i;
+
+    cfsp = pvt->cfsp;
+    for (i = 0; i < 2; i++) {
+        lia[i] = rtpp_repl_laddr(cfsp, &rsp->side[i]);
+        if (lia[i] == NULL)
+            return (NULL);
+    }
+    if (rtpp_repl_bind(cfsp, lia[0], rsp->side[0].port, fds) != 0) {
+        RTPP_ELOG(cfsp->glog, RTPP_LOG_ERR, "replication: can't bind "
+          "to the %s port %d", SA_AF2STR(lia[0]), rsp->side[0].port);
+        return (NULL);
+    }
+    memset(&cca, '\0', sizeof(cca));
+    cca.call_id = call_id;
+    cca.from_tag = from_tag;
+    rtpp_timestamp_get(&dtime);
+    spa = rtpp_session_ctor(cfsp, &cca, &dtime, lia, rsp->strong == 0,
+      rsp->side[0].port, fds);
+    RTPP_OBJ_DECREF(fds[0]);
+    RTPP_OBJ_DECREF(fds[1]);
+    if (spa == NULL)
+        return (NULL);
+    hte = CALL_SMETHOD(cfsp->sessions_ht, append_str_refcnt, spa->call_id,
+      spa->rcnt, NULL);
+    if (hte == NULL)
+        goto e0;
+    if (CALL_SMETHOD(cfsp->sessions_wrt, reg, spa->rcnt, spa->seuid) != 0) {
+        CALL_SMETHOD(cfsp->sessions_ht, remove_str, spa->call_id, hte);
+        goto e0;
+    }
+    rep = rtpp_repl_ent_ctor(rsp->seuid);
+    if (rep == NULL)
+        goto e0;
+    rep->val = spa->seuid;
+    rep->gen = pvt->gen;
+    CALL_SMETHOD(pvt->ents, remove_by_key, &rep->key, NULL);
+    if (CALL_SMETHOD(pvt->ents, append_refcnt, &rep->key, rep->rcnt,
+      NULL) == NULL) {
+        RTPP_OBJ_DECREF(rep);
+        goto e0;
+    }
+    RTPP_OBJ_DECREF(rep);
+    RTPP_LOG(spa->log, RTPP_LOG_INFO, "replicated session on port %d "
+      "created, tag %.*s", rsp->side[0].port, FMTSTR(from_tag));
+    return (spa);
+e0:
+    RTPP_OBJ_DECREF(spa);
+    return (NULL);
+}
+
+struct rtpp_repl_del_arg {
+    struct rtpp_session *spa;
+    struct rtpp_weakref *sessions_wrt;
+};
+
+static int
+rtpp_repl_del_match(void *dp, void *ap)
+{
+    struct rtpp_repl_del_arg *dap;
+
+    dap = (struct rtpp_repl_del_arg *)ap;
+    if (dp != dap->spa)
+        return (RTPP_HT_MATCH_CONT);
+    CALL_SMETHOD(dap->sessions_wrt, unreg, dap->spa->seuid);
+    return (RTPP_HT_MATCH_DEL | RTPP_HT_MATCH_BRK);
+}
+
+/* Remove a replicated session from the local tables */
+static void
+rtpp_repl_sess_remove(const struct rtpp_cfg *cfsp, struct rtpp_session *spa)
+{
+    struct rtpp_repl_del_arg da;
+
+    da.spa = spa;
+    da.sessions_wrt = cfsp->sessions_wrt;
+    CALL_SMETHOD(cfsp->sessions_ht, foreach_key_str, spa->call_id,
+      rtpp_repl_del_match, &da);
+}
+
+/* Returns -1 if the record is malformed */
+static int
+rtpp_repl_apply_sess(struct rtpp_repl_priv *pvt, const void *data,
+  size_t dlen)
+{
+    const struct rtpp_cfg *cfsp;
+    struct rtpp_repl_sess rs;
+    const struct rtpp_repl_sess *rsp;
+    const struct sockaddr *ia;
+    struct rtpp_socket *fds[2], *ofd;
+    struct rtpp_session *spa;
+    struct rtpp_refcnt *rco;
+    int i;
+
+    cfsp = pvt->cfsp;
+    rsp = &rs;
+    if (dlen < RTPP_REPL_SESS_LEN || rtpp_repl_dec_sess(data, &rs) != 0 ||
+      dlen != RTPP_REPL_SESS_LEN + rs.call_id_len + rs.from_tag_len)
+        return (-1);
+    /* Not allocated on the active yet, nothing to bind */
+    if (rs.side[0].port == 0)
+        return (0);
+    rtpp_str_t call_id = {.s = (const char *)data + RTPP_REPL_SESS_LEN,
+      .len = rsp->call_id_len};
+    rtpp_str_t from_tag = {.s = call_id.s + call_id.len,
+      .len = rsp->from_tag_len};
+
+    spa = NULL;
+    rco = CALL_SMETHOD(pvt->ents, find, &rsp->seuid);
+    if (rco != NULL) {
+        struct rtpp_repl_ent *rep = CALL_SMETHOD(rco, getdata);
+        rep->gen = pvt->gen;
+        spa = CALL_SMETHOD(cfsp->sessions_wrt, get_by_idx, rep->val);
+        RC_DECREF(rco);
+    }
+    if (spa != NULL && (!rtpp_str_match(spa->call_id, &call_id) ||
+      !rtpp_str_match(spa->from_tag, &from_tag))) {
+        /* Not the call we have replicated under this seuid, start over */
+        RTPP_LOG(spa->log, RTPP_LOG_INFO, "replicated session on port %d "
+          "belongs to another call now, removed", spa->rtp->stream[0]->port);
+        rtpp_repl_sess_remove(cfsp, spa);
+        RTPP_OBJ_DECREF(spa);
+        spa = NULL;
+    }
+    if (spa == NULL) {
+        spa = rtpp_repl_sess_create(pvt, rsp, &call_id, &from_tag);
+        if (spa == NULL)
+            return (0);
+    }
+
+    for (i = 0; i < 2; i++) {
+        if (rsp->side[i].port == 0 ||
+          rsp->side[i].port == spa->rtp->stream[i]->port)
+            continue;
+        ia = rtpp_repl_laddr(cfsp, &rsp->side[i]);
+        if (ia == NULL || rtpp_repl_bind(cfsp, ia, rsp->side[i].port, fds) != 0) {
+            RTPP_ELOG(spa->log, RTPP_LOG_ERR, "replication: can't bind "
+              "to the port %d", rsp->side[i].port);
+            continue;
+        }
+        spa->rtp->stream[i]->laddr = spa->rtcp->stream[i]->laddr = ia;
+        ofd = CALL_SMETHOD(spa->rtp->stream[i], get_skt, HEREVAL);
+        if (ofd != NULL) {
+            CALL_SMETHOD(cfsp->sessinfo, update, spa, i, fds);
+            RTPP_OBJ_DECREF(ofd);
+        } else {
+            CALL_SMETHOD(cfsp->sessinfo, append, spa, i, fds);
+        }
+        CALL_METHOD(cfsp->rtpp_proc_cf, nudge, spa->shard);
+        RTPP_OBJ_DECREF(fds[0]);
+        RTPP_OBJ_DECREF(fds[1]);
+        spa->rtp->stream[i]->port = rsp->side[i].port;
+        spa->rtcp->stream[i]->port = rsp->side[i].port + 1;
+    }
+    spa->strong = rsp->strong;
+    spa->complete = rsp->complete;
+    for (i = 0; i < 2; i++) {
+        CALL_SMETHOD(spa->rtp->stream[i], restore_state, &rsp->side[i].rtp);
+        CALL_SMETHOD(spa->rtcp->stream[i], restore_state, &rsp->side[i].rtcp);
+        CALL_SMETHOD(spa->rtp->stream[i]->ttl, reset_with, cfsp->max_ttl);
+    }
+    RTPP_OBJ_DECREF(spa);
+    return (0);
+}
+
+static void
+rtpp_repl_apply_del(struct rtpp_repl_priv *pvt, uint64_t seuid)
+{
+    const struct rtpp_cfg *cfsp;
+    struct rtpp_session *spa;
+    struct rtpp_refcnt *rco;
+    uint64_t lseuid;
+
+    cfsp = pvt->cfsp;
+    rco = CALL_SMETHOD(pvt->ents, remove_by_key, &seuid, NULL);
+    if (rco == NULL)
+        return;
+    lseuid = ((struct rtpp_repl_ent *)CALL_SMETHOD(rco, getdata))->val;
+    RC_DECREF(rco);
+    spa = CALL_SMETHOD(cfsp->sessions_wrt, get_by_idx, lseuid);
+    if (spa == NULL)
+        return;
+    RTPP_LOG(spa->log, RTPP_LOG_INFO, "replicated session on port %d "
+      "removed", spa->rtp->stream[0]->port);
+    rtpp_repl_sess_remove(cfsp, spa);
+    RTPP_OBJ_DECREF(spa);
+}
+
+struct rtpp_repl_sweep_arg {
+    const struct rtpp_cfg *cfsp;
+    uint64_t gen;
+    int nremoved;
+};
+
+/*
+ * Drop replicated sessions that have not been refreshed since the given
+ * generation, or all of them if it is 0.
+ */
+static int
+rtpp_repl_sweep(void *dp, void *ap)
+{
+    const struct rtpp_repl_ent *rep;
+    struct rtpp_repl_sweep_arg *sap;
+    struct rtpp_session *spa;
+
+    rep = (const struct rtpp_repl_ent *)dp;
+    sap = (struct rtpp_repl_sweep_arg *)ap;
+    if (sap->gen != 0 && rep->gen == sap->gen)
+        return (RTPP_HT_MATCH_CONT);
+    spa = CALL_SMETHOD(sap->cfsp->sessions_wrt, get_by_idx, rep->val);
+    if (spa != NULL) {
+        rtpp_repl_sess_remove(sap->cfsp, spa);
+        RTPP_OBJ_DECREF(spa);
+        sap->nremoved++;
+    }
+    return (RTPP_HT_MATCH_DEL);
+}
+
+static void
+rtpp_repl_apply_hello(struct rtpp_repl_priv *pvt, uint64_t instance)
+{
+    struct rtpp_repl_sweep_arg sa;
+
+    if (pvt->have_instance && instance != pvt->instance) {
+        /* The active has restarted, its seuids mean nothing to us now */
+        sa = (struct rtpp_repl_sweep_arg){.cfsp = pvt->cfsp, .gen = 0};
+        CALL_SMETHOD(pvt->ents, foreach, rtpp_repl_sweep, &sa, NULL);
+        RTPP_LOG(pvt->cfsp->glog, RTPP_LOG_INFO, "replication: new active "
+          "instance, %d replicated session(s) removed", sa.nremoved);
+    }
+    pvt->instance = instance;
+    pvt->have_instance = 1;
+}
+
+/* First full pass on this connection is over */
+static void
+rtpp_repl_apply_insync(struct rtpp_repl_priv *pvt)
+{
+    struct rtpp_repl_sweep_arg sa;
+
+    /* Whatever the active has not sent again is gone there */
+    sa = (struct rtpp_repl_sweep_arg){.cfsp = pvt->cfsp, .gen = pvt->gen};
+    CALL_SMETHOD(pvt->ents, foreach, rtpp_repl_sweep, &sa, NULL);
+    if (sa.nremoved > 0) {
+        RTPP_LOG(pvt->cfsp->glog, RTPP_LOG_INFO, "replication: %d "
+          "replicated session(s) are gone on the active, removed",
+          sa.nremoved);
+    }
+    pvt->insync = 1;
+}
+
+/*
+ * Active is alive: hold TTLs of the replicated sessions, media does not
+ * flow through us yet. Also forget sessions that went away locally.
+ */
+static int
+rtpp_repl_touch(void *dp, void *ap)
+{
+    const struct rtpp_repl_ent *rep;
+    const struct rtpp_cfg *cfsp;
+    struct rtpp_session *spa;
+
+    rep = (const struct rtpp_repl_ent *)dp;
+    cfsp = (const struct rtpp_cfg *)ap;
+    spa = CALL_SMETHOD(cfsp->sessions_wrt, get_by_idx, rep->val);
+    if (spa == NULL)
+        return (RTPP_HT_MATCH_DEL);
+    CALL_SMETHOD(spa->rtp->stream[0]->ttl, reset_with, cfsp->max_ttl);
+    CALL_SMETHOD(spa->rtp->stream[1]->ttl, reset_with, cfsp->max_ttl);
+    RTPP_OBJ_DECREF(spa);
+    return (RTPP_HT_MATCH_CONT);
+}
+
+/* Process complete records in the buffer, returns -1 on protocol error */
+static int
+rtpp_repl_input(struct rtpp_repl_priv *pvt)
+{
+    struct rtpp_repl_hdr hdr;
+    size_t off;
+    const uint8_t *cp, *data;
+
+    for (off = 0; pvt->buf.len - off >= RTPP_REPL_HDR_LEN;
+      off += RTPP_REPL_HDR_LEN + hdr.dlen) {
+        cp = (const uint8_t *)pvt->buf.data + off;
+        hdr.magic = rtpp_repl_get(&cp, 4);
+        hdr.version = rtpp_repl_get(&cp, 2);
+        hdr.type = rtpp_repl_get(&cp, 2);
+        hdr.dlen = rtpp_repl_get(&cp, 4);
+        if (hdr.magic != RTPP_REPL_MAGIC || hdr.version != RTPP_REPL_VERSION ||
+          hdr.dlen > RTPP_REPL_MAXREC)
+            return (-1);
+        if (pvt->buf.len - off - RTPP_REPL_HDR_LEN < hdr.dlen)
+            break;
+        data = cp;
+        /* Exactly one HELLO, and it has to come first */
+        if (pvt->hello != (hdr.type != RTPP_REPL_HELLO))
+            return (-1);
+        switch (hdr.type) {
+        case RTPP_REPL_HELLO:
+            if (hdr.dlen != 8)
+                return (-1);
+            rtpp_repl_apply_hello(pvt, rtpp_repl_get(&data, 8));
+            pvt->hello = 1;
+            break;
+
+        case RTPP_REPL_SESS:
+            if (rtpp_repl_apply_sess(pvt, data, hdr.dlen) != 0)
+                return (-1);
+            break;
+
+        case RTPP_REPL_DEL:
+            if (hdr.dlen != 8)
+                return (-1);
+            rtpp_repl_apply_del(pvt, rtpp_repl_get(&data, 8));
+            break;
+
+        case RTPP_REPL_SYNC:
+            if (!pvt->insync)
+                rtpp_repl_apply_insync(pvt);
+            CALL_SMETHOD(pvt->ents, foreach, rtpp_repl_touch,
+              (void *)pvt->cfsp, NULL);
+            break;
+
+        default:
+            return (-1);
+        }
+    }
+    pvt->buf.len -= off;
+    memmove(pvt->buf.data, pvt->buf.data + off, pvt->buf.len);
+    return (0);
+}
+
+static void
+rtpp_repl_standby_run(struct rtpp_repl_priv *pvt)
+{
+    const struct rtpp_cfg *cfsp;
+    struct pollfd pfds[2];
+    ssize_t r;
+    int s, nfds;
+
+    cfsp = pvt->cfsp;
+    for (;;) {
+        if (atomic_load(&pvt->tstate) == TSTATE_CEASE)
+            break;
+        pfds[0].fd = pvt->lfd;
+        pfds[0].events = POLLIN;
+        pfds[1].fd = pvt->s;
+        pfds[1].events = POLLIN;
+        nfds = (pvt->s >= 0) ? 2 : 1;
+        if (poll(pfds, nfds, 100) <= 0)
+            continue;
+        if (pfds[0].revents & POLLIN) {
+            s = accept(pvt->lfd, NULL, NULL);
+            if (s >= 0) {
+                if (pvt->s >= 0)
+                    close(pvt->s);
+                pvt->s = s;
+                pvt->buf.len = 0;
+                /* The active starts with a full pass, see insync */
+                pvt->gen++;
+                pvt->insync = 0;
+                pvt->hello = 0;
+                RTPP_LOG(cfsp->glog, RTPP_LOG_INFO, "replication: active "
+                  "has connected");
+                continue;
+            }
+        }
+        if (nfds < 2 || pfds[1].revents == 0)
+            continue;
+        if (rtpp_repl_buf_reserve(&pvt->buf, RTPP_REPL_MAXREC) != 0)
+            goto drop;
+        r = recv(pvt->s, pvt->buf.data + pvt->buf.len,
+          pvt->buf.alen - pvt->buf.len, 0);
+        if (r < 0 && (errno == EINTR || errno == EAGAIN))
+            continue;
+        if (r > 0) {
+            pvt->buf.len += r;
+            if (rtpp_repl_input(pvt) == 0)
+                continue;
+        }
+drop:
+        RTPP_LOG(cfsp->glog, RTPP_LOG_INFO, "replication: active has "
+          "disconnected, replicated sessions are on their own now");
+        close(pvt->s);
+        pvt->s = -1;
+        pvt->buf.len = 0;
+    }
+}
+
+static void *
+rtpp_repl_run(void *arg)
+{
+    struct rtpp_repl_priv *pvt;
+
+    pvt = (struct rtpp_repl_priv *)arg;
+    if (pvt->standby)
+        rtpp_repl_standby_run(pvt);
+    else
+        rtpp_repl_active_run(pvt);
+    return (NULL);
+}
+
+struct rtpp_repl *
+rtpp_repl_ctor(const struct rtpp_cfg *cfsp)
+{
+    struct rtpp_repl_priv *pvt;
+    int reuse;
+
+    pvt = rtpp_zmalloc(sizeof(*pvt));
+    if (pvt == NULL)
+        goto e0;
+    pvt->cfsp = cfsp;
+    pvt->lfd = pvt->s = -1;
+    pvt->instance = ((uint64_t)random()) << 32 | (uint64_t)random();
+    pvt->standby = (cfsp->repl_listen != NULL);
+    if (rtpp_repl_parse_addr(pvt->standby ? cfsp->repl_listen :
+      cfsp->repl_peer, &pvt->addr, pvt->standby) != 0) {
+        RTPP_LOG(cfsp->glog, RTPP_LOG_ERR, "replication: %s: invalid address",
+          pvt->standby ? cfsp->repl_listen : cfsp->repl_peer);
+        goto e1;
+    }
+    pvt->ents = rtpp_hash_table_ctor(rtpp_ht_key_u64_t, 0);
+    if (pvt->ents == NULL)
+        goto e1;
+    if (pthread_mutex_init(&pvt->q.lock, NULL) != 0)
+        goto e2;
+    pvt->q.seuids = pvt->q.bufs[0];
+    if (pvt->standby) {
+        pvt->lfd = socket(pvt->addr.ss_family, SOCK_STREAM, 0);
+        if (pvt->lfd < 0)
+            goto e3;
+        reuse = 1;
+        setsockopt(pvt->lfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(pvt->lfd, sstosa(&pvt->addr), SA_LEN(sstosa(&pvt->addr))) != 0 ||
+          listen(pvt->lfd, 1) != 0) {
+            RTPP_ELOG(cfsp->glog, RTPP_LOG_ERR, "replication: can't listen "
+              "on %s", cfsp->repl_listen);
+            goto e4;
+        }
+    } else {
+        pvt->elp = prdic_init(RTPP_REPL_FREQ, 0.0);
+        if (pvt->elp == NULL)
+            goto e3;
+    }
+    atomic_init(&pvt->tstate, TSTATE_RUN);
+    if (pthread_create(&pvt->thread_id, NULL, &rtpp_repl_run, pvt) != 0)
+        goto e4;
+#if HAVE_PTHREAD_SETNAME_NP
+    (void)pthread_setname_np(pvt->thread_id, "rtpp_repl");
+#endif
+    pvt->pub.note = &rtpp_repl_note;
+    pvt->pub.shutdown = &rtpp_repl_shutdown;
+    pvt->pub.dtor = &rtpp_repl_dtor;
+    return (&pvt->pub);
+e4:
+    if (pvt->elp != NULL)
+        prdic_free(pvt->elp);
+    if (pvt->lfd >= 0)
+        close(pvt->lfd);
+e3:
+    pthread_mutex_destroy(&pvt->q.lock);
+e2:
+    RTPP_OBJ_DECREF(pvt->ents);
+e1:
+    free(pvt);
+e0:
+    return (NULL);
+}
+
+static void
+rtpp_repl_shutdown(struct rtpp_repl *pub)
+{
+    struct rtpp_repl_priv *pvt;
+
+    PUB2PVT(pub, pvt);
+    if (atomic_exchange(&pvt->tstate, TSTATE_CEASE) == TSTATE_CEASE)
+        return;
+    pthread_join(pvt->thread_id, NULL);
+    if (pvt->s >= 0) {
+        close(pvt->s);
+        pvt->s = -1;
+    }
+    if (pvt->lfd >= 0) {
+        close(pvt->lfd);
+        pvt->lfd = -1;
+    }
+}
+
+static void
+rtpp_repl_dtor(struct rtpp_repl *pub)
+{
+    struct rtpp_repl_priv *pvt;
+
+    PUB2PVT(pub, pvt);
+    rtpp_repl_shutdown(pub);
+    if (pvt->elp != NULL)
+        prdic_free(pvt->elp);
+    pthread_mutex_destroy(&pvt->q.lock);
+    CALL_SMETHOD(pvt->ents, purge);
+    RTPP_OBJ_DECREF(pvt->ents);
+    free(pvt->buf.data);
+    free(pvt);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+struct rtpp_repl;
+struct rtpp_cfg;
+
+/*
+ * Active/standby replication of the session state. On the active instance
+ * the command and media paths report sessions that have been created,
+ * changed or removed with note(); the reports are collected and sent in
+ * batches, several times a second, to the standby one. The standby keeps
+ * an equivalent set of sessions bound to the same ports, ready to carry
+ * media as soon as the service address moves over to it.
+ *
+ * note() may be called from any thread, it never blocks for long and
+ * never allocates. shutdown() stops the replication, note() is a no-op
+ * after that, but the object stays valid until dtor().
+ */
+DEFINE_METHOD(rtpp_repl, rtpp_repl_note, void, uint64_t);
+DEFINE_METHOD(rtpp_repl, rtpp_repl_shutdown, void);
+DEFINE_METHOD(rtpp_repl, rtpp_repl_dtor, void);
+
+struct rtpp_repl {
+    rtpp_repl_note_t note;
+    rtpp_repl_shutdown_t shutdown;
+    rtpp_repl_dtor_t dtor;
+};
+
+struct rtpp_repl *rtpp_repl_ctor(const struct rtpp_cfg *);
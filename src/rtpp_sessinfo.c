@@ -74,12 +74,18 @@ struct rtpp_polltbl_hst {
    pthread_mutex_t lock;
 };
 
-struct rtpp_sessinfo_priv {
-   struct rtpp_sessinfo pub;
+/* Change logs for the RTP and RTCP threads of one media shard */
+struct rtpp_sessinfo_shard {
    struct rtpp_polltbl_hst hst_rtp;
    struct rtpp_polltbl_hst hst_rtcp;
 };
 
+struct rtpp_sessinfo_priv {
+   struct rtpp_sessinfo pub;
+   int nshards;
+   struct rtpp_sessinfo_shard *shards;
+};
+
 static int rtpp_sinfo_append(struct rtpp_sessinfo *, struct rtpp_session *,
   int, struct rtpp_socket **);
 static void rtpp_sinfo_update(struct rtpp_sessinfo *, struct rtpp_session *,
@@ -177,27 +183,42 @@ rtpp_sessinfo_ctor(const struct rtpp_cfg *cfsp)
 {
     struct rtpp_sessinfo *sessinfo;
     struct rtpp_sessinfo_priv *pvt;
+    struct rtpp_sessinfo_shard *shp;
+    int i;
 
     pvt = rtpp_rzmalloc(sizeof(struct rtpp_sessinfo_priv), PVT_RCOFFS(pvt));
     if (pvt == NULL) {
         return (NULL);
     }
     sessinfo = &(pvt->pub);
-    if (rtpp_polltbl_hst_alloc(&pvt->hst_rtp, 10) != 0) {
-        goto e6;
+    pvt->shards = rtpp_zmalloc(sizeof(pvt->shards[0]) * cfsp->nshards);
+    if (pvt->shards == NULL) {
+        goto e5;
     }
-    if (rtpp_polltbl_hst_alloc(&pvt->hst_rtcp, 10) != 0) {
-        goto e7;
+    for (i = 0; i < cfsp->nshards; i++) {
+        shp = &pvt->shards[i];
+        if (rtpp_polltbl_hst_alloc(&shp->hst_rtp, 10) != 0) {
+            goto e6;
+        }
+        if (rtpp_polltbl_hst_alloc(&shp->hst_rtcp, 10) != 0) {
+            rtpp_polltbl_hst_dtor(&shp->hst_rtp);
+            goto e6;
+        }
+        shp->hst_rtp.streams_wrt = cfsp->rtp_streams_wrt;
+        shp->hst_rtcp.streams_wrt = cfsp->rtcp_streams_wrt;
     }
-    pvt->hst_rtp.streams_wrt = cfsp->rtp_streams_wrt;
-    pvt->hst_rtcp.streams_wrt = cfsp->rtcp_streams_wrt;
+    pvt->nshards = cfsp->nshards;
 
     PUBINST_FININIT(&pvt->pub, pvt, rtpp_sessinfo_dtor);
     return (sessinfo);
 
-e7:
-    rtpp_polltbl_hst_dtor(&pvt->hst_rtp);
 e6:
+    while (--i >= 0) {
+        rtpp_polltbl_hst_dtor(&pvt->shards[i].hst_rtcp);
+        rtpp_polltbl_hst_dtor(&pvt->shards[i].hst_rtp);
+    }
+    free(pvt->shards);
+e5:
     RTPP_OBJ_DECREF(&(pvt->pub));
     free(pvt);
     return (NULL);
@@ -208,8 +229,11 @@ rtpp_sessinfo_dtor(struct rtpp_sessinfo_priv *pvt)
 {
 
     rtpp_sessinfo_fin(&(pvt->pub));
-    rtpp_polltbl_hst_dtor(&pvt->hst_rtp);
-    rtpp_polltbl_hst_dtor(&pvt->hst_rtcp);
+    for (int i = 0; i < pvt->nshards; i++) {
+        rtpp_polltbl_hst_dtor(&pvt->shards[i].hst_rtp);
+        rtpp_polltbl_hst_dtor(&pvt->shards[i].hst_rtcp);
+    }
+    free(pvt->shards);
     free(pvt);
 }
 
@@ -218,36 +242,38 @@ rtpp_sinfo_append(struct rtpp_sessinfo *sessinfo, struct rtpp_session *sp,
   int index, struct rtpp_socket **new_fds)
 {
     struct rtpp_sessinfo_priv *pvt;
+    struct rtpp_sessinfo_shard *shp;
     struct rtpp_stream *rtp, *rtcp;
 
     PUB2PVT(sessinfo, pvt);
-    pthread_mutex_lock(&pvt->hst_rtp.lock);
-    if (pvt->hst_rtp.ulen == pvt->hst_rtp.main.alen) {
-        if (rtpp_polltbl_hst_extend(&pvt->hst_rtp) < 0) {
+    shp = &pvt->shards[sp->shard];
+    pthread_mutex_lock(&shp->hst_rtp.lock);
+    if (shp->hst_rtp.ulen == shp->hst_rtp.main.alen) {
+        if (rtpp_polltbl_hst_extend(&shp->hst_rtp) < 0) {
             goto e0;
         }
     }
-    pthread_mutex_lock(&pvt->hst_rtcp.lock);
-    if (pvt->hst_rtcp.ulen == pvt->hst_rtcp.main.alen) {
-        if (rtpp_polltbl_hst_extend(&pvt->hst_rtcp) < 0) {
+    pthread_mutex_lock(&shp->hst_rtcp.lock);
+    if (shp->hst_rtcp.ulen == shp->hst_rtcp.main.alen) {
+        if (rtpp_polltbl_hst_extend(&shp->hst_rtcp) < 0) {
             goto e1;
         }
     }
     rtp = sp->rtp->stream[index];
     CALL_SMETHOD(rtp, set_skt, new_fds[0]);
-    rtpp_polltbl_hst_record(&pvt->hst_rtp, HST_ADD, rtp->stuid, new_fds[0]);
-    pthread_mutex_unlock(&pvt->hst_rtp.lock);
+    rtpp_polltbl_hst_record(&shp->hst_rtp, HST_ADD, rtp->stuid, new_fds[0]);
+    pthread_mutex_unlock(&shp->hst_rtp.lock);
 
     rtcp = sp->rtcp->stream[index];
     CALL_SMETHOD(rtcp, set_skt, new_fds[1]);
-    rtpp_polltbl_hst_record(&pvt->hst_rtcp, HST_ADD, rtcp->stuid, new_fds[1]);
-    pthread_mutex_unlock(&pvt->hst_rtcp.lock);
+    rtpp_polltbl_hst_record(&shp->hst_rtcp, HST_ADD, rtcp->stuid, new_fds[1]);
+    pthread_mutex_unlock(&shp->hst_rtcp.lock);
 
     return (0);
 e1:
-    pthread_mutex_unlock(&pvt->hst_rtcp.lock);
+    pthread_mutex_unlock(&shp->hst_rtcp.lock);
 e0:
-    pthread_mutex_unlock(&pvt->hst_rtp.lock);
+    pthread_mutex_unlock(&shp->hst_rtp.lock);
     return (-1);
 }
 
@@ -274,48 +300,50 @@ rtpp_sinfo_update(struct rtpp_sessinfo *sessinfo, struct rtpp_session *sp,
   int index, struct rtpp_socket **new_fds)
 {
     struct rtpp_sessinfo_priv *pvt;
+    struct rtpp_sessinfo_shard *shp;
     struct rtpp_stream *rtp, *rtcp;
     struct rtpp_socket *old_fd;
 
     PUB2PVT(sessinfo, pvt);
+    shp = &pvt->shards[sp->shard];
 
-    pthread_mutex_lock(&pvt->hst_rtp.lock);
-    if (pvt->hst_rtp.ulen == pvt->hst_rtp.main.alen) {
-        if (rtpp_polltbl_hst_extend(&pvt->hst_rtp) < 0) {
+    pthread_mutex_lock(&shp->hst_rtp.lock);
+    if (shp->hst_rtp.ulen == shp->hst_rtp.main.alen) {
+        if (rtpp_polltbl_hst_extend(&shp->hst_rtp) < 0) {
             goto e0;
         }
     }
-    pthread_mutex_lock(&pvt->hst_rtcp.lock);
-    if (pvt->hst_rtcp.ulen == pvt->hst_rtcp.main.alen) {
-        if (rtpp_polltbl_hst_extend(&pvt->hst_rtcp) < 0) {
+    pthread_mutex_lock(&shp->hst_rtcp.lock);
+    if (shp->hst_rtcp.ulen == shp->hst_rtcp.main.alen) {
+        if (rtpp_polltbl_hst_extend(&shp->hst_rtcp) < 0) {
             goto e1;
         }
     }
     rtp = sp->rtp->stream[index];
     old_fd = CALL_SMETHOD(rtp, update_skt, new_fds[0]);
     if (old_fd != NULL) {
-        rtpp_polltbl_hst_record(&pvt->hst_rtp, HST_UPD, rtp->stuid, new_fds[0]);
-        pthread_mutex_unlock(&pvt->hst_rtp.lock);
+        rtpp_polltbl_hst_record(&shp->hst_rtp, HST_UPD, rtp->stuid, new_fds[0]);
+        pthread_mutex_unlock(&shp->hst_rtp.lock);
         RTPP_OBJ_DECREF(old_fd);
     } else {
-        rtpp_polltbl_hst_record(&pvt->hst_rtp, HST_ADD, rtp->stuid, new_fds[0]);
-        pthread_mutex_unlock(&pvt->hst_rtp.lock);
+        rtpp_polltbl_hst_record(&shp->hst_rtp, HST_ADD, rtp->stuid, new_fds[0]);
+        pthread_mutex_unlock(&shp->hst_rtp.lock);
     }
     rtcp = sp->rtcp->stream[index];
     old_fd = CALL_SMETHOD(rtcp, update_skt, new_fds[1]);
     if (old_fd != NULL) {
-        rtpp_polltbl_hst_record(&pvt->hst_rtcp, HST_UPD, rtcp->stuid, new_fds[1]);
-        pthread_mutex_unlock(&pvt->hst_rtcp.lock);
+        rtpp_polltbl_hst_record(&shp->hst_rtcp, HST_UPD, rtcp->stuid, new_fds[1]);
+        pthread_mutex_unlock(&shp->hst_rtcp.lock);
         RTPP_OBJ_DECREF(old_fd);
     } else {
-        rtpp_polltbl_hst_record(&pvt->hst_rtcp, HST_ADD, rtcp->stuid, new_fds[1]);
-        pthread_mutex_unlock(&pvt->hst_rtcp.lock);
+        rtpp_polltbl_hst_record(&shp->hst_rtcp, HST_ADD, rtcp->stuid, new_fds[1]);
+        pthread_mutex_unlock(&shp->hst_rtcp.lock);
     }
     return;
 e1:
-    pthread_mutex_unlock(&pvt->hst_rtcp.lock);
+    pthread_mutex_unlock(&shp->hst_rtcp.lock);
 e0:
-    pthread_mutex_unlock(&pvt->hst_rtp.lock);
+    pthread_mutex_unlock(&shp->hst_rtp.lock);
 }
 
 static void
@@ -323,38 +351,40 @@ rtpp_sinfo_remove(struct rtpp_sessinfo *sessinfo, struct rtpp_session *sp,
   int index)
 {
     struct rtpp_sessinfo_priv *pvt;
+    struct rtpp_sessinfo_shard *shp;
     struct rtpp_stream *rtp, *rtcp;
     struct rtpp_socket *fd_rtp, *fd_rtcp;;
 
     PUB2PVT(sessinfo, pvt);
+    shp = &pvt->shards[sp->shard];
 
     rtp = sp->rtp->stream[index];
     rtcp = sp->rtcp->stream[index];
     fd_rtp = CALL_SMETHOD(rtp, get_skt, HEREVAL);
     fd_rtcp = CALL_SMETHOD(rtcp, get_skt, HEREVAL);
     if (fd_rtp != NULL) {
-        pthread_mutex_lock(&pvt->hst_rtp.lock);
-        if (pvt->hst_rtp.ulen == pvt->hst_rtp.main.alen) {
-            if (rtpp_polltbl_hst_extend(&pvt->hst_rtp) < 0) {
+        pthread_mutex_lock(&shp->hst_rtp.lock);
+        if (shp->hst_rtp.ulen == shp->hst_rtp.main.alen) {
+            if (rtpp_polltbl_hst_extend(&shp->hst_rtp) < 0) {
                 goto e0;
             }
         }
     }
     if (fd_rtcp != NULL) {
-        pthread_mutex_lock(&pvt->hst_rtcp.lock);
-        if (pvt->hst_rtcp.ulen == pvt->hst_rtcp.main.alen) {
-            if (rtpp_polltbl_hst_extend(&pvt->hst_rtcp) < 0) {
+        pthread_mutex_lock(&shp->hst_rtcp.lock);
+        if (shp->hst_rtcp.ulen == shp->hst_rtcp.main.alen) {
+            if (rtpp_polltbl_hst_extend(&shp->hst_rtcp) < 0) {
                 goto e1;
             }
         }
     }
     if (fd_rtp != NULL) {
-        rtpp_polltbl_hst_record(&pvt->hst_rtp, HST_DEL, rtp->stuid, NULL);
-        pthread_mutex_unlock(&pvt->hst_rtp.lock);
+        rtpp_polltbl_hst_record(&shp->hst_rtp, HST_DEL, rtp->stuid, NULL);
+        pthread_mutex_unlock(&shp->hst_rtp.lock);
     }
     if (fd_rtcp != NULL) {
-        rtpp_polltbl_hst_record(&pvt->hst_rtcp, HST_DEL, rtcp->stuid, NULL);
-        pthread_mutex_unlock(&pvt->hst_rtcp.lock);
+        rtpp_polltbl_hst_record(&shp->hst_rtcp, HST_DEL, rtcp->stuid, NULL);
+        pthread_mutex_unlock(&shp->hst_rtcp.lock);
     }
     if (fd_rtp != NULL)
         RTPP_OBJ_DECREF(fd_rtp);
@@ -362,10 +392,10 @@ rtpp_sinfo_remove(struct rtpp_sessinfo *sessinfo, struct rtpp_session *sp,
         RTPP_OBJ_DECREF(fd_rtcp);
     return;
 e1:
-    pthread_mutex_unlock(&pvt->hst_rtcp.lock);
+    pthread_mutex_unlock(&shp->hst_rtcp.lock);
 e0:
     if (fd_rtp != NULL)
-        pthread_mutex_unlock(&pvt->hst_rtp.lock);
+        pthread_mutex_unlock(&shp->hst_rtp.lock);
 }
 
 void
@@ -400,7 +430,9 @@ rtpp_sinfo_sync_polltbl(struct rtpp_sessinfo *sessinfo,
 
     PUB2PVT(sessinfo, pvt);
 
-    hp = (pipe_type == PIPE_RTP) ? &pvt->hst_rtp : &pvt->hst_rtcp;
+    RTPP_DBG_ASSERT(ptbl->shard >= 0 && ptbl->shard < pvt->nshards);
+    hp = (pipe_type == PIPE_RTP) ? &pvt->shards[ptbl->shard].hst_rtp :
+      &pvt->shards[ptbl->shard].hst_rtcp;
 
     pthread_mutex_lock(&hp->lock);
     if (hp->ulen == 0) {
@@ -64,6 +64,7 @@ struct rtpp_polltbl {
     struct rtpp_weakref *streams_wrt;
     int wakefd[2];
     _Atomic(int) served_i_wake;
+    int shard;
 };
 
 DECLARE_SMETHODS(rtpp_sessinfo)
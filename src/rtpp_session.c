@@ -54,6 +54,7 @@
 #include "rtpp_mallocs.h"
 #include "rtpp_module_if.h"
 #include "rtpp_modman.h"
+#include "rtpp_pcount.h"
 #include "rtpp_pipe.h"
 #include "rtpp_codeptr.h"
 #include "rtpp_stream.h"
@@ -64,6 +65,8 @@
 #include "rtpp_refcnt.h"
 #include "rtpp_timeout_data.h"
 #include "rtpp_proc_async.h"
+#include "rtpp_netio_async.h"
+#include "rtpp_xxHash.h"
 
 struct rtpp_session_priv
 {
@@ -74,10 +77,52 @@ struct rtpp_session_priv
     struct rtpp_str call_id;
     struct rtpp_str from_tag;
     struct rtpp_str from_tag_nmn;
+    struct rtpp_session_blk *blk;
+    /* Storage for the from_tag_nmn follows */
+};
+
+/*
+ * The session, its pipes, their streams and the objects the streams share
+ * are laid out in a single allocation headed by this structure:
+ *
+ *   blk | session | ttl(s) | RTP pipe, pcount, 2 streams | RTCP pipe ...
+ *
+ * The pipes share the session's refcount. The streams keep their own, since
+ * they are looked up via weakref and held by the media threads independently
+ * of the session. The session and every stream hold a reference on the
+ * block, the last one to go finalizes the shared ttl/pcount and frees it.
+ */
+struct rtpp_session_blk {
+    struct rtpp_refcnt *rcnt;
+    struct rtpp_pcount *pcount[2];
+    struct rtpp_ttl *ttl[2];
 };
 
 static void rtpp_session_dtor(struct rtpp_session_priv *);
 
+static void
+rtpp_session_blk_dtor(struct rtpp_session_blk *blk)
+{
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        if (blk->pcount[i] != NULL)
+            rtpp_pcount_dtor_pa(blk->pcount[i]);
+        if (blk->ttl[i] != NULL)
+            rtpp_ttl_dtor_pa(blk->ttl[i]);
+    }
+    free(blk);
+}
+
+int
+rtpp_session_shard(const struct rtpp_cfg *cfs, const rtpp_str_t *call_id)
+{
+
+    if (cfs->nshards < 2)
+        return (0);
+    return (XXH64(call_id->s, call_id->len, 0) % cfs->nshards);
+}
+
 struct rtpp_session *
 rtpp_session_ctor(const struct rtpp_cfg *cfs, struct common_cmd_args *ccap,
   const struct rtpp_timestamp *dtime, const struct sockaddr **lia, int weak,
@@ -85,17 +130,55 @@ rtpp_session_ctor(const struct rtpp_cfg *cfs, struct common_cmd_args *ccap,
 {
     struct rtpp_session_priv *pvt;
     struct rtpp_session *pub;
+    struct rtpp_session_blk *blk;
     struct rtpp_log *log;
     struct r_pipe_ctor_args pipe_cfg;
-    int i;
+    struct {
+        size_t sess;
+        size_t ttl[2];
+        size_t rtp;
+        size_t rtcp;
+        size_t len;
+    } boff;
+    size_t slen;
+    int i, nttls;
+
+    rtpp_str_const_t tag_nomedianum = {.s = ccap->from_tag->s, .len = ccap->from_tag->len};
+    const char *semi = memchr(tag_nomedianum.s, ';', tag_nomedianum.len);
+    if (semi != NULL) {
+        tag_nomedianum.len = semi - tag_nomedianum.s;
+    }
+
+    pipe_cfg = (struct r_pipe_ctor_args){
+      .streams_wrt = cfs->rtp_streams_wrt, .proc_servers = cfs->proc_servers,
+      .rtpp_stats = cfs->rtpp_stats, .pipe_type = PIPE_RTP,
+#if ENABLE_MODULE_IF
+      .nmodules  = cfs->modules_cf->count.total,
+#endif
+      .pproc_manager = cfs->pproc_manager, .repl = cfs->rtpp_repl_cf};
+    slen = sizeof(struct rtpp_session_priv) + tag_nomedianum.len + 1;
+    nttls = (cfs->ttl_mode == TTL_INDEPENDENT) ? 2 : 1;
+    boff.sess = RTPP_MALIGN(sizeof(struct rtpp_session_blk));
+    boff.ttl[0] = boff.sess + RTPP_MALIGN(rtpp_rsize(slen));
+    boff.ttl[1] = boff.ttl[0] + RTPP_MALIGN(rtpp_ttl_osize);
+    boff.rtp = boff.ttl[nttls - 1] + RTPP_MALIGN(rtpp_ttl_osize);
+    boff.rtcp = boff.rtp + RTPP_MALIGN(rtpp_pipe_osize(&pipe_cfg));
+    pipe_cfg.pipe_type = PIPE_RTCP;
+    boff.len = boff.rtcp + rtpp_pipe_osize(&pipe_cfg);
 
-    pvt = rtpp_rzmalloc(sizeof(struct rtpp_session_priv), PVT_RCOFFS(pvt));
-    if (pvt == NULL) {
+    blk = rtpp_rzmalloc(boff.len, offsetof(struct rtpp_session_blk, rcnt));
+    if (blk == NULL) {
         goto e0;
     }
+    CALL_SMETHOD(blk->rcnt, attach, (rtpp_refcnt_dtor_t)&rtpp_session_blk_dtor,
+      blk);
+    /* The initial reference on the block belongs to the session */
+    pvt = rtpp_rzinit((char *)blk + boff.sess, slen, PVT_RCOFFS(pvt));
+    pvt->blk = blk;
 
     pub = &(pvt->pub);
     rtpp_gen_uid(&pub->seuid);
+    pub->shard = rtpp_session_shard(cfs, ccap->call_id);
 
     log = rtpp_log_ctor("rtpproxy", ccap->call_id->s, 0);
     if (log == NULL) {
@@ -103,24 +186,27 @@ rtpp_session_ctor(const struct rtpp_cfg *cfs, struct common_cmd_args *ccap,
     }
     CALL_METHOD(log, start, cfs);
     CALL_METHOD(log, setlevel, cfs->log_level);
-    pipe_cfg = (struct r_pipe_ctor_args){.seuid = pub->seuid,
-      .streams_wrt = cfs->rtp_streams_wrt, .proc_servers = cfs->proc_servers,
-      .log = log, .rtpp_stats = cfs->rtpp_stats, .pipe_type = PIPE_RTP,
-#if ENABLE_MODULE_IF
-      .nmodules  = cfs->modules_cf->count.total,
-#endif
-      .pproc_manager = cfs->pproc_manager};
-    pub->rtp = rtpp_pipe_ctor(&pipe_cfg);
+    pipe_cfg.seuid = pub->seuid;
+    pipe_cfg.shard = pub->shard;
+    pipe_cfg.sender = rtpp_anetio_get_sender(cfs->rtpp_proc_cf->netio,
+      pub->shard);
+    pipe_cfg.log = log;
+    pipe_cfg.owner = blk->rcnt;
+    pipe_cfg.pipe_type = PIPE_RTP;
+    pub->rtp = rtpp_pipe_ctor_pa((char *)blk + boff.rtp, pub->rcnt, &pipe_cfg);
     if (pub->rtp == NULL) {
         goto e2;
     }
+    blk->pcount[0] = pub->rtp->pcount;
     /* spb is RTCP twin session for this one. */
     pipe_cfg.streams_wrt = cfs->rtcp_streams_wrt;
     pipe_cfg.pipe_type = PIPE_RTCP;
-    pub->rtcp = rtpp_pipe_ctor(&pipe_cfg);
+    pub->rtcp = rtpp_pipe_ctor_pa((char *)blk + boff.rtcp, pub->rcnt,
+      &pipe_cfg);
     if (pub->rtcp == NULL) {
         goto e3;
     }
+    blk->pcount[1] = pub->rtcp->pcount;
     pvt->acct = rtpp_acct_ctor(pub->seuid);
     if (pvt->acct == NULL) {
         goto e4;
@@ -136,14 +222,9 @@ rtpp_session_ctor(const struct rtpp_cfg *cfs, struct common_cmd_args *ccap,
         goto e6;
     }
     pub->from_tag = &pvt->from_tag.fx;
-    rtpp_str_const_t tag_nomedianum = {.s = ccap->from_tag->s, .len = ccap->from_tag->len};
-    const char *semi = memchr(tag_nomedianum.s, ';', tag_nomedianum.len);
-    if (semi != NULL) {
-        tag_nomedianum.len = semi - tag_nomedianum.s;
-    }
-    if (rtpp_str_dup2(&tag_nomedianum, &pvt->from_tag_nmn.ro) == NULL) {
-        goto e7;
-    }
+    pvt->from_tag_nmn.rw.s = (char *)(pvt + 1);
+    memcpy(pvt->from_tag_nmn.rw.s, tag_nomedianum.s, tag_nomedianum.len);
+    pvt->from_tag_nmn.rw.len = tag_nomedianum.len;
     pub->from_tag_nmn = &pvt->from_tag_nmn.fx;
     for (i = 0; i < 2; i++) {
         pub->rtp->stream[i]->laddr = lia[i];
@@ -157,19 +238,19 @@ rtpp_session_ctor(const struct rtpp_cfg *cfs, struct common_cmd_args *ccap,
 
     pub->rtp->stream[0]->port = lport;
     pub->rtcp->stream[0]->port = lport + 1;
-    for (i = 0; i < 2; i++) {
-        if (i == 0 || cfs->ttl_mode == TTL_INDEPENDENT) {
-            pub->rtp->stream[i]->ttl = rtpp_ttl_ctor(cfs->max_setup_ttl);
-            if (pub->rtp->stream[i]->ttl == NULL) {
-                goto e8;
-            }
-        } else {
-            pub->rtp->stream[i]->ttl = pub->rtp->stream[0]->ttl;
-            RTPP_OBJ_INCREF(pub->rtp->stream[0]->ttl);
+    for (i = 0; i < nttls; i++) {
+        blk->ttl[i] = rtpp_ttl_ctor_pa((char *)blk + boff.ttl[i], blk->rcnt,
+          cfs->max_setup_ttl);
+        if (blk->ttl[i] == NULL) {
+            goto e8;
         }
+    }
+    for (i = 0; i < 2; i++) {
         /* RTCP shares the same TTL */
-        pub->rtcp->stream[i]->ttl = pub->rtp->stream[i]->ttl;
+        pub->rtp->stream[i]->ttl = blk->ttl[i % nttls];
         RTPP_OBJ_INCREF(pub->rtp->stream[i]->ttl);
+        pub->rtcp->stream[i]->ttl = blk->ttl[i % nttls];
+        RTPP_OBJ_INCREF(pub->rtcp->stream[i]->ttl);
     }
     for (i = 0; i < 2; i++) {
         pub->rtp->stream[i]->stuid_rtcp = pub->rtcp->stream[i]->stuid;
@@ -188,29 +269,27 @@ rtpp_session_ctor(const struct rtpp_cfg *cfs, struct common_cmd_args *ccap,
 #endif
 
     CALL_SMETHOD(cfs->sessinfo, append, pub, 0, fds);
-    CALL_METHOD(cfs->rtpp_proc_cf, nudge);
+    CALL_METHOD(cfs->rtpp_proc_cf, nudge, pub->shard);
 
     CALL_SMETHOD(pub->rcnt, attach, (rtpp_refcnt_dtor_t)&rtpp_session_dtor,
       pvt);
     return (&pvt->pub);
 
 e8:
-    free(pvt->from_tag_nmn.rw.s);
-e7:
     free(pvt->from_tag.rw.s);
 e6:
     free(pvt->call_id.rw.s);
 e5:
     RTPP_OBJ_DECREF(pvt->acct);
 e4:
-    RTPP_OBJ_DECREF(pub->rtcp);
+    rtpp_pipe_dtor_pa(pub->rtcp);
 e3:
-    RTPP_OBJ_DECREF(pub->rtp);
+    rtpp_pipe_dtor_pa(pub->rtp);
 e2:
     RTPP_OBJ_DECREF(log);
 e1:
     RTPP_OBJ_DECREF(pub);
-    free(pvt);
+    RC_DECREF(blk->rcnt);
 e0:
     return (NULL);
 }
@@ -228,20 +307,26 @@ rtpp_session_dtor(struct rtpp_session_priv *pvt)
 
     CALL_SMETHOD(pub->rtp, get_stats, &pvt->acct->rtp);
     CALL_SMETHOD(pub->rtcp, get_stats, &pvt->acct->rtcp);
-    if (pub->complete != 0) {
+    if (pub->complete != 0 && pub->handed_off == 0) {
         CALL_SMETHOD(pub->rtp, upd_cntrs, &pvt->acct->rtp);
         CALL_SMETHOD(pub->rtcp, upd_cntrs, &pvt->acct->rtcp);
     }
-    RTPP_LOG(pub->log, RTPP_LOG_INFO, "session on ports %d/%d is cleaned up",
-      pub->rtp->stream[0]->port, pub->rtp->stream[1]->port);
+    RTPP_LOG(pub->log, RTPP_LOG_INFO, "session on ports %d/%d is %s",
+      pub->rtp->stream[0]->port, pub->rtp->stream[1]->port,
+      pub->handed_off ? "handed over" : "cleaned up");
     for (i = 0; i < 2; i++) {
         CALL_SMETHOD(pvt->sessinfo, remove, pub, i);
     }
     RTPP_OBJ_DECREF(pvt->sessinfo);
-    CALL_SMETHOD(pub->rtpp_stats, updatebyname, "nsess_destroyed", 1);
-    CALL_SMETHOD(pub->rtpp_stats, updatebyname_d, "total_duration",
-      session_time);
-    if (pvt->module_cf != NULL) {
+    if (pub->handed_off == 0) {
+        CALL_SMETHOD(pub->rtpp_stats, updatebyname, "nsess_destroyed", 1);
+        CALL_SMETHOD(pub->rtpp_stats, updatebyname_d, "total_duration",
+          session_time);
+    }
+    /* The successor is going to account for it */
+    if (pvt->module_cf != NULL && pub->handed_off != 0) {
+        RTPP_OBJ_DECREF(pvt->module_cf);
+    } else if (pvt->module_cf != NULL) {
         pvt->acct->call_id = pvt->call_id.rw.s;
         pvt->call_id.rw.s = NULL;
         pvt->acct->from_tag = pvt->from_tag.rw.s;
@@ -267,12 +352,11 @@ rtpp_session_dtor(struct rtpp_session_priv *pvt)
         free(pvt->call_id.rw.s);
     if (pvt->from_tag.rw.s != NULL)
         free(pvt->from_tag.rw.s);
-    if (pvt->from_tag_nmn.rw.s != NULL)
-        free(pvt->from_tag_nmn.rw.s);
 
-    RTPP_OBJ_DECREF(pvt->pub.rtcp);
-    RTPP_OBJ_DECREF(pvt->pub.rtp);
-    free(pvt);
+    rtpp_pipe_dtor_pa(pvt->pub.rtcp);
+    rtpp_pipe_dtor_pa(pvt->pub.rtp);
+    /* May release the storage we are in, must be the last thing */
+    RC_DECREF(pvt->blk->rcnt);
 }
 
 int
@@ -50,6 +50,10 @@ struct rtpp_session {
     struct rtpp_timeout_data *timeout_data;
     /* UID */
     uint64_t seuid;
+    /* Media plane partition owning the session, see rtpp_session_shard() */
+    int shard;
+    /* Taken over by the warm restart successor, no accounting on destroy */
+    int handed_off;
 
     struct rtpp_stats *rtpp_stats;
 
@@ -63,6 +67,7 @@ int compare_session_tags(const rtpp_str_t *, const rtpp_str_t *, unsigned *);
 int find_stream(const struct rtpp_cfg *, const rtpp_str_t *, const rtpp_str_t *,
   const rtpp_str_t *, struct rtpp_session **);
 
+int rtpp_session_shard(const struct rtpp_cfg *, const rtpp_str_t *);
 struct rtpp_session *rtpp_session_ctor(const struct rtpp_cfg *,
   struct common_cmd_args *, const struct rtpp_timestamp *,
   const struct sockaddr **, int, int, struct rtpp_socket **);
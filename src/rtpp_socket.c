@@ -139,6 +139,37 @@ e0:
     return (NULL);
 }
 
+/*
+ * Wrap an already bound descriptor, e.g. one received from another process.
+ * On success the socket takes over the descriptor, on failure the caller
+ * still owns it.
+ */
+struct rtpp_socket *
+rtpp_socket_ctor_fd(struct rtpp_anetio_cf *netio, int fd)
+{
+    struct rtpp_socket_priv *pvt;
+    socklen_t tlen;
+
+    pvt = rtpp_rzmalloc(sizeof(struct rtpp_socket_priv), PVT_RCOFFS(pvt));
+    if (pvt == NULL) {
+        goto e0;
+    }
+    tlen = sizeof(pvt->type);
+    if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &pvt->type, &tlen) != 0) {
+        goto e1;
+    }
+    pvt->fd = fd;
+    pvt->netio = netio;
+    pvt->rtp_recv = &rtpp_socket_rtp_recv_simple;
+    PUBINST_FININIT(&pvt->pub, pvt, rtpp_socket_dtor);
+    return (&pvt->pub);
+e1:
+    RTPP_OBJ_DECREF(&(pvt->pub));
+    free(pvt);
+e0:
+    return (NULL);
+}
+
 static void
 rtpp_socket_dtor(struct rtpp_socket_priv *pvt)
 {
@@ -233,8 +264,7 @@ rtpp_socket_send_pkt_na(struct rtpp_socket *self, struct sthread_args *str,
     struct rtpp_socket_priv *pvt;
 
     PUB2PVT(self, pvt);
-    if (str == NULL)
-        str = rtpp_anetio_pick_sender(pvt->netio);
+    RTPP_DBG_ASSERT(str != NULL);
     return (rtpp_anetio_send_pkt_na(str, pvt->fd, daddr, pkt,
       self->rcnt, log));
 }
@@ -38,6 +38,7 @@ struct rtpp_timestamp;
 struct rtpp_anetio_cf;
 
 DECLARE_CLASS(rtpp_socket, struct rtpp_anetio_cf *, int, int);
+struct rtpp_socket *rtpp_socket_ctor_fd(struct rtpp_anetio_cf *, int);
 
 DEFINE_METHOD(rtpp_socket, rtpp_socket_bind, int, const struct sockaddr *,
   int);
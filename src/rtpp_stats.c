@@ -44,12 +44,14 @@
 #include "rtpp_time.h"
 #include "rtpp_mallocs.h"
 #include "rtpp_command_reply.h"
+#include "rtpp_lhist.h"
 
 struct rtpp_stat_derived;
 
 enum rtpp_cnt_type {
     RTPP_CNT_U64,
-    RTPP_CNT_DBL
+    RTPP_CNT_DBL,
+    RTPP_CNT_HIST
 };
 
 struct rtpp_stat_descr
@@ -63,6 +65,7 @@ struct rtpp_stat_descr
 union rtpp_stat_cnt {
     _Atomic(uint64_t) u64;
     double d;
+    struct rtpp_lhist *h;
 };
 
 struct rtpp_stat
@@ -110,6 +113,16 @@ static struct rtpp_stat_descr default_stats[] = {
     {.name = "rtpa_nlost",           .descr = "Total number of lost RTP packets based on SEQ tracking", .type = RTPP_CNT_U64},
     {.name = "rtpa_perrs",           .descr = "Total number of RTP packets that failed RTP parse routine in SEQ tracking", .type = RTPP_CNT_U64},
     {.name = "pps_in",               .descr = "Rate at which RTP/RTPC packets are received (packets per second)", .type = RTPP_CNT_DBL, .derive_from = "npkts_rcvd"},
+    {.name = "lat_rtp_rx",           .descr = "Latency from RTP worker wakeup to the packet being received (us)", .type = RTPP_CNT_HIST},
+    {.name = "lat_rtp_pproc",        .descr = "Time spent by RTP packets in the processing chain (us)", .type = RTPP_CNT_HIST},
+    {.name = "lat_rtcp_rx",          .descr = "Latency from RTCP worker wakeup to the packet being received (us)", .type = RTPP_CNT_HIST},
+    {.name = "lat_rtcp_pproc",       .descr = "Time spent by RTCP packets in the processing chain (us)", .type = RTPP_CNT_HIST},
+    {.name = "lat_netio_qwait",      .descr = "Time spent by outgoing packets in the RTPP->NET queue (us)", .type = RTPP_CNT_HIST},
+    {.name = "lat_netio_send",       .descr = "Time taken by the sendto(2) of outgoing packets (us)", .type = RTPP_CNT_HIST},
+    {.name = "lat_total",            .descr = "Latency from packet arrival to sendto(2) return (us)", .type = RTPP_CNT_HIST},
+    {.name = "npkts_pool_alloc",     .descr = "Total number of packet buffers allocated from the pre-allocated pool", .type = RTPP_CNT_U64},
+    {.name = "npkts_pool_miss",      .descr = "Total number of packet buffers allocated from the heap due to the pool being exhausted", .type = RTPP_CNT_U64},
+    {.name = "pkt_pool_util",        .descr = "Fraction of the pre-allocated packet pool currently in use", .type = RTPP_CNT_DBL},
     {.name = NULL}
 };
 
@@ -133,6 +146,7 @@ static int rtpp_stats_getidxbyname(struct rtpp_stats *, const char *);
 static int rtpp_stats_updatebyidx(struct rtpp_stats *, int, uint64_t);
 static int rtpp_stats_updatebyname(struct rtpp_stats *, const char *, uint64_t);
 static int rtpp_stats_updatebyname_d(struct rtpp_stats *, const char *, double);
+static int rtpp_stats_updatehist(struct rtpp_stats *, int, const struct rtpp_lhist *);
 static int64_t rtpp_stats_getlvalbyname(struct rtpp_stats *, const char *);
 static int rtpp_stats_nstr(struct rtpp_stats *, const char *, struct rtpc_reply *);
 static int rtpp_stats_getnstats(struct rtpp_stats *);
@@ -143,6 +157,7 @@ DEFINE_SMETHODS(rtpp_stats,
     .updatebyidx = &rtpp_stats_updatebyidx,
     .updatebyname = &rtpp_stats_updatebyname,
     .updatebyname_d = &rtpp_stats_updatebyname_d,
+    .updatehist = &rtpp_stats_updatehist,
     .getlvalbyname = &rtpp_stats_getlvalbyname,
     .getnstats = &rtpp_stats_getnstats,
     .nstr = &rtpp_stats_nstr,
@@ -219,23 +234,30 @@ rtpp_stats_ctor(void)
         st = &pvt->stats[pvt->nstats];
         st->descr = &default_stats[i];
         if (pthread_mutex_init(&st->mutex, NULL) != 0) {
-            while ((pvt->nstats - 1) >= 0) {
-                st = &pvt->stats[pvt->nstats - 1];
-                pthread_mutex_destroy(&st->mutex);
-                pvt->nstats -= 1;
-            }
-            goto e2;
+            goto e3;
         }
-        if (default_stats[i].type == RTPP_CNT_U64) {
+        switch (default_stats[i].type) {
+        case RTPP_CNT_U64:
             atomic_init(&st->cnt.u64, 0);
-        } else {
+            break;
+
+        case RTPP_CNT_DBL:
             st->cnt.d = 0.0;
+            break;
+
+        case RTPP_CNT_HIST:
+            st->cnt.h = rtpp_zmalloc(sizeof(*st->cnt.h));
+            if (st->cnt.h == NULL) {
+                pthread_mutex_destroy(&st->mutex);
+                goto e3;
+            }
+            break;
         }
         pvt->nstats += 1;
     }
     pvt->rppp = rtpp_pearson_perfect_ctor(getdstat, pvt);
     if (pvt->rppp == NULL) {
-        goto e2;
+        goto e3;
     }
     pub->pvt = pvt;
     for (i = 0; default_stats[i].name != NULL; i++) {
@@ -251,6 +273,14 @@ rtpp_stats_ctor(void)
     }
     PUBINST_FININIT(pub, fp, rtpp_stats_dtor);
     return (pub);
+e3:
+    while ((pvt->nstats - 1) >= 0) {
+        st = &pvt->stats[pvt->nstats - 1];
+        pthread_mutex_destroy(&st->mutex);
+        if (st->descr->type == RTPP_CNT_HIST)
+            free(st->cnt.h);
+        pvt->nstats -= 1;
+    }
 e2:
     if (pvt->dstats != NULL)
         free(pvt->dstats);
@@ -317,6 +347,24 @@ rtpp_stats_updatebyname_d(struct rtpp_stats *self, const char *name, double incr
     return rtpp_stats_updatebyidx_internal(self, idx, RTPP_CNT_DBL, &incr);
 }
 
+static int
+rtpp_stats_updatehist(struct rtpp_stats *self, int idx, const struct rtpp_lhist *hp)
+{
+    struct rtpp_stats_priv *pvt;
+    struct rtpp_stat *st;
+
+    pvt = self->pvt;
+    if (idx < 0 || idx >= pvt->nstats)
+        return (-1);
+    st = &pvt->stats[idx];
+    if (st->descr->type != RTPP_CNT_HIST)
+        return (-1);
+    pthread_mutex_lock(&st->mutex);
+    rtpp_lhist_merge(st->cnt.h, hp);
+    pthread_mutex_unlock(&st->mutex);
+    return (0);
+}
+
 static int64_t
 rtpp_stats_getlvalbyname(struct rtpp_stats *self, const char *name)
 {
@@ -331,6 +379,12 @@ rtpp_stats_getlvalbyname(struct rtpp_stats *self, const char *name)
     }
     pvt = self->pvt;
     st = &pvt->stats[idx];
+    if (st->descr->type == RTPP_CNT_HIST) {
+        pthread_mutex_lock(&st->mutex);
+        rval = st->cnt.h->cnt;
+        pthread_mutex_unlock(&st->mutex);
+        return (rval);
+    }
     rval = atomic_load_explicit(&st->cnt.u64, memory_order_relaxed);
     return (rval);
 }
@@ -350,14 +404,29 @@ rtpp_stats_nstr(struct rtpp_stats *self, const char *name, struct rtpc_reply *rr
     }
     pvt = self->pvt;
     st = &pvt->stats[idx];
-    if (pvt->stats[idx].descr->type == RTPP_CNT_U64) {
+    switch (pvt->stats[idx].descr->type) {
+    case RTPP_CNT_U64:
         uval = atomic_load_explicit(&st->cnt.u64, memory_order_relaxed);
         rval = CALL_SMETHOD(rrp, appendf, "%" PRIu64, uval);
-    } else {
+        break;
+
+    case RTPP_CNT_DBL:
         pthread_mutex_lock(&st->mutex);
         dval = st->cnt.d;
         pthread_mutex_unlock(&st->mutex);
         rval = CALL_SMETHOD(rrp, appendf, "%f", dval);
+        break;
+
+    case RTPP_CNT_HIST:
+    default:
+        /* count,p50,p90,p99,max */
+        pthread_mutex_lock(&st->mutex);
+        rval = CALL_SMETHOD(rrp, appendf, "%" PRIu64 ",%" PRIu64 ",%" PRIu64
+          ",%" PRIu64 ",%" PRIu64, st->cnt.h->cnt,
+          rtpp_lhist_pctl(st->cnt.h, 0.50), rtpp_lhist_pctl(st->cnt.h, 0.90),
+          rtpp_lhist_pctl(st->cnt.h, 0.99), st->cnt.h->max);
+        pthread_mutex_unlock(&st->mutex);
+        break;
     }
     return (rval);
 }
@@ -373,6 +442,8 @@ rtpp_stats_dtor(struct rtpp_stats_full *fp)
     for (i = 0; i < pvt->nstats; i++) {
         st = &pvt->stats[i];
         pthread_mutex_destroy(&st->mutex);
+        if (st->descr->type == RTPP_CNT_HIST)
+            free(st->cnt.h);
     }
     RTPP_OBJ_DECREF(pvt->rppp);
     if (pvt->dstats != NULL) {
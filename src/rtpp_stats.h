@@ -28,6 +28,7 @@
 #pragma once
 
 struct rtpc_reply;
+struct rtpp_lhist;
 
 #if !defined(DECLARE_CLASS)
 #error "rtpp_types.h" needs to be included
@@ -39,6 +40,7 @@ DECLARE_METHOD(rtpp_stats, rtpp_stats_getidxbyname, int, const char *);
 DECLARE_METHOD(rtpp_stats, rtpp_stats_updatebyidx, int, int, uint64_t);
 DECLARE_METHOD(rtpp_stats, rtpp_stats_updatebyname, int, const char *, uint64_t);
 DECLARE_METHOD(rtpp_stats, rtpp_stats_updatebyname_d, int, const char *, double);
+DECLARE_METHOD(rtpp_stats, rtpp_stats_updatehist, int, int, const struct rtpp_lhist *);
 DECLARE_METHOD(rtpp_stats, rtpp_stats_getlvalbyname, int64_t, const char *);
 DECLARE_METHOD(rtpp_stats, rtpp_stats_nstr, int, const char *, struct rtpc_reply *);
 DECLARE_METHOD(rtpp_stats, rtpp_stats_getnstats, int);
@@ -49,6 +51,7 @@ DECLARE_SMETHODS(rtpp_stats) {
     METHOD_ENTRY(rtpp_stats_updatebyidx, updatebyidx);
     METHOD_ENTRY(rtpp_stats_updatebyname, updatebyname);
     METHOD_ENTRY(rtpp_stats_updatebyname_d, updatebyname_d);
+    METHOD_ENTRY(rtpp_stats_updatehist, updatehist);
     METHOD_ENTRY(rtpp_stats_getlvalbyname, getlvalbyname);
     METHOD_ENTRY(rtpp_stats_getnstats, getnstats);
     METHOD_ENTRY(rtpp_stats_nstr, nstr);
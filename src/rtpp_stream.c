@@ -63,6 +63,7 @@
 #include "rtpp_network.h"
 #include "rtpp_pcount.h"
 #include "rtpp_pcnt_strm.h"
+#include "rtpp_lhist.h"
 #include "rtpp_proc.h"
 #include "rtpp_record.h"
 #include "rtpp_stats.h"
@@ -81,6 +82,8 @@
 #include "advanced/pproc_manager.h"
 #include "advanced/packet_processor.h"
 #include "rtpp_command_stats.h"
+#include "rtpp_wrestart.h"
+#include "rtpp_repl.h"
 
 #define  SEQ_SYNC_IVAL   1.0    /* in seconds */
 
@@ -120,6 +123,12 @@ struct rtpp_stream_priv
     /* Remote source address */
     struct rtpp_netaddr *rem_addr;
     int npkts_resizer_in_idx;
+    /* Told about the latching state changes, NULL if not replicating */
+    struct rtpp_repl *repl;
+    /* Sender thread of our shard, for packets that don't come with one */
+    struct sthread_args *sender;
+    /* Holds the storage when placed into the session block, NULL otherwise */
+    struct rtpp_refcnt *owner;
     /* Placeholder for per-module structures */
     struct pmod_data pmod_data;
 };
@@ -164,6 +173,10 @@ void rtpp_stream_get_stats(struct rtpp_stream *, struct rtpp_acct_hold *);
 static struct rtp_packet *rtpp_stream_rx(struct rtpp_stream *,
   struct rtpp_weakref *, const struct rtpp_timestamp *, struct rtpp_proc_rstats *);
 static struct rtpp_netaddr *rtpp_stream_get_rem_addr(struct rtpp_stream *, int);
+static void rtpp_stream_save_state(struct rtpp_stream *,
+  struct rtpp_stream_snap *);
+static void rtpp_stream_restore_state(struct rtpp_stream *,
+  const struct rtpp_stream_snap *);
 static struct rtpp_stream *rtpp_stream_get_sender(struct rtpp_stream *,
   const struct rtpp_cfg *cfsp);
 
@@ -191,6 +204,8 @@ DEFINE_SMETHODS(rtpp_stream,
     .latch_setmode = &rtpp_stream_latch_setmode,
     .latch_getmode = &rtpp_stream_latch_getmode,
     .get_sender = &rtpp_stream_get_sender,
+    .save_state = &rtpp_stream_save_state,
+    .restore_state = &rtpp_stream_restore_state,
 );
 
 static struct pproc_act
@@ -238,18 +253,69 @@ resizer_injest(const struct pkt_proc_ctx *pktxp)
     return ((packet == NULL) ? PPROC_ACT_TAKE : PPROC_ACT_NOP);
 }
 
-struct rtpp_stream *
-rtpp_stream_ctor(const struct r_stream_ctor_args *ap)
+struct rtpp_stream_layout {
+    size_t pcnt_strm;
+    size_t raddr_prev;
+    size_t analyzer;
+    size_t len;
+};
+
+static void
+rtpp_stream_layout(const struct r_stream_ctor_args *ap,
+  struct rtpp_stream_layout *lp)
 {
-    struct rtpp_stream_priv *pvt;
     size_t alen;
 
     alen = offsetof(struct rtpp_stream_priv, pmod_data.adp) + 
-      (ap->nmodules * sizeof(pvt->pmod_data.adp[0]));
-    pvt = rtpp_rzmalloc(alen, PVT_RCOFFS(pvt));
-    if (pvt == NULL) {
-        goto e0;
+      (ap->nmodules * sizeof(((struct rtpp_stream_priv *)0)->pmod_data.adp[0]));
+    /*
+     * Objects that never outlive the stream are placed right after it in
+     * the same allocation and share its refcount.
+     */
+    lp->pcnt_strm = RTPP_MALIGN(alen);
+    lp->raddr_prev = lp->pcnt_strm + RTPP_MALIGN(rtpp_pcnt_strm_osize);
+    lp->analyzer = lp->raddr_prev + RTPP_MALIGN(rtpp_netaddr_osize);
+    lp->len = lp->analyzer;
+    if (ap->pipe_type == PIPE_RTP)
+        lp->len += rtpp_analyzer_osize;
+}
+
+size_t
+rtpp_stream_osize(const struct r_stream_ctor_args *ap)
+{
+    struct rtpp_stream_layout lay;
+
+    rtpp_stream_layout(ap, &lay);
+    return (rtpp_rsize(lay.len));
+}
+
+struct rtpp_stream *
+rtpp_stream_ctor(const struct r_stream_ctor_args *ap)
+{
+    void *pap;
+    struct rtpp_stream *pub;
+
+    RTPP_DBG_ASSERT(ap->owner == NULL);
+    pap = malloc(rtpp_stream_osize(ap));
+    if (pap == NULL) {
+        return (NULL);
+    }
+    pub = rtpp_stream_ctor_pa(pap, ap);
+    if (pub == NULL) {
+        free(pap);
+        return (NULL);
     }
+    return (pub);
+}
+
+struct rtpp_stream *
+rtpp_stream_ctor_pa(void *pap, const struct r_stream_ctor_args *ap)
+{
+    struct rtpp_stream_priv *pvt;
+    struct rtpp_stream_layout eoff;
+
+    rtpp_stream_layout(ap, &eoff);
+    pvt = rtpp_rzinit(pap, eoff.len, PVT_RCOFFS(pvt));
     if (pthread_mutex_init(&pvt->lock, NULL) != 0) {
         goto e1;
     }
@@ -258,7 +324,8 @@ rtpp_stream_ctor(const struct r_stream_ctor_args *ap)
         goto e2;
     }
     if (ap->pipe_type == PIPE_RTP) {
-        pvt->pub.analyzer = rtpp_analyzer_ctor(ap->log);
+        pvt->pub.analyzer = rtpp_analyzer_ctor_pa((char *)pvt + eoff.analyzer,
+          pvt->pub.rcnt, ap->log);
         if (pvt->pub.analyzer == NULL) {
             goto e3;
         }
@@ -267,7 +334,8 @@ rtpp_stream_ctor(const struct r_stream_ctor_args *ap)
             .descr = "resize_packet",
             .arg = (void *)pvt,
             .key = (void *)(pvt + 1),
-            .enqueue = &resizer_injest
+            .enqueue = &resizer_injest,
+            .flags = PPROC_IF_FLAG_STOCK
         };
         if (CALL_SMETHOD(pvt->pub.pproc_manager, reg, PPROC_ORD_RESIZE, &resize_packet_poi) < 0)
             goto e4;
@@ -283,15 +351,18 @@ rtpp_stream_ctor(const struct r_stream_ctor_args *ap)
         .arg = (void *)pvt->pub.analyzer,
         .key = (void *)pvt,
         .enqueue = (ap->pipe_type == PIPE_RTP) ? &analyze_rtp_packet : &analyze_rtcp_packet,
+        .flags = PPROC_IF_FLAG_STOCK
     };
     if (CALL_SMETHOD(pvt->pub.pproc_manager, reg, PPROC_ORD_ANALYZE, &analyze_packet_poi) < 0)
         goto e5;
 
-    pvt->pub.pcnt_strm = rtpp_pcnt_strm_ctor();
+    pvt->pub.pcnt_strm = rtpp_pcnt_strm_ctor_pa((char *)pvt + eoff.pcnt_strm,
+      pvt->pub.rcnt);
     if (pvt->pub.pcnt_strm == NULL) {
         goto e6;
     }
-    pvt->raddr_prev = rtpp_netaddr_ctor();
+    pvt->raddr_prev = rtpp_netaddr_ctor_pa((char *)pvt + eoff.raddr_prev,
+      pvt->pub.rcnt);
     if (pvt->raddr_prev == NULL) {
         goto e7;
     }
@@ -306,9 +377,16 @@ rtpp_stream_ctor(const struct r_stream_ctor_args *ap)
     RTPP_OBJ_INCREF(ap->log);
     pvt->pub.side = ap->side;
     pvt->pub.pipe_type = ap->pipe_type;
+    pvt->pub.shard = ap->shard;
+    pvt->sender = ap->sender;
 
     rtpp_gen_uid(&pvt->pub.stuid);
     pvt->pub.seuid = ap->seuid;
+    pvt->repl = ap->repl;
+    if (ap->owner != NULL) {
+        pvt->owner = ap->owner;
+        RC_INCREF(ap->owner);
+    }
     for (unsigned int i = 0; i < ap->nmodules; i++) {
         atomic_init(&(pvt->pmod_data.adp[i]), NULL);
     }
@@ -318,9 +396,9 @@ rtpp_stream_ctor(const struct r_stream_ctor_args *ap)
     return (&pvt->pub);
 
 e8:
-    RTPP_OBJ_DECREF(pvt->raddr_prev);
+    rtpp_netaddr_dtor_pa(pvt->raddr_prev);
 e7:
-    RTPP_OBJ_DECREF(pvt->pub.pcnt_strm);
+    rtpp_pcnt_strm_dtor_pa(pvt->pub.pcnt_strm);
 e6:
     CALL_SMETHOD(pvt->pub.pproc_manager, unreg, pvt);
 e5:
@@ -329,7 +407,7 @@ e5:
     }
 e4:
     if (ap->pipe_type == PIPE_RTP) {
-        RTPP_OBJ_DECREF(pvt->pub.analyzer);
+        rtpp_analyzer_dtor_pa(pvt->pub.analyzer);
     }
 e3:
     RTPP_OBJ_DECREF(pvt->pub.pproc_manager);
@@ -337,8 +415,6 @@ e2:
     pthread_mutex_destroy(&pvt->lock);
 e1:
     RTPP_OBJ_DECREF(&(pvt->pub));
-    free(pvt);
-e0:
     return (NULL);
 }
 
@@ -409,7 +485,7 @@ rtpp_stream_dtor(struct rtpp_stream_priv *pvt)
          if (rst.pecount > 0) {
              CALL_SMETHOD(pvt->rtpp_stats, updatebyname, "rtpa_perrs", rst.pecount);
          }
-         RTPP_OBJ_DECREF(pvt->pub.analyzer);
+         rtpp_analyzer_dtor_pa(pvt->pub.analyzer);
     }
     if (pvt->fd != NULL)
         RTPP_OBJ_DECREF(pvt->fd);
@@ -432,10 +508,10 @@ rtpp_stream_dtor(struct rtpp_stream_priv *pvt)
     }
     if (pub->ttl != NULL)
         RTPP_OBJ_DECREF(pub->ttl);
-    RTPP_OBJ_DECREF(pub->pcnt_strm);
+    rtpp_pcnt_strm_dtor_pa(pub->pcnt_strm);
     RTPP_OBJ_DECREF(pvt->pub.log);
     RTPP_OBJ_DECREF(pvt->rem_addr);
-    RTPP_OBJ_DECREF(pvt->raddr_prev);
+    rtpp_netaddr_dtor_pa(pvt->raddr_prev);
     RTPP_OBJ_DECREF(pvt->proc_servers);
     if (pvt->pub.pipe_type == PIPE_RTP) {
         CALL_SMETHOD(pvt->pub.pproc_manager, unreg, pvt + 1);
@@ -444,7 +520,12 @@ rtpp_stream_dtor(struct rtpp_stream_priv *pvt)
     RTPP_OBJ_DECREF(pvt->pub.pproc_manager);
 
     pthread_mutex_destroy(&pvt->lock);
-    free(pvt);
+    if (pvt->owner != NULL) {
+        /* May release the storage we are in, must be the last thing */
+        RC_DECREF(pvt->owner);
+    } else {
+        free(pvt);
+    }
 }
 
 static void
@@ -618,6 +699,15 @@ rtpp_stream_get_proto(struct rtpp_stream *self)
     return (PP_NAME(self->pipe_type));
 }
 
+/* Queue the session for replication, remote address or latch has changed */
+static inline void
+_rtpp_stream_notechg(struct rtpp_stream_priv *pvt)
+{
+
+    if (pvt->repl != NULL)
+        CALL_METHOD(pvt->repl, note, pvt->pub.seuid);
+}
+
 static int
 _rtpp_stream_latch(struct rtpp_stream_priv *pvt, double dtime,
   struct rtp_packet *packet)
@@ -673,6 +763,7 @@ _rtpp_stream_latch(struct rtpp_stream_priv *pvt, double dtime,
       saddr, ptype, ssrc, seq);
 #endif
     pvt->latch_info.latched = newlatch;
+    _rtpp_stream_notechg(pvt);
     return (1);
 }
 
@@ -711,6 +802,17 @@ rtpp_stream_latch_getmode(struct rtpp_stream *self)
     return (mode);
 }
 
+static int
+_rtpp_stream_latch_sync_due(struct rtpp_stream_priv *pvt, double dtime)
+{
+    const struct rtpps_latch *lip;
+
+    lip = &pvt->latch_info;
+    if (pvt->pub.pipe_type != PIPE_RTP || lip->ssrc.inited == 0)
+        return (0);
+    return (dtime - lip->last_sync >= SEQ_SYNC_IVAL);
+}
+
 static void
 _rtpp_stream_latch_sync(struct rtpp_stream_priv *pvt, double dtime,
   struct rtp_packet *packet)
@@ -718,9 +820,7 @@ _rtpp_stream_latch_sync(struct rtpp_stream_priv *pvt, double dtime,
     struct rtpps_latch *lip;
 
     lip = &pvt->latch_info;
-    if (pvt->pub.pipe_type != PIPE_RTP || lip->ssrc.inited == 0)
-        return;
-    if (dtime - lip->last_sync < SEQ_SYNC_IVAL)
+    if (!_rtpp_stream_latch_sync_due(pvt, dtime))
         return;
     if (rtp_packet_parse(packet) != RTP_PARSER_OK)
         return;
@@ -794,6 +894,7 @@ __rtpp_stream_fill_addr(struct rtpp_stream_priv *pvt, struct rtp_packet *packet)
     const char *wice = (pvt->latch_info.mode == RTPLM_FORCE_ON) ? " (with ICE)" : "";
     RTPP_LOG(pvt->pub.log, RTPP_LOG_INFO,
       "%s's address filled in%s: %s (%s)", actor, wice, saddr, ptype);
+    _rtpp_stream_notechg(pvt);
     return;
 }
 
@@ -836,6 +937,7 @@ rtpp_stream_guess_addr(struct rtpp_stream *self,
     pvt->latch_info.latched = self->asymmetric;
     RTPP_LOG(pvt->pub.log, RTPP_LOG_INFO, "guessing %s port "
       "for %s to be %d", ptype, actor, rport + 1);
+    _rtpp_stream_notechg(pvt);
 
     return (0);
 }
@@ -980,6 +1082,8 @@ rtpp_stream_send_pkt(struct rtpp_stream *self, struct sthread_args *sap,
     int rval;
 
     PUB2PVT(self, pvt);
+    if (sap == NULL)
+        sap = pvt->sender;
     pthread_mutex_lock(&pvt->lock);
     rval = CALL_SMETHOD(pvt->fd, send_pkt_na, sap, pvt->rem_addr, pkt,
       self->log);
@@ -995,6 +1099,8 @@ rtpp_stream_send_pkt_to(struct rtpp_stream *self, struct sthread_args *sap,
     int rval;
 
     PUB2PVT(self, pvt);
+    if (sap == NULL)
+        sap = pvt->sender;
     pthread_mutex_lock(&pvt->lock);
     rval = CALL_SMETHOD(pvt->fd, send_pkt_na, sap, rem_addr, pkt,
       self->log);
@@ -1103,6 +1209,21 @@ rtpp_stream_rx(struct rtpp_stream *self, struct rtpp_weakref *rtcps_wrt,
     if (pvt->latch_info.mode == RTPLM_FORCE_OFF)
         goto nolatch;
 
+    /*
+     * Common case: stream is latched, packet is coming from the address
+     * we already have and there is nothing to update in the latch state.
+     * The address is checked without holding any lock, we only come back
+     * for the full check below if it does not match.
+     */
+    if (self->asymmetric == 0 && _rtpp_stream_islatched(pvt) &&
+      !_rtpp_stream_latch_sync_due(pvt, dtime->mono)) {
+        pthread_mutex_unlock(&pvt->lock);
+        if (CALL_SMETHOD(pvt->rem_addr, cmp, sstosa(&packet->raddr),
+          packet->rlen) == 0)
+            return (packet);
+        pthread_mutex_lock(&pvt->lock);
+    }
+
     if (!CALL_SMETHOD(pvt->rem_addr, isempty)) {
         /* Check that the packet is authentic, drop if it isn't */
         if (self->asymmetric == 0) {
@@ -1182,3 +1303,53 @@ rtpp_stream_get_sender(struct rtpp_stream *self, const struct rtpp_cfg *cfsp)
     return (CALL_SMETHOD(cfsp->rtcp_streams_wrt, get_by_idx,
       self->stuid_sendr));
 }
+
+static void
+rtpp_stream_save_state(struct rtpp_stream *self, struct rtpp_stream_snap *ssp)
+{
+    struct rtpp_stream_priv *pvt;
+
+    PUB2PVT(self, pvt);
+    memset(ssp, '\0', sizeof(*ssp));
+    pthread_mutex_lock(&pvt->lock);
+    if (!CALL_SMETHOD(pvt->rem_addr, isempty)) {
+        ssp->rem_alen = CALL_SMETHOD(pvt->rem_addr, get,
+          sstosa(&ssp->rem_addr), sizeof(ssp->rem_addr));
+    }
+    ssp->asymmetric = self->asymmetric;
+    ssp->weak = self->weak;
+    ssp->ptime = self->ptime;
+    ssp->untrusted_addr = pvt->untrusted_addr;
+    ssp->latch_mode = pvt->latch_info.mode;
+    ssp->latched = pvt->latch_info.latched;
+    ssp->ssrc_inited = pvt->latch_info.ssrc.inited;
+    ssp->ssrc = pvt->latch_info.ssrc.val;
+    ssp->seq = pvt->latch_info.seq;
+    pthread_mutex_unlock(&pvt->lock);
+}
+
+static void
+rtpp_stream_restore_state(struct rtpp_stream *self,
+  const struct rtpp_stream_snap *ssp)
+{
+    struct rtpp_stream_priv *pvt;
+
+    PUB2PVT(self, pvt);
+    pthread_mutex_lock(&pvt->lock);
+    if (ssp->rem_alen > 0) {
+        CALL_SMETHOD(pvt->rem_addr, set, sstosa(&ssp->rem_addr),
+          ssp->rem_alen);
+    }
+    self->asymmetric = ssp->asymmetric;
+    self->weak = ssp->weak;
+    self->ptime = ssp->ptime;
+    pvt->untrusted_addr = ssp->untrusted_addr;
+    pvt->latch_info.mode = ssp->latch_mode;
+    pvt->latch_info.latched = ssp->latched;
+    pvt->latch_info.ssrc.inited = ssp->ssrc_inited;
+    pvt->latch_info.ssrc.val = ssp->ssrc;
+    pvt->latch_info.seq = ssp->seq;
+    /* Make the first packet re-sync the sequence number */
+    pvt->latch_info.last_sync = 0.0;
+    pthread_mutex_unlock(&pvt->lock);
+}
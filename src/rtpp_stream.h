@@ -43,6 +43,9 @@ struct rtpp_acct_hold;
 struct rtpp_proc_rstats;
 struct rtpp_timestamp;
 struct rtpp_cfg;
+struct rtpp_stream_snap;
+struct rtpp_repl;
+struct rtpp_refcnt;
 
 enum rtpp_stream_side { RTPP_SSIDE_CALLER = 1, RTPP_SSIDE_CALLEE = 0 };
 
@@ -61,10 +64,23 @@ struct r_stream_ctor_args {
     uint64_t seuid;
     unsigned int nmodules;
     struct pproc_manager *pproc_manager;
+    struct rtpp_repl *repl;
+    int shard;
+    struct sthread_args *sender;
+    /* Holds the storage passed to rtpp_stream_ctor_pa(), see rtpp_session.c */
+    struct rtpp_refcnt *owner;
 };
 
 DECLARE_CLASS(rtpp_stream, const struct r_stream_ctor_args *);
 
+/*
+ * Unlike other _ctor_pa() the stream keeps a refcount of its own and takes
+ * a reference to ap->owner, which it drops when destroyed.
+ */
+size_t rtpp_stream_osize(const struct r_stream_ctor_args *);
+struct rtpp_stream *rtpp_stream_ctor_pa(void *,
+  const struct r_stream_ctor_args *);
+
 DECLARE_METHOD(rtpp_stream, rtpp_stream_handle_play, int, const char *,
   const char *, int, struct rtpp_command *, int);
 DECLARE_METHOD(rtpp_stream, rtpp_stream_handle_noplay, void);
@@ -99,6 +115,10 @@ DECLARE_METHOD(rtpp_stream, rtpp_stream_latch_setmode, void, enum rtpps_latch_mo
 DECLARE_METHOD(rtpp_stream, rtpp_stream_latch_getmode, enum rtpps_latch_mode);
 DECLARE_METHOD(rtpp_stream, rtpp_stream_get_sender, struct rtpp_stream *,
   const struct rtpp_cfg *cfsp);
+DECLARE_METHOD(rtpp_stream, rtpp_stream_save_state, void,
+  struct rtpp_stream_snap *);
+DECLARE_METHOD(rtpp_stream, rtpp_stream_restore_state, void,
+  const struct rtpp_stream_snap *);
 
 DECLARE_SMETHODS(rtpp_stream) {
     METHOD_ENTRY(rtpp_stream_handle_play, handle_play);
@@ -124,6 +144,8 @@ DECLARE_SMETHODS(rtpp_stream) {
     METHOD_ENTRY(rtpp_stream_latch_setmode, latch_setmode);
     METHOD_ENTRY(rtpp_stream_latch_getmode, latch_getmode);
     METHOD_ENTRY(rtpp_stream_get_sender, get_sender);
+    METHOD_ENTRY(rtpp_stream_save_state, save_state);
+    METHOD_ENTRY(rtpp_stream_restore_state, restore_state);
 };
 
 struct pmod_data {
@@ -162,6 +184,8 @@ DECLARE_CLASS_PUBTYPE(rtpp_stream, {
     uint64_t stuid_rtp;
     /* Type of pipe we are associated with, read-only */
     int pipe_type;
+    /* Media shard of the session we belong to, read-only */
+    int shard;
     struct rtpp_log *log;
     /* Copy of the per-pipe counters */
     struct rtpp_pcount *pcount;
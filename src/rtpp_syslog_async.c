@@ -29,206 +29,839 @@
 #define _GNU_SOURCE /* pthread_setname_np() */
 #endif
 
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <errno.h>
 #include <pthread.h>
 #include <syslog.h>
+#include <time.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "config.h"
 
-#ifndef HAVE_STRLCPY
-#include "rtpp_types.h"
-#include "rtpp_util.h"
-#endif
-
 #include "rtpp_debug.h"
 #include "rtpp_syslog_async.h"
 
-#define SYSLOG_WI_POOL_SIZE     64
-#define SYSLOG_WI_DATA_LEN      2048
+/*
+ * Every thread that logs gets its own single-producer single-consumer
+ * byte ring, mapped with its first message and put on a lock-free list
+ * that the syslog thread walks. Producers do not format anything: the
+ * message is stored as a sequence of segments, each one being the format
+ * pointer followed by the arguments it consumes in their binary form,
+ * strings are copied inline so that the caller's buffers may go away.
+ * The syslog thread parses the formats again, renders the text and hands
+ * it over to syslog(3), taking the messages off the rings in the order
+ * they were recorded in. Nothing is ever waited for: when the ring is
+ * full the message is dropped and accounted, the consumer reports the
+ * number of dropped messages once it catches up. The consumer only parks
+ * on the condition variable when all rings are empty, so the producers
+ * have to touch the mutex only when the syslog thread is idle. Rings of
+ * the threads that have exited are unmapped once drained.
+ */
+#define SYSLOG_RING_LEN         (32 * 1024) /* per thread, must be power of 2 */
+#define SYSLOG_REC_MAXLEN       2048 /* largest encoded message */
+#define SYSLOG_MSG_MAXLEN       2048 /* longest rendered message */
+#define SYSLOG_IDLE_IVAL        1   /* seconds between idle hook calls */
 
-typedef enum {
-    SYSLOG_ITEM_ASYNC_WRITE,
-    SYSLOG_ITEM_ASYNC_EXIT
-} item_types;
+#define SYSLOG_ALIGN(len)       (((len) + 7) & ~(size_t)7)
 
-struct syslog_wi
-{
-    item_types item_type;
-    char data[SYSLOG_WI_DATA_LEN];
-    int len;
+struct syslog_rec {
+    uint32_t len;       /* whole record, 0 marks the skip to the ring start */
     int priority;
-    struct syslog_wi *next;
+    uint64_t ts;
+    unsigned char data[];
+};
+
+struct syslog_seg {
+    const char *fmt;
+    uint32_t len;       /* header and the arguments */
+};
+
+struct syslog_async_msg {
+    struct syslog_rec *rec;
+    size_t pad;
+    size_t len;
+};
+
+struct syslog_ring {
+    _Atomic(unsigned long) head;
+    _Atomic(unsigned long) tail;
+    _Atomic(int) orphaned;
+    struct syslog_ring *next;
+    struct syslog_async_msg msg;
+    unsigned char buf[SYSLOG_RING_LEN] __attribute__ ((aligned (8)));
+};
+
+enum syslog_lmod {LM_NONE, LM_HH, LM_H, LM_L, LM_LL, LM_J, LM_Z, LM_T, LM_LD};
+
+struct syslog_spec {
+    const char *flags;
+    int nflags;
+    int width;          /* -1 if not given */
+    int prec;           /* ditto */
+    enum syslog_lmod lmod;
+    char conv;
 };
 
-#define SYSLOG_WI_NOWAIT        0
-#define SYSLOG_WI_WAIT          1
+#define SYSLOG_SPEC_ARG         (-2) /* width or precision is '*' */
+#define SYSLOG_SPEC_MAX         9999
+
+struct syslog_obuf {
+    char *buf;
+    size_t len;
+    size_t pos;
+};
 
 static pthread_mutex_t syslog_init_mutex = PTHREAD_MUTEX_INITIALIZER;
 static int syslog_queue_inited = 0;
 static pthread_t syslog_queue;
 static pthread_cond_t syslog_queue_cond;
 static pthread_mutex_t syslog_queue_mutex;
-static pthread_cond_t syslog_wi_free_cond;
-static pthread_mutex_t syslog_wi_free_mutex;
+static pthread_key_t syslog_ring_key;
+static syslog_async_idle_hook_t syslog_idle_hook;
+static __thread struct syslog_ring *syslog_ring_self;
+
+static struct {
+    _Atomic(struct syslog_ring *) rings;
+    _Atomic(int) sleeping;
+    _Atomic(int) exiting;
+    _Atomic(int) exited;
+    _Atomic(unsigned long) dropped;
+    _Atomic(unsigned long) drain_req;
+    _Atomic(unsigned long) drain_ack;
+} syslog_ctl;
 
-static int syslog_dropped_items;
+static int
+syslog_spec_num(const char **cpp)
+{
+    const char *cp;
+    int n;
 
-static struct syslog_wi syslog_wi_pool[SYSLOG_WI_POOL_SIZE];
-static struct syslog_wi *syslog_wi_free;
-static struct syslog_wi *syslog_wi_queue, *syslog_wi_queue_tail;
+    cp = *cpp;
+    if (*cp == '*') {
+        *cpp = cp + 1;
+        return (SYSLOG_SPEC_ARG);
+    }
+    if (*cp < '0' || *cp > '9')
+        return (-1);
+    for (n = 0; *cp >= '0' && *cp <= '9'; cp++) {
+        if (n <= SYSLOG_SPEC_MAX)
+            n = n * 10 + (*cp - '0');
+    }
+    *cpp = cp;
+    return (n > SYSLOG_SPEC_MAX ? SYSLOG_SPEC_MAX : n);
+}
 
-static void
-syslog_queue_run(void)
+/*
+ * Parses the conversion specification following the '%' and returns the
+ * pointer past it, or NULL for anything that cannot be replayed later
+ * (positional arguments, wide characters and strings), such formats are
+ * rendered by the producer instead.
+ */
+static const char *
+syslog_spec_parse(const char *cp, struct syslog_spec *sp)
 {
-    struct syslog_wi *wi;
 
-    for (;;) {
-        pthread_mutex_lock(&syslog_queue_mutex);
-        while (syslog_wi_queue == NULL) {
-            pthread_cond_wait(&syslog_queue_cond, &syslog_queue_mutex);
+    sp->flags = cp;
+    for (;; cp++) {
+        switch (*cp) {
+        case '-': case '+': case ' ': case '#': case '0': case '\'':
+            continue;
         }
-        wi = syslog_wi_queue;
-        syslog_wi_queue = wi->next;
-        pthread_mutex_unlock(&syslog_queue_mutex);
+        break;
+    }
+    sp->nflags = cp - sp->flags;
+    if (sp->nflags > 8)
+        return (NULL);
+    sp->width = syslog_spec_num(&cp);
+    if (*cp == '$')
+        return (NULL);
+    sp->prec = -1;
+    if (*cp == '.') {
+        cp++;
+        sp->prec = syslog_spec_num(&cp);
+        if (sp->prec == -1)
+            sp->prec = 0;
+    }
+    switch (*cp) {
+    case 'h':
+        cp++;
+        sp->lmod = LM_H;
+        if (*cp == 'h') {
+            cp++;
+            sp->lmod = LM_HH;
+        }
+        break;
+
+    case 'l':
+        cp++;
+        sp->lmod = LM_L;
+        if (*cp == 'l') {
+            cp++;
+            sp->lmod = LM_LL;
+        }
+        break;
+
+    case 'q':
+        cp++;
+        sp->lmod = LM_LL;
+        break;
+
+    case 'j':
+        cp++;
+        sp->lmod = LM_J;
+        break;
+
+    case 'z':
+        cp++;
+        sp->lmod = LM_Z;
+        break;
+
+    case 't':
+        cp++;
+        sp->lmod = LM_T;
+        break;
+
+    case 'L':
+        cp++;
+        sp->lmod = LM_LD;
+        break;
+
+    default:
+        sp->lmod = LM_NONE;
+        break;
+    }
+    sp->conv = *cp;
+    switch (sp->conv) {
+    case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+        if (sp->lmod == LM_LD)
+            return (NULL);
+        break;
+
+    case 'e': case 'E': case 'f': case 'F':
+    case 'g': case 'G': case 'a': case 'A':
+        if (sp->lmod != LM_NONE && sp->lmod != LM_L && sp->lmod != LM_LD)
+            return (NULL);
+        break;
+
+    case 'c': case 's': case 'p': case 'm': case '%':
+        if (sp->lmod != LM_NONE)
+            return (NULL);
+        break;
+
+    case 'n':
+        break;
+
+    default:
+        return (NULL);
+    }
+    return (cp + 1);
+}
 
-        /* main work here */
-        switch (wi->item_type) {
-            case SYSLOG_ITEM_ASYNC_WRITE:
-                syslog(wi->priority, "%s", wi->data);
+static int
+syslog_enc_put(struct syslog_async_msg *msg, const void *vp, size_t len)
+{
+
+    if (SYSLOG_REC_MAXLEN - msg->len < SYSLOG_ALIGN(len))
+        return (-1);
+    memcpy((unsigned char *)msg->rec + msg->len, vp, len);
+    msg->len += SYSLOG_ALIGN(len);
+    return (0);
+}
+
+static int
+syslog_enc_str(struct syslog_async_msg *msg, const char *s, int prec)
+{
+    unsigned char *dp;
+    size_t room;
+    uint32_t l;
+
+    room = SYSLOG_REC_MAXLEN - msg->len;
+    if (room < SYSLOG_ALIGN(sizeof(l) + 1))
+        return (-1);
+    if (s == NULL)
+        s = "(null)";
+    room -= sizeof(l) + 1;
+    if (prec >= 0 && (size_t)prec < room)
+        room = prec;
+    l = strnlen(s, room);
+    dp = (unsigned char *)msg->rec + msg->len;
+    memcpy(dp, &l, sizeof(l));
+    memcpy(dp + sizeof(l), s, l);
+    dp[sizeof(l) + l] = '\0';
+    msg->len += SYSLOG_ALIGN(sizeof(l) + l + 1);
+    return (0);
+}
+
+/*
+ * Records the arguments consumed by the format. Returns -1 if the format
+ * cannot be replayed, running out of room is not an error: the segment is
+ * cut short and the rendering stops there.
+ */
+static int
+syslog_enc_seg(struct syslog_async_msg *msg, const char *fmt, int serrno,
+  va_list ap)
+{
+    struct syslog_spec sp;
+    const char *cp;
+    long double ldv;
+    double dv;
+    intmax_t iv;
+    uintmax_t uv;
+    void *pv;
+    int prec, rval;
+
+    for (cp = fmt; (cp = strchr(cp, '%')) != NULL;) {
+        cp = syslog_spec_parse(cp + 1, &sp);
+        if (cp == NULL)
+            return (-1);
+        if (sp.width == SYSLOG_SPEC_ARG) {
+            iv = va_arg(ap, int);
+            if (syslog_enc_put(msg, &iv, sizeof(iv)) != 0)
+                return (0);
+        }
+        prec = sp.prec;
+        if (prec == SYSLOG_SPEC_ARG) {
+            iv = va_arg(ap, int);
+            if (syslog_enc_put(msg, &iv, sizeof(iv)) != 0)
+                return (0);
+            prec = (iv < 0) ? -1 : iv;
+        }
+        switch (sp.conv) {
+        case 'd': case 'i':
+            switch (sp.lmod) {
+            case LM_HH:
+                iv = (signed char)va_arg(ap, int);
                 break;
 
-            case SYSLOG_ITEM_ASYNC_EXIT:
-                return;
+            case LM_H:
+                iv = (short)va_arg(ap, int);
+                break;
+
+            case LM_L:
+                iv = va_arg(ap, long);
+                break;
+
+            case LM_LL:
+                iv = va_arg(ap, long long);
+                break;
+
+            case LM_J:
+                iv = va_arg(ap, intmax_t);
+                break;
+
+            case LM_Z:
+                iv = va_arg(ap, ssize_t);
+                break;
+
+            case LM_T:
+                iv = va_arg(ap, ptrdiff_t);
+                break;
 
             default:
+                iv = va_arg(ap, int);
+                break;
+            }
+            rval = syslog_enc_put(msg, &iv, sizeof(iv));
+            break;
+
+        case 'o': case 'u': case 'x': case 'X':
+            switch (sp.lmod) {
+            case LM_HH:
+                uv = (unsigned char)va_arg(ap, unsigned int);
                 break;
-        }
 
-        /* put wi into syslog_wi_free' tail */
-        pthread_mutex_lock(&syslog_wi_free_mutex);
+            case LM_H:
+                uv = (unsigned short)va_arg(ap, unsigned int);
+                break;
 
-        wi->next = syslog_wi_free;
-        syslog_wi_free = wi;
+            case LM_L:
+                uv = va_arg(ap, unsigned long);
+                break;
+
+            case LM_LL:
+                uv = va_arg(ap, unsigned long long);
+                break;
 
-        pthread_cond_signal(&syslog_wi_free_cond);
-        pthread_mutex_unlock(&syslog_wi_free_mutex);
+            case LM_J:
+                uv = va_arg(ap, uintmax_t);
+                break;
+
+            case LM_Z:
+                uv = va_arg(ap, size_t);
+                break;
+
+            case LM_T:
+                uv = (size_t)va_arg(ap, ptrdiff_t);
+                break;
+
+            default:
+                uv = va_arg(ap, unsigned int);
+                break;
+            }
+            rval = syslog_enc_put(msg, &uv, sizeof(uv));
+            break;
+
+        case 'c':
+            iv = va_arg(ap, int);
+            rval = syslog_enc_put(msg, &iv, sizeof(iv));
+            break;
+
+        case 'e': case 'E': case 'f': case 'F':
+        case 'g': case 'G': case 'a': case 'A':
+            if (sp.lmod == LM_LD) {
+                ldv = va_arg(ap, long double);
+                rval = syslog_enc_put(msg, &ldv, sizeof(ldv));
+            } else {
+                dv = va_arg(ap, double);
+                rval = syslog_enc_put(msg, &dv, sizeof(dv));
+            }
+            break;
+
+        case 'p':
+            pv = va_arg(ap, void *);
+            rval = syslog_enc_put(msg, &pv, sizeof(pv));
+            break;
+
+        case 's':
+            rval = syslog_enc_str(msg, va_arg(ap, const char *), prec);
+            break;
+
+        case 'm':
+            rval = syslog_enc_str(msg, strerror(serrno), prec);
+            break;
+
+        case 'n':
+            (void)va_arg(ap, void *);
+            /* Fall through */
+        default:
+            rval = 0;
+            break;
+        }
+        if (rval != 0)
+            return (0);
     }
+    return (0);
 }
 
 static int
-syslog_queue_init(void)
+syslog_dec_get(const unsigned char **app, const unsigned char *ep, void *vp,
+  size_t len)
 {
-    int i;
 
-    memset(syslog_wi_pool, 0, sizeof(syslog_wi_pool));
-    for (i = 0; i < SYSLOG_WI_POOL_SIZE - 1; i++) {
-        syslog_wi_pool[i].next = &syslog_wi_pool[i + 1];
-    }
-    syslog_wi_pool[SYSLOG_WI_POOL_SIZE - 1].next = NULL;
+    if ((size_t)(ep - *app) < SYSLOG_ALIGN(len))
+        return (-1);
+    memcpy(vp, *app, len);
+    *app += SYSLOG_ALIGN(len);
+    return (0);
+}
+
+static const char *
+syslog_dec_str(const unsigned char **app, const unsigned char *ep)
+{
+    const char *s;
+    uint32_t l;
+
+    if ((size_t)(ep - *app) < SYSLOG_ALIGN(sizeof(l) + 1))
+        return (NULL);
+    memcpy(&l, *app, sizeof(l));
+    if ((size_t)(ep - *app) < SYSLOG_ALIGN(sizeof(l) + l + 1))
+        return (NULL);
+    s = (const char *)*app + sizeof(l);
+    *app += SYSLOG_ALIGN(sizeof(l) + l + 1);
+    return (s);
+}
 
-    syslog_wi_free = syslog_wi_pool;
-    syslog_wi_queue = NULL;
-    syslog_wi_queue_tail = NULL;
+static void
+syslog_obuf_put(struct syslog_obuf *obp, const char *s, size_t len)
+{
 
-    syslog_dropped_items = 0;
+    if (len > obp->len - obp->pos - 1)
+        len = obp->len - obp->pos - 1;
+    memcpy(obp->buf + obp->pos, s, len);
+    obp->pos += len;
+    obp->buf[obp->pos] = '\0';
+}
 
-    if (pthread_cond_init(&syslog_queue_cond, NULL) != 0)
-        goto e0;
-    if (pthread_mutex_init(&syslog_queue_mutex, NULL) != 0)
-        goto e1;
-    if (pthread_cond_init(&syslog_wi_free_cond, NULL)  != 0)
-        goto e2;
-    if (pthread_mutex_init(&syslog_wi_free_mutex, NULL)  != 0)
-        goto e3;
-    if (pthread_create(&syslog_queue, NULL, (void *(*)(void *))&syslog_queue_run, NULL) != 0)
-        goto e4;
-#if HAVE_PTHREAD_SETNAME_NP
-    (void)pthread_setname_np(syslog_queue, "syslog_queue");
-#endif
+static void
+syslog_obuf_printf(struct syslog_obuf *obp, const char *fmt, ...)
+{
+    va_list ap;
+    size_t room;
+    int n;
 
-    return 0;
-e4:
-    pthread_mutex_destroy(&syslog_wi_free_mutex);
-e3:
-    pthread_cond_destroy(&syslog_wi_free_cond);
-e2:
-    pthread_mutex_destroy(&syslog_queue_mutex);
-e1:
-    pthread_cond_destroy(&syslog_queue_cond);
-e0:
-    return -1;
+    room = obp->len - obp->pos;
+    if (room <= 1)
+        return;
+    va_start(ap, fmt);
+    n = vsnprintf(obp->buf + obp->pos, room, fmt, ap);
+    va_end(ap);
+    if (n > 0)
+        obp->pos += ((size_t)n < room) ? (size_t)n : room - 1;
 }
 
-static struct syslog_wi *
-syslog_queue_get_free_item(int wait)
+static void
+syslog_seg_render(const struct syslog_seg *sgp, struct syslog_obuf *obp)
 {
-    struct syslog_wi *wi;
-
-    pthread_mutex_lock(&syslog_wi_free_mutex);
-    while (syslog_wi_free == NULL) {
-        /* no free work items, return if no wait is requested */
-        if (wait == 0) {
-            syslog_dropped_items++;
-            pthread_mutex_unlock(&syslog_wi_free_mutex);
-            return NULL;
+    const unsigned char *ap, *ep;
+    struct syslog_spec sp;
+    const char *cp, *pp, *lm, *s;
+    char spec[32];
+    long double ldv;
+    double dv;
+    intmax_t iv;
+    uintmax_t uv;
+    void *pv;
+    int width, prec, minus, n;
+    char conv;
+
+    ap = (const unsigned char *)sgp + SYSLOG_ALIGN(sizeof(*sgp));
+    ep = (const unsigned char *)sgp + sgp->len;
+    for (cp = sgp->fmt; (pp = strchr(cp, '%')) != NULL;) {
+        syslog_obuf_put(obp, cp, pp - cp);
+        cp = syslog_spec_parse(pp + 1, &sp);
+        RTPP_DBG_ASSERT(cp != NULL);
+        if (cp == NULL)
+            return;
+        minus = 0;
+        width = sp.width;
+        if (width == SYSLOG_SPEC_ARG) {
+            if (syslog_dec_get(&ap, ep, &iv, sizeof(iv)) != 0)
+                return;
+            if (iv < 0) {
+                minus = 1;
+                iv = -iv;
+            }
+            width = (iv > SYSLOG_SPEC_MAX) ? SYSLOG_SPEC_MAX : iv;
+        }
+        prec = sp.prec;
+        if (prec == SYSLOG_SPEC_ARG) {
+            if (syslog_dec_get(&ap, ep, &iv, sizeof(iv)) != 0)
+                return;
+            prec = (iv < 0) ? -1 : (iv > SYSLOG_SPEC_MAX) ? SYSLOG_SPEC_MAX : iv;
+        }
+        if (sp.conv == '%') {
+            syslog_obuf_put(obp, "%", 1);
+            continue;
+        }
+        if (sp.conv == 'n')
+            continue;
+        /* Integers have all been widened to intmax_t when recorded */
+        lm = "";
+        conv = sp.conv;
+        switch (conv) {
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+            lm = "j";
+            break;
+
+        case 'e': case 'E': case 'f': case 'F':
+        case 'g': case 'G': case 'a': case 'A':
+            if (sp.lmod == LM_LD)
+                lm = "L";
+            break;
+
+        case 'm':
+            conv = 's';
+            break;
+        }
+        n = snprintf(spec, sizeof(spec), "%%%.*s%s", sp.nflags, sp.flags,
+          minus ? "-" : "");
+        if (width >= 0)
+            n += snprintf(spec + n, sizeof(spec) - n, "%d", width);
+        if (prec >= 0)
+            n += snprintf(spec + n, sizeof(spec) - n, ".%d", prec);
+        snprintf(spec + n, sizeof(spec) - n, "%s%c", lm, conv);
+
+        switch (sp.conv) {
+        case 'd': case 'i': case 'c':
+            if (syslog_dec_get(&ap, ep, &iv, sizeof(iv)) != 0)
+                return;
+            if (sp.conv == 'c')
+                syslog_obuf_printf(obp, spec, (int)iv);
+            else
+                syslog_obuf_printf(obp, spec, iv);
+            break;
+
+        case 'o': case 'u': case 'x': case 'X':
+            if (syslog_dec_get(&ap, ep, &uv, sizeof(uv)) != 0)
+                return;
+            syslog_obuf_printf(obp, spec, uv);
+            break;
+
+        case 'e': case 'E': case 'f': case 'F':
+        case 'g': case 'G': case 'a': case 'A':
+            if (sp.lmod == LM_LD) {
+                if (syslog_dec_get(&ap, ep, &ldv, sizeof(ldv)) != 0)
+                    return;
+                syslog_obuf_printf(obp, spec, ldv);
+            } else {
+                if (syslog_dec_get(&ap, ep, &dv, sizeof(dv)) != 0)
+                    return;
+                syslog_obuf_printf(obp, spec, dv);
+            }
+            break;
+
+        case 'p':
+            if (syslog_dec_get(&ap, ep, &pv, sizeof(pv)) != 0)
+                return;
+            syslog_obuf_printf(obp, spec, pv);
+            break;
+
+        case 's': case 'm':
+            s = syslog_dec_str(&ap, ep);
+            if (s == NULL)
+                return;
+            syslog_obuf_printf(obp, spec, s);
+            break;
         }
-        pthread_cond_wait(&syslog_wi_free_cond, &syslog_wi_free_mutex);
     }
+    syslog_obuf_put(obp, cp, strlen(cp));
+}
+
+static void
+syslog_rec_render(const struct syslog_rec *rec, struct syslog_obuf *obp)
+{
+    const unsigned char *cp, *ep;
+    const struct syslog_seg *sgp;
+
+    cp = (const unsigned char *)rec + SYSLOG_ALIGN(sizeof(*rec));
+    ep = (const unsigned char *)rec + rec->len;
+    while (cp < ep) {
+        sgp = (const struct syslog_seg *)cp;
+        syslog_seg_render(sgp, obp);
+        cp += sgp->len;
+    }
+}
 
-    wi = syslog_wi_free;
+static struct syslog_rec *
+syslog_ring_peek(struct syslog_ring *ring)
+{
+    struct syslog_rec *rec;
+    unsigned long head, tail, off;
+
+    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    while (tail != head) {
+        off = tail & (SYSLOG_RING_LEN - 1);
+        rec = (struct syslog_rec *)(ring->buf + off);
+        if (rec->len != 0)
+            return (rec);
+        tail += SYSLOG_RING_LEN - off;
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+    return (NULL);
+}
 
-    /* move up syslog_wi_free */
-    syslog_wi_free = syslog_wi_free->next;
-    pthread_mutex_unlock(&syslog_wi_free_mutex);
+static void
+syslog_ring_pop(struct syslog_ring *ring, struct syslog_rec *rec)
+{
+    unsigned long tail;
 
-    return wi;
+    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + rec->len, memory_order_release);
 }
 
+/*
+ * Only the syslog thread unlinks, producers only ever push new rings in
+ * front of the list.
+ */
 static void
-syslog_queue_put_item(struct syslog_wi *wi)
+syslog_ring_unlink(struct syslog_ring *prev, struct syslog_ring *ring)
 {
+    struct syslog_ring *first;
+
+    if (prev == NULL) {
+        first = ring;
+        if (atomic_compare_exchange_strong(&syslog_ctl.rings, &first,
+          ring->next))
+            return;
+        for (prev = first; prev->next != ring; prev = prev->next)
+            continue;
+    }
+    prev->next = ring->next;
+}
 
-    pthread_mutex_lock(&syslog_queue_mutex);
+static struct syslog_ring *
+syslog_queue_next_item(struct syslog_rec **recp)
+{
+    struct syslog_ring *ring, *prev, *next, *best;
+    struct syslog_rec *rec;
+    int orphaned;
+
+    best = NULL;
+    prev = NULL;
+    for (ring = atomic_load(&syslog_ctl.rings); ring != NULL; ring = next) {
+        next = ring->next;
+        orphaned = atomic_load(&ring->orphaned);
+        rec = syslog_ring_peek(ring);
+        if (rec == NULL) {
+            if (orphaned) {
+                syslog_ring_unlink(prev, ring);
+                munmap(ring, sizeof(*ring));
+                continue;
+            }
+        } else if (best == NULL || rec->ts < (*recp)->ts) {
+            best = ring;
+            *recp = rec;
+        }
+        prev = ring;
+    }
+    return (best);
+}
+
+static void
+syslog_queue_run(void)
+{
+    struct syslog_ring *ring;
+    struct syslog_rec *rec;
+    struct syslog_obuf ob;
+    struct timespec deadline;
+    char data[SYSLOG_MSG_MAXLEN];
+    unsigned long dropped, reported, dreq;
+    int exiting;
+
+    reported = 0;
+    for (;;) {
+        dreq = atomic_load(&syslog_ctl.drain_req);
+        ring = syslog_queue_next_item(&rec);
+        if (ring == NULL) {
+            atomic_store(&syslog_ctl.drain_ack, dreq);
+            dropped = atomic_load_explicit(&syslog_ctl.dropped,
+              memory_order_relaxed);
+            if (dropped != reported) {
+                syslog(LOG_WARNING, "syslog_async: %lu message(s) dropped",
+                  dropped - reported);
+                reported = dropped;
+            }
+            exiting = atomic_load(&syslog_ctl.exiting);
+            /* The hook may queue more messages, have another look after */
+            if (syslog_idle_hook != NULL)
+                syslog_idle_hook(exiting);
+            pthread_mutex_lock(&syslog_queue_mutex);
+            atomic_store(&syslog_ctl.sleeping, 1);
+            ring = syslog_queue_next_item(&rec);
+            if (ring == NULL && atomic_load(&syslog_ctl.exiting) == 0 &&
+              atomic_load(&syslog_ctl.drain_req) == dreq) {
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                deadline.tv_sec += SYSLOG_IDLE_IVAL;
+                pthread_cond_timedwait(&syslog_queue_cond, &syslog_queue_mutex,
+                  &deadline);
+                ring = syslog_queue_next_item(&rec);
+            }
+            atomic_store(&syslog_ctl.sleeping, 0);
+            pthread_mutex_unlock(&syslog_queue_mutex);
+            if (ring == NULL) {
+                if (exiting)
+                    return;
+                continue;
+            }
+        }
 
-    wi->next = NULL;
-    if (syslog_wi_queue == NULL) {
-        syslog_wi_queue = wi;
-        syslog_wi_queue_tail = wi;
-    } else {
-        syslog_wi_queue_tail->next = wi;
-        syslog_wi_queue_tail = wi;
+        /* main work here */
+        ob.buf = data;
+        ob.len = sizeof(data);
+        ob.pos = 0;
+        data[0] = '\0';
+        syslog_rec_render(rec, &ob);
+        syslog(rec->priority, "%s", data);
+
+        syslog_ring_pop(ring, rec);
     }
+}
 
-    /* notify worker thread */
-    pthread_cond_signal(&syslog_queue_cond);
+static void
+syslog_ring_detach(void *arg)
+{
+    struct syslog_ring *ring;
 
-    pthread_mutex_unlock(&syslog_queue_mutex);
+    ring = (struct syslog_ring *)arg;
+    syslog_ring_self = NULL;
+    atomic_store(&ring->orphaned, 1);
+}
+
+static struct syslog_ring *
+syslog_ring_attach(void)
+{
+    struct syslog_ring *ring, *first;
+
+    /* Mapped rather than allocated, to be first touched by the owner */
+    ring = mmap(NULL, sizeof(*ring), PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (ring == MAP_FAILED)
+        return (NULL);
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->orphaned, 0);
+    ring->msg.rec = NULL;
+    if (pthread_setspecific(syslog_ring_key, ring) != 0) {
+        munmap(ring, sizeof(*ring));
+        return (NULL);
+    }
+    first = atomic_load(&syslog_ctl.rings);
+    do {
+        ring->next = first;
+    } while (!atomic_compare_exchange_weak(&syslog_ctl.rings, &first, ring));
+    syslog_ring_self = ring;
+    return (ring);
+}
+
+static int
+syslog_queue_init(void)
+{
+
+    if (pthread_key_create(&syslog_ring_key, syslog_ring_detach) != 0)
+        goto e0;
+    if (pthread_cond_init(&syslog_queue_cond, NULL) != 0)
+        goto e1;
+    if (pthread_mutex_init(&syslog_queue_mutex, NULL) != 0)
+        goto e2;
+    if (pthread_create(&syslog_queue, NULL, (void *(*)(void *))&syslog_queue_run, NULL) != 0)
+        goto e3;
+#if HAVE_PTHREAD_SETNAME_NP
+    (void)pthread_setname_np(syslog_queue, "syslog_queue");
+#endif
+
+    return 0;
+e3:
+    pthread_mutex_destroy(&syslog_queue_mutex);
+e2:
+    pthread_cond_destroy(&syslog_queue_cond);
+e1:
+    pthread_key_delete(syslog_ring_key);
+e0:
+    return -1;
 }
 
 static void
 syslog_async_atexit(void)
 {
-    struct syslog_wi *wi;
 
     if (syslog_queue_inited == 0)
         return;
 
-    /* Wait for the worker thread to exit */
-    wi = syslog_queue_get_free_item(SYSLOG_WI_WAIT);
-    wi->item_type = SYSLOG_ITEM_ASYNC_EXIT;
-    syslog_queue_put_item(wi);
+    /* Let the worker thread drain the rings and wait for it to exit */
+    pthread_mutex_lock(&syslog_queue_mutex);
+    atomic_store(&syslog_ctl.exiting, 1);
+    pthread_cond_signal(&syslog_queue_cond);
+    pthread_mutex_unlock(&syslog_queue_mutex);
     pthread_join(syslog_queue, NULL);
+    atomic_store(&syslog_ctl.exited, 1);
 }
 
 int
-syslog_async_init(const char *app, int facility)
+syslog_async_init(const char *app, int facility,
+  syslog_async_idle_hook_t idle_hook)
 {
 
     pthread_mutex_lock(&syslog_init_mutex);
     if (syslog_queue_inited == 0) {
+        syslog_idle_hook = idle_hook;
         if (syslog_queue_init() != 0) {
             pthread_mutex_unlock(&syslog_init_mutex);
             return -1;
@@ -243,48 +876,140 @@ syslog_async_init(const char *app, int facility)
     return 0;
 }
 
-void
-vsyslog_async(int priority, const char *pre, const char *post,
-  const char *user_fmt, va_list ap)
+struct syslog_async_msg *
+syslog_async_begin(int priority)
 {
-    struct syslog_wi *wi;
-    char *p;
-    int s1, s2, s3, l, m;
+    struct syslog_ring *ring;
+    struct syslog_async_msg *msg;
+    struct timespec ts;
+    unsigned long head, tail, off;
+
+    ring = syslog_ring_self;
+    if (ring == NULL) {
+        ring = syslog_ring_attach();
+        if (ring == NULL)
+            goto drop;
+    }
+    msg = &ring->msg;
+    /* Nested message, i.e. from a signal handler */
+    if (msg->rec != NULL)
+        goto drop;
+    head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    off = head & (SYSLOG_RING_LEN - 1);
+    msg->pad = 0;
+    if (SYSLOG_RING_LEN - off < SYSLOG_REC_MAXLEN)
+        msg->pad = SYSLOG_RING_LEN - off;
+    if (SYSLOG_RING_LEN - (head - tail) < msg->pad + SYSLOG_REC_MAXLEN)
+        goto drop;
+    if (msg->pad != 0)
+        ((struct syslog_rec *)(ring->buf + off))->len = 0;
+    msg->rec = (struct syslog_rec *)(ring->buf +
+      ((head + msg->pad) & (SYSLOG_RING_LEN - 1)));
+    msg->rec->priority = priority;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    msg->rec->ts = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    msg->len = SYSLOG_ALIGN(sizeof(*msg->rec));
+    return (msg);
+drop:
+    atomic_fetch_add_explicit(&syslog_ctl.dropped, 1, memory_order_relaxed);
+    return (NULL);
+}
 
-    wi = syslog_queue_get_free_item(SYSLOG_WI_NOWAIT);
-    if (wi == NULL)
+void
+syslog_async_vadd(struct syslog_async_msg *msg, const char *fmt, va_list ap)
+{
+    struct syslog_seg *sgp;
+    unsigned char *dp;
+    size_t sstart, room;
+    va_list apc;
+    uint32_t l;
+    int serrno, n;
+
+    if (msg == NULL)
         return;
-
-    m = l = sizeof(wi->data);
-    s1 = strlcpy(wi->data, pre, l);
-    if (s1 >= l) {
-        s1 = l - 1;
-    }
-    p = wi->data + s1;
-    l -= s1;
-    if (l <= 1)
-        goto truncate;
-    s2 = vsnprintf(p, l, user_fmt, ap);
-    if (s2 >= l) {
-        /* message was truncated */
-        s2 = l - 1;
-        p[s2] = '\0';
+    serrno = errno;
+    sstart = msg->len;
+    if (SYSLOG_REC_MAXLEN - sstart < SYSLOG_ALIGN(sizeof(*sgp)))
+        return;
+    sgp = (struct syslog_seg *)((unsigned char *)msg->rec + sstart);
+    sgp->fmt = fmt;
+    msg->len += SYSLOG_ALIGN(sizeof(*sgp));
+    va_copy(apc, ap);
+    if (syslog_enc_seg(msg, fmt, serrno, ap) != 0) {
+        /* Cannot be replayed, render it here then */
+        msg->len = sstart + SYSLOG_ALIGN(sizeof(*sgp));
+        room = SYSLOG_REC_MAXLEN - msg->len;
+        if (room < SYSLOG_ALIGN(sizeof(l) + 1)) {
+            msg->len = sstart;
+            goto out;
+        }
+        dp = (unsigned char *)msg->rec + msg->len;
+        errno = serrno;
+        n = vsnprintf((char *)dp + sizeof(l), room - sizeof(l), fmt, apc);
+        if (n < 0)
+            n = 0;
+        l = ((size_t)n < room - sizeof(l)) ? (size_t)n : room - sizeof(l) - 1;
+        memcpy(dp, &l, sizeof(l));
+        dp[sizeof(l) + l] = '\0';
+        msg->len += SYSLOG_ALIGN(sizeof(l) + l + 1);
+        sgp->fmt = "%s";
     }
-    p += s2;
-    l -= s2;
-    if (l <= 1 || post == NULL)
-        goto truncate;
-    s3 = strlcpy(p, post, l);
-    if (s3 >= l) {
-        /* message was truncated */
-        s3 = l - 1;
+    sgp->len = msg->len - sstart;
+out:
+    va_end(apc);
+}
+
+void
+syslog_async_add(struct syslog_async_msg *msg, const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    syslog_async_vadd(msg, fmt, ap);
+    va_end(ap);
+}
+
+void
+syslog_async_commit(struct syslog_async_msg *msg)
+{
+    struct syslog_ring *ring;
+    unsigned long head;
+
+    if (msg == NULL)
+        return;
+    ring = (struct syslog_ring *)((char *)msg -
+      offsetof(struct syslog_ring, msg));
+    msg->rec->len = msg->len;
+    head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    msg->rec = NULL;
+    atomic_store(&ring->head, head + msg->pad + msg->len);
+
+    /* notify worker thread, only if it has nothing else to do */
+    if (atomic_load(&syslog_ctl.sleeping) != 0) {
+        pthread_mutex_lock(&syslog_queue_mutex);
+        pthread_cond_signal(&syslog_queue_cond);
+        pthread_mutex_unlock(&syslog_queue_mutex);
     }
-    l -= s3;
-truncate:
-    RTPP_DBG_ASSERT(l >= 0 && l <= m);
-    wi->len = m - l;
-    RTPP_DBG_ASSERT(wi->data[wi->len] == '\0' && strlen(wi->data) == wi->len);
-    wi->priority = priority;
-    wi->item_type = SYSLOG_ITEM_ASYNC_WRITE;
-    syslog_queue_put_item(wi);
+}
+
+/*
+ * Waits until the syslog thread has rendered everything that has been
+ * committed before the call.
+ */
+void
+syslog_async_drain(void)
+{
+    const struct timespec ival = {.tv_sec = 0, .tv_nsec = 1000000};
+    unsigned long req;
+
+    if (syslog_queue_inited == 0)
+        return;
+    req = atomic_fetch_add(&syslog_ctl.drain_req, 1) + 1;
+    pthread_mutex_lock(&syslog_queue_mutex);
+    pthread_cond_signal(&syslog_queue_cond);
+    pthread_mutex_unlock(&syslog_queue_mutex);
+    while (atomic_load(&syslog_ctl.drain_ack) < req &&
+      atomic_load(&syslog_ctl.exited) == 0)
+        nanosleep(&ival, NULL);
 }
@@ -30,7 +30,31 @@
 
 #include <stdarg.h>
 
-int syslog_async_init(const char *, int);
-void vsyslog_async(int, const char *, const char *, const char *, va_list);
+/*
+ * The idle hook is called from the syslog thread whenever it runs out of
+ * messages, then once a second for as long as it stays idle, and one last
+ * time with a non-zero argument once the process is exiting.
+ */
+typedef void (*syslog_async_idle_hook_t)(int);
+
+/*
+ * A message is put together from one or more printf-style segments between
+ * syslog_async_begin() and syslog_async_commit(). The arguments are only
+ * recorded, the text is rendered later by the syslog thread, so the
+ * formats have to stay valid until then, which literals do. Code that is
+ * about to unload formats (i.e. dlclose() a module) calls
+ * syslog_async_drain() first. NULL is returned when the message has to be
+ * dropped, the other calls accept it as is.
+ */
+struct syslog_async_msg;
+
+int syslog_async_init(const char *, int, syslog_async_idle_hook_t);
+struct syslog_async_msg *syslog_async_begin(int);
+void syslog_async_add(struct syslog_async_msg *, const char *, ...)
+  __attribute__ ((format (printf, 2, 3)));
+void syslog_async_vadd(struct syslog_async_msg *, const char *, va_list)
+  __attribute__ ((format (printf, 2, 0)));
+void syslog_async_commit(struct syslog_async_msg *);
+void syslog_async_drain(void);
 
 #endif
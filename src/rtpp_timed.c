@@ -33,6 +33,7 @@
 #include <pthread.h>
 #include <signal.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -51,6 +52,8 @@
 #include "rtpp_timed_task.h"
 #include "rtpp_timed_fin.h"
 #include "rtpp_timed_task_fin.h"
+#include "rtpp_tload.h"
+#include "rtpp_cpuset.h"
 
 #include "elperiodic.h"
 
@@ -65,6 +68,7 @@ struct rtpp_timed_cf {
     int wi_dsize;
     void *elp;
     int state;
+    struct rtpp_tload_ent *tlp;
 };
 
 #define RT_ST_RUNNING 0
@@ -91,7 +95,7 @@ static int rtpp_timed_schedule(struct rtpp_timed *,
 static struct rtpp_timed_task *rtpp_timed_schedule_rc(struct rtpp_timed *,
   double offset, struct rtpp_refcnt *, rtpp_timed_cb_t, rtpp_timed_cancel_cb_t,
   void *);
-static void rtpp_timed_process(struct rtpp_timed_cf *, double);
+static int rtpp_timed_process(struct rtpp_timed_cf *, double);
 static int rtpp_timed_cancel(struct rtpp_timed_task *);
 static void rtpp_timed_shutdown(struct rtpp_timed *);
 
@@ -109,7 +113,7 @@ rtpp_timed_queue_run(void *argp)
     struct rtpp_timed_cf *rtcp;
     struct rtpp_wi *wi;
     struct rtpp_timed_wi *wi_data;
-    int signum;
+    int signum, nitems;
     double ctime;
 
     rtcp = (struct rtpp_timed_cf *)argp;
@@ -123,7 +127,9 @@ rtpp_timed_queue_run(void *argp)
             }
         }
         ctime = getdtime();
-        rtpp_timed_process(rtcp, ctime);
+        rtpp_tload_wake(rtcp->tlp, ctime);
+        nitems = rtpp_timed_process(rtcp, ctime);
+        rtpp_tload_sleep(rtcp->tlp, getdtime(), nitems);
         prdic_procrastinate(rtcp->elp);
     }
     /* We are terminating, get rid of all requests */
@@ -142,7 +148,8 @@ rtpp_timed_queue_run(void *argp)
 }
 
 struct rtpp_timed *
-rtpp_timed_ctor(double run_period)
+rtpp_timed_ctor(double run_period, struct rtpp_tload *tload,
+  const struct rtpp_cpusets *cpusets)
 {
     struct rtpp_timed_cf *rtcp;
 
@@ -171,18 +178,29 @@ rtpp_timed_ctor(double run_period)
     if (rtcp->elp == NULL) {
         goto e4;
     }
+    if (tload != NULL) {
+        rtcp->tlp = CALL_SMETHOD(tload, reg, "rtpp_timed_queue", rtcp->q);
+        if (rtcp->tlp == NULL) {
+            goto e5;
+        }
+    }
     if (pthread_create(&rtcp->thread_id, NULL,
       (void *(*)(void *))&rtpp_timed_queue_run, rtcp) != 0) {
-        goto e5;
+        goto e6;
     }
 #if HAVE_PTHREAD_SETNAME_NP
     (void)pthread_setname_np(rtcp->thread_id, "rtpp_timed_queue");
 #endif
+    /* Best effort, there is no logger to report failure to */
+    (void)rtpp_cpusets_apply(cpusets, RTPP_TCLASS_TIMED, -1, rtcp->thread_id);
     rtcp->last_run = getdtime();
     rtcp->period = run_period;
     rtcp->wi_dsize = sizeof(struct rtpp_timed_wi) + rtpp_refcnt_osize;
     PUBINST_FININIT(&rtcp->pub, rtcp, rtpp_timed_destroy);
     return (&rtcp->pub);
+e6:
+    if (rtcp->tlp != NULL)
+        CALL_SMETHOD(rtcp->tlp->owner, unreg, rtcp->tlp);
 e5:
     prdic_free(rtcp->elp);
 e4:
@@ -218,6 +236,8 @@ rtpp_timed_destroy(struct rtpp_timed_cf *rtpp_timed_cf)
         rtpp_timed_shutdown(&rtpp_timed_cf->pub);
     }
     rtpp_timed_fin(&(rtpp_timed_cf->pub));
+    if (rtpp_timed_cf->tlp != NULL)
+        CALL_SMETHOD(rtpp_timed_cf->tlp->owner, unreg, rtpp_timed_cf->tlp);
     rtpp_queue_destroy(rtpp_timed_cf->cmd_q);
     rtpp_queue_destroy(rtpp_timed_cf->q);
     free(rtpp_timed_cf);
@@ -318,21 +338,22 @@ rtpp_timed_istime(struct rtpp_wi *wi, void *p)
     return (1);
 }
 
-static void
+static int
 rtpp_timed_process(struct rtpp_timed_cf *rtcp, double ctime)
 {
     struct rtpp_wi *wi;
     struct rtpp_timed_wi *wi_data;
     struct rtpp_timed_istime_arg istime_arg;
     enum rtpp_timed_cb_rvals cb_rval;
+    int nprocessed;
 
     istime_arg.ctime = ctime;
     istime_arg.wi_dsize = rtcp->wi_dsize;
-    for (;;) {
+    for (nprocessed = 0;; nprocessed++) {
         wi = rtpp_queue_get_first_matching(rtcp->q, rtpp_timed_istime,
           &istime_arg);
         if (wi == NULL) {
-            return;
+            return (nprocessed);
         }
         wi_data = rtpp_wi_data_get_ptr(wi, rtcp->wi_dsize, rtcp->wi_dsize);
         cb_rval = wi_data->cb.func(ctime, wi_data->cb.arg);
@@ -28,12 +28,15 @@
 #pragma once
 
 struct rtpp_refcnt;
+struct rtpp_tload;
+struct rtpp_cpusets;
 enum rtpp_timed_cb_rvals {CB_LAST, CB_MORE};
 
 DEFINE_RAW_METHOD(rtpp_timed_cb, enum rtpp_timed_cb_rvals, double, void *);
 DEFINE_RAW_METHOD(rtpp_timed_cancel_cb, void, void *);
 
-DECLARE_CLASS(rtpp_timed, double);
+DECLARE_CLASS(rtpp_timed, double, struct rtpp_tload *,
+  const struct rtpp_cpusets *);
 
 DECLARE_METHOD(rtpp_timed, rtpp_timed_schedule, int, double,
   rtpp_timed_cb_t, rtpp_timed_cancel_cb_t, void *);
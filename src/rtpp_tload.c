@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rtpp_types.h"
+#include "rtpp_mallocs.h"
+#include "rtpp_codeptr.h"
+#include "rtpp_refcnt.h"
+#include "rtpp_debug.h"
+#include "rtpp_queue.h"
+#include "rtpp_time.h"
+#include "rtpp_command_reply.h"
+#include "rtpp_tload.h"
+#include "rtpp_tload_fin.h"
+
+/* Outbound queue length that counts as full load */
+#define RTPP_TLOAD_QLEN_TRS RTPQ_LARGE_CB_LEN
+
+struct rtpp_tload_rent {
+    struct rtpp_tload_ent pub;
+    struct rtpp_queue *q;
+    struct rtpp_tload_rent *next;
+    char name[0];
+};
+
+struct rtpp_tload_priv {
+    struct rtpp_tload pub;
+    pthread_mutex_t lock;
+    struct rtpp_tload_rent *first;
+};
+
+static void rtpp_tload_dtor(struct rtpp_tload_priv *);
+static struct rtpp_tload_ent *rtpp_tload_reg(struct rtpp_tload *, const char *,
+  struct rtpp_queue *);
+static void rtpp_tload_unreg(struct rtpp_tload *, struct rtpp_tload_ent *);
+static double rtpp_tload_get_load(struct rtpp_tload *, const char *);
+static void rtpp_tload_aggregate(struct rtpp_tload *, const char *, double,
+  struct rtpp_tload_agg *);
+static int rtpp_tload_report(struct rtpp_tload *, struct rtpc_reply *);
+
+DEFINE_SMETHODS(rtpp_tload,
+    .reg = &rtpp_tload_reg,
+    .unreg = &rtpp_tload_unreg,
+    .get_load = &rtpp_tload_get_load,
+    .aggregate = &rtpp_tload_aggregate,
+    .report = &rtpp_tload_report,
+);
+
+struct rtpp_tload *
+rtpp_tload_ctor(void)
+{
+    struct rtpp_tload_priv *pvt;
+
+    pvt = rtpp_rzmalloc(sizeof(struct rtpp_tload_priv), PVT_RCOFFS(pvt));
+    if (pvt == NULL) {
+        goto e0;
+    }
+    if (pthread_mutex_init(&pvt->lock, NULL) != 0) {
+        goto e1;
+    }
+    PUBINST_FININIT(&pvt->pub, pvt, rtpp_tload_dtor);
+    return ((&pvt->pub));
+
+e1:
+    RTPP_OBJ_DECREF(&(pvt->pub));
+    free(pvt);
+e0:
+    return (NULL);
+}
+
+static void
+rtpp_tload_dtor(struct rtpp_tload_priv *pvt)
+{
+
+    rtpp_tload_fin(&(pvt->pub));
+    /* Every entry holds a reference, so we cannot get here otherwise */
+    RTPP_DBG_ASSERT(pvt->first == NULL);
+    pthread_mutex_destroy(&pvt->lock);
+    free(pvt);
+}
+
+static struct rtpp_tload_ent *
+rtpp_tload_reg(struct rtpp_tload *self, const char *name, struct rtpp_queue *q)
+{
+    struct rtpp_tload_priv *pvt;
+    struct rtpp_tload_rent *rep;
+    size_t nlen;
+
+    PUB2PVT(self, pvt);
+    nlen = strlen(name) + 1;
+    rep = rtpp_zmalloc(sizeof(*rep) + nlen);
+    if (rep == NULL)
+        return (NULL);
+    memcpy(rep->name, name, nlen);
+    rep->q = q;
+    rep->pub.lts = rep->pub.wstart = getdtime();
+    RTPP_OBJ_INCREF(self);
+    rep->pub.owner = self;
+    pthread_mutex_lock(&pvt->lock);
+    rep->next = pvt->first;
+    pvt->first = rep;
+    pthread_mutex_unlock(&pvt->lock);
+    return (&rep->pub);
+}
+
+static void
+rtpp_tload_unreg(struct rtpp_tload *self, struct rtpp_tload_ent *ep)
+{
+    struct rtpp_tload_priv *pvt;
+    struct rtpp_tload_rent *rep, **repp;
+
+    PUB2PVT(self, pvt);
+    PUB2PVT(ep, rep);
+    pthread_mutex_lock(&pvt->lock);
+    for (repp = &pvt->first; *repp != NULL; repp = &(*repp)->next) {
+        if (*repp == rep) {
+            *repp = rep->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pvt->lock);
+    free(rep);
+    RTPP_OBJ_DECREF(self);
+}
+
+static double
+rtpp_tload_get_load(struct rtpp_tload *self, const char *prefix)
+{
+    struct rtpp_tload_priv *pvt;
+    struct rtpp_tload_rent *rep;
+    double load, rval, now;
+    size_t plen;
+
+    PUB2PVT(self, pvt);
+    plen = (prefix != NULL) ? strlen(prefix) : 0;
+    rval = 0.0;
+    now = getdtime();
+    pthread_mutex_lock(&pvt->lock);
+    for (rep = pvt->first; rep != NULL; rep = rep->next) {
+        if (plen > 0 && strncmp(rep->name, prefix, plen) != 0)
+            continue;
+        load = rtpp_tload_ent_getload(&rep->pub, now);
+        if (load > rval)
+            rval = load;
+    }
+    pthread_mutex_unlock(&pvt->lock);
+    return (rval);
+}
+
+static void
+rtpp_tload_aggregate(struct rtpp_tload *self, const char *prefix, double now,
+  struct rtpp_tload_agg *agp)
+{
+    struct rtpp_tload_priv *pvt;
+    struct rtpp_tload_rent *rep;
+    struct rtpp_queue_stats qs;
+    double load;
+    size_t plen;
+
+    PUB2PVT(self, pvt);
+    plen = (prefix != NULL) ? strlen(prefix) : 0;
+    memset(agp, '\0', sizeof(*agp));
+    pthread_mutex_lock(&pvt->lock);
+    for (rep = pvt->first; rep != NULL; rep = rep->next) {
+        if (plen > 0 && strncmp(rep->name, prefix, plen) != 0)
+            continue;
+        load = rtpp_tload_ent_getload(&rep->pub, now);
+        if (load > agp->load)
+            agp->load = load;
+        agp->nitems += atomic_load_explicit(&rep->pub.nitems,
+          memory_order_relaxed);
+        if (rep->q == NULL)
+            continue;
+        rtpp_queue_get_stats(rep->q, &qs);
+        if (qs.length > agp->qlen)
+            agp->qlen = qs.length;
+        agp->ndrops += qs.ndrops;
+    }
+    pthread_mutex_unlock(&pvt->lock);
+}
+
+static int
+rtpp_tload_report(struct rtpp_tload *self, struct rtpc_reply *rrp)
+{
+    struct rtpp_tload_priv *pvt;
+    struct rtpp_tload_rent *rep;
+    struct rtpp_queue_stats qs;
+    double now;
+    int aerr;
+
+    PUB2PVT(self, pvt);
+    aerr = 0;
+    now = getdtime();
+    pthread_mutex_lock(&pvt->lock);
+    for (rep = pvt->first; rep != NULL && aerr == 0; rep = rep->next) {
+        const struct rtpp_tload_ent *ep = &rep->pub;
+
+        aerr = CALL_SMETHOD(rrp, appendf, "thread %s: load=%.3f busy=%.3f "
+          "idle=%.3f wakeups=%llu items=%llu drops=%llu", rep->name,
+          rtpp_tload_ent_getload(&rep->pub, now),
+          (double)atomic_load_explicit(&ep->busy_us, memory_order_relaxed) / 1e6,
+          (double)atomic_load_explicit(&ep->idle_us, memory_order_relaxed) / 1e6,
+          (unsigned long long)atomic_load_explicit(&ep->nwakeups, memory_order_relaxed),
+          (unsigned long long)atomic_load_explicit(&ep->nitems, memory_order_relaxed),
+          (unsigned long long)atomic_load_explicit(&ep->ndrops, memory_order_relaxed));
+        if (aerr == 0 && rep->q != NULL) {
+            rtpp_queue_get_stats(rep->q, &qs);
+            aerr = CALL_SMETHOD(rrp, appendf, " qlen=%u qhwm=%u qdrops=%llu",
+              qs.length, qs.hwm, (unsigned long long)qs.ndrops);
+        }
+        if (aerr == 0)
+            aerr = CALL_SMETHOD(rrp, appendf, "\n");
+    }
+    pthread_mutex_unlock(&pvt->lock);
+    return (aerr);
+}
+
+/*
+ * Feed the latest aggregate into the overload detector. The pressure is
+ * the highest of the thread load, the queue length and the queue drop
+ * rate since the previous update, each scaled so that 1.0 means full
+ * load. The detector engages at high_trs and disengages once the pressure
+ * gets below low_trs. Returns the new state.
+ */
+int
+rtpp_tload_ovl_update(struct rtpp_tload_ovl *op,
+  const struct rtpp_tload_agg *agp, double high_trs, double low_trs)
+{
+    uint64_t nitems, ndrops;
+    double pressure;
+
+    /* Counters may go backwards when threads unregister */
+    nitems = (agp->nitems > op->nitems) ? agp->nitems - op->nitems : 0;
+    ndrops = (agp->ndrops > op->ndrops) ? agp->ndrops - op->ndrops : 0;
+    op->nitems = agp->nitems;
+    op->ndrops = agp->ndrops;
+    op->drate = (ndrops > 0) ? (double)ndrops / (double)(nitems + ndrops) : 0.0;
+
+    pressure = agp->load;
+    if ((double)agp->qlen / RTPP_TLOAD_QLEN_TRS > pressure)
+        pressure = (double)agp->qlen / RTPP_TLOAD_QLEN_TRS;
+    if (op->drate / RTPP_TLOAD_DRATE_TRS > pressure)
+        pressure = op->drate / RTPP_TLOAD_DRATE_TRS;
+    op->pressure = pressure;
+
+    if (op->engaged == 0) {
+        if (pressure >= high_trs)
+            op->engaged = 1;
+    } else {
+        if (pressure < low_trs)
+            op->engaged = 0;
+    }
+    return (op->engaged);
+}
+
+#if defined(rtpp_tload_selftest)
+#include <stdio.h>
+#include "rtpp_memdeb_internal.h"
+#include "libexecinfo/stacktraverse.h"
+#include "libexecinfo/execinfo.h"
+
+#if !defined(NO_ERR_H)
+#include <err.h>
+#endif
+
+#define errx_ifnot(expr) \
+    if (!(expr)) \
+        errx(1, "`%s` check has failed in %s() at %s:%d", #expr, __func__, \
+          __FILE__, __LINE__);
+
+RTPP_MEMDEB_APP_STATIC;
+
+#define TLST_HIGH 0.85
+#define TLST_LOW  0.75
+
+static int
+tlst_update(struct rtpp_tload *tlp, struct rtpp_tload_ovl *op, double now)
+{
+    struct rtpp_tload_agg agg;
+
+    CALL_SMETHOD(tlp, aggregate, "rtpp_proc: ", now, &agg);
+    return (rtpp_tload_ovl_update(op, &agg, TLST_HIGH, TLST_LOW));
+}
+
+int
+rtpp_tload_selftest(void)
+{
+    struct rtpp_tload *tlp;
+    struct rtpp_tload_ent *ep, *iep;
+    struct rtpp_tload_ovl ovl;
+    struct rtpp_tload_agg agg;
+    double t0;
+    int rval;
+
+    RTPP_MEMDEB_APP_INIT();
+
+    tlp = rtpp_tload_ctor();
+    errx_ifnot(tlp != NULL);
+    ep = CALL_SMETHOD(tlp, reg, "rtpp_proc: 0", NULL);
+    errx_ifnot(ep != NULL);
+    iep = CALL_SMETHOD(tlp, reg, "rtpp_proc: 1", NULL);
+    errx_ifnot(iep != NULL);
+    t0 = ep->lts;
+    iep->lts = iep->wstart = t0;
+
+    /* Worker 0 is 95% busy over the first window, worker 1 is idle */
+    rtpp_tload_wake(ep, t0);
+    rtpp_tload_sleep(ep, t0 + 0.95, 100);
+    rtpp_tload_wake(ep, t0 + 1.0);
+    rtpp_tload_wake(iep, t0 + 1.0);
+    rtpp_tload_sleep(iep, t0 + 1.0, 0);
+    errx_ifnot(rtpp_tload_ent_getload(ep, t0 + 1.0) > 0.94);
+    errx_ifnot(rtpp_tload_ent_getload(iep, t0 + 1.0) < 0.01);
+
+    memset(&ovl, '\0', sizeof(ovl));
+    errx_ifnot(tlst_update(tlp, &ovl, t0 + 1.0) == 1);
+
+    /* Both go idle and never wake up again, last published load is stale */
+    rtpp_tload_sleep(ep, t0 + 1.0, 0);
+    errx_ifnot(atomic_load(&ep->load) > 0.94 * RTPP_TLOAD_SCALE);
+    errx_ifnot(tlst_update(tlp, &ovl, t0 + 1.05) == 1);
+    errx_ifnot(ovl.pressure > 0.85 && ovl.pressure < 0.95);
+    errx_ifnot(tlst_update(tlp, &ovl, t0 + 1.5) == 0);
+    errx_ifnot(ovl.pressure > 0.4 && ovl.pressure < 0.5);
+    errx_ifnot(tlst_update(tlp, &ovl, t0 + 2.5) == 0);
+    errx_ifnot(ovl.pressure == 0.0);
+
+    /* Once it wakes up, the owner publishes the idle window on its own */
+    rtpp_tload_wake(ep, t0 + 2.5);
+    errx_ifnot(atomic_load(&ep->load) == 0);
+
+    /* A single queue drop does not engage it, a sustained drop rate does */
+    memset(&ovl, '\0', sizeof(ovl));
+    memset(&agg, '\0', sizeof(agg));
+    agg.nitems = 1000;
+    errx_ifnot(rtpp_tload_ovl_update(&ovl, &agg, TLST_HIGH, TLST_LOW) == 0);
+    agg.nitems += 1000;
+    agg.ndrops += 1;
+    errx_ifnot(rtpp_tload_ovl_update(&ovl, &agg, TLST_HIGH, TLST_LOW) == 0);
+    errx_ifnot(ovl.drate > 0.0 && ovl.drate < RTPP_TLOAD_DRATE_TRS);
+    agg.nitems += 100;
+    agg.ndrops += 100;
+    errx_ifnot(rtpp_tload_ovl_update(&ovl, &agg, TLST_HIGH, TLST_LOW) == 1);
+    agg.nitems += 1000;
+    errx_ifnot(rtpp_tload_ovl_update(&ovl, &agg, TLST_HIGH, TLST_LOW) == 0);
+    errx_ifnot(ovl.drate == 0.0);
+
+    /* Queue length alone */
+    agg.qlen = RTPP_TLOAD_QLEN_TRS;
+    errx_ifnot(rtpp_tload_ovl_update(&ovl, &agg, TLST_HIGH, TLST_LOW) == 1);
+    agg.qlen = 0;
+    errx_ifnot(rtpp_tload_ovl_update(&ovl, &agg, TLST_HIGH, TLST_LOW) == 0);
+
+    CALL_SMETHOD(tlp, unreg, iep);
+    CALL_SMETHOD(tlp, unreg, ep);
+    RTPP_OBJ_DECREF(tlp);
+
+    rval = rtpp_memdeb_dumpstats(MEMDEB_SYM, 0);
+    return (rval);
+}
+#endif /* rtpp_tload_selftest */
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <stdatomic.h>
+
+struct rtpp_queue;
+struct rtpc_reply;
+
+/*
+ * Registry of the long-lived threads and their load. Each thread gets an
+ * entry, which it updates every time it goes to sleep (poll, cond wait,
+ * periodic timer) and wakes up. Counters are only ever written by the
+ * owner thread, so updates are just relaxed atomic stores. If the thread
+ * is fed by the rtpp_queue, the queue depth is sampled on report.
+ *
+ * The load is only published by the owner when it wakes up or goes to
+ * sleep, so a thread that has been blocked for a while would otherwise
+ * keep reporting whatever it had before. Readers therefore pass in the
+ * current time and the last value is scaled down by the portion of the
+ * window the thread has spent asleep since.
+ */
+
+#define RTPP_TLOAD_WIN    1.0   /* load averaging window, seconds */
+#define RTPP_TLOAD_SCALE  1000000
+#define RTPP_TLOAD_DRATE_TRS 0.01 /* queue drop rate that counts as full load */
+
+struct rtpp_tload_ent {
+    struct rtpp_tload *owner;
+    _Atomic(uint64_t) busy_us;
+    _Atomic(uint64_t) idle_us;
+    _Atomic(uint64_t) nwakeups;
+    _Atomic(uint64_t) nitems;
+    _Atomic(uint64_t) ndrops;
+    /* Busy/total ratio over the last complete window, RTPP_TLOAD_SCALE */
+    _Atomic(uint32_t) load;
+    /* When the owner went to sleep, usec, 0 while it is running */
+    _Atomic(uint64_t) sleep_us;
+    /* Owner thread private state */
+    double lts;
+    double wstart;
+    double wbusy;
+};
+
+/* Summary over a group of threads, see the aggregate() method */
+struct rtpp_tload_agg {
+    double load;           /* highest load in the group */
+    unsigned int qlen;     /* longest input queue in the group */
+    uint64_t nitems;       /* items processed by the group */
+    uint64_t ndrops;       /* items rejected by the full input queues */
+};
+
+/* Overload detector state, see rtpp_tload_ovl_update() */
+struct rtpp_tload_ovl {
+    int engaged;
+    double pressure;       /* as of the last update */
+    double drate;          /* drops / (items + drops) since the last update */
+    uint64_t nitems;
+    uint64_t ndrops;
+};
+
+DECLARE_CLASS(rtpp_tload, void);
+
+DECLARE_METHOD(rtpp_tload, rtpp_tload_reg, struct rtpp_tload_ent *,
+  const char *, struct rtpp_queue *);
+DECLARE_METHOD(rtpp_tload, rtpp_tload_unreg, void, struct rtpp_tload_ent *);
+DECLARE_METHOD(rtpp_tload, rtpp_tload_get_load, double, const char *);
+DECLARE_METHOD(rtpp_tload, rtpp_tload_aggregate, void, const char *,
+  double, struct rtpp_tload_agg *);
+DECLARE_METHOD(rtpp_tload, rtpp_tload_report, int, struct rtpc_reply *);
+
+DECLARE_SMETHODS(rtpp_tload)
+{
+    METHOD_ENTRY(rtpp_tload_reg, reg);
+    METHOD_ENTRY(rtpp_tload_unreg, unreg);
+    METHOD_ENTRY(rtpp_tload_get_load, get_load);
+    METHOD_ENTRY(rtpp_tload_aggregate, aggregate);
+    METHOD_ENTRY(rtpp_tload_report, report);
+};
+
+DECLARE_CLASS_PUBTYPE(rtpp_tload, {});
+
+int rtpp_tload_ovl_update(struct rtpp_tload_ovl *,
+  const struct rtpp_tload_agg *, double, double);
+
+static inline void
+rtpp_tload_updwin(struct rtpp_tload_ent *ep, double now)
+{
+    double wlen;
+
+    wlen = now - ep->wstart;
+    if (wlen < RTPP_TLOAD_WIN)
+        return;
+    atomic_store_explicit(&ep->load,
+      (uint32_t)(ep->wbusy / wlen * RTPP_TLOAD_SCALE), memory_order_relaxed);
+    ep->wstart = now;
+    ep->wbusy = 0.0;
+}
+
+/* Called by the owner thread right after it has been woken up */
+static inline void
+rtpp_tload_wake(struct rtpp_tload_ent *ep, double now)
+{
+
+    if (ep == NULL)
+        return;
+    atomic_fetch_add_explicit(&ep->idle_us, (uint64_t)((now - ep->lts) * 1e6),
+      memory_order_relaxed);
+    atomic_fetch_add_explicit(&ep->nwakeups, 1, memory_order_relaxed);
+    atomic_store_explicit(&ep->sleep_us, 0, memory_order_relaxed);
+    ep->lts = now;
+    rtpp_tload_updwin(ep, now);
+}
+
+/* Called by the owner thread right before it blocks */
+static inline void
+rtpp_tload_sleep(struct rtpp_tload_ent *ep, double now, unsigned int nitems)
+{
+    double busy;
+
+    if (ep == NULL)
+        return;
+    busy = now - ep->lts;
+    atomic_fetch_add_explicit(&ep->busy_us, (uint64_t)(busy * 1e6),
+      memory_order_relaxed);
+    if (nitems > 0)
+        atomic_fetch_add_explicit(&ep->nitems, nitems, memory_order_relaxed);
+    ep->lts = now;
+    ep->wbusy += busy;
+    rtpp_tload_updwin(ep, now);
+    atomic_store_explicit(&ep->sleep_us, (uint64_t)(now * 1e6),
+      memory_order_relaxed);
+}
+
+/*
+ * Called by the owner thread when it had to give up on some items for
+ * reasons other than the load (i.e. send errors), informational only.
+ */
+static inline void
+rtpp_tload_drop(struct rtpp_tload_ent *ep, unsigned int nitems)
+{
+
+    if (ep == NULL)
+        return;
+    atomic_fetch_add_explicit(&ep->ndrops, nitems, memory_order_relaxed);
+}
+
+static inline double
+rtpp_tload_ent_getload(struct rtpp_tload_ent *ep, double now)
+{
+    double load, asleep;
+    uint64_t sleep_us;
+
+    if (ep == NULL)
+        return (0.0);
+    load = (double)atomic_load_explicit(&ep->load, memory_order_relaxed) /
+      RTPP_TLOAD_SCALE;
+    sleep_us = atomic_load_explicit(&ep->sleep_us, memory_order_relaxed);
+    if (sleep_us == 0)
+        return (load);
+    asleep = now - (double)sleep_us / 1e6;
+    if (asleep >= RTPP_TLOAD_WIN)
+        return (0.0);
+    if (asleep > 0.0)
+        load *= (RTPP_TLOAD_WIN - asleep) / RTPP_TLOAD_WIN;
+    return (load);
+}
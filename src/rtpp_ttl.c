@@ -43,17 +43,22 @@ struct rtpp_ttl_priv {
     int ttl;
     pthread_mutex_t lock;
 };
+const size_t rtpp_ttl_osize = sizeof(struct rtpp_ttl_priv);
 
 static void rtpp_ttl_dtor(struct rtpp_ttl_priv *);
 static void rtpp_ttl_reset(struct rtpp_ttl *);
 static void rtpp_ttl_reset_with(struct rtpp_ttl *, int);
 static int rtpp_ttl_get_remaining(struct rtpp_ttl *);
+static int rtpp_ttl_get_max(struct rtpp_ttl *);
+static void rtpp_ttl_restore(struct rtpp_ttl *, int, int);
 static int rtpp_ttl_decr(struct rtpp_ttl *);
 
 DEFINE_SMETHODS(rtpp_ttl,
     .reset = &rtpp_ttl_reset,
     .reset_with = &rtpp_ttl_reset_with,
     .get_remaining = &rtpp_ttl_get_remaining,
+    .get_max = &rtpp_ttl_get_max,
+    .restore = &rtpp_ttl_restore,
     .decr = &rtpp_ttl_decr,
 );
 
@@ -80,6 +85,33 @@ e0:
     return (NULL);
 }
 
+struct rtpp_ttl *
+rtpp_ttl_ctor_pa(void *pap, struct rtpp_refcnt *rcnt, int max_ttl)
+{
+    struct rtpp_ttl_priv *pvt;
+
+    pvt = (struct rtpp_ttl_priv *)pap;
+    if (pthread_mutex_init(&pvt->lock, NULL) != 0) {
+        return (NULL);
+    }
+    pvt->ttl = pvt->max_ttl = max_ttl;
+    pvt->pub.rcnt = rcnt;
+#if defined(RTPP_DEBUG)
+    pvt->pub.smethods = GET_SMETHODS(&pvt->pub);
+#endif
+    return ((&pvt->pub));
+}
+
+void
+rtpp_ttl_dtor_pa(struct rtpp_ttl *pub)
+{
+    struct rtpp_ttl_priv *pvt;
+
+    PUB2PVT(pub, pvt);
+    rtpp_ttl_fin(pub);
+    pthread_mutex_destroy(&pvt->lock);
+}
+
 static void
 rtpp_ttl_dtor(struct rtpp_ttl_priv *pvt)
 {
@@ -125,6 +157,31 @@ rtpp_ttl_get_remaining(struct rtpp_ttl *self)
     return (rval);
 }
 
+static int
+rtpp_ttl_get_max(struct rtpp_ttl *self)
+{
+    struct rtpp_ttl_priv *pvt;
+    int rval;
+
+    PUB2PVT(self, pvt);
+    pthread_mutex_lock(&pvt->lock);
+    rval = pvt->max_ttl;
+    pthread_mutex_unlock(&pvt->lock);
+    return (rval);
+}
+
+static void
+rtpp_ttl_restore(struct rtpp_ttl *self, int ttl, int max_ttl)
+{
+    struct rtpp_ttl_priv *pvt;
+
+    PUB2PVT(self, pvt);
+    pthread_mutex_lock(&pvt->lock);
+    pvt->ttl = ttl;
+    pvt->max_ttl = max_ttl;
+    pthread_mutex_unlock(&pvt->lock);
+}
+
 static int
 rtpp_ttl_decr(struct rtpp_ttl *self)
 {
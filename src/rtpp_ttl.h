@@ -33,6 +33,8 @@ DECLARE_CLASS(rtpp_ttl, int);
 DECLARE_METHOD(rtpp_ttl, rtpp_ttl_reset, void);
 DECLARE_METHOD(rtpp_ttl, rtpp_ttl_reset_with, void, int);
 DECLARE_METHOD(rtpp_ttl, rtpp_ttl_get_remaining, int);
+DECLARE_METHOD(rtpp_ttl, rtpp_ttl_get_max, int);
+DECLARE_METHOD(rtpp_ttl, rtpp_ttl_restore, void, int, int);
 DECLARE_METHOD(rtpp_ttl, rtpp_ttl_decr, int);
 
 DECLARE_SMETHODS(rtpp_ttl)
@@ -40,7 +42,16 @@ DECLARE_SMETHODS(rtpp_ttl)
     METHOD_ENTRY(rtpp_ttl_reset, reset);
     METHOD_ENTRY(rtpp_ttl_reset_with, reset_with);
     METHOD_ENTRY(rtpp_ttl_get_remaining, get_remaining);
+    METHOD_ENTRY(rtpp_ttl_get_max, get_max);
+    METHOD_ENTRY(rtpp_ttl_restore, restore);
     METHOD_ENTRY(rtpp_ttl_decr, decr);
 };
 
 DECLARE_CLASS_PUBTYPE(rtpp_ttl, {});
+
+struct rtpp_refcnt;
+
+/* Storage and refcount provided by the owner, see rtpp_session.c */
+extern const size_t rtpp_ttl_osize;
+struct rtpp_ttl *rtpp_ttl_ctor_pa(void *, struct rtpp_refcnt *, int);
+void rtpp_ttl_dtor_pa(struct rtpp_ttl *);
@@ -109,6 +109,7 @@ extern const struct rtpp_dtls_conn_smethods * const rtpp_dtls_conn_smethods;
 extern const struct rtpp_socket_smethods * const rtpp_socket_smethods;
 extern const struct rtpp_refproxy_smethods * const rtpp_refproxy_smethods RTPP_EXPORT;
 extern const struct rtpc_reply_smethods * const rtpc_reply_smethods;
+extern const struct rtpp_tload_smethods * const rtpp_tload_smethods;
 
 #define GET_SMETHODS(obj) _Generic((obj), \
     struct rtpp_refcnt *: rtpp_refcnt_smethods, \
@@ -135,7 +136,8 @@ extern const struct rtpc_reply_smethods * const rtpc_reply_smethods;
     struct rtpp_dtls_conn *: rtpp_dtls_conn_smethods, \
     struct rtpp_socket *: rtpp_socket_smethods, \
     struct rtpp_refproxy *: rtpp_refproxy_smethods, \
-    struct rtpc_reply *: rtpc_reply_smethods \
+    struct rtpc_reply *: rtpc_reply_smethods, \
+    struct rtpp_tload *: rtpp_tload_smethods \
 )
 
 #if defined(RTPP_DEBUG)
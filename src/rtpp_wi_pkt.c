@@ -49,6 +49,7 @@
 struct rtpp_wi_sendto {
     struct rtpp_wi_pvt wip;
     struct sockaddr_storage to;
+    struct rtpp_refcnt *sock_rcnt;
     char msg[0];
 };
 
@@ -76,6 +77,7 @@ rtpp_wi_malloc(int sock, const void *msg, size_t msg_len, int flags,
         .msg_len = msg_len,
         .tolen = tolen
     };
+    wis->sock_rcnt = NULL;
     memcpy(wis->msg, msg, msg_len);
     memcpy(&(wis->to), sendto, tolen);
     CALL_SMETHOD(wis->wip.pub.rcnt, attach, (rtpp_refcnt_dtor_t)&rtpp_wi_free,
@@ -105,6 +107,7 @@ rtpp_wi_malloc_na(int sock, const void *msg, size_t msg_len, int flags,
         .tolen = tolen,
         .aux_rcnt = data_rcnt,
     };
+    wis->sock_rcnt = NULL;
     memcpy(&(wis->to), sendto, tolen);
     CALL_SMETHOD(wis->wip.pub.rcnt, attach, (rtpp_refcnt_dtor_t)&rtpp_wi_free,
       wis);
@@ -138,9 +141,51 @@ rtpp_wi_malloc_pkt_na(int sock, struct rtp_packet *pkt,
     return (&(wipp->pub));
 }
 
+/*
+ * Allocate work item to send payload of the packet to the specified
+ * address without copying it. The packet is referenced, not consumed,
+ * so the same packet can be queued to any number of destinations. The
+ * caller must make sure packet data is not modified until all of them
+ * are sent out. The optional sock_rcnt keeps the socket alive meanwhile.
+ */
+struct rtpp_wi *
+rtpp_wi_malloc_fwd(int sock, struct rtp_packet *pkt,
+  const struct sockaddr *sendto, size_t tolen, struct rtpp_refcnt *sock_rcnt)
+{
+    struct rtpp_wi_sendto *wis;
+
+    wis = rtpp_rmalloc(sizeof(struct rtpp_wi_sendto), PVT_RCOFFS(&wis->wip));
+    if (wis == NULL) {
+        return (NULL);
+    }
+    wis->wip = (const struct rtpp_wi_pvt) {
+        .pub.wi_type = RTPP_WI_TYPE_OPKT,
+        .pub.rcnt = wis->wip.pub.rcnt,
+        .nsend = 1,
+        .sock = sock,
+        .msg = pkt->data.buf,
+        .sendto = sstosa(&(wis->to)),
+        .msg_len = pkt->size,
+        .tolen = tolen,
+        .aux_rcnt = pkt->rcnt,
+    };
+    RC_INCREF(pkt->rcnt);
+    wis->sock_rcnt = sock_rcnt;
+    if (sock_rcnt != NULL) {
+        RC_INCREF(sock_rcnt);
+    }
+    memcpy(&(wis->to), sendto, tolen);
+    CALL_SMETHOD(wis->wip.pub.rcnt, attach, (rtpp_refcnt_dtor_t)&rtpp_wi_free,
+      wis);
+    return (&(wis->wip.pub));
+}
+
 static void
 rtpp_wi_free(struct rtpp_wi_sendto *wis)
 {
+    if (wis->sock_rcnt != NULL) {
+        RC_DECREF(wis->sock_rcnt);
+    }
     rtpp_wi_pkt_free(&wis->wip);
     free(wis);
 }
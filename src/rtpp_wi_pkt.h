@@ -40,5 +40,7 @@ struct rtpp_wi *rtpp_wi_malloc_na(int, const void *, size_t, int,
   const struct sockaddr *, size_t, struct rtpp_refcnt *);
 struct rtpp_wi *rtpp_wi_malloc_pkt_na(int, struct rtp_packet *,
   struct rtpp_netaddr *, int, struct rtpp_refcnt *);
+struct rtpp_wi *rtpp_wi_malloc_fwd(int, struct rtp_packet *,
+  const struct sockaddr *, size_t, struct rtpp_refcnt *);
 
 #endif
@@ -41,6 +41,9 @@ struct rtpp_wi_pvt {
     socklen_t tolen;
     const void *msg;
     int nsend;
+    /* Time the item has been queued and the packet has been received (if known) */
+    double etime;
+    double rtime;
     int debug;
     struct rtpp_log *log;
     char data[0];
@@ -0,0 +1,718 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+
+#include "rtpp_types.h"
+#include "rtpp_defines.h"
+#include "rtpp_list.h"
+#include "rtpp_log.h"
+#include "rtpp_log_obj.h"
+#include "rtpp_cfg.h"
+#include "rtpp_command.h"
+#include "rtpp_command_args.h"
+#include "rtpp_command_async.h"
+#include "rtpp_command_sub.h"
+#include "rtpp_command_private.h"
+#include "rtpp_controlfd.h"
+#include "rtpp_bindaddrs.h"
+#include "rtpp_codeptr.h"
+#include "rtpp_refcnt.h"
+#include "rtpp_hash_table.h"
+#include "rtpp_weakref.h"
+#include "rtpp_network.h"
+#include "rtpp_time.h"
+#include "rtpp_pipe.h"
+#include "rtpp_pcount.h"
+#include "rtpp_proc_async.h"
+#include "rtpp_sessinfo.h"
+#include "rtpp_session.h"
+#include "rtpp_socket.h"
+#include "rtpp_stream.h"
+#include "rtpp_ttl.h"
+#include "rtpp_debug.h"
+#include "rtpp_wrestart.h"
+
+#define RTPP_WR_MAGIC   0x52575253      /* "RWRS" */
+#define RTPP_WR_TOUT    10              /* Per-record I/O timeout, seconds */
+#define RTPP_WR_MAXFDS  4               /* RTP and RTCP for both sides */
+
+enum rtpp_wr_rtype {
+    RTPP_WR_CTRL = 1,   /* Control socket, predecessor -> successor */
+    RTPP_WR_SESS,       /* Session, predecessor -> successor */
+    RTPP_WR_END,        /* End of the CTRL or SESS run */
+    RTPP_WR_READY,      /* Successor is ready to take the sessions over */
+    RTPP_WR_DONE        /* Successor has restored all sessions */
+};
+
+struct rtpp_wr_hdr {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t type;
+    uint32_t dlen;
+};
+
+/* Followed by the cmd_sock string, descriptors in the SCM_RIGHTS */
+struct rtpp_wr_ctrl {
+    int type;
+};
+
+struct rtpp_wr_side {
+    struct sockaddr_storage laddr;
+    int port;
+    int ttl;
+    int max_ttl;
+    int hasfds;
+    struct rtpp_stream_snap rtp;
+    struct rtpp_stream_snap rtcp;
+};
+
+/*
+ * Followed by the call_id and from_tag, RTP and RTCP descriptors of each
+ * side that has them in the SCM_RIGHTS.
+ */
+struct rtpp_wr_sess {
+    uint32_t call_id_len;
+    uint32_t from_tag_len;
+    int strong;
+    int complete;
+    struct rtpps_pcount pcount[2];
+    struct rtpp_wr_side side[2];
+};
+
+#define RTPP_WR_BUFLEN  (sizeof(struct rtpp_wr_sess) + 2 * RTPP_CMD_BUFLEN)
+
+union rtpp_wr_cmsg {
+    struct cmsghdr cm;
+    char buf[CMSG_SPACE(sizeof(int) * RTPP_WR_MAXFDS)];
+};
+
+struct rtpp_wr_send_args {
+    int s;
+    int nsess;
+    int nfail;
+};
+
+static int
+rtpp_wr_setaddr(const struct rtpp_cfg *cfsp, struct sockaddr_un *ifsun)
+{
+
+    if (strlen(cfsp->wrestart_sock) >= sizeof(ifsun->sun_path)) {
+        errno = ENAMETOOLONG;
+        return (-1);
+    }
+    memset(ifsun, '\0', sizeof(struct sockaddr_un));
+#if defined(HAVE_SOCKADDR_SUN_LEN)
+    ifsun->sun_len = strlen(cfsp->wrestart_sock);
+#endif
+    ifsun->sun_family = AF_LOCAL;
+    strcpy(ifsun->sun_path, cfsp->wrestart_sock);
+    return (0);
+}
+
+static int
+rtpp_wr_settout(int s)
+{
+    struct timeval tv = {.tv_sec = RTPP_WR_TOUT};
+
+    if (setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) != 0)
+        return (-1);
+    return (setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)));
+}
+
+/*
+ * Send a record made of iov[1]...iov[iovcnt - 1], iov[0] is filled with
+ * the header.
+ */
+static int
+rtpp_wr_send(int s, enum rtpp_wr_rtype type, struct iovec *iov, int iovcnt,
+  const int *fds, int nfds)
+{
+    struct rtpp_wr_hdr hdr;
+    struct msghdr msg;
+    union rtpp_wr_cmsg cmsgbuf;
+    struct cmsghdr *cmsg;
+    int i;
+
+    RTPP_DBG_ASSERT(nfds <= RTPP_WR_MAXFDS);
+    memset(&hdr, '\0', sizeof(hdr));
+    hdr.magic = RTPP_WR_MAGIC;
+    hdr.version = RTPP_WR_VERSION;
+    hdr.type = type;
+    for (i = 1; i < iovcnt; i++)
+        hdr.dlen += iov[i].iov_len;
+    iov[0].iov_base = &hdr;
+    iov[0].iov_len = sizeof(hdr);
+
+    memset(&msg, '\0', sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+    if (nfds > 0) {
+        memset(&cmsgbuf, '\0', sizeof(cmsgbuf));
+        msg.msg_control = cmsgbuf.buf;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * nfds);
+    }
+    if (sendmsg(s, &msg, 0) < 0)
+        return (-1);
+    return (0);
+}
+
+static int
+rtpp_wr_send_simple(int s, enum rtpp_wr_rtype type)
+{
+    struct iovec iov[1];
+
+    return (rtpp_wr_send(s, type, iov, 1, NULL, 0));
+}
+
+/*
+ * Receive one record, returns its type or -1 on error. Any descriptors
+ * that came with the record are stored in fds and become the property
+ * of the caller.
+ */
+static int
+rtpp_wr_recv(int s, void *buf, size_t blen, size_t *dlenp, int *fds,
+  int *nfdsp)
+{
+    struct rtpp_wr_hdr hdr;
+    struct iovec iov[2];
+    struct msghdr msg;
+    union rtpp_wr_cmsg cmsgbuf;
+    struct cmsghdr *cmsg;
+    ssize_t rlen;
+    int i, n;
+
+    iov[0].iov_base = &hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = buf;
+    iov[1].iov_len = blen;
+    memset(&msg, '\0', sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    msg.msg_control = cmsgbuf.buf;
+    msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+    *nfdsp = 0;
+    rlen = recvmsg(s, &msg, 0);
+    if (rlen <= 0) {
+        if (rlen == 0)
+            errno = ECONNRESET;
+        return (-1);
+    }
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+      cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            continue;
+        n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        if (*nfdsp + n > RTPP_WR_MAXFDS)
+            n = RTPP_WR_MAXFDS - *nfdsp;
+        memcpy(fds + *nfdsp, CMSG_DATA(cmsg), sizeof(int) * n);
+        *nfdsp += n;
+    }
+    if ((msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) != 0 ||
+      (size_t)rlen < sizeof(hdr) || hdr.magic != RTPP_WR_MAGIC ||
+      hdr.version != RTPP_WR_VERSION || hdr.dlen != rlen - sizeof(hdr)) {
+        for (i = 0; i < *nfdsp; i++)
+            close(fds[i]);
+        *nfdsp = 0;
+        errno = EINVAL;
+        return (-1);
+    }
+    *dlenp = hdr.dlen;
+    return (hdr.type);
+}
+
+static int
+rtpp_wr_expect(int s, enum rtpp_wr_rtype type)
+{
+    struct rtpp_wr_hdr buf;
+    size_t dlen;
+    int fds[RTPP_WR_MAXFDS], nfds, rtype, i;
+
+    rtype = rtpp_wr_recv(s, &buf, sizeof(buf), &dlen, fds, &nfds);
+    for (i = 0; i < nfds; i++)
+        close(fds[i]);
+    if (rtype < 0)
+        return (-1);
+    if (rtype != type || dlen != 0) {
+        errno = EINVAL;
+        return (-1);
+    }
+    return (0);
+}
+
+static int
+rtpp_wr_send_ctrls(const struct rtpp_cfg *cfsp, int s)
+{
+    struct rtpp_ctrl_sock *ctrl_sock;
+    struct rtpp_wr_ctrl wc;
+    struct iovec iov[3];
+    int fds[2], nfds;
+
+    for (ctrl_sock = RTPP_LIST_HEAD(cfsp->ctrl_socks);
+      ctrl_sock != NULL; ctrl_sock = RTPP_ITER_NEXT(ctrl_sock)) {
+        if (ctrl_sock->type == RTPC_STDIO)
+            continue;
+        memset(&wc, '\0', sizeof(wc));
+        wc.type = ctrl_sock->type;
+        fds[0] = ctrl_sock->controlfd_in;
+        nfds = 1;
+        if (ctrl_sock->controlfd_out != ctrl_sock->controlfd_in)
+            fds[nfds++] = ctrl_sock->controlfd_out;
+        iov[1].iov_base = &wc;
+        iov[1].iov_len = sizeof(wc);
+        iov[2].iov_base = (void *)ctrl_sock->cmd_sock;
+        iov[2].iov_len = strlen(ctrl_sock->cmd_sock);
+        if (rtpp_wr_send(s, RTPP_WR_CTRL, iov, 3, fds, nfds) != 0)
+            return (-1);
+    }
+    return (rtpp_wr_send_simple(s, RTPP_WR_END));
+}
+
+static int
+rtpp_wr_ctrl_take(struct rtpp_cfg *cfsp, const void *buf, size_t dlen,
+  const int *fds, int nfds)
+{
+    const struct rtpp_wr_ctrl *wcp;
+    const char *cmd_sock;
+    struct rtpp_ctrl_sock *ctrl_sock;
+    size_t clen;
+    socklen_t alen;
+    int i;
+
+    if (dlen < sizeof(*wcp) || nfds < 1 || nfds > 2) {
+        errno = EINVAL;
+        return (-1);
+    }
+    wcp = buf;
+    cmd_sock = (const char *)(wcp + 1);
+    clen = dlen - sizeof(*wcp);
+    for (ctrl_sock = RTPP_LIST_HEAD(cfsp->ctrl_socks);
+      ctrl_sock != NULL; ctrl_sock = RTPP_ITER_NEXT(ctrl_sock)) {
+        if (ctrl_sock->type != wcp->type || ctrl_sock->inherited != 0)
+            continue;
+        if (strlen(ctrl_sock->cmd_sock) != clen ||
+          memcmp(ctrl_sock->cmd_sock, cmd_sock, clen) != 0)
+            continue;
+        ctrl_sock->controlfd_in = fds[0];
+        ctrl_sock->controlfd_out = fds[nfds - 1];
+        alen = sizeof(ctrl_sock->bindaddr);
+        getsockname(fds[0], sstosa(&ctrl_sock->bindaddr), &alen);
+        ctrl_sock->inherited = 1;
+        return (0);
+    }
+    /* Not in our configuration, let it go */
+    for (i = 0; i < nfds; i++)
+        close(fds[i]);
+    return (0);
+}
+
+static int
+rtpp_wr_sess_save(int s, struct rtpp_session *sp)
+{
+    struct rtpp_wr_sess ws;
+    struct rtpp_wr_side *wsp;
+    struct rtpp_socket *skts[RTPP_WR_MAXFDS];
+    struct iovec iov[4];
+    int fds[RTPP_WR_MAXFDS], nfds, i, rval;
+
+    memset(&ws, '\0', sizeof(ws));
+    ws.call_id_len = sp->call_id->len;
+    ws.from_tag_len = sp->from_tag->len;
+    ws.strong = sp->strong;
+    ws.complete = sp->complete;
+    CALL_SMETHOD(sp->rtp->pcount, get_stats, &ws.pcount[0]);
+    CALL_SMETHOD(sp->rtcp->pcount, get_stats, &ws.pcount[1]);
+    nfds = 0;
+    for (i = 0; i < 2; i++) {
+        wsp = &ws.side[i];
+        memcpy(&wsp->laddr, sp->rtp->stream[i]->laddr,
+          SA_LEN(sp->rtp->stream[i]->laddr));
+        wsp->port = sp->rtp->stream[i]->port;
+        wsp->ttl = CALL_SMETHOD(sp->rtp->stream[i]->ttl, get_remaining);
+        wsp->max_ttl = CALL_SMETHOD(sp->rtp->stream[i]->ttl, get_max);
+        CALL_SMETHOD(sp->rtp->stream[i], save_state, &wsp->rtp);
+        CALL_SMETHOD(sp->rtcp->stream[i], save_state, &wsp->rtcp);
+        skts[nfds] = CALL_SMETHOD(sp->rtp->stream[i], get_skt, HEREVAL);
+        if (skts[nfds] == NULL)
+            continue;
+        skts[nfds + 1] = CALL_SMETHOD(sp->rtcp->stream[i], get_skt, HEREVAL);
+        if (skts[nfds + 1] == NULL) {
+            RTPP_OBJ_DECREF(skts[nfds]);
+            continue;
+        }
+        fds[nfds] = CALL_SMETHOD(skts[nfds], getfd);
+        fds[nfds + 1] = CALL_SMETHOD(skts[nfds + 1], getfd);
+        nfds += 2;
+        wsp->hasfds = 1;
+    }
+    iov[1].iov_base = &ws;
+    iov[1].iov_len = sizeof(ws);
+    iov[2].iov_base = (void *)sp->call_id->s;
+    iov[2].iov_len = sp->call_id->len;
+    iov[3].iov_base = (void *)sp->from_tag->s;
+    iov[3].iov_len = sp->from_tag->len;
+    rval = rtpp_wr_send(s, RTPP_WR_SESS, iov, 4, fds, nfds);
+    for (i = 0; i < nfds; i++)
+        RTPP_OBJ_DECREF(skts[i]);
+    return (rval);
+}
+
+static int
+rtpp_wr_sess_send(void *dp, void *ap)
+{
+    struct rtpp_session *sp;
+    struct rtpp_wr_send_args *wap;
+
+    sp = (struct rtpp_session *)dp;
+    wap = (struct rtpp_wr_send_args *)ap;
+    if (rtpp_wr_sess_save(wap->s, sp) != 0) {
+        wap->nfail++;
+        return (RTPP_WR_MATCH_BRK);
+    }
+    /* Keep the TTL thread and the destructor off it from now on */
+    sp->handed_off = 1;
+    wap->nsess++;
+    return (RTPP_WR_MATCH_CONT);
+}
+
+static int
+rtpp_wr_sess_reclaim(void *dp, void *ap)
+{
+    struct rtpp_session *sp;
+
+    sp = (struct rtpp_session *)dp;
+    sp->handed_off = 0;
+    return (RTPP_WR_MATCH_CONT);
+}
+
+/*
+ * Re-create the session in this process around the received sockets,
+ * takes over the descriptors in all cases.
+ */
+static int
+rtpp_wr_sess_restore(struct rtpp_cfg *cfsp, const void *buf, size_t dlen,
+  int *fds, int nfds, const struct rtpp_timestamp *dtime)
+{
+    const struct rtpp_wr_sess *wsp;
+    struct rtpp_socket *skts[2][2] = {{NULL, NULL}, {NULL, NULL}};
+    const struct sockaddr *lia[2];
+    struct common_cmd_args cca;
+    struct rtpp_session *spa;
+    struct rtpp_hash_table_entry *hte;
+    const char *errmsg;
+    int i, j, k;
+
+    wsp = buf;
+    if (dlen < sizeof(*wsp) || wsp->side[0].hasfds == 0 ||
+      dlen != sizeof(*wsp) + wsp->call_id_len + wsp->from_tag_len ||
+      nfds != 2 * (wsp->side[0].hasfds + wsp->side[1].hasfds))
+        goto e0;
+    rtpp_str_t call_id = {.s = (const char *)(wsp + 1),
+      .len = wsp->call_id_len};
+    rtpp_str_t from_tag = {.s = call_id.s + call_id.len,
+      .len = wsp->from_tag_len};
+    for (i = 0; i < 2; i++) {
+        lia[i] = CALL_METHOD(cfsp->bindaddrs_cf, addr2,
+          sstosa(&wsp->side[i].laddr), &errmsg);
+        if (lia[i] == NULL)
+            goto e0;
+    }
+    for (i = k = 0; i < 2; i++) {
+        if (wsp->side[i].hasfds == 0)
+            continue;
+        for (j = 0; j < 2; j++, k++) {
+            skts[i][j] = rtpp_socket_ctor_fd(cfsp->rtpp_proc_cf->netio, fds[k]);
+            if (skts[i][j] == NULL)
+                goto e1;
+            fds[k] = -1;
+            if (CALL_SMETHOD(skts[i][j], setnonblock) < 0)
+                goto e1;
+            CALL_SMETHOD(skts[i][j], settimestamp);
+        }
+    }
+
+    memset(&cca, '\0', sizeof(cca));
+    cca.call_id = &call_id;
+    cca.from_tag = &from_tag;
+    spa = rtpp_session_ctor(cfsp, &cca, dtime, lia, wsp->strong == 0,
+      wsp->side[0].port, skts[0]);
+    if (spa == NULL)
+        goto e1;
+    if (wsp->side[1].hasfds != 0) {
+        CALL_SMETHOD(cfsp->sessinfo, append, spa, 1, skts[1]);
+        CALL_METHOD(cfsp->rtpp_proc_cf, nudge, spa->shard);
+        spa->rtp->stream[1]->port = wsp->side[1].port;
+        spa->rtcp->stream[1]->port = wsp->side[1].port + 1;
+    }
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < 2; j++) {
+            if (skts[i][j] != NULL)
+                RTPP_OBJ_DECREF(skts[i][j]);
+        }
+    }
+    spa->complete = wsp->complete;
+    spa->strong = wsp->strong;
+    for (i = 0; i < 2; i++) {
+        CALL_SMETHOD(spa->rtp->stream[i]->ttl, restore, wsp->side[i].ttl,
+          wsp->side[i].max_ttl);
+        CALL_SMETHOD(spa->rtp->stream[i], restore_state, &wsp->side[i].rtp);
+        CALL_SMETHOD(spa->rtcp->stream[i], restore_state, &wsp->side[i].rtcp);
+    }
+    CALL_SMETHOD(spa->rtp->pcount, add_stats, &wsp->pcount[0]);
+    CALL_SMETHOD(spa->rtcp->pcount, add_stats, &wsp->pcount[1]);
+
+    hte = CALL_SMETHOD(cfsp->sessions_ht, append_str_refcnt, spa->call_id,
+      spa->rcnt, NULL);
+    if (hte == NULL)
+        goto e2;
+    if (CALL_SMETHOD(cfsp->sessions_wrt, reg, spa->rcnt, spa->seuid) != 0) {
+        CALL_SMETHOD(cfsp->sessions_ht, remove_str, spa->call_id, hte);
+        goto e2;
+    }
+    RTPP_LOG(spa->log, RTPP_LOG_INFO, "session on ports %d/%d taken over, "
+      "tag %.*s", spa->rtp->stream[0]->port, spa->rtp->stream[1]->port,
+      FMTSTR(spa->from_tag));
+    RTPP_OBJ_DECREF(spa);
+    return (0);
+
+e2:
+    RTPP_OBJ_DECREF(spa);
+    return (-1);
+e1:
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < 2; j++) {
+            if (skts[i][j] != NULL)
+                RTPP_OBJ_DECREF(skts[i][j]);
+        }
+    }
+e0:
+    for (i = 0; i < nfds; i++) {
+        if (fds[i] >= 0)
+            close(fds[i]);
+    }
+    return (-1);
+}
+
+/*
+ * Connect to the predecessor and take over its control sockets. Returns
+ * the connection to be passed into rtpp_wrestart_restore() later on, or -1
+ * with errno set to ENOENT or ECONNREFUSED if there is nobody to take over
+ * from.
+ */
+int
+rtpp_wrestart_attach(struct rtpp_cfg *cfsp)
+{
+    struct sockaddr_un ifsun;
+    void *buf;
+    size_t dlen;
+    int s, fds[RTPP_WR_MAXFDS], nfds, rtype, serrno;
+
+    if (rtpp_wr_setaddr(cfsp, &ifsun) != 0)
+        return (-1);
+    s = socket(AF_LOCAL, SOCK_SEQPACKET, 0);
+    if (s < 0)
+        return (-1);
+    if (connect(s, (struct sockaddr *)&ifsun, sizeof(ifsun)) != 0)
+        goto e0;
+    if (rtpp_wr_settout(s) != 0)
+        goto e0;
+    buf = malloc(RTPP_WR_BUFLEN);
+    if (buf == NULL)
+        goto e0;
+    for (;;) {
+        rtype = rtpp_wr_recv(s, buf, RTPP_WR_BUFLEN, &dlen, fds, &nfds);
+        if (rtype == RTPP_WR_END && nfds == 0)
+            break;
+        if (rtype == RTPP_WR_CTRL &&
+          rtpp_wr_ctrl_take(cfsp, buf, dlen, fds, nfds) == 0)
+            continue;
+        for (int i = 0; i < nfds; i++)
+            close(fds[i]);
+        if (rtype >= 0)
+            errno = EINVAL;
+        goto e1;
+    }
+    free(buf);
+    return (s);
+e1:
+    free(buf);
+e0:
+    serrno = errno;
+    close(s);
+    errno = serrno;
+    return (-1);
+}
+
+/*
+ * Tell the predecessor we are up and running and receive its sessions.
+ * Consumes the connection, returns the number of sessions restored or -1.
+ */
+int
+rtpp_wrestart_restore(struct rtpp_cfg *cfsp, int s)
+{
+    struct rtpp_timestamp dtime;
+    void *buf;
+    size_t dlen;
+    int fds[RTPP_WR_MAXFDS], nfds, rtype, nsess;
+
+    nsess = 0;
+    buf = malloc(RTPP_WR_BUFLEN);
+    if (buf == NULL)
+        goto e0;
+    if (rtpp_wr_send_simple(s, RTPP_WR_READY) != 0)
+        goto e1;
+    rtpp_timestamp_get(&dtime);
+    for (;;) {
+        rtype = rtpp_wr_recv(s, buf, RTPP_WR_BUFLEN, &dlen, fds, &nfds);
+        if (rtype == RTPP_WR_END && nfds == 0)
+            break;
+        if (rtype != RTPP_WR_SESS) {
+            for (int i = 0; i < nfds; i++)
+                close(fds[i]);
+            goto e1;
+        }
+        if (rtpp_wr_sess_restore(cfsp, buf, dlen, fds, nfds, &dtime) != 0) {
+            RTPP_LOG(cfsp->glog, RTPP_LOG_ERR, "warm restart: can't restore "
+              "session #%d", nsess + 1);
+            goto e1;
+        }
+        nsess++;
+    }
+    if (rtpp_wr_send_simple(s, RTPP_WR_DONE) != 0)
+        goto e1;
+    free(buf);
+    close(s);
+    RTPP_LOG(cfsp->glog, RTPP_LOG_INFO, "warm restart: %d session(s) taken "
+      "over from the predecessor", nsess);
+    return (nsess);
+e1:
+    free(buf);
+e0:
+    close(s);
+    return (-1);
+}
+
+int
+rtpp_wrestart_listen(const struct rtpp_cfg *cfsp)
+{
+    struct sockaddr_un ifsun;
+    int s, flags;
+
+    if (rtpp_wr_setaddr(cfsp, &ifsun) != 0)
+        return (-1);
+    s = socket(AF_LOCAL, SOCK_SEQPACKET, 0);
+    if (s < 0)
+        return (-1);
+    unlink(cfsp->wrestart_sock);
+    if (bind(s, (struct sockaddr *)&ifsun, sizeof(ifsun)) != 0)
+        goto e0;
+    if (listen(s, 1) != 0)
+        goto e0;
+    flags = fcntl(s, F_GETFL);
+    if (flags < 0 || fcntl(s, F_SETFL, flags | O_NONBLOCK) < 0)
+        goto e0;
+    return (s);
+e0:
+    close(s);
+    return (-1);
+}
+
+/*
+ * Polled from the main loop: if a successor has connected, hand everything
+ * over to it. Returns 1 when done and the process should exit, 0 if nobody
+ * is there or the successor failed before taking over and -1 if it failed
+ * after we have given up the control sockets, in which case we are left in
+ * the slow shutdown mode.
+ */
+int
+rtpp_wrestart_serve(struct rtpp_cfg *cfsp, int lfd)
+{
+    struct rtpp_ctrl_sock *ctrl_sock;
+    struct rtpp_wr_send_args wa;
+    int s;
+
+    s = accept(lfd, NULL, NULL);
+    if (s < 0)
+        return (0);
+    RTPP_LOG(cfsp->glog, RTPP_LOG_INFO, "warm restart: successor has "
+      "connected, handing over control sockets");
+    if (rtpp_wr_settout(s) != 0 || rtpp_wr_send_ctrls(cfsp, s) != 0 ||
+      rtpp_wr_expect(s, RTPP_WR_READY) != 0) {
+        RTPP_ELOG(cfsp->glog, RTPP_LOG_ERR, "warm restart: successor has "
+          "failed to start, aborting");
+        close(s);
+        return (0);
+    }
+
+    /* Freeze the state by stopping command processing, then hand it over */
+    cfsp->slowshutdown = 1;
+    CALL_METHOD(cfsp->rtpp_cmd_cf, dtor);
+    cfsp->rtpp_cmd_cf = NULL;
+    memset(&wa, '\0', sizeof(wa));
+    wa.s = s;
+    CALL_SMETHOD(cfsp->sessions_wrt, foreach, rtpp_wr_sess_send, &wa);
+    if (wa.nfail != 0 || rtpp_wr_send_simple(s, RTPP_WR_END) != 0 ||
+      rtpp_wr_expect(s, RTPP_WR_DONE) != 0) {
+        RTPP_ELOG(cfsp->glog, RTPP_LOG_ERR, "warm restart: failed after "
+          "%d session(s), initiating deorbiting-burn sequence", wa.nsess);
+        CALL_SMETHOD(cfsp->sessions_wrt, foreach, rtpp_wr_sess_reclaim, NULL);
+        close(s);
+        return (-1);
+    }
+    close(s);
+
+    /* Shared objects belong to the successor now, leave them be on exit */
+    for (ctrl_sock = RTPP_LIST_HEAD(cfsp->ctrl_socks);
+      ctrl_sock != NULL; ctrl_sock = RTPP_ITER_NEXT(ctrl_sock)) {
+        if (ctrl_sock->type != RTPC_STDIO)
+            ctrl_sock->handed_off = 1;
+    }
+    cfsp->pid_file = NULL;
+    RTPP_LOG(cfsp->glog, RTPP_LOG_INFO, "warm restart: %d session(s) "
+      "handed over to the successor, exiting", wa.nsess);
+    cfsp->fastshutdown = 1;
+    return (1);
+}
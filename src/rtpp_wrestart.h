@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2026 Sippy Software, Inc., http://www.sippysoft.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+struct rtpp_cfg;
+
+/*
+ * Warm restart: the running process hands its control sockets, sessions
+ * and bound RTP/RTCP sockets over to a freshly started one through a UNIX
+ * socket. The records are exchanged in the native layout, so that both
+ * processes have to agree on RTPP_WR_VERSION.
+ */
+#define RTPP_WR_VERSION 2
+
+/* Snapshot of the per-stream state, native layout as well */
+struct rtpp_stream_snap {
+    struct sockaddr_storage rem_addr;
+    size_t rem_alen;
+    int asymmetric;
+    int weak;
+    int ptime;
+    int untrusted_addr;
+    int latch_mode;
+    int latched;
+    int ssrc_inited;
+    uint32_t ssrc;
+    int seq;
+};
+
+/* Successor side */
+int rtpp_wrestart_attach(struct rtpp_cfg *);
+int rtpp_wrestart_restore(struct rtpp_cfg *, int);
+
+/* Predecessor side */
+int rtpp_wrestart_listen(const struct rtpp_cfg *);
+int rtpp_wrestart_serve(struct rtpp_cfg *, int);